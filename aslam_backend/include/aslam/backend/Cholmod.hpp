@@ -1,12 +1,14 @@
 #ifndef ASLAM_BACKEND_CHOLMOD_HPP
 #define ASLAM_BACKEND_CHOLMOD_HPP
 
+#include <vector>
 #include <cholmod.h>
 #ifndef QRSOLVER_DISABLED
 #include <SuiteSparseQR.hpp>
 #endif
 #include <sm/assert_macros.hpp>
 #include <Eigen/Core>
+#include "util/Instrumentation.hpp"
 
 namespace aslam {
   namespace backend {
@@ -41,6 +43,38 @@ namespace aslam {
        */
       cholmod_factor* analyze(cholmod_sparse* J);
 
+      /**
+       * \brief Wraps the cholmod_analyze_p function with a given fill-reducing ordering
+       *
+       * @param J    the sparse matrix to analyze. J*J' is factorized.
+       * @param perm the ordering of the rows of J
+       *
+       * @return a cholmod factor for the matrix. This must be freed using Cholmod::free()
+       */
+      cholmod_factor* analyze(cholmod_sparse* J, index_t* perm);
+
+      /**
+       * \brief Wraps the cholmod_analyze function without fill-reducing ordering and postordering
+       *
+       * @param A the sparse matrix to analyze. A symmetric A is factorized, otherwise A*A'.
+       *
+       * @return a cholmod factor whose rows keep the order of the rows of A. This must be freed using Cholmod::free()
+       */
+      cholmod_factor* analyzeNatural(cholmod_sparse* A);
+
+      /// \brief Fill-reducing orderings of A*A' for an unsymmetric matrix A.
+      ///        The permutation of the rows of A is written to perm. Returns true for success.
+      bool amd(cholmod_sparse* A, index_t* perm);
+      bool colamd(cholmod_sparse* A, index_t* perm);
+      /// \brief Returns false if CHOLMOD was built without METIS
+      bool nestedDissection(cholmod_sparse* A, index_t* perm);
+
+      /// \brief Constrained fill-reducing orderings of A*A'. Row i of A is ordered after
+      ///        all rows in a constraint set smaller than cmember[i].
+      ///        Returns false for failure or if CHOLMOD was built without the partition module.
+      bool camd(cholmod_sparse* A, index_t* cmember, index_t* perm);
+      bool ccolamd(cholmod_sparse* A, index_t* cmember, index_t* perm);
+
       /// \brief wraps the spqr analyze functions
 #ifndef QRSOLVER_DISABLED
       spqr_factor* analyzeQR(cholmod_sparse* J);
@@ -88,6 +122,13 @@ namespace aslam {
                            double normTol = 1e-8);
 #endif
 
+      /// \brief copy a factor. The copy must be freed using Cholmod::free()
+      cholmod_factor* copy(cholmod_factor* L);
+
+      /// \brief convert a numerical factor in place to a simplicial, packed and monotonic LL' factor.
+      ///        Returns true for success.
+      bool toSimplicialLL(cholmod_factor* L);
+
       cholmod_sparse* aat(cholmod_sparse* A);
 
       /// Scale a matrix by S
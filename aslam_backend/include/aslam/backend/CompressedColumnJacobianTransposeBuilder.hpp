@@ -3,6 +3,9 @@
 
 #include "JacobianBuilder.hpp"
 #include "CompressedColumnMatrix.hpp"
+#include "util/Instrumentation.hpp"
+#include "util/Deadline.hpp"
+#include <atomic>
 
 namespace aslam {
   namespace backend {
@@ -30,8 +33,16 @@ namespace aslam {
       virtual void initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors);
 
       /// \brief build the large, sparse internal Jacobian matrix from the error terms.
+      ///        Throws util::Deadline::Exceeded if the deadline passed before all Jacobians were evaluated.
       virtual void buildSystem(size_t nThreads, bool useMEstimator);
 
+      /// \brief Set the deadline checked before evaluating the Jacobians of every error term in buildSystem()
+      void setDeadline(const util::Deadline& deadline) { _deadline = deadline; }
+
+      /// \brief evaluate the Jacobians of error term i and write them into the matrix.
+      ///        Safe to call concurrently for different error terms.
+      void linearizeErrorTerm(size_t i, bool useMEstimator);
+
       /// \brief Get a view of the transpose of the Jacobian as a cholmod sparse matrix.
       virtual cholmod_sparse getJacobianTransposeView();
 
@@ -71,6 +82,11 @@ namespace aslam {
       /// \brief have we built the Jacobian from the transpose?
       bool _isJacobianBuiltFromJacobianTranspose;
 
+      util::Deadline _deadline;
+
+      /// \brief Did a thread abandon its error terms because the deadline passed?
+      std::atomic<bool> _deadlineExceeded;
+
       template<typename MEMBER_FUNCTION_PTR>
       void setupThreadedJob(MEMBER_FUNCTION_PTR ptr, size_t nThreads, bool useMEstimator);
 
@@ -0,0 +1,60 @@
+/** \file DenseCholeskyLinearSolverOptions.h
+    \brief This file defines the DenseCholeskyLinearSolverOptions class which
+           contains specific options for the dense Cholesky linear solver.
+  */
+
+#ifndef ASLAM_BACKEND_DENSE_CHOLESKY_LINEAR_SOLVER_OPTIONS_H
+#define ASLAM_BACKEND_DENSE_CHOLESKY_LINEAR_SOLVER_OPTIONS_H
+
+#include <cstddef>
+
+namespace aslam {
+  namespace backend {
+
+    /** The class DenseCholeskyLinearSolverOptions contains specific options
+        for the dense Cholesky linear solver.
+        \brief Dense Cholesky linear solver options
+      */
+    class DenseCholeskyLinearSolverOptions {
+    public:
+      /** \name Constructors/destructor
+        @{
+        */
+      /// Default constructor
+      DenseCholeskyLinearSolverOptions();
+      /// Copy constructor
+      DenseCholeskyLinearSolverOptions(const DenseCholeskyLinearSolverOptions&
+        other);
+      /// Assignment operator
+      DenseCholeskyLinearSolverOptions& operator =
+        (const DenseCholeskyLinearSolverOptions& other);
+      /// Destructor
+      virtual ~DenseCholeskyLinearSolverOptions();
+      /** @}
+        */
+
+      /** \name Members
+        @{
+        */
+      /// Factorize with LDLT instead of LLT
+      bool useLdlt;
+      /// If the estimated reciprocal condition number of the factorization is
+      /// below this, or it failed, the system is solved with a rank revealing
+      /// QR decomposition of the normal equations instead
+      double minReciprocalCondition;
+      /// Number of Jacobian rows collected for one rank-k update of the normal
+      /// equations. Only error terms depending on at least half of the columns
+      /// are collected, the others update their blocks directly.
+      size_t rowBlockSize;
+      /// Memory budget in bytes of the normal equations accumulated per thread.
+      /// Fewer threads than requested build the system if it is exceeded.
+      size_t threadMemoryBudget;
+      /** @}
+        */
+
+    };
+
+  }
+}
+
+#endif // ASLAM_BACKEND_DENSE_CHOLESKY_LINEAR_SOLVER_OPTIONS_H
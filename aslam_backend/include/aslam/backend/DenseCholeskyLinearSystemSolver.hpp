@@ -0,0 +1,95 @@
+#ifndef ASLAM_DENSE_CHOLESKY_LINEAR_SYSTEM_SOLVER_HPP
+#define ASLAM_DENSE_CHOLESKY_LINEAR_SYSTEM_SOLVER_HPP
+
+#include "LinearSystemSolver.hpp"
+
+#include "aslam/backend/DenseCholeskyLinearSolverOptions.h"
+
+namespace sm {
+
+  class PropertyTree;
+
+}
+namespace aslam {
+  namespace backend {
+
+    /**
+     * \class DenseCholeskyLinearSystemSolver
+     * \brief Solves the dense normal equations (J^T J + D^2) dx = J^T e with a Cholesky factorization
+     *
+     * The Jacobian is never stored. The Jacobians of every error term are accumulated into the upper triangle of
+     * J^T J right after they are evaluated, block by block or, for error terms depending on most design variables,
+     * by rank-k updates with blocks of Jacobian rows. Each thread accumulates its own copy of the normal
+     * equations, which are summed up afterwards.
+     *
+     * The damping is added to the diagonal of a working copy of J^T J in its lower triangle, which is factorized in
+     * place, so the system can be solved again with another damping without rebuilding it. An ill-conditioned
+     * system is solved with a rank revealing QR decomposition of the normal equations instead.
+     */
+    class DenseCholeskyLinearSystemSolver : public LinearSystemSolver {
+    public:
+      DenseCholeskyLinearSystemSolver(const DenseCholeskyLinearSolverOptions& options = DenseCholeskyLinearSolverOptions());
+      DenseCholeskyLinearSystemSolver(const sm::PropertyTree& config);
+      ~DenseCholeskyLinearSystemSolver() override;
+
+      /// \brief build the system of equations.
+      void buildSystem(size_t nThreads, bool useMEstimator) override;
+
+      /// \brief solve the system storing the solution in outDx and returning true on success.
+      bool solveSystem(Eigen::VectorXd& outDx) override;
+
+      std::string name() const override { return "dense_cholesky"; }
+
+      /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
+      double rhsJtJrhs() override;
+
+      /// \brief The undamped J^T J of the last buildSystem()
+      void getHessian(Eigen::MatrixXd& outH) const;
+
+      /// \brief The number of solves which fell back to QR because the factorization failed or was ill-conditioned
+      size_t numQrFallbacks() const { return _numQrFallbacks; }
+
+      /// Returns the options
+      const DenseCholeskyLinearSolverOptions& getOptions() const;
+      /// Returns the options
+      DenseCholeskyLinearSolverOptions& getOptions();
+      /// Sets the options
+      void setOptions(const DenseCholeskyLinearSolverOptions& options);
+
+    private:
+      /// \brief a method for a thread to evaluate the Jacobians of a set of error terms and accumulate the normal equations
+      void accumulateNormalEquations(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
+
+      /// \brief Add the collected rows of a thread to its normal equations and clear them
+      void flushRowBlock(size_t threadId, size_t numRows);
+
+      /// \brief initialized the matrix structure for the problem with these error terms and errors.
+      void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
+
+      /// \brief The undamped J^T J in the upper triangle. The diagonal and the lower triangle hold the factor of the
+      ///        damped system after solveSystem().
+      Eigen::MatrixXd _H;
+
+      /// \brief The diagonal of the undamped J^T J
+      Eigen::VectorXd _hessianDiagonal;
+
+      /// \brief The normal equations accumulated by the threads other than the first one
+      std::vector<Eigen::MatrixXd> _threadHessians;
+      std::vector<Eigen::VectorXd> _threadRhs;
+
+      /// \brief The Jacobian rows and errors collected by each thread for the next rank-k update
+      std::vector<Eigen::MatrixXd> _threadRowBlocks;
+      std::vector<Eigen::VectorXd> _threadRowBlockErrors;
+
+      size_t _numQrFallbacks;
+
+      /// Options
+      DenseCholeskyLinearSolverOptions _options;
+
+    };
+
+  } // namespace backend
+} // namespace aslam
+
+
+#endif /* ASLAM_DENSE_CHOLESKY_LINEAR_SYSTEM_SOLVER_HPP */
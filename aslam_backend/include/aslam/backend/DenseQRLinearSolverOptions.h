@@ -24,6 +24,8 @@
 #ifndef ASLAM_BACKEND_DENSE_QR_LINEAR_SOLVER_OPTIONS_H
 #define ASLAM_BACKEND_DENSE_QR_LINEAR_SOLVER_OPTIONS_H
 
+#include <cstddef>
+
 namespace aslam {
   namespace backend {
 
@@ -48,6 +50,22 @@ namespace aslam {
       /** @}
         */
 
+      /** \name Members
+        @{
+        */
+      /// Store the Jacobian and factorize it in single precision. The right-hand
+      /// side and the refinement residuals are still accumulated in double.
+      /// Only the dense QR solver has this mode; the sparse solvers store J^T
+      /// in double.
+      bool useSinglePrecision;
+      /// Maximum number of iterative refinement steps recovering double accuracy
+      /// of a single precision solution
+      size_t maxRefinementIterations;
+      /// Refinement stops once the relative norm of a correction drops below this
+      double refinementTolerance;
+      /** @}
+        */
+
     };
 
   }
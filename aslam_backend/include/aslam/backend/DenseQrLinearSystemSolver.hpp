@@ -26,10 +26,16 @@ namespace aslam {
       /// \brief solve the system storing the solution in outDx and returning true on success.
       bool solveSystem(Eigen::VectorXd& outDx) override;
 
-      /// \brief return the Jacobian matrix if available. Null if not available.
+      bool supportsFusedEvaluation() const override { return true; }
+
+      /// \brief return the Jacobian matrix if available. Null if not available,
+      ///        i.e. when the Jacobian is stored in single precision.
       const Matrix* Jacobian() const override;
       const Eigen::MatrixXd& getJacobian() const;
 
+      /// \brief The Jacobian matrix stored in single precision (empty unless useSinglePrecision is set)
+      Eigen::MatrixXf::ConstRowsBlockXpr getJacobianSinglePrecision() const;
+
       std::string name() const override { return "dense_qr";};
       
       /// Returns the options
@@ -48,12 +54,27 @@ namespace aslam {
       /// \brief a method for a thread to evaluate Jacobians
       void evaluateJacobians(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
 
+      /// \brief solve the system with a single precision factorization and refine the solution in double
+      bool solveSystemSinglePrecision(Eigen::VectorXd& outDx);
+
+      /// \brief y = J x with the single precision Jacobian, accumulated in double
+      void rightMultiplySinglePrecision(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const;
+
+      /// \brief y = J^T x with the single precision Jacobian, accumulated in double
+      void leftMultiplySinglePrecision(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const;
+
       /// \brief initialized the matrix structure for the problem with these error terms and errors.
       void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
+      void beginJacobianEvaluation() override;
+      void linearizeErrorTerm(size_t i, bool useMEstimator) override;
 
       /// \brief the dense Jacobian matrix
       DenseMatrix _J;
 
+      /// \brief the dense Jacobian matrix in single precision, used instead of _J if useSinglePrecision is set.
+      ///        With a diagonal conditioner it has _JCols extra rows at the bottom for the diagonal.
+      Eigen::MatrixXf _Jf;
+
       Eigen::VectorXd _truncated_e;
 
       /// Options
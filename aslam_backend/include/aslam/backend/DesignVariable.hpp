@@ -2,6 +2,7 @@
 #define ASLAM_DESIGN_VARIABLE_HPP
 
 #include <sm/Id.hpp>
+#include <cstdint>
 #include <unordered_set>
 #include <set>
 
@@ -103,6 +104,27 @@ namespace aslam {
       /// \brief Computes the minimal distance in tangent space between the current value of the DV and xHat and the jacobian
       void minimalDifferenceAndJacobian(const Eigen::MatrixXd& xHat, Eigen::VectorXd& outDifference, Eigen::MatrixXd& outJacobian) const;
 
+      /// \brief A stamp that changes whenever the value of the design variable changes.
+      ///        Stamps are drawn from one global, monotonically increasing counter, so a
+      ///        stamp is larger than all stamps handed out before it to any design variable.
+      std::uint64_t version() const { return _version; }
+
+      /// \brief Invalidates the caches of the expressions depending on this design variable and bumps its version.
+      ///        Setters call it. Call it after writing to memory the design variable doesn't own, e.g. the
+      ///        external memory of a mapped design variable.
+      void invalidateCache() {
+        _version = nextVersion();
+        if (!_cacheNodes.empty())
+          invalidateCacheImplementation();
+      }
+
+      /// \brief Bumps the stamp of the values expressions depend on which are not design variables, e.g. after
+      ///        setting a constant expression node. All cached expression values are recomputed afterwards.
+      static void invalidateConstants();
+
+      /// \brief The stamp of the last invalidateConstants() call, drawn from the same counter as version()
+      static std::uint64_t constantsVersion();
+
     protected:
       /// \brief what is the number of dimensions of the perturbation variable.
       virtual int minimalDimensionsImplementation() const = 0;
@@ -127,12 +149,6 @@ namespace aslam {
       /// Computes the minimal distance in tangent space between the current value of the DV and xHat and the jacobian
       virtual void minimalDifferenceAndJacobianImplementation(const Eigen::MatrixXd& xHat, Eigen::VectorXd& outDifference, Eigen::MatrixXd& outJacobian) const;
 
-      /// Invalidates the cache
-      void invalidateCache() {
-        if (!_cacheNodes.empty())
-          invalidateCacheImplementation();
-      }
-
     private:
 
       /// Registers a cache expression that has to be reset each time the design variable changes its value
@@ -141,6 +157,9 @@ namespace aslam {
       /// Invalidates the cache
       void invalidateCacheImplementation();
 
+      /// Draws the next version stamp from the global counter
+      static std::uint64_t nextVersion();
+
     private:
       /// \brief The block index used in the optimization routine.
       int _blockIndex;
@@ -157,6 +176,9 @@ namespace aslam {
       /// \brief The scaling of this design variable within the optimization.
       double _scaling;
 
+      /// \brief The version stamp of the current value
+      std::uint64_t _version;
+
       /// \brief Cache expressions that have to be reseted
       std::vector< boost::weak_ptr<CacheInterface> > _cacheNodes;
     };
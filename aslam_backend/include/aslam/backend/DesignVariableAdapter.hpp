@@ -25,6 +25,7 @@ namespace aslam {
 
       virtual ~DesignVariableAdapter();
 
+      /// \brief The wrapped variable. Call invalidateCache() after changing it through the returned reference.
       T& value();
       const T& value() const;
 
@@ -9,6 +9,7 @@
 #include <sm/eigen/NumericalDiff.hpp>
 #include <sm/timing/Timer.hpp>
 #include "MEstimatorPolicies.hpp"
+#include "util/Instrumentation.hpp"
 #include <sm/eigen/matrix_sqrt.hpp>
 #include <sm/timing/NsecTimeUtilities.hpp>
 
@@ -49,6 +50,7 @@ namespace aslam {
       /// \brief update (compute and store) the raw squared error
       ///        After this is called, the _squaredError is filled in with \f$ \mathbf e^T \mathbf R^{-1} \mathbf e \f$
       double updateRawSquaredError() {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::ErrorEvaluation, *this);
         return _squaredError = evaluateErrorImplementation();
       }
 
@@ -289,13 +291,6 @@ namespace aslam {
       /// \brief the inverse uncertainty matrix.
       inverse_covariance_t _sqrtInvR;
 
-      // swap to enable
-      //typedef sm::timing::Timer Timer;
-      // swap to disable
-      typedef sm::timing::DummyTimer Timer;
-
-      Timer _evalJacobianTimer;
-      Timer _buildHessianTimer;
     };
 
   } // namespace backend
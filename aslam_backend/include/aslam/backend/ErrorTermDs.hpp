@@ -103,13 +103,6 @@ namespace aslam {
       /// \brief the inverse uncertainty matrix.
       inverse_covariance_t _sqrtInvR;
 
-      // swap to enable
-      //typedef sm::timing::Timer Timer;
-      // swap to disable
-      typedef sm::timing::DummyTimer Timer;
-
-      Timer _evalJacobianTimer;
-      Timer _buildHessianTimer;
     };
 
   } // namespace backend
@@ -0,0 +1,134 @@
+#ifndef ASLAM_BACKEND_EXPRESSION_ARENA_HPP
+#define ASLAM_BACKEND_EXPRESSION_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    /**
+     * \class ExpressionArena
+     * \brief Allocates expression nodes from large contiguous slabs
+     *
+     * While an arena is current for a thread (see ExpressionArena::Scope), allocateNode()
+     * places every new node together with its shared pointer control block into the
+     * slabs of the arena instead of doing two small heap allocations per node.
+     * Releasing a node only runs its destructor. Every control block holds a shared
+     * reference to the slabs it lives in, so release() and the destruction of the arena
+     * only hand the slabs over to the nodes still using them. The slabs are freed in bulk
+     * once the last of these nodes and the last weak pointer to it (e.g. of an
+     * ExpressionContext) are gone, so nodes may safely outlive the arena.
+     *
+     * The nodes keep the atomic reference counts of boost::shared_ptr, which is the node
+     * handle of the expression API. Creating and finally releasing a node additionally
+     * updates the reference count of its slabs once.
+     *
+     * Memory of released nodes is not reused before the slabs are freed, the arena
+     * is meant for problems that are built once and torn down as a whole.
+     * Allocation is not synchronized: an arena must only be current in one thread
+     * at a time.
+     */
+    class ExpressionArena {
+     private:
+      struct Slabs;
+
+     public:
+      /**
+       * \class Allocator
+       * \brief Standard allocator handing out memory of an arena. Deallocation is a no-op,
+       *        the allocator keeps the slabs alive instead.
+       */
+      template <typename T>
+      class Allocator {
+       public:
+        typedef T value_type;
+        template <typename U> struct rebind { typedef Allocator<U> other; };
+
+        explicit Allocator(const boost::shared_ptr<Slabs> & slabs) : _slabs(slabs) { }
+        template <typename U>
+        Allocator(const Allocator<U> & other) : _slabs(other._slabs) { }
+
+        T * allocate(std::size_t n) {
+          return static_cast<T *>(ExpressionArena::allocate(*_slabs, n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T * /* p */, std::size_t /* n */) { }
+
+        template <typename U>
+        bool operator==(const Allocator<U> & other) const { return _slabs == other._slabs; }
+        template <typename U>
+        bool operator!=(const Allocator<U> & other) const { return _slabs != other._slabs; }
+
+       private:
+        template <typename U> friend class Allocator;
+        boost::shared_ptr<Slabs> _slabs; /// \brief Keeps the slabs alive as long as a node or a weak pointer to it uses them
+      };
+
+      /**
+       * \class Scope
+       * \brief Makes an arena the current arena of the calling thread for its lifetime
+       */
+      class Scope {
+       public:
+        explicit Scope(ExpressionArena & arena);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope & operator=(const Scope &) = delete;
+       private:
+        ExpressionArena * _previous;
+      };
+
+      /// \brief Constructor, slabs will have \p slabSize bytes. Nothing is allocated up front.
+      explicit ExpressionArena(std::size_t slabSize = 1 << 20);
+      ~ExpressionArena();
+
+      ExpressionArena(const ExpressionArena &) = delete;
+      ExpressionArena & operator=(const ExpressionArena &) = delete;
+
+      /// \brief Allocate \p size bytes aligned to \p alignment
+      void * allocate(std::size_t size, std::size_t alignment);
+
+      /// \brief An allocator for this arena
+      template <typename T>
+      Allocator<T> allocator() { return Allocator<T>(_slabs); }
+
+      /// \brief Hand the current slabs over to the nodes using them and start with new ones.
+      ///        The old slabs are freed as soon as their last node is released.
+      void release();
+
+      /// \brief Number of slabs currently in use by this arena
+      std::size_t numSlabs() const;
+
+      /// \brief Number of bytes handed out from the current slabs
+      std::size_t numBytesAllocated() const;
+
+      /// \brief The arena current for the calling thread, nullptr if there is none
+      static ExpressionArena * current();
+
+     private:
+      static void * allocate(Slabs & slabs, std::size_t size, std::size_t alignment);
+
+      std::size_t _slabSize;
+      boost::shared_ptr<Slabs> _slabs;
+    };
+
+    /// \brief Create a node of type \p T. The node is placed into the current arena of the
+    ///        calling thread if there is one and allocated on the heap otherwise.
+    ///        Expression factories should use makeNode() (ExpressionContext.hpp) instead.
+    template <typename T, typename ... Args>
+    boost::shared_ptr<T> allocateNode(Args && ... args) {
+      ExpressionArena * arena = ExpressionArena::current();
+      if (arena == nullptr)
+        return boost::shared_ptr<T>(new T(std::forward<Args>(args)...));
+      return boost::allocate_shared<T>(arena->allocator<T>(), std::forward<Args>(args)...);
+    }
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_EXPRESSION_ARENA_HPP */
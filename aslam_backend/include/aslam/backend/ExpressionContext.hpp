@@ -0,0 +1,261 @@
+#ifndef ASLAM_BACKEND_EXPRESSION_CONTEXT_HPP
+#define ASLAM_BACKEND_EXPRESSION_CONTEXT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <Eigen/Core>
+
+#include "ExpressionArena.hpp"
+
+namespace aslam {
+  namespace backend {
+
+    /// \brief Whether nodes of type \p T may be shared by an ExpressionContext.
+    ///        Nodes whose value can be changed by one of their users (e.g. settable constants)
+    ///        must specialize this to std::false_type. Nodes keeping per-evaluation scratch
+    ///        state in members must do so too: the error terms sharing them may be evaluated
+    ///        by different threads. A value cached per state (see internal::ValueCacheStamp) is fine.
+    template <typename T>
+    struct IsShareableNode : std::true_type { };
+
+    namespace detail {
+
+      /// \brief How a node constructor argument takes part in the structural key of a node.
+      ///        Arguments without a specialization (e.g. functors) make the node unshareable.
+      template <typename T, typename Enable = void>
+      struct NodeKey {
+        static constexpr bool keyable = false;
+      };
+
+      /// \brief Numbers and enums are compared by value
+      template <typename T>
+      struct NodeKey<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type> {
+        static constexpr bool keyable = true;
+        typedef T type;
+        static type make(const T & v) { return v; }
+        static bool equal(const type & a, const type & b) { return a == b; }
+        static void hash(std::size_t & seed, const type & v) { boost::hash_combine(seed, v); }
+      };
+
+      /// \brief Child nodes and other shared objects are compared by identity
+      template <typename T>
+      struct NodeKey< boost::shared_ptr<T> > {
+        static constexpr bool keyable = true;
+        typedef const void * type;
+        static type make(const boost::shared_ptr<T> & v) { return v.get(); }
+        static bool equal(type a, type b) { return a == b; }
+        static void hash(std::size_t & seed, type v) { boost::hash_combine(seed, v); }
+      };
+
+      template <typename T>
+      struct NodeKey<T *> {
+        static constexpr bool keyable = true;
+        typedef const void * type;
+        static type make(const T * v) { return v; }
+        static bool equal(type a, type b) { return a == b; }
+        static void hash(std::size_t & seed, type v) { boost::hash_combine(seed, v); }
+      };
+
+      /// \brief Constant vectors and matrices are compared coefficient-wise
+      template <typename T>
+      struct NodeKey<T, typename std::enable_if<std::is_base_of<Eigen::DenseBase<T>, T>::value>::type> {
+        static constexpr bool keyable = true;
+        typedef typename T::PlainObject type;
+        static type make(const T & v) { return v; }
+        static bool equal(const type & a, const type & b) { return a.rows() == b.rows() && a.cols() == b.cols() && a == b; }
+        static void hash(std::size_t & seed, const type & v) {
+          boost::hash_combine(seed, v.rows());
+          boost::hash_combine(seed, v.cols());
+          for (typename type::Index i = 0; i < v.size(); ++i)
+            boost::hash_combine(seed, v.data()[i]);
+        }
+      };
+
+      template <typename ... Args>
+      struct AllKeyable : std::true_type { };
+      template <typename First, typename ... Rest>
+      struct AllKeyable<First, Rest ...> : std::integral_constant<bool, NodeKey<First>::keyable && AllKeyable<Rest ...>::value> { };
+
+      /// \brief Hashing and comparison of key tuples, element by element
+      template <std::size_t I, std::size_t N>
+      struct KeyTupleOps {
+        template <typename Tuple>
+        static void hash(std::size_t & seed, const Tuple & key) {
+          typedef typename std::tuple_element<I, Tuple>::type Element;
+          NodeKey<Element>::hash(seed, std::get<I>(key));
+          KeyTupleOps<I + 1, N>::hash(seed, key);
+        }
+        template <typename Tuple>
+        static bool equal(const Tuple & a, const Tuple & b) {
+          typedef typename std::tuple_element<I, Tuple>::type Element;
+          return NodeKey<Element>::equal(std::get<I>(a), std::get<I>(b)) && KeyTupleOps<I + 1, N>::equal(a, b);
+        }
+      };
+      template <std::size_t N>
+      struct KeyTupleOps<N, N> {
+        template <typename Tuple>
+        static void hash(std::size_t & /* seed */, const Tuple & /* key */) { }
+        template <typename Tuple>
+        static bool equal(const Tuple & /* a */, const Tuple & /* b */) { return true; }
+      };
+
+    } // namespace detail
+
+    /**
+     * \class ExpressionContext
+     * \brief Shares structurally identical expression nodes (hash-consing)
+     *
+     * While a context is current for a thread (see ExpressionContext::Scope), makeNode()
+     * hashes every new node by its type and its constructor arguments: child nodes by
+     * identity and constants by value. If a node with the same key is still alive, it is
+     * returned instead of creating a new one. Rebuilding the same subexpression several
+     * times therefore stores it once, which saves memory and allocations. Nodes caching
+     * their value (e.g. the products and inverses of rotations and transformations) are
+     * evaluated once per state of their design variables, however many trees use them,
+     * e.g. the T_world_cam.inverse() of all reprojection errors of one camera.
+     *
+     * Shared nodes are used by several error terms at once, which may be evaluated
+     * concurrently. Nodes which are not safe to share (see IsShareableNode) and nodes whose
+     * arguments can't be compared (e.g. functors) are always created anew, and so are the
+     * nodes built on top of them.
+     * The context only keeps weak references, expired entries are purged as the table grows.
+     * They stay valid for nodes allocated from an ExpressionArena, even after its release().
+     * The context is not synchronized: it must only be current in one thread at a time.
+     */
+    class ExpressionContext {
+     public:
+      /**
+       * \class Scope
+       * \brief Makes a context the current context of the calling thread for its lifetime
+       */
+      class Scope {
+       public:
+        explicit Scope(ExpressionContext & context);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope & operator=(const Scope &) = delete;
+       private:
+        ExpressionContext * _previous;
+      };
+
+      ExpressionContext();
+      ~ExpressionContext();
+
+      ExpressionContext(const ExpressionContext &) = delete;
+      ExpressionContext & operator=(const ExpressionContext &) = delete;
+
+      /// \brief Return the live node of type \p T constructed from equal arguments
+      ///        or create and register a new one
+      template <typename T, typename ... Args>
+      boost::shared_ptr<T> getOrCreate(Args && ... args);
+
+      /// \brief Number of node requests answered by this context
+      std::size_t numLookups() const { return _numLookups; }
+
+      /// \brief Number of node requests answered with an existing node
+      std::size_t numHits() const { return _numHits; }
+
+      /// \brief Number of registered nodes which are still alive
+      std::size_t numUniqueNodes() const;
+
+      /// \brief Fraction of the node requests answered with an existing node
+      double deduplicationRatio() const { return _numLookups == 0 ? 0.0 : double(_numHits) / double(_numLookups); }
+
+      /// \brief Forget all registered nodes and reset the statistics
+      void clear();
+
+      /// \brief Drop the entries of released nodes
+      void purge();
+
+      /// \brief The context current for the calling thread, nullptr if there is none
+      static ExpressionContext * current();
+
+     private:
+      struct Entry {
+        virtual ~Entry() { }
+        boost::weak_ptr<void> node;
+      };
+
+      template <typename T, typename Key>
+      struct TypedEntry : public Entry {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        explicit TypedEntry(const Key & key) : key(key) { }
+        Key key;
+      };
+
+      typedef std::unordered_multimap<std::size_t, std::unique_ptr<Entry> > table_t;
+
+      void registerEntry(std::size_t hash, std::unique_ptr<Entry> entry);
+
+      table_t _table;
+      std::size_t _purgeThreshold;
+      std::size_t _numLookups = 0;
+      std::size_t _numHits = 0;
+    };
+
+    template <typename T, typename ... Args>
+    boost::shared_ptr<T> ExpressionContext::getOrCreate(Args && ... args) {
+      typedef std::tuple<typename detail::NodeKey<typename std::decay<Args>::type>::type ...> key_t;
+      typedef TypedEntry<T, key_t> entry_t;
+
+      const key_t key(detail::NodeKey<typename std::decay<Args>::type>::make(args) ...);
+      std::size_t hash = typeid(entry_t).hash_code();
+      detail::KeyTupleOps<0, sizeof...(Args)>::hash(hash, key);
+
+      ++_numLookups;
+      auto range = _table.equal_range(hash);
+      for (auto it = range.first; it != range.second; ++it) {
+        const entry_t * entry = dynamic_cast<const entry_t *>(it->second.get());
+        if (entry == nullptr || !detail::KeyTupleOps<0, sizeof...(Args)>::equal(entry->key, key))
+          continue;
+        // The children of a live node are alive as well, so their addresses can't have been reused
+        boost::shared_ptr<void> node = entry->node.lock();
+        if (node) {
+          ++_numHits;
+          return boost::static_pointer_cast<T>(node);
+        }
+      }
+
+      boost::shared_ptr<T> node = allocateNode<T>(std::forward<Args>(args)...);
+      std::unique_ptr<Entry> entry(new entry_t(key));
+      entry->node = node;
+      registerEntry(hash, std::move(entry));
+      return node;
+    }
+
+    namespace detail {
+      template <typename T, typename ... Args>
+      boost::shared_ptr<T> makeNode(std::true_type /* shareable */, Args && ... args) {
+        ExpressionContext * context = ExpressionContext::current();
+        if (context == nullptr)
+          return allocateNode<T>(std::forward<Args>(args)...);
+        return context->getOrCreate<T>(std::forward<Args>(args)...);
+      }
+      template <typename T, typename ... Args>
+      boost::shared_ptr<T> makeNode(std::false_type /* shareable */, Args && ... args) {
+        return allocateNode<T>(std::forward<Args>(args)...);
+      }
+    } // namespace detail
+
+    /// \brief Create a node of type \p T, or return an equal live node of the current
+    ///        ExpressionContext of the calling thread if \p T is shareable.
+    ///        New nodes are allocated with allocateNode().
+    template <typename T, typename ... Args>
+    boost::shared_ptr<T> makeNode(Args && ... args) {
+      typedef std::integral_constant<bool, IsShareableNode<T>::value && detail::AllKeyable<typename std::decay<Args>::type ...>::value> shareable_t;
+      return detail::makeNode<T>(shareable_t(), std::forward<Args>(args)...);
+    }
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_EXPRESSION_CONTEXT_HPP */
@@ -22,6 +22,9 @@ namespace aslam {
             
             /// \brief should the optimizer revert on failure? You should probably return true
             bool revertOnFailure() override;
+
+            /// \brief Gauss-Newton rebuilds the system at every step
+            bool linearizesEveryStep() const override;
             
             /// \brief print the current state to a stream (no newlines).
             std::ostream & printState(std::ostream & out) const override;
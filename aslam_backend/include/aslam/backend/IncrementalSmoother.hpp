@@ -0,0 +1,195 @@
+#ifndef ASLAM_BACKEND_INCREMENTAL_SMOOTHER_HPP
+#define ASLAM_BACKEND_INCREMENTAL_SMOOTHER_HPP
+
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <aslam/Exceptions.hpp>
+#include <aslam/backend/DesignVariable.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+
+namespace sm {
+  class ConstPropertyTree;
+}
+
+namespace aslam {
+  namespace backend {
+
+    struct IncrementalSmootherOptions
+    {
+      IncrementalSmootherOptions();
+      IncrementalSmootherOptions(const sm::ConstPropertyTree& config);
+
+      /// \brief Design variables whose update since their linearization exceeds this (max. absolute entry) are relinearized
+      double relinearizeThreshold = 0.1;
+      /// \brief Check for design variables to relinearize every this many updates. 0 disables relinearization.
+      int relinearizeInterval = 10;
+      /// \brief Refactor with a new fill-reducing ordering every this many updates. 0 disables reordering.
+      int reorderInterval = 100;
+      /// \brief The back substitution doesn't propagate changes of the update smaller than this
+      double wildfireThreshold = 0.0;
+      bool useMEstimator = true;
+      bool verbose = false;
+    };
+
+    /**
+     * \class IncrementalSmoother
+     * \brief Incremental smoothing and mapping (iSAM) on error terms and design variables
+     *
+     * Keeps the square root information matrix R and the right hand side d of the problem linearized at a
+     * linearization point per design variable. The rows of new error terms are rotated into R with Givens
+     * rotations, which touches only the rows of R reached by the new rows and their fill-in. The estimate is the
+     * linearization point updated by the solution of R delta = d. The back substitution only recomputes the rows
+     * which changed or depend on a changed entry of delta, so appending to a chain costs the same regardless of its length.
+     *
+     * Every relinearizeInterval updates, the design variables whose delta exceeds relinearizeThreshold get their
+     * estimate as new linearization point and the error terms depending on them are linearized again. All other
+     * error terms keep their linearization. Only the rows of R from the first column of these error terms on
+     * change: they are recomputed with a sparse Cholesky factorization of their Schur complement, and the rows
+     * above keep their Givens rotations. Reordering every reorderInterval updates refactors all of R in one
+     * batch Cholesky factorization. The ordering is a fill-reducing ordering of the design variable graph with the design variables of the
+     * latest update last, where they are most likely touched by the next error terms.
+     *
+     * Design variables and error terms are not owned. The design variables must be active, their block
+     * indices and column bases are set by the smoother. After every update they hold the estimate.
+     */
+    class IncrementalSmoother
+    {
+     public:
+      SM_DEFINE_EXCEPTION(Exception, aslam::Exception);
+      typedef IncrementalSmootherOptions Options;
+
+      /// \brief The work done by the last update
+      struct UpdateStatistics
+      {
+        size_t numNewDesignVariables = 0;
+        size_t numNewErrorTerms = 0;
+        /// \brief Error terms linearized, including the new ones
+        size_t numLinearizedErrorTerms = 0;
+        size_t numRelinearizedDesignVariables = 0;
+        size_t numGivensRotations = 0;
+        /// \brief Rows of R recomputed by a Cholesky factorization
+        size_t numRefactoredRows = 0;
+        /// \brief Rows of R solved in the back substitution
+        size_t numBackSubstitutedRows = 0;
+        /// \brief Were rows of R refactored after relinearizing or reordering?
+        bool refactored = false;
+        bool reordered = false;
+      };
+
+      IncrementalSmoother(const Options& options = Options());
+      IncrementalSmoother(const sm::ConstPropertyTree& config);
+      ~IncrementalSmoother();
+
+      /// \brief Add design variables and error terms and update the estimate.
+      ///        The error terms may only depend on design variables added in this or previous updates.
+      void update(const std::vector<DesignVariable*>& newDesignVariables, const std::vector<ErrorTerm*>& newErrorTerms);
+
+      /// \brief Relinearize all design variables exceeding the threshold, optionally reorder, and refactor
+      void relinearize(bool reorder = false);
+
+      size_t numDesignVariables() const { return _variables.size(); }
+      size_t numErrorTerms() const { return _factors.size(); }
+      /// \brief The dimension of the linear system
+      size_t numColumns() const { return _R.size(); }
+      /// \brief The number of non-zero entries of R
+      size_t numNonZeros() const;
+
+      /// \brief The update of design variable i from its linearization point
+      Eigen::VectorXd delta(size_t i) const;
+
+      /// \brief The squared error of the linearized system at the linearization point plus delta
+      double linearizedSquaredError() const;
+
+      const UpdateStatistics& lastUpdate() const { return _lastUpdate; }
+
+      const Options& getOptions() const { return _options; }
+      Options& options() { return _options; }
+      void setOptions(const Options& options) { _options = options; }
+
+     private:
+      /// \brief The sorted (column, value) entries of a row
+      typedef std::vector<std::pair<int, double> > SparseRow;
+
+      struct Variable {
+        DesignVariable* dv;
+        int dim;
+        /// \brief The first column in the current ordering
+        int column;
+        Eigen::MatrixXd linearizationPoint;
+      };
+
+      struct Factor {
+        ErrorTerm* errorTerm;
+        /// \brief The active design variables of the error term
+        std::vector<size_t> variables;
+        /// \brief The weighted Jacobian at the linearization point, one column block per entry of variables
+        Eigen::MatrixXd jacobian;
+        /// \brief Minus the weighted error at the linearization point
+        Eigen::VectorXd rhs;
+      };
+
+      void addVariable(DesignVariable* dv);
+      size_t addFactor(ErrorTerm* errorTerm);
+
+      /// \brief Linearize factors at the linearization points of their design variables
+      void linearize(const std::vector<size_t>& factors);
+
+      /// \brief Move the linearization points of the design variables exceeding the threshold to their estimates
+      ///        and linearize their factors again. Returns the linearized factors.
+      std::vector<size_t> relinearizeVariables();
+
+      /// \brief Rotate the rows of a factor into R
+      void addFactorRows(const Factor& factor);
+      void addRow(SparseRow& row, double rhs);
+      void givens(int k, SparseRow& row, double& rhs);
+
+      /// \brief Recompute R from the first column of the given relinearized factors on, or all of R when reordering
+      void refactor(bool reorder, const std::vector<size_t>& factors);
+      void computeOrdering();
+      /// \brief Recompute the rows of R and d from firstColumn on with a Cholesky factorization of the Schur
+      ///        complement of the rows above. Returns false if it is not positive definite.
+      bool factorize(int firstColumn);
+      /// \brief Recompute R by rotating the rows of all factors into it
+      void rotateAllFactors();
+
+      /// \brief Solve R delta = d for the dirty rows and update the estimates of the design variables
+      void backSubstitute();
+
+      void setEstimate(size_t variable);
+
+      Options _options;
+
+      std::vector<Variable> _variables;
+      std::unordered_map<const DesignVariable*, size_t> _variableIndices;
+      std::vector<Factor> _factors;
+      /// \brief The factors depending on each design variable
+      std::vector<std::vector<size_t> > _variableFactors;
+      /// \brief The design variables of each column
+      std::vector<size_t> _columnVariables;
+
+      /// \brief The rows of R, the first entry of a non-empty row is on the diagonal
+      std::vector<SparseRow> _R;
+      /// \brief The rows of R with an entry in each column, above the diagonal
+      std::vector<std::vector<int> > _columnRows;
+      std::vector<double> _d;
+      std::vector<double> _delta;
+      /// \brief The squared residual of the rows eliminated completely. Plus the squared norm of d it is
+      ///        the squared norm of the right hand sides of all factors.
+      double _residual;
+      /// \brief Rows whose entry of delta needs to be recomputed
+      std::set<int> _dirtyRows;
+
+      /// \brief The design variables of the latest update, ordered last when reordering
+      std::vector<size_t> _recentVariables;
+      size_t _numUpdates;
+      UpdateStatistics _lastUpdate;
+    };
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_INCREMENTAL_SMOOTHER_HPP */
@@ -93,6 +93,17 @@ namespace aslam {
         return this->empty();
       }
 
+      /// \brief Enable or disable multiplying small fixed-size chain rule matrices with
+      ///        fully unrolled fixed-size kernels (enabled by default)
+      void setUseFixedSizeChainRule(const bool enable) {
+        this->setUseFixedSizeKernels(enable);
+      }
+
+      /// \brief Are fixed-size kernels used for small fixed-size chain rule matrices?
+      bool useFixedSizeChainRule() const {
+        return this->useFixedSizeKernels();
+      }
+
       /// \brief Const getter for the chain rule matrix
       template<int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic>
       EIGEN_ALWAYS_INLINE MatrixStack::ConstMap<Rows, Cols> chainRuleMatrix() const {
@@ -33,8 +33,21 @@ namespace aslam {
           std::ostream & printState(std::ostream & out) const override;
           bool requiresAugmentedDiagonal() const override;
           std::string name() const override { return "levenberg_marquardt"; }
+
+          /// \brief The number of damping values tried per iteration. With k > 1 the damped system is solved for
+          ///        lambda * f^i, i = -(k-1)/2 ... k/2, where f is the speculativeLambdaFactor. The steps are tried
+          ///        through the optimizer and the one with the lowest cost is returned. 1 (the default) disables it.
+          ///        The optimizer reuses the cost of the returned step if it was tried last, which is the case
+          ///        whenever the same damping as in the previous iteration wins.
+          void setNumSpeculativeLambdas(int numLambdas);
+          int getNumSpeculativeLambdas() const { return _numSpeculativeLambdas; }
+
+          void setSpeculativeLambdaFactor(double factor);
+          double getSpeculativeLambdaFactor() const { return _speculativeLambdaFactor; }
         private:
           double getLmRho(const Eigen::VectorXd & dx);
+          /// \brief Solve for several damping values around _lambda and pick the best step
+          bool solveSpeculatively(int nThreads, Eigen::VectorXd& outDx);
           double _lambdaInit;
           double _gammaInit;
           double _betaInit;
@@ -46,6 +59,11 @@ namespace aslam {
           double _beta;
           int _p;
           double _mu;
+
+          int _numSpeculativeLambdas;
+          double _speculativeLambdaFactor;
+          /// \brief The index of the damping value which won the last speculative iteration
+          int _lastBestSpeculativeLambda = 0;
         };
         
     } // namespace backend
@@ -1,10 +1,13 @@
 #ifndef ASLAM_BACKEND_LINEAR_SYSTEM_SOLVER_HPP
 #define ASLAM_BACKEND_LINEAR_SYSTEM_SOLVER_HPP
 
+#include <atomic>
 #include <vector>
 #include <Eigen/Core>
 #include <boost/function.hpp>
 #include <sm/assert_macros.hpp>
+#include "util/CommonDefinitions.hpp"
+#include "util/Deadline.hpp"
 
 namespace aslam {
   namespace backend {
@@ -28,6 +31,24 @@ namespace aslam {
       /// \brief Evaluate the error using nThreads.
       double evaluateError(size_t nThreads, bool useMEstimator, callback::Manager * callback = nullptr);
 
+      /// \brief Evaluate the error and, in the same pass over the error terms, the Jacobians of the linear system.
+      ///        The next call to buildSystem() with the same useMEstimator skips evaluating the Jacobians.
+      ///        The Jacobians are weighted before the RESIDUALS_UPDATED callback is issued.
+      ///        Falls back to evaluateError() if the solver doesn't support it.
+      double evaluateErrorAndJacobians(size_t nThreads, bool useMEstimator, callback::Manager * callback = nullptr);
+
+      /// \brief Does this solver evaluate the Jacobians in the error pass in evaluateErrorAndJacobians()?
+      virtual bool supportsFusedEvaluation() const { return false; }
+
+      /// \brief Forget the Jacobians of the last evaluateErrorAndJacobians(). Call it when the state changed since.
+      void discardEvaluatedJacobians() { _jacobiansEvaluated = false; }
+
+      /// \brief The number of error passes which evaluated the Jacobians too
+      size_t numFusedEvaluations() const { return _numFusedEvaluations; }
+
+      /// \brief The number of calls to buildSystem() which reused the Jacobians of a fused error pass
+      size_t numSavedJacobianPasses() const { return _numSavedJacobianPasses; }
+
       /// \brief initialized the matrix structure for the problem with these error terms and errors.
       void initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner);
 
@@ -77,6 +98,11 @@ namespace aslam {
         return _acceptConstantErrorTerms;
       }
       void setAcceptConstantErrorTerms(bool acceptConstantErrorTerms);
+
+      /// \brief Abandon evaluating errors and Jacobians once \p deadline passed. They then throw util::Deadline::Exceeded.
+      ///        The deadline is checked before every error term, a running factorization isn't interrupted.
+      void setDeadline(const util::Deadline& deadline) { _deadline = deadline; }
+      const util::Deadline& getDeadline() const { return _deadline; }
     protected:
       /// \brief initialized the matrix structure for the problem with these error terms and errors.
       virtual void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) = 0;
@@ -88,7 +114,32 @@ namespace aslam {
       /// \brief a function for one thread to evaluate a set of error terms.
       void evaluateErrors(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
 
+      /// \brief a function for one thread to evaluate the errors and Jacobians of a set of error terms.
+      void evaluateErrorsAndJacobians(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
+
+      /// \brief Prepare the Jacobian storage before the error terms are linearized in evaluateErrorAndJacobians().
+      virtual void beginJacobianEvaluation() { }
+
+      /// \brief Evaluate the weighted Jacobians of error term i and write them into the linear system.
+      ///        Called concurrently for different error terms by solvers which support fused evaluation.
+      virtual void linearizeErrorTerm(size_t i, bool useMEstimator);
+
+      /// \brief To be called by buildSystem(). Returns true if the Jacobians were already evaluated
+      ///        by evaluateErrorAndJacobians() with this useMEstimator and consumes them.
+      bool takeEvaluatedJacobians(bool useMEstimator);
+
+      /// \brief To be checked before every error term in jobs run by setupThreadedJob().
+      ///        Returns true if the deadline passed and the job should abandon its range.
+      bool deadlinePassed() {
+        if (UNLIKELY(_deadline.isExceeded())) {
+          _deadlineExceeded = true;
+          return true;
+        }
+        return false;
+      }
+
       /// \brief a function to split a multi-threaded job across all error term indices.
+      ///        Throws util::Deadline::Exceeded if a job abandoned its range because the deadline passed.
       void setupThreadedJob(boost::function<void(size_t, size_t, size_t, bool)> job, size_t nThreads, bool useMEstimator);
 
       /// \brief Event hook to handle new value for the acceptConstantErrorTerms property
@@ -120,6 +171,23 @@ namespace aslam {
 
       /// \brief The number of columns in the Jacobian matrix
       size_t _JCols;
+
+      /// \brief The deadline for evaluating errors and Jacobians
+      util::Deadline _deadline;
+
+    private:
+      double evaluateErrorTerms(size_t nThreads, bool useMEstimator, callback::Manager * callback, bool evaluateJacobians);
+
+      /// \brief Were the Jacobians evaluated with the last error and not consumed by buildSystem() yet?
+      bool _jacobiansEvaluated;
+      /// \brief The M-estimator setting of the evaluated Jacobians
+      bool _jacobiansUseMEstimator;
+
+      size_t _numFusedEvaluations;
+      size_t _numSavedJacobianPasses;
+
+      /// \brief Did a job of the current threaded job abandon its range?
+      std::atomic<bool> _deadlineExceeded;
     };
 
   } // namespace backend
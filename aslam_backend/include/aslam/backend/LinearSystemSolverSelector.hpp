@@ -0,0 +1,175 @@
+#ifndef ASLAM_BACKEND_LINEAR_SYSTEM_SOLVER_SELECTOR_HPP
+#define ASLAM_BACKEND_LINEAR_SYSTEM_SOLVER_SELECTOR_HPP
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <sm/assert_macros.hpp>
+
+namespace sm {
+  class ConstPropertyTree;
+}
+
+namespace aslam {
+  namespace backend {
+
+    class DesignVariable;
+    class ErrorTerm;
+    class LinearSystemSolver;
+
+    /// \brief What the LinearSystemSolverSelector knows about a linear system before choosing a backend
+    struct LinearSystemStructure
+    {
+      /// \brief The dimensions of the Jacobian
+      size_t numRows = 0;
+      size_t numCols = 0;
+      size_t numDesignVariables = 0;
+      size_t numErrorTerms = 0;
+      /// \brief The number of structurally nonzero entries of the Jacobian
+      size_t jacobianNnz = 0;
+      /// \brief The dimensions of the design variable blocks
+      int minBlockDimension = 0;
+      int maxBlockDimension = 0;
+      double meanBlockDimension = 0.0;
+      /// \brief The flops for forming J^T J from the sparse Jacobian
+      double normalEquationsFlops = 0.0;
+      /// \brief The nonzeros in the lower triangle of the Cholesky factor of J^T J and the flops to compute it,
+      ///        estimated from a symbolic analysis of the design variable graph with AMD
+      double factorNnz = 0.0;
+      double factorFlops = 0.0;
+      /// \brief Fewer rows than columns or a design variable observed by fewer error rows than it has dimensions.
+      ///        J^T J is then singular, unless a damping term is added.
+      bool rankDeficiencyHint = false;
+
+      /// \brief The fraction of nonzero entries of the lower triangle of the factor, 1 for a dense factor
+      double factorDensity() const { return numCols ? factorNnz / (0.5 * numCols * (numCols + 1.0)) : 0.0; }
+    };
+
+    std::ostream& operator<<(std::ostream& out, const LinearSystemStructure& structure);
+
+    struct LinearSystemSolverSelectorOptions
+    {
+      LinearSystemSolverSelectorOptions();
+      LinearSystemSolverSelectorOptions(const sm::ConstPropertyTree& config);
+
+      /// \brief Use this backend instead of selecting one. One of "auto", "sparse_cholesky", "block_cholesky",
+      ///        "sparse_qr", "dense_cholesky" and "dense_qr".
+      std::string backend = "auto";
+      /// \brief The cost of a flop in a dense, BLAS backed factorization relative to a flop in CHOLMOD's
+      ///        sparse factorization
+      double denseFlopCost = 0.25;
+      /// \brief The cost of a call to a sparse solver and of every nonzero of the Jacobian and of the factor it
+      ///        handles, in flops. This overhead dominates for small problems.
+      double sparseOverhead = 2e5;
+      double sparseNonzeroCost = 20.0;
+      /// \brief The cost of a flop in the block Cholesky solver for design variable blocks of dimension 1. The
+      ///        overhead per block is amortized over larger blocks, so it is divided by the mean block dimension.
+      double blockCholeskyFlopCost = 3.0;
+      /// \brief The dense solvers are not considered if their Jacobian or normal equations need more memory than
+      ///        this, in bytes
+      size_t maxDenseMemory = size_t(1) << 30;
+      /// \brief Time every candidate backend on the first system of a structure and use the fastest
+      bool calibrate = false;
+      /// \brief The number of builds and solves timed per candidate when calibrating
+      int calibrationRuns = 1;
+      bool verbose = false;
+    };
+
+    /**
+     * \class LinearSystemSolverSelector
+     * \brief Selects the linear system solver backend from the structure of the problem
+     *
+     * Set it as Optimizer2Options::linearSystemSolverSelector instead of a Optimizer2Options::linearSystemSolver.
+     * Every time the optimizer initializes the matrix structure, the selector inspects the dimensions of the
+     * Jacobian, its nonzeros, the dimensions of the design variable blocks, the fill of the Cholesky factor from a
+     * symbolic analysis of the design variable graph and whether J^T J is likely rank deficient, and returns the
+     * backend with the lowest estimated cost:
+     *  - dense_cholesky or dense_qr for small or dense problems, where a dense factorization is much faster than a
+     *    sparse one,
+     *  - sparse_cholesky or block_cholesky for sparse problems, depending on the block dimensions,
+     *  - a rank revealing QR solver if J^T J is likely rank deficient.
+     *
+     * The built-in cost model can be replaced with setCostModel(), or measured on the actual system with
+     * LinearSystemSolverSelectorOptions::calibrate. The backends are kept between selections so that they can
+     * reuse their structure if the problem didn't change.
+     */
+    class LinearSystemSolverSelector
+    {
+     public:
+      SM_DEFINE_EXCEPTION(Exception, std::runtime_error);
+
+      typedef LinearSystemSolverSelectorOptions Options;
+
+      /// \brief Returns the estimated cost of solving a system of this structure with the named backend, in
+      ///        arbitrary but consistent units. A negative cost excludes the backend.
+      typedef boost::function<double(const LinearSystemStructure&, const std::string&)> CostModel;
+
+      /// \brief The last selection
+      struct Decision
+      {
+        std::string backend;
+        /// \brief Why it was chosen
+        std::string reason;
+        LinearSystemStructure structure;
+        /// \brief The estimated costs of the candidates or, if calibrated, their times in seconds
+        std::map<std::string, double> costs;
+      };
+
+      LinearSystemSolverSelector(const Options& options = Options());
+      LinearSystemSolverSelector(const sm::ConstPropertyTree& config);
+      virtual ~LinearSystemSolverSelector();
+
+      /// \brief Analyze the structure of the system and return the backend to use. The matrix structure of the
+      ///        backend is not initialized yet.
+      /// \param requiresAugmentedDiagonal Will the trust region policy add a damping term to the diagonal?
+      ///        sparse_qr is not a candidate then, as it doesn't support one.
+      boost::shared_ptr<LinearSystemSolver> select(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors,
+                                                   bool requiresAugmentedDiagonal);
+
+      /// \brief The structure of the system with these design variables and error terms
+      static LinearSystemStructure analyze(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors);
+
+      /// \brief The built-in estimate of the cost of solving a system of this structure with the named backend
+      double estimateCost(const LinearSystemStructure& structure, const std::string& backend) const;
+
+      /// \brief Replace the built-in cost model. An empty function restores it.
+      void setCostModel(const CostModel& costModel) { _costModel = costModel; }
+
+      /// \brief The backend with this name, created on first use
+      boost::shared_ptr<LinearSystemSolver> getSolver(const std::string& backend);
+
+      /// \brief Use this instance for the named backend, e.g. to set its options
+      void setSolver(const std::string& backend, const boost::shared_ptr<LinearSystemSolver>& solver);
+
+      const Decision& lastDecision() const { return _decision; }
+
+      const Options& getOptions() const { return _options; }
+      Options& options() { return _options; }
+      void setOptions(const Options& options) { _options = options; }
+
+      /// \brief The names of all backends which may be selected
+      static std::vector<std::string> backends();
+
+     private:
+      /// \brief Time the build and solve of every candidate on the current state
+      void calibrate(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors,
+                     bool requiresAugmentedDiagonal, const std::vector<std::string>& candidates);
+
+      Options _options;
+      CostModel _costModel;
+      std::map<std::string, boost::shared_ptr<LinearSystemSolver> > _solvers;
+      /// \brief The calibrated backend, kept while the dimensions of the system don't change
+      std::string _calibratedBackend;
+      std::vector<size_t> _calibratedStructure;
+      std::map<std::string, double> _calibrationTimes;
+      Decision _decision;
+    };
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_LINEAR_SYSTEM_SOLVER_SELECTOR_HPP */
@@ -24,8 +24,18 @@ namespace backend {
 /// 											The functions removes this many input design variables, starting at the beginning of
 ///												the list of input design variables. Therefore, the ordering of the design variables in the
 ///												input desing variables list matters!
-/// \param[IN] useMEstimator					Wheter or not to use an M-Estimator in the QR sovler.
+/// \param[IN] useMEstimator					Wheter or not to use an M-Estimator when evaluating the error terms.
 /// \param[OUT] outPriorErrorTermPtr			Shared pointer to the resulting marginalized prior error term.
+/// \param[OUT] outRtop						Top-left numTopRowsInRtop x numTopRowsInRtop block of the covariance of all input design variables.
+/// \param[OUT] designVariablesInvolvedInRtop	Input design variables covered by outRtop.
+/// \param[IN] numTopRowsInRtop				Size of the covariance block to compute (0 to skip the covariance).
+/// \param[IN] numThreads					Number of threads used to evaluate the error terms and Jacobians.
+///
+/// The removed design variables are eliminated with a Schur complement on the sparse normal equations.
+/// Only the Hessian block of the removed design variables is factorized, which keeps the cost low
+/// when few design variables are removed from a large window. If that block is rank deficient,
+/// it is solved with a rank-revealing QR instead. The covariance block requires a full rank Hessian
+/// and an aslam::Exception is thrown otherwise.
 ///
 void marginalize(
 			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
@@ -11,6 +11,7 @@
 // standard includes
 #include <cstdint>
 #include <vector>
+#include <type_traits>
 #include <utility> // std::move
 
 // Eigen includes
@@ -101,6 +102,10 @@ namespace backend {
 
    public:
 
+    /// \brief Chain rules with up to this many rows are multiplied with fixed-size kernels
+    ///        if the pushed matrix has a fixed size as well
+    static constexpr int MaxFixedSizeRows = 6;
+
     /// \brief Constructs a stack
     MatrixStack(const uint16_t numRows, const std::size_t maxNumMatrices, const std::size_t estimatedNumElementsPerMatrix)
         : _data(maxNumMatrices*estimatedNumElementsPerMatrix), _numRows(numRows)
@@ -111,6 +116,12 @@ namespace backend {
     /// \brief Is the stack empty?
     bool empty() const { return _headers.empty(); }
 
+    /// \brief Enable or disable the fixed-size chain rule kernels (enabled by default)
+    void setUseFixedSizeKernels(const bool enable) { _useFixedSizeKernels = enable; }
+
+    /// \brief Are the fixed-size chain rule kernels enabled?
+    bool useFixedSizeKernels() const { return _useFixedSizeKernels; }
+
     /// \brief Number of matrices stored
     std::size_t numMatrices() const { return _headers.size(); }
 
@@ -125,7 +136,7 @@ namespace backend {
       {
         SM_ASSERT_EQ_DBG(Exception, this->numTopCols(), mat.rows(), "Incompatible matrix sizes");
         this->allocate(mat.cols()); // We allocate space for 1 more matrix. Stack wasn't empty before, so now we have at least 2.
-        this->top().noalias() = this->matrix(this->numMatrices()-2)*mat;
+        this->multiplyTop(mat, std::integral_constant<bool, DERIVED::SizeAtCompileTime != Eigen::Dynamic>());
       }
       else
       {
@@ -191,6 +202,40 @@ namespace backend {
 
    protected:
 
+    /// \brief Computes top = previous * mat for a dynamically sized \p mat
+    template <typename DERIVED>
+    EIGEN_ALWAYS_INLINE void multiplyTop(const Eigen::MatrixBase<DERIVED>& mat, std::false_type /*isFixedSize*/)
+    {
+      this->top().noalias() = this->matrix(this->numMatrices()-2)*mat;
+    }
+
+    /// \brief Computes top = previous * mat for a fixed-size \p mat. Dispatches on the
+    ///        number of rows so that Eigen can unroll the product completely.
+    template <typename DERIVED>
+    EIGEN_ALWAYS_INLINE void multiplyTop(const Eigen::MatrixBase<DERIVED>& mat, std::true_type /*isFixedSize*/)
+    {
+      static_assert(MaxFixedSizeRows == 6, "Adapt the dispatch below");
+      if (_useFixedSizeKernels) {
+        switch (this->numRows()) {
+          case 1: this->multiplyTopFixedSize<1>(mat); return;
+          case 2: this->multiplyTopFixedSize<2>(mat); return;
+          case 3: this->multiplyTopFixedSize<3>(mat); return;
+          case 4: this->multiplyTopFixedSize<4>(mat); return;
+          case 5: this->multiplyTopFixedSize<5>(mat); return;
+          case 6: this->multiplyTopFixedSize<6>(mat); return;
+          default: break;
+        }
+      }
+      this->multiplyTop(mat, std::false_type());
+    }
+
+    template <int Rows, typename DERIVED>
+    EIGEN_ALWAYS_INLINE void multiplyTopFixedSize(const Eigen::MatrixBase<DERIVED>& mat)
+    {
+      this->top<Rows, DERIVED::ColsAtCompileTime>().noalias() =
+          this->matrix<Rows, DERIVED::RowsAtCompileTime>(this->numMatrices()-2)*mat;
+    }
+
     /// \brief Allocates memory and metadata for an element of size \p _numRows x \p cols.
     void allocate(const int cols)
     {
@@ -242,6 +287,7 @@ namespace backend {
     std::vector<Header> _headers; /// \brief Metadata for the matrix entries
 
     uint16_t _numRows; /// \brief Number of rows
+    bool _useFixedSizeKernels = true; /// \brief Multiply fixed-size chain rule matrices with fixed-size kernels
     std::size_t _dataSize = 0; /// \brief Number of elements in \p _data. Note
   };
 
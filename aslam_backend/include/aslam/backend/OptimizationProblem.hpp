@@ -2,10 +2,14 @@
 #define ASLAM_BACKEND_OPTIMIZATION_PROBLEM_SIMPLE
 
 #include "OptimizationProblemBase.hpp"
+#include "ExpressionArena.hpp"
 #include <boost/shared_ptr.hpp>
+#include <iterator>
+#include <type_traits>
 #include <vector>
 
 #include <unordered_map>
+#include <unordered_set>
 
 namespace aslam {
   namespace backend {
@@ -17,6 +21,10 @@ namespace aslam {
      *        only stores containers of design variables and error terms.
      *        This container owns the design variables and error terms and
      *        it will call delete on them when it goes out of scope.
+     *
+     *        Membership tests, insertions and removals are O(1). Removing a
+     *        design variable or error term moves the last one of the same kind
+     *        into its place, so removals do not preserve the insertion order.
      */
     class OptimizationProblem : public OptimizationProblemBase {
     public:
@@ -31,6 +39,11 @@ namespace aslam {
       /// \brief Add a design variable to the problem.
       void addDesignVariable(boost::shared_ptr<DesignVariable> dv);
 
+      /// \brief Add a range of design variables to the problem. The elements
+      /// must be convertible to boost::shared_ptr<DesignVariable>.
+      template <typename Iterator>
+      void addDesignVariables(Iterator begin, Iterator end);
+
       /// \brief Remove the design variable. This may cause error terms to also be removed.
       void removeDesignVariable(const DesignVariable* dv);
 
@@ -50,14 +63,35 @@ namespace aslam {
       /// \brief Add a scalar non-squared error term to the problem
       virtual void addErrorTerm(const boost::shared_ptr<ScalarNonSquaredErrorTerm> & et);
 
+      /// \brief Add a range of error terms to the problem. The elements must be
+      /// convertible to boost::shared_ptr<ErrorTerm> or
+      /// boost::shared_ptr<ScalarNonSquaredErrorTerm>.
+      template <typename Iterator>
+      void addErrorTerms(Iterator begin, Iterator end);
+
       /// \brief Remove the error term
       void removeErrorTerm(const ErrorTerm* dv);
 
-      /// \brief clear the design variables and error terms.
+      /// \brief Remove the scalar non-squared error term
+      void removeErrorTerm(const ScalarNonSquaredErrorTerm* dv);
+
+      /// \brief Reserve memory for the given number of design variables and error terms.
+      void reserve(size_t numDesignVariables, size_t numErrorTerms, size_t numNonSquaredErrorTerms = 0);
+
+      /// \brief clear the design variables and error terms and release the expression arena.
       void clear();
 
-      /// \brief used for debugging...is the design variable in the problem.
-      bool isDesignVariableInProblem(const DesignVariable* dv);
+      /// \brief The arena the expressions of this problem's error terms can be allocated from.
+      ///        Make it current with an ExpressionArena::Scope while building the error terms.
+      ///        Its slabs are released in bulk after the problem was cleared and the last
+      ///        expression allocated from them is gone.
+      ExpressionArena & expressionArena();
+
+      /// \brief is the design variable in the problem.
+      bool isDesignVariableInProblem(const DesignVariable* dv) const;
+
+      /// \brief is the error term in the problem.
+      bool isErrorTermInProblem(const ErrorTerm* et) const;
 
       size_t countActiveDesignVariables();
 
@@ -76,18 +110,52 @@ namespace aslam {
       void getErrorsImplementation(const DesignVariable* dv, std::set<ErrorTerm*>& outErrorSet) override;
       void getNonSquaredErrorsImplementation(const DesignVariable* dv, std::set<ScalarNonSquaredErrorTerm*>& outErrorSet) override;
 
-      // \todo Replace these std::vectors by something better. The underlying algorithms that this object
-      //       supports suck with these containers. Blerg. See "removeDesignVariable()" for an example of
-      //       just how bad this is.
+      /// \brief Created on first use
+      boost::shared_ptr<ExpressionArena> _expressionArena;
+
       std::vector< boost::shared_ptr<DesignVariable> > _designVariables;
       std::vector< boost::shared_ptr<ErrorTerm> > _errorTerms;
       std::vector< boost::shared_ptr<ScalarNonSquaredErrorTerm> > _sNSErrorTerms;
-      typedef std::unordered_multimap< DesignVariable*, ErrorTerm*> error_map_t;
-      typedef std::unordered_multimap< DesignVariable*, ScalarNonSquaredErrorTerm*> error_map_sns_t;
+
+      /// \brief Position of each design variable / error term in the containers above
+      std::unordered_map<const DesignVariable*, size_t> _designVariableIndex;
+      std::unordered_map<const ErrorTerm*, size_t> _errorTermIndex;
+      std::unordered_map<const ScalarNonSquaredErrorTerm*, size_t> _sNSErrorTermIndex;
+
+      /// \brief The error terms of each design variable
+      typedef std::unordered_map< const DesignVariable*, std::unordered_set<ErrorTerm*> > error_map_t;
+      typedef std::unordered_map< const DesignVariable*, std::unordered_set<ScalarNonSquaredErrorTerm*> > error_map_sns_t;
       error_map_t _errorTermMap;
       error_map_sns_t _errorTermMapSns;
+
+    private:
+      template <typename Iterator>
+      static size_t rangeSize(Iterator /* begin */, Iterator /* end */, std::input_iterator_tag) { return 0; }
+      template <typename Iterator>
+      static size_t rangeSize(Iterator begin, Iterator end, std::forward_iterator_tag) { return std::distance(begin, end); }
     };
 
+    template <typename Iterator>
+    void OptimizationProblem::addDesignVariables(Iterator begin, Iterator end)
+    {
+      const size_t n = rangeSize(begin, end, typename std::iterator_traits<Iterator>::iterator_category());
+      reserve(_designVariables.size() + n, _errorTerms.size(), _sNSErrorTerms.size());
+      for (; begin != end; ++begin)
+        addDesignVariable(*begin);
+    }
+
+    template <typename Iterator>
+    void OptimizationProblem::addErrorTerms(Iterator begin, Iterator end)
+    {
+      const size_t n = rangeSize(begin, end, typename std::iterator_traits<Iterator>::iterator_category());
+      if (std::is_convertible<typename std::iterator_traits<Iterator>::value_type, boost::shared_ptr<ErrorTerm> >::value)
+        reserve(_designVariables.size(), _errorTerms.size() + n, _sNSErrorTerms.size());
+      else
+        reserve(_designVariables.size(), _errorTerms.size(), _sNSErrorTerms.size() + n);
+      for (; begin != end; ++begin)
+        addErrorTerm(*begin);
+    }
+
 
   } // namespace backend
 } // namespace aslam
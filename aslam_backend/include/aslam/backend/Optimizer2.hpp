@@ -29,6 +29,7 @@ namespace sm {
 namespace aslam {
   namespace backend {
     class LinearSystemSolver;
+    class SparseCholeskyLinearSystemSolver;
 
     /**
      * \class Optimizer2
@@ -58,6 +59,9 @@ namespace aslam {
       typedef Optimizer2Options Options;
       struct Status : public OptimizerStatus {
         SolutionReturnValue srv;
+        /// \brief The estimated duration of an iteration in seconds: an exponential moving average of the
+        ///        previous iterations, where the last iteration has a weight of 1/2
+        double iterationTime = 0.0;
        private:
         void resetImplementation() override;
       };
@@ -74,6 +78,11 @@ namespace aslam {
       void initializeTrustRegionPolicy();
 
       /// \brief Run the optimization
+      ///
+      /// A callback returning ProceedInstruction::SUCCEED or FAIL stops the optimization after the current phase
+      /// with the convergence status STOPPED or FAILURE. Options::timeLimit bounds the duration.
+      /// If the trust region policy doesn't revert regressions, a regression in the last step before such an
+      /// early stop is reverted.
       SolutionReturnValue optimize();
 
       /// \brief Return the status
@@ -97,13 +106,20 @@ namespace aslam {
       /// The value of the objective function.
       double J() const;
 
-      /// \brief compute the full covariance matrix. This is expensive.
+      /// \brief compute the upper triangle of the full covariance matrix. This is expensive.
       void computeCovariances(SparseBlockMatrix& outP, double lambda);
 
       /// \brief compute only the diagonal covariance blocks.
       void computeDiagonalCovariances(SparseBlockMatrix& outP, double lambda);
 
-      /// \brief compute only the covariance blocks associated with the block indices passed as an argument
+      /// \brief compute only the covariance blocks associated with the block indices passed as an argument.
+      ///
+      /// The Hessian with diagonal conditioner lambda is linearized and factorized with a sparse Cholesky
+      /// decomposition at the current state, so the result doesn't depend on the solver used by the optimization.
+      /// If that solver is a SparseCholeskyLinearSystemSolver, its options and ordering groups are used, and its
+      /// last factor is reused if it was computed at the current state with the same conditioner and without
+      /// M-estimator weights. The symbolic factorization is kept for the next call. Only the requested entries
+      /// are computed, in parallel over numThreadsJacobian threads.
       void computeCovarianceBlocks(const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP, double lambda);
 
       void computeHessian(SparseBlockMatrix& outH, double lambda);
@@ -117,7 +133,8 @@ namespace aslam {
       /// \brief how many dense design variables are involved in the problem
       size_t numDesignVariables() const;
 
-      /// \brief print the internal timing information.
+      /// \brief print the internal timing information, the Jacobian passes saved by fused error and Jacobian
+      ///        evaluation and, if enabled, the instrumentation report.
       void printTiming() const;
 
       /// \brief Do a bunch of checks to see if the problem is well-defined. This includes checking that every error term is
@@ -151,16 +168,29 @@ namespace aslam {
       /// \brief Zero the Gauss-Newton matrices.
       void zeroMatrices();
 
+      /// \brief Evaluate the error at the current state together with the Jacobians, if the solver supports it.
+      ///        Only to be used if the trust region policy will linearize the current state.
+      double evaluateErrorAndJacobians(bool useMEstimator);
+
       /// \brief Revert the last state update.
       void revertLastStateUpdate();
 
       /// \brief Apply a state update.
-      double applyStateUpdate();
+      double applyStateUpdate(const Eigen::VectorXd& dx);
+
+      /// \brief The cost of the state updated by dx, without callbacks. The update is reverted before it returns.
+      double evaluateTrialStep(const Eigen::VectorXd& dx, int nThreads);
+
+      /// \brief Take J as the error of the current state, which the error terms were evaluated at last.
+      void useEvaluatedError(double J);
 
       /// \brief issue callback for given event
       template<typename Event>
       void issueCallback();
 
+      /// \brief Record the instruction returned by the callbacks
+      void proceed(callback::ProceedInstruction instruction);
+
       void optimizeImplementation() override;
 
       void initializeImplementation() override;
@@ -173,6 +203,13 @@ namespace aslam {
 
       boost::shared_ptr<LinearSystemSolver> _solver;
 
+      /// \brief Factorizes the Hessian at the current state for computeCovarianceBlocks()
+      boost::shared_ptr<SparseCholeskyLinearSystemSolver> _covarianceSolver;
+
+      /// \brief Was the last factor of _solver computed at the current state, and before the last state update
+      bool _isFactorizedAtState = false;
+      bool _p_isFactorizedAtState = false;
+
       boost::shared_ptr<TrustRegionPolicy> _trustRegionPolicy;
 
       /// \brief the current set of options
@@ -183,6 +220,9 @@ namespace aslam {
 
       /// \brief A class that manages the optimizer callbacks
       callback::Manager _callbackManager;
+
+      /// \brief The first instruction other than CONTINUE returned by a callback during optimize()
+      callback::ProceedInstruction _proceedInstruction = callback::ProceedInstruction::CONTINUE;
     };
 
 } // namespace backend
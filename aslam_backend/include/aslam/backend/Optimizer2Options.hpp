@@ -2,6 +2,7 @@
 #define ASLAM_BACKEND_OPTIMIZER_2_OPTIONS_HPP
 
 #include <ostream>
+#include <string>
 #include <boost/shared_ptr.hpp>
 
 #include <aslam/backend/OptimizerBase.hpp>
@@ -9,13 +10,17 @@
 namespace aslam {
   namespace backend {
   class LinearSystemSolver;
+  class LinearSystemSolverSelector;
   class TrustRegionPolicy;
   
     struct Optimizer2Options : public OptimizerOptionsBase {
       Optimizer2Options() :
         doSchurComplement(false),
         verbose(false),
-        linearSolverMaximumFails(0)
+        linearSolverMaximumFails(0),
+        fuseErrorAndJacobianEvaluation(true),
+        timeLimit(0.0),
+        traceBufferSize(1 << 15)
       {
         convergenceDeltaError = 1e-3;
         convergenceDeltaX = 1e-3;
@@ -31,7 +36,29 @@ namespace aslam {
       /// \brief The number of times the linear solver may fail before the optimization is aborted. (>0 only if a fall back is available!)
       int linearSolverMaximumFails;
 
+      /// \brief Evaluate the Jacobians in the same pass over the error terms as the errors whenever the trust region
+      ///        policy will linearize the evaluated state. Not done while RESIDUALS_UPDATED callbacks are registered,
+      ///        as they may change the weighting of the Jacobians.
+      bool fuseErrorAndJacobianEvaluation;
+
+      /// \brief The wall-clock time budget of optimize() in seconds, unlimited if not positive. The initial error is
+      ///        always evaluated. An iteration is not started if the previous ones suggest it won't finish in time,
+      ///        and the evaluation of errors and Jacobians is abandoned when the time is up. The best state reached
+      ///        is kept and the convergence status is TIME_LIMIT.
+      double timeLimit;
+
+      /// \brief If not empty, a timeline of every call to optimize() is written to this file in the Chrome trace
+      ///        event format (see aslam/backend/util/Instrumentation.hpp). Open it with chrome://tracing or Perfetto.
+      ///        A failure to write it is logged and does not affect the result of optimize().
+      std::string traceFile;
+
+      /// \brief The number of trace events kept per thread, older events are overwritten.
+      size_t traceBufferSize;
+
       boost::shared_ptr<LinearSystemSolver> linearSystemSolver;
+      /// \brief If set and no linearSystemSolver is given, it selects the linear system solver from the structure
+      ///        of the problem whenever the optimizer is initialized. Until then the optimizer has no solver.
+      boost::shared_ptr<LinearSystemSolverSelector> linearSystemSolverSelector;
       boost::shared_ptr<TrustRegionPolicy> trustRegionPolicy;
     };
 
@@ -41,6 +68,10 @@ namespace aslam {
       out << "\tdoSchurComplement: " << options.doSchurComplement << std::endl;
       out << "\tverbose: " << options.verbose << std::endl;
       out << "\tlinearSolverMaximumFails: " << options.linearSolverMaximumFails << std::endl;
+      out << "\tfuseErrorAndJacobianEvaluation: " << options.fuseErrorAndJacobianEvaluation << std::endl;
+      out << "\ttimeLimit: " << options.timeLimit << std::endl;
+      out << "\ttraceFile: " << options.traceFile << std::endl;
+      out << "\ttraceBufferSize: " << options.traceBufferSize << std::endl;
       return out;
     }
   } // namespace backend
@@ -38,6 +38,8 @@ enum ConvergenceStatus
   DX,             //!< DX
   DOBJECTIVE,     //!< DOBJECTIVE
   MAX_ITERATIONS, //!< MAX_ITERATIONS
+  TIME_LIMIT,     //!< TIME_LIMIT: stopped at the time limit with the best state so far
+  STOPPED,        //!< STOPPED: stopped by a callback returning ProceedInstruction::SUCCEED
 };
 
 /// \brief Stream operator for ConvergenceStatus
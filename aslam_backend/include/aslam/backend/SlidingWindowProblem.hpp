@@ -0,0 +1,145 @@
+#ifndef ASLAM_BACKEND_SLIDING_WINDOW_PROBLEM_HPP
+#define ASLAM_BACKEND_SLIDING_WINDOW_PROBLEM_HPP
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "OptimizationProblemBase.hpp"
+#include "Optimizer2.hpp"
+#include "MarginalizationPriorErrorTerm.hpp"
+
+namespace sm {
+  class ConstPropertyTree;
+}
+
+namespace aslam {
+  namespace backend {
+
+    struct SlidingWindowProblemOptions
+    {
+      SlidingWindowProblemOptions();
+      SlidingWindowProblemOptions(const sm::ConstPropertyTree& config);
+
+      /// \brief Use the M-estimators of the error terms when marginalizing them
+      bool useMEstimator = true;
+      /// \brief The number of threads evaluating the error terms to marginalize
+      size_t numThreadsMarginalization = 1;
+      bool verbose = false;
+    };
+
+    /**
+     * \class SlidingWindowProblem
+     * \brief An optimization problem over a window of design variables which are marginalized when they leave it
+     *
+     * Design variables and error terms are pushed as they arrive. Design variables marked for removal are
+     * marginalized by slide(): the error terms depending on them, including earlier priors, are replaced by a
+     * MarginalizationPriorErrorTerm on the design variables they connect to.
+     *
+     * The window keeps the design variables and the error terms in the order they were added, priors first.
+     * A window moving by the same kind of states therefore presents the same structure to the linear solver
+     * in every slide, and the SparseCholeskyLinearSystemSolver keeps its ordering and symbolic factorization
+     * (see SparseCholeskyLinearSystemSolver::numStructureReuses()). The optimizer is initialized again only if the
+     * window changed, with the same linear system solver instance.
+     */
+    class SlidingWindowProblem : public OptimizationProblemBase
+    {
+     public:
+      typedef SlidingWindowProblemOptions Options;
+
+      /// \brief The latency of the last slide() and optimize() calls in seconds
+      struct Statistics
+      {
+        size_t numMarginalizedDesignVariables = 0;
+        size_t numMarginalizedErrorTerms = 0;
+        /// \brief The dimension of the new prior, 0 if there is none
+        size_t priorDimension = 0;
+        double marginalizationTime = 0.0;
+        /// \brief Set up of the optimizer and the matrix structure for the changed window
+        double initializationTime = 0.0;
+        double optimizationTime = 0.0;
+        /// \brief Did the linear system solver keep its ordering and symbolic factorization?
+        bool structureReused = false;
+      };
+
+      SlidingWindowProblem(const Optimizer2Options& optimizerOptions = Optimizer2Options(), const Options& options = Options());
+      SlidingWindowProblem(const sm::ConstPropertyTree& config, boost::shared_ptr<LinearSystemSolver> linearSystemSolver, boost::shared_ptr<TrustRegionPolicy> trustRegionPolicy);
+      ~SlidingWindowProblem() override;
+
+      /// \brief Add a design variable at the end of the window. If the second argument is true, the design variable
+      ///        will be deleted when it is removed from the window.
+      void addDesignVariable(DesignVariable* dv, bool problemOwnsVariable);
+      void addDesignVariable(const boost::shared_ptr<DesignVariable>& dv);
+
+      /// \brief Add an error term. Its active design variables have to be in the window.
+      void addErrorTerm(ErrorTerm* et, bool problemOwnsErrorTerm);
+      void addErrorTerm(const boost::shared_ptr<ErrorTerm>& et) override;
+
+      /// \brief Marginalize the design variable with the next slide()
+      void markForRemoval(const DesignVariable* dv);
+      bool isMarkedForRemoval(const DesignVariable* dv) const;
+
+      /// \brief Marginalize the design variables marked for removal at their current estimates and remove them
+      ///        and their error terms from the window.
+      void slide();
+
+      /// \brief Optimize the design variables of the window
+      SolutionReturnValue optimize();
+
+      bool isDesignVariableInProblem(const DesignVariable* dv) const;
+      bool isErrorTermInProblem(const ErrorTerm* et) const;
+
+      /// \brief The priors of the window, from the latest slides
+      const std::vector< boost::shared_ptr<MarginalizationPriorErrorTerm> >& priors() const { return _priors; }
+
+      const Statistics& statistics() const { return _statistics; }
+
+      Optimizer2& optimizer() { return *_optimizer; }
+      const Optimizer2& optimizer() const { return *_optimizer; }
+
+      const Options& getOptions() const { return _options; }
+      Options& options() { return _options; }
+      void setOptions(const Options& options) { _options = options; }
+
+     protected:
+      size_t numDesignVariablesImplementation() const override;
+      DesignVariable* designVariableImplementation(size_t i) override;
+      const DesignVariable* designVariableImplementation(size_t i) const override;
+      size_t numErrorTermsImplementation() const override;
+      size_t numNonSquaredErrorTermsImplementation() const override;
+      ErrorTerm* errorTermImplementation(size_t i) override;
+      ScalarNonSquaredErrorTerm* nonSquaredErrorTermImplementation(size_t i) override;
+      const ErrorTerm* errorTermImplementation(size_t i) const override;
+      const ScalarNonSquaredErrorTerm* nonSquaredErrorTermImplementation(size_t i) const override;
+      void getErrorsImplementation(const DesignVariable* dv, std::set<ErrorTerm*>& outErrorSet) override;
+      void getNonSquaredErrorsImplementation(const DesignVariable* dv, std::set<ScalarNonSquaredErrorTerm*>& outErrorSet) override;
+
+     private:
+      void initializeOptimizer();
+
+      Options _options;
+      boost::shared_ptr<Optimizer2> _optimizer;
+
+      /// \brief The design variables in the order they were added
+      std::vector< boost::shared_ptr<DesignVariable> > _designVariables;
+      /// \brief The priors followed by the other error terms in the order they were added
+      std::vector< boost::shared_ptr<ErrorTerm> > _errorTerms;
+      std::vector< boost::shared_ptr<MarginalizationPriorErrorTerm> > _priors;
+
+      std::unordered_set<const DesignVariable*> _designVariableSet;
+      std::unordered_set<const ErrorTerm*> _errorTermSet;
+      /// \brief The error terms of each design variable
+      std::unordered_map< const DesignVariable*, std::unordered_set<ErrorTerm*> > _errorTermMap;
+      std::unordered_set<const DesignVariable*> _markedForRemoval;
+
+      /// \brief Did the window change since the optimizer was initialized
+      bool _windowChanged;
+      Statistics _statistics;
+    };
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_SLIDING_WINDOW_PROBLEM_HPP */
@@ -24,6 +24,8 @@
 #ifndef ASLAM_BACKEND_SPARSE_CHOLESKY_LINEAR_SOLVER_OPTIONS_H
 #define ASLAM_BACKEND_SPARSE_CHOLESKY_LINEAR_SOLVER_OPTIONS_H
 
+#include <cstddef>
+
 namespace aslam {
   namespace backend {
 
@@ -33,6 +35,19 @@ namespace aslam {
       */
     class SparseCholeskyLinearSolverOptions {
     public:
+      /// Fill-reducing orderings of the linear system
+      enum Ordering {
+        /// AMD on the scalar pattern, computed by CHOLMOD
+        ScalarAmd,
+        /// AMD on the design variable graph
+        BlockAmd,
+        /// COLAMD on the design variable graph
+        BlockColamd,
+        /// Nested dissection on the design variable graph. Falls back to
+        /// AMD if CHOLMOD was built without METIS.
+        BlockNestedDissection
+      };
+
       /** \name Constructors/destructor
         @{
         */
@@ -49,6 +64,24 @@ namespace aslam {
       /** @}
         */
 
+      /** \name Members
+        @{
+        */
+      /// Memory budget in bytes for the selected inverse and its per thread
+      /// workspaces when recovering covariance blocks from the factor
+      /// (0: unbounded). Covariance columns are solved for instead if not even
+      /// the selected inverse and the workspaces of one thread fit into it.
+      size_t covarianceMemoryBudget;
+      /// Fill-reducing ordering used for the symbolic factorization
+      Ordering ordering;
+      /// Assemble the upper triangle of J^T J explicitly and factorize it as a
+      /// symmetric matrix instead of letting CHOLMOD form it from J^T. J^T is
+      /// stored in double either way, there is no single precision mode as in
+      /// DenseQRLinearSolverOptions::useSinglePrecision.
+      bool assembleNormalEquations;
+      /** @}
+        */
+
     };
 
   }
@@ -1,10 +1,13 @@
 #ifndef ASLAM_BACKEND_SPARSE_CHOLESKY_LINEAR_SYSTEM_SOLVER_HPP
 #define ASLAM_BACKEND_SPARSE_CHOLESKY_LINEAR_SYSTEM_SOLVER_HPP
 
+#include <unordered_map>
+
 #include "LinearSystemSolver.hpp"
 #include "CompressedColumnJacobianTransposeBuilder.hpp"
 
 #include "aslam/backend/SparseCholeskyLinearSolverOptions.h"
+#include "backend.hpp"
 
 namespace sm {
 
@@ -23,6 +26,7 @@ namespace aslam {
 
       void buildSystem(size_t nThreads, bool useMEstimator) override;
       bool solveSystem(Eigen::VectorXd& outDx) override;
+      bool supportsFusedEvaluation() const override { return true; }
 
       /// Returns the options
       const SparseCholeskyLinearSolverOptions& getOptions() const;
@@ -35,10 +39,66 @@ namespace aslam {
       /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
       double rhsJtJrhs() override;
    
+      /// \brief Returns true if the factor of the last successful solveSystem() call is available
+      ///        and was computed with the constant diagonal conditioner \p lambda.
+      bool isFactorizedWithConstantConditioner(double lambda) const;
+
+      /// \brief Compute the covariance blocks (blockRow, blockCol) of the inverse Hessian from the factor of
+      ///        the last successful solveSystem() call, without refactorizing. The blocks are split across
+      ///        nThreads threads. Returns false if no usable factor is available.
+      ///
+      /// @param rowBlockIndices the cumulative column indices ending each design variable block
+      /// @param blockIndices    the (blockRow, blockCol) pairs to compute
+      /// @param outP            the resulting sparse block matrix. Only the requested blocks are allocated.
+      /// @param nThreads        the number of threads to use
+      bool computeCovarianceBlocks(const std::vector<int>& rowBlockIndices, const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP, size_t nThreads);
+
+      /// \brief Constrain the block orderings: design variables of a higher group are eliminated after all
+      ///        design variables of lower groups, e.g. to keep the latest states at the end of the factor.
+      ///        Design variables are in group 0 by default. Takes effect with the next initMatrixStructure() call.
+      void setOrderingGroup(const DesignVariable* dv, int group);
+
+      /// \brief Remove all ordering constraints
+      void clearOrderingGroups();
+
+      /// \brief The ordering constraint groups set with setOrderingGroup()
+      const std::unordered_map<const DesignVariable*, int>& getOrderingGroups() const { return _orderingGroups; }
+
+      /// \brief The scalar column ordering passed to the symbolic factorization. Empty if CHOLMOD orders the
+      ///        scalar pattern itself.
+      const std::vector<int>& getOrdering() const { return _ordering; }
+
+      /// \brief The number of calls to initMatrixStructure() which kept the ordering and the symbolic factorization
+      ///        because the structure of the system didn't change, e.g. when a sliding window moved by a state.
+      size_t numStructureReuses() const { return _numStructureReuses; }
     
     private:
+      /// \brief Compute the fill-reducing ordering on the design variable graph
+      void setOrdering(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors) override;
+
+      /// \brief Set up the pattern of the upper triangle of J^T J from the pattern of J^T
+      void initNormalEquationsStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors);
+
+      /// \brief Assemble the upper triangle of J^T J from J^T
+      void buildNormalEquations(size_t nThreads);
+
+      /// \brief Assemble the block columns [startIdx, endIdx) of the normal equations
+      void buildNormalEquationsBlockColumns(size_t threadId, size_t startIdx, size_t endIdx);
+
+      /// \brief The product of two Jacobian blocks of an error term, contributing to one block of J^T J.
+      ///        The values of J^T belonging to an error term form a dense column major matrix.
+      struct NormalEquationsTerm {
+        int valueStart;       ///< Index of the first value of the error term in J^T
+        int rows;             ///< Rows of J^T of the error term, i.e. the dimension of its active design variables
+        int cols;             ///< Dimension of the error term
+        int rowOffsetA;       ///< First row of the block row design variable in the error term's rows of J^T
+        int dimA;             ///< Dimension of the block row design variable
+        int rowOffsetB;       ///< First row of the block column design variable in the error term's rows of J^T
+        int hessianRowOffset; ///< Offset of the block within the columns of J^T J
+      };
       void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
       void handleNewAcceptConstantErrorTerms() override;
+      void linearizeErrorTerm(size_t i, bool useMEstimator) override;
 
       CompressedColumnJacobianTransposeBuilder<int> _jacobianBuilder;
 
@@ -47,6 +107,40 @@ namespace aslam {
       cholmod_dense  _cholmodRhs;
       cholmod_factor* _factor;
 
+      /// \brief Is _factor numerically valid, i.e. did the last factorization succeed
+      bool _isFactorized;
+
+      /// \brief The diagonal conditioner _factor was computed with (empty if none was used)
+      Eigen::VectorXd _factorConditioner;
+
+      /// \brief Was the structure initialized for the assembled normal equations
+      bool _useNormalEquations;
+
+      /// \brief The upper triangle of J^T J in compressed column form (SparseCholeskyLinearSolverOptions::assembleNormalEquations)
+      std::vector<int> _hessianColPtr;
+      std::vector<int> _hessianRowInd;
+      std::vector<double> _hessianValues;
+      /// \brief The diagonal of J^T J without the diagonal conditioner
+      Eigen::VectorXd _hessianDiagonal;
+
+      /// \brief The first column and the dimension of the design variable blocks, sorted by column
+      std::vector<int> _blockColumnBase;
+      std::vector<int> _blockColumnDim;
+      /// \brief The contributions to each block column of J^T J
+      std::vector<std::vector<NormalEquationsTerm> > _normalEquationsTerms;
+
+      /// \brief The ordering constraint group of the design variables
+      std::unordered_map<const DesignVariable*, int> _orderingGroups;
+
+      /// \brief The scalar column ordering given to CHOLMOD (empty for SparseCholeskyLinearSolverOptions::ScalarAmd)
+      std::vector<int> _ordering;
+
+      /// \brief The block structure _ordering and _factor were computed for, see setOrdering()
+      std::vector<int> _structure;
+      /// \brief Did the last setOrdering() call find the structure unchanged
+      bool _structureUnchanged;
+      size_t _numStructureReuses;
+
       /// Options
       SparseCholeskyLinearSolverOptions _options;
 
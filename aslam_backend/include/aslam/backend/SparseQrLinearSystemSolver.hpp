@@ -25,6 +25,7 @@ namespace aslam {
       // virtual void evaluateError(size_t nThreads, bool useMEstimator);
       void buildSystem(size_t nThreads, bool useMEstimator) override;
       bool solveSystem(Eigen::VectorXd& outDx) override;
+      bool supportsFusedEvaluation() const override { return true; }
       // virtual void solveConstantAugmentedSystem(double diagonalConditioner, Eigen::VectorXd & outDx);
       // virtual void solveAugmentedSystem(const Eigen::VectorXd & diagonalConditioner, Eigen::VectorXd & outDx);
 
@@ -60,6 +61,7 @@ namespace aslam {
     private:
       void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
       void handleNewAcceptConstantErrorTerms() override;
+      void linearizeErrorTerm(size_t i, bool useMEstimator) override;
 
       CompressedColumnJacobianTransposeBuilder<index_t> _jacobianBuilder;
 
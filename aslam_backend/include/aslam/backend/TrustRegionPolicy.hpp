@@ -3,6 +3,7 @@
 
 #include <aslam/backend/LinearSystemSolver.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 #include "Optimizer2Options.hpp"
 #include <sm/eigen/assert_macros.hpp>
 #include <aslam/Exceptions.hpp>
@@ -13,6 +14,10 @@ namespace aslam {
         class TrustRegionPolicy
         {
         public:
+            /// \brief Returns the cost of the state updated by dx, evaluated with nThreads. The update is reverted
+            ///        before it returns, the error terms keep the errors of the trial.
+            typedef boost::function<double (const Eigen::VectorXd& dx, int nThreads)> TrialStepEvaluator;
+
             TrustRegionPolicy();
             virtual ~TrustRegionPolicy();
             
@@ -31,6 +36,19 @@ namespace aslam {
             /// \brief should the optimizer revert on failure? You should probably return true (the default implementation does this)
             virtual bool revertOnFailure();
 
+            /// \brief does solveSystem() linearize the problem at every new state, also after a regression?
+            ///        The optimizer then evaluates the Jacobians in the same pass as the errors of each step.
+            ///        The first state is linearized by every policy.
+            virtual bool linearizesEveryStep() const;
+
+            /// \brief set by the optimizer to let the policy try steps before it returns one. May be empty.
+            void setTrialStepEvaluator(const TrialStepEvaluator& evaluator) { _evaluateTrialStep = evaluator; }
+
+            /// \brief true if the step returned by the last solveSystem() was the last trial step evaluated.
+            ///        The error terms then hold its errors and outJ is its cost, so the optimizer doesn't have
+            ///        to evaluate the step again once it applied it. Consumes the cost.
+            bool takeEvaluatedStepError(double& outJ);
+
             /// \brief print the current state to a stream (no newlines).
             virtual std::ostream & printState(std::ostream & out) const = 0;
             virtual std::string name() const = 0;
@@ -38,6 +56,11 @@ namespace aslam {
         protected:
             double get_dJ();
             bool isFirstIteration(){ return _isFirstIteration; }
+            bool canEvaluateTrialSteps() const { return !_evaluateTrialStep.empty(); }
+            /// \brief The cost of the current state updated by dx, which is kept as it is
+            double evaluateTrialStep(const Eigen::VectorXd& dx, int nThreads) { return _evaluateTrialStep(dx, nThreads); }
+            /// \brief To be called by solveSystemImplementation() if it returns the last trial step it evaluated
+            void setEvaluatedStepError(double J) { _evaluatedStepError = J; _hasEvaluatedStepError = true; }
 
             /// \brief called by the optimizer when an optimization is starting
             virtual void optimizationStartingImplementation(double J) = 0;
@@ -48,6 +71,10 @@ namespace aslam {
             boost::shared_ptr<LinearSystemSolver> _solver;
             
         private:
+            TrialStepEvaluator _evaluateTrialStep;
+            double _evaluatedStepError;
+            bool _hasEvaluatedStepError;
+
             /// \brief the linear system solver.
             double _J;
             double _p_J;
@@ -51,6 +51,26 @@ namespace aslam {
       static cholmod_factor* analyze(cholmod_sparse* A, cholmod_common* c) {
         return cholmod_analyze(A, c);
       }
+      static cholmod_factor* analyze_p(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_analyze_p(A, perm, NULL, 0, c);
+      }
+      static int amd(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_amd(A, NULL, 0, perm, c);
+      }
+      static int colamd(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_colamd(A, NULL, 0, 1, perm, c);
+      }
+#ifndef NPARTITION
+      static int camd(cholmod_sparse* A, int* cmember, int* perm, cholmod_common* c) {
+        return cholmod_camd(A, NULL, 0, cmember, perm, c);
+      }
+      static int ccolamd(cholmod_sparse* A, int* cmember, int* perm, cholmod_common* c) {
+        return cholmod_ccolamd(A, NULL, 0, cmember, perm, c);
+      }
+      static SuiteSparse_long nested_dissection(cholmod_sparse* A, int* perm, int* cparent, int* cmember, cholmod_common* c) {
+        return cholmod_nested_dissection(A, NULL, 0, perm, cparent, cmember, c);
+      }
+#endif
       static int free_sparse(cholmod_sparse** A, cholmod_common* c) {
         return cholmod_free_sparse(A, c);
       }
@@ -80,6 +100,13 @@ namespace aslam {
           int xtype, cholmod_common* c) {
         return cholmod_allocate_dense(nrow, ncol, d, xtype, c);
       }
+      static cholmod_factor* copy_factor(cholmod_factor* L, cholmod_common* c) {
+        return cholmod_copy_factor(L, c);
+      }
+      static int change_factor(int to_xtype, int to_ll, int to_super, int to_packed,
+          int to_monotonic, cholmod_factor* L, cholmod_common* c) {
+        return cholmod_change_factor(to_xtype, to_ll, to_super, to_packed, to_monotonic, L, c);
+      }
     };
 
     template<>
@@ -98,6 +125,26 @@ namespace aslam {
       static cholmod_factor* analyze(cholmod_sparse* A, cholmod_common* c) {
         return cholmod_l_analyze(A, c);
       }
+      static cholmod_factor* analyze_p(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_analyze_p(A, perm, NULL, 0, c);
+      }
+      static int amd(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_amd(A, NULL, 0, perm, c);
+      }
+      static int colamd(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_colamd(A, NULL, 0, 1, perm, c);
+      }
+#ifndef NPARTITION
+      static int camd(cholmod_sparse* A, SuiteSparse_long* cmember, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_camd(A, NULL, 0, cmember, perm, c);
+      }
+      static int ccolamd(cholmod_sparse* A, SuiteSparse_long* cmember, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_ccolamd(A, NULL, 0, cmember, perm, c);
+      }
+      static SuiteSparse_long nested_dissection(cholmod_sparse* A, SuiteSparse_long* perm, SuiteSparse_long* cparent, SuiteSparse_long* cmember, cholmod_common* c) {
+        return cholmod_l_nested_dissection(A, NULL, 0, perm, cparent, cmember, c);
+      }
+#endif
       static int free_sparse(cholmod_sparse** A, cholmod_common* c) {
         return cholmod_l_free_sparse(A, c);
       }
@@ -127,6 +174,13 @@ namespace aslam {
           int xtype, cholmod_common* c) {
         return cholmod_l_allocate_dense(nrow, ncol, d, xtype, c);
       }
+      static cholmod_factor* copy_factor(cholmod_factor* L, cholmod_common* c) {
+        return cholmod_l_copy_factor(L, c);
+      }
+      static int change_factor(int to_xtype, int to_ll, int to_super, int to_packed,
+          int to_monotonic, cholmod_factor* L, cholmod_common* c) {
+        return cholmod_l_change_factor(to_xtype, to_ll, to_super, to_packed, to_monotonic, L, c);
+      }
     };
 
 
@@ -211,6 +265,7 @@ namespace aslam {
       //  * is done.  A supernodal analysis done otherwise.
       //  * Default:  CHOLMOD_AUTO.  Default supernodal_switch = 40
       _cholmod.supernodal = CHOLMOD_AUTO;
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
       cholmod_factor* factor = NULL;
       factor = CholmodIndexTraits<index_t>::analyze(J, &_cholmod);
       SM_ASSERT_EQ(Exception, _cholmod.status, CHOLMOD_OK, "The symbolic cholesky factorization failed.");
@@ -218,6 +273,85 @@ namespace aslam {
       return factor;
     }
 
+    template<typename I>
+    cholmod_factor* Cholmod<I>::analyze(cholmod_sparse* J, index_t* perm)
+    {
+      SM_ASSERT_TRUE(Exception, perm != NULL, "Null input");
+      // Only use the given ordering. CHOLMOD still postorders it with respect to the elimination tree.
+      _cholmod.nmethods = 1;
+      _cholmod.method[0].ordering = CHOLMOD_GIVEN;
+      _cholmod.supernodal = CHOLMOD_AUTO;
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+      cholmod_factor* factor = CholmodIndexTraits<index_t>::analyze_p(J, perm, &_cholmod);
+      SM_ASSERT_EQ(Exception, _cholmod.status, CHOLMOD_OK, "The symbolic cholesky factorization failed.");
+      SM_ASSERT_FALSE(Exception, factor == NULL, "cholmod_analyze_p returned a null factor");
+      return factor;
+    }
+
+    template<typename I>
+    cholmod_factor* Cholmod<I>::analyzeNatural(cholmod_sparse* A)
+    {
+      SM_ASSERT_TRUE(Exception, A != NULL, "Null input");
+      _cholmod.nmethods = 1;
+      _cholmod.method[0].ordering = CHOLMOD_NATURAL;
+      _cholmod.postorder = 0;
+      _cholmod.supernodal = CHOLMOD_AUTO;
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+      cholmod_factor* factor = CholmodIndexTraits<index_t>::analyze(A, &_cholmod);
+      _cholmod.postorder = 1;
+      SM_ASSERT_EQ(Exception, _cholmod.status, CHOLMOD_OK, "The symbolic cholesky factorization failed.");
+      SM_ASSERT_FALSE(Exception, factor == NULL, "cholmod_analyze returned a null factor");
+      return factor;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::amd(cholmod_sparse* A, index_t* perm)
+    {
+      const int status = CholmodIndexTraits<index_t>::amd(A, perm, &_cholmod);
+      return status != 0 && _cholmod.status == CHOLMOD_OK;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::colamd(cholmod_sparse* A, index_t* perm)
+    {
+      const int status = CholmodIndexTraits<index_t>::colamd(A, perm, &_cholmod);
+      return status != 0 && _cholmod.status == CHOLMOD_OK;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::nestedDissection(cholmod_sparse* A, index_t* perm)
+    {
+#ifndef NPARTITION
+      std::vector<index_t> cparent(A->nrow), cmember(A->nrow);
+      const SuiteSparse_long numComponents = CholmodIndexTraits<index_t>::nested_dissection(A, perm, cparent.data(), cmember.data(), &_cholmod);
+      return numComponents >= 0 && _cholmod.status == CHOLMOD_OK;
+#else
+      return false;
+#endif
+    }
+
+    template<typename I>
+    bool Cholmod<I>::camd(cholmod_sparse* A, index_t* cmember, index_t* perm)
+    {
+#ifndef NPARTITION
+      const int status = CholmodIndexTraits<index_t>::camd(A, cmember, perm, &_cholmod);
+      return status != 0 && _cholmod.status == CHOLMOD_OK;
+#else
+      return false;
+#endif
+    }
+
+    template<typename I>
+    bool Cholmod<I>::ccolamd(cholmod_sparse* A, index_t* cmember, index_t* perm)
+    {
+#ifndef NPARTITION
+      const int status = CholmodIndexTraits<index_t>::ccolamd(A, cmember, perm, &_cholmod);
+      return status != 0 && _cholmod.status == CHOLMOD_OK;
+#else
+      return false;
+#endif
+    }
+
 #ifndef QRSOLVER_DISABLED
     template<typename I>
     spqr_factor* Cholmod<I>::analyzeQR(cholmod_sparse* J)
@@ -234,6 +368,7 @@ namespace aslam {
       //_cholmod.supernodal = CHOLMOD_AUTO;
       _cholmod.SPQR_nthreads = -1;  // let tbb choose whats best
       _cholmod.SPQR_grain = 12;   // +/-2* number of cores
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
       spqr_factor* factor = NULL;
       cholmod_sparse* qrJ = cholmod_l_transpose(J, 1, &_cholmod) ;
       factor = SuiteSparseQR_symbolic <double>(SPQR_ORDERING_BEST, SPQR_DEFAULT_TOL, qrJ, &_cholmod) ;
@@ -288,6 +423,7 @@ namespace aslam {
     {
       SM_ASSERT_TRUE(Exception, A != NULL, "Null input");
       SM_ASSERT_TRUE(Exception, L != NULL, "Null input");
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
       _cholmod.quick_return_if_not_posdef = 1;
       int status = CholmodIndexTraits<index_t>::factorize(A, L, &_cholmod);
       switch (_cholmod.status) {
@@ -336,6 +472,7 @@ namespace aslam {
         At = cholmod_l_transpose(A, 1, &_cholmod) ;
       SM_ASSERT_TRUE(Exception, At != NULL, "Null input");
       SM_ASSERT_TRUE(Exception, L != NULL, "Null input");
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
       _cholmod.quick_return_if_not_posdef = 1;
       int status = SuiteSparseQR_numeric(tol, At, L, &_cholmod);
       // TODO: check if those ones are the same for cholmod and spqr
@@ -391,6 +528,7 @@ namespace aslam {
       if (factorize(A, L)) {
         //cholmod_print_dense(b, "b", &_cholmod);
         //cholmod_print_sparse(A,"A", &_cholmod);
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
         cholmod_dense* X = CholmodIndexTraits<index_t>::solve(CHOLMOD_A, L, b, &_cholmod);
         //cholmod_print_dense(X, "X", &_cholmod);
         return X;
@@ -423,6 +561,7 @@ namespace aslam {
       }
       cholmod_dense* res = NULL;
       if (factorize(qrJ, L, tol)) {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
         cholmod_dense* qrY = SuiteSparseQR_qmult(SPQR_QTX, L, b, &_cholmod);
         res = SuiteSparseQR_solve(SPQR_RETX_EQUALS_B, L, qrY, &_cholmod);
         CholmodIndexTraits<index_t>::free_dense(&qrY, &_cholmod);
@@ -504,6 +643,23 @@ namespace aslam {
       return sqrt(norm);
     }
 
+    template<typename I>
+    cholmod_factor* Cholmod<I>::copy(cholmod_factor* L)
+    {
+      SM_ASSERT_TRUE(Exception, L != NULL, "Null input");
+      cholmod_factor* copy = CholmodIndexTraits<index_t>::copy_factor(L, &_cholmod);
+      SM_ASSERT_FALSE(Exception, copy == NULL, "cholmod_copy_factor failed");
+      return copy;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::toSimplicialLL(cholmod_factor* L)
+    {
+      SM_ASSERT_TRUE(Exception, L != NULL, "Null input");
+      const int status = CholmodIndexTraits<index_t>::change_factor(CholmodValueTraits<double>::XType, 1, 0, 1, 1, L, &_cholmod);
+      return status != 0 && L->is_ll && !L->is_super && L->is_monotonic;
+    }
+
     template<typename I>
     size_t Cholmod<I>::getMemoryUsage() const {
       return _cholmod.memory_inuse;
@@ -5,7 +5,7 @@ namespace aslam {
   namespace backend {
 
     template<typename I>
-    CompressedColumnJacobianTransposeBuilder<I>::CompressedColumnJacobianTransposeBuilder() : _isInitialized(false)
+    CompressedColumnJacobianTransposeBuilder<I>::CompressedColumnJacobianTransposeBuilder() : _isInitialized(false), _deadlineExceeded(false)
     {
     }
 
@@ -83,8 +83,12 @@ namespace aslam {
     template<typename I>
     void CompressedColumnJacobianTransposeBuilder<I>::buildSystem(size_t nThreads, bool useMEstimator)
     {
+      instrumentation::ScopedTrace trace("Build system");
       _isJacobianBuiltFromJacobianTranspose = false;
+      _deadlineExceeded = false;
       setupThreadedJob(&CompressedColumnJacobianTransposeBuilder::evaluateJacobians, nThreads, useMEstimator);
+      if (_deadlineExceeded)
+        SM_THROW(util::Deadline::Exceeded, "The deadline passed before all Jacobians were evaluated");
     }
 
 
@@ -92,15 +96,28 @@ namespace aslam {
     template<typename I>
     void CompressedColumnJacobianTransposeBuilder<I>::evaluateJacobians(int /* threadId */, int startIdx, int endIdx, bool useMEstimator)
     {
-      Eigen::VectorXd ee;
+      instrumentation::ScopedTrace trace("Evaluate Jacobians (thread)");
       for (int i = startIdx; i < endIdx; ++i) {
-        JacobianContainerSparse<Eigen::Dynamic> jc(_jacobianPointers[i].errorTerm->dimension());
-        _jacobianPointers[i].errorTerm->getWeightedJacobians(jc, useMEstimator);
-        _J_transpose.writeJacobians(jc, _jacobianPointers[i].jcp);
+        if (UNLIKELY(_deadline.isExceeded())) {
+          _deadlineExceeded = true;
+          return;
+        }
+        linearizeErrorTerm(i, useMEstimator);
       }
     }
 
 
+    template<typename I>
+    void CompressedColumnJacobianTransposeBuilder<I>::linearizeErrorTerm(size_t i, bool useMEstimator)
+    {
+      SM_ASSERT_LT_DBG(std::runtime_error, i, _jacobianPointers.size(), "Index out of bounds");
+      JacobianContainerSparse<Eigen::Dynamic> jc(_jacobianPointers[i].errorTerm->dimension());
+      _jacobianPointers[i].errorTerm->getWeightedJacobians(jc, useMEstimator);
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly, *_jacobianPointers[i].errorTerm);
+      _J_transpose.writeJacobians(jc, _jacobianPointers[i].jcp);
+    }
+
+
     // /// \brief Get a view of the Jacobian as a cholmod sparse matrix.
     // cholmod_sparse CompressedColumnJacobianTransposeBuilder::getJacobianView()
     // {
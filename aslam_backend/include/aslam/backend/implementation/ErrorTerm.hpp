@@ -26,9 +26,7 @@ namespace aslam {
 
 
     template<int C>
-    ErrorTermFs<C>::ErrorTermFs() : 
-      _evalJacobianTimer("ErrorTerm: Evaluate Jacobian", true),
-      _buildHessianTimer("ErrorTerm: Build Hessian", true)
+    ErrorTermFs<C>::ErrorTermFs()
     {
       _sqrtInvR = inverse_covariance_t::Identity();
     }
@@ -103,16 +101,13 @@ namespace aslam {
     template<int C>
     void ErrorTermFs<C>::buildHessianImplementation(SparseBlockMatrix& outHessian, Eigen::VectorXd& outRhs, bool useMEstimator)
     {
-      _evalJacobianTimer.start();
       JacobianContainerSparse<Dimension> J(C);
       evaluateJacobians(J);
-      _evalJacobianTimer.stop();
-      _buildHessianTimer.start();
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly, *this);
       double sqrtWeight = 1.0;
       if (useMEstimator)
         sqrtWeight = sqrt(_mEstimatorPolicy->getWeight(getRawSquaredError()));
       J.evaluateHessian(_error, sqrtWeight * _sqrtInvR, outHessian, outRhs);
-      _buildHessianTimer.stop();
     }
 
     template<int C>
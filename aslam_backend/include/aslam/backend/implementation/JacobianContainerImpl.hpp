@@ -22,6 +22,37 @@ class JacobianContainerImplHelper {
     jc.addJacobian(dv, m1);
   }
 
+  /// \brief Multiplies the chain rule with a 3x3 Jacobian using a fully unrolled kernel
+  template <int R, typename JC, typename MATRIX>
+  EIGEN_ALWAYS_INLINE static void multiplyAndAddFixedSize(JC & jc, DesignVariable* dv, const MATRIX& jacobian)
+  {
+    const Eigen::Matrix3d J = jacobian.template cast<double>();
+    jc.addJacobian(dv, jc.template chainRuleMatrix<R, 3>()*J);
+  }
+
+  /// \brief Dispatches on the number of rows of containers with a dynamic number of rows
+  template <typename JC, typename MATRIX>
+  EIGEN_ALWAYS_INLINE static bool multiplyAndAddFixedSize(JC & jc, DesignVariable* dv, const MATRIX& jacobian, std::integral_constant<int, Eigen::Dynamic>)
+  {
+    static_assert(MatrixStack::MaxFixedSizeRows == 6, "Adapt the dispatch below");
+    switch (jc.rows()) {
+      case 1: multiplyAndAddFixedSize<1>(jc, dv, jacobian); return true;
+      case 2: multiplyAndAddFixedSize<2>(jc, dv, jacobian); return true;
+      case 3: multiplyAndAddFixedSize<3>(jc, dv, jacobian); return true;
+      case 4: multiplyAndAddFixedSize<4>(jc, dv, jacobian); return true;
+      case 5: multiplyAndAddFixedSize<5>(jc, dv, jacobian); return true;
+      case 6: multiplyAndAddFixedSize<6>(jc, dv, jacobian); return true;
+      default: return false;
+    }
+  }
+
+  template <typename JC, typename MATRIX, int R>
+  EIGEN_ALWAYS_INLINE static bool multiplyAndAddFixedSize(JC & jc, DesignVariable* dv, const MATRIX& jacobian, std::integral_constant<int, R>)
+  {
+    multiplyAndAddFixedSize<R>(jc, dv, jacobian);
+    return true;
+  }
+
  public:
   template<bool IS_IDENTITY = false, typename JC, typename MATRIX>
   EIGEN_ALWAYS_INLINE static void addImpl(JC & jc, DesignVariable* dv, const MATRIX & jacobian)
@@ -40,6 +71,10 @@ class JacobianContainerImplHelper {
     }
     else
     {
+      // Most local Jacobians are 3x3 (points, rotations), these get a fixed-size kernel
+      if (!IS_IDENTITY && jc.useFixedSizeChainRule() && jacobian.rows() == 3 && jacobian.cols() == 3
+          && multiplyAndAddFixedSize(jc, dv, jacobian, std::integral_constant<int, JC::RowsAtCompileTime>()))
+        return;
       const auto CR = jc.template chainRuleMatrix<JC::RowsAtCompileTime>();
       multiplyAndAdd(jc, dv, CR, jacobian.template cast<double>(), std::integral_constant<bool, IS_IDENTITY>());
     }
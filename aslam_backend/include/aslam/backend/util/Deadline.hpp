@@ -0,0 +1,52 @@
+#ifndef INCLUDE_ASLAM_BACKEND_DEADLINE_HPP_
+#define INCLUDE_ASLAM_BACKEND_DEADLINE_HPP_
+
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+#include <sm/assert_macros.hpp>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+/**
+ * \class Deadline
+ * \brief A point in time after which time bounded work is abandoned.
+ *
+ * A default constructed deadline never passes and checking it doesn't read the clock.
+ */
+class Deadline {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  SM_DEFINE_EXCEPTION(Exceeded, std::runtime_error);
+
+  Deadline() : _isSet(false) { }
+
+  /// \brief A deadline \p seconds from now
+  explicit Deadline(double seconds)
+      : _isSet(true), _end(Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds))) { }
+
+  bool isSet() const { return _isSet; }
+
+  /// \brief Has the deadline passed?
+  bool isExceeded() const { return _isSet && Clock::now() >= _end; }
+
+  /// \brief The seconds left until the deadline, negative once it passed and infinite if it is not set
+  double remaining() const {
+    if (!_isSet)
+      return std::numeric_limits<double>::infinity();
+    return std::chrono::duration<double>(_end - Clock::now()).count();
+  }
+
+ private:
+  bool _isSet;
+  Clock::time_point _end;
+};
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_DEADLINE_HPP_ */
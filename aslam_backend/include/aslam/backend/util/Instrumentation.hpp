@@ -0,0 +1,175 @@
+#ifndef INCLUDE_ASLAM_BACKEND_INSTRUMENTATION_HPP_
+#define INCLUDE_ASLAM_BACKEND_INSTRUMENTATION_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+
+#include "CommonDefinitions.hpp"
+
+namespace aslam {
+namespace backend {
+namespace instrumentation {
+
+/// \brief The phases of the optimization pipeline which are instrumented
+enum class Phase : int {
+  ErrorEvaluation,    ///< Evaluating the error of an error term
+  JacobianEvaluation, ///< Evaluating the Jacobians of an error term
+  Assembly,           ///< Writing Jacobians, Hessian blocks and right hand sides into the linear system
+  Factorization,      ///< Symbolic and numeric factorization of the linear system
+  Solve,              ///< Solving with an existing factorization
+  StateUpdate         ///< Applying or reverting a state update of the design variables
+};
+constexpr int NumPhases = 6;
+constexpr int NumHistogramBuckets = 32;
+/// \brief Error term types beyond this number are accounted to one common entry
+constexpr int MaxErrorTermTypes = 256;
+
+/// \brief Human readable name of a phase
+const char * name(Phase phase);
+
+/// \brief Durations accumulated for one phase
+struct Counters {
+  std::uint64_t count = 0;
+  std::uint64_t totalNs = 0;
+  std::uint64_t maxNs = 0;
+
+  double meanNs() const { return count == 0 ? 0.0 : double(totalNs) / double(count); }
+  void add(const Counters & other);
+};
+
+/// \brief Counters together with a histogram of the durations.
+///        Bucket b counts the durations in [2^b, 2^(b+1)) ns, the last bucket all longer ones.
+struct Statistics : public Counters {
+  Statistics() { histogram.fill(0); }
+  std::array<std::uint64_t, NumHistogramBuckets> histogram;
+
+  /// \brief Upper bound of the duration below which a fraction \p q of the samples lies.
+  ///        The resolution is the bucket width.
+  double quantileNs(double q) const;
+  void add(const Statistics & other);
+};
+
+/// \brief A snapshot of all recorded durations, aggregated over all threads
+struct Report {
+  std::array<Statistics, NumPhases> phases;
+  /// \brief Per error term type (demangled type name) and phase
+  std::map<std::string, std::array<Counters, NumPhases> > errorTermTypes;
+
+  const Statistics & phase(Phase p) const { return phases[static_cast<int>(p)]; }
+  void print(std::ostream & out) const;
+};
+
+namespace detail {
+  enum Flags : unsigned { Recording = 1u, Tracing = 2u };
+  extern std::atomic<unsigned> flags;
+  /// \brief Record and / or trace a finished scope
+  void finish(Phase phase, std::uint64_t start, const std::type_info * errorTermType, unsigned flags);
+  void trace(const char * name, std::uint64_t start);
+  inline std::uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+/// \brief Whether durations are recorded. Off by default.
+inline bool isEnabled() { return (detail::flags.load(std::memory_order_relaxed) & detail::Recording) != 0; }
+
+/// \brief Switch recording on or off for all threads
+void setEnabled(bool enabled);
+
+/// \brief Aggregate the counters of all threads, including the ones which already finished
+Report collect();
+
+/// \brief Reset all counters. Durations recorded concurrently may be lost.
+void reset();
+
+/// \brief Whether trace events are recorded. Off by default.
+inline bool isTracing() { return (detail::flags.load(std::memory_order_relaxed) & detail::Tracing) != 0; }
+
+/// \brief Discard all trace events and start tracing. Every thread writes into a ring buffer
+///        of \p eventsPerBuffer events, the oldest events are overwritten when it is full.
+void startTracing(std::size_t eventsPerBuffer = 1 << 15);
+
+/// \brief Stop tracing. The recorded events are kept until tracing is started again.
+void stopTracing();
+
+/// \brief Set the optimizer iteration attached to the trace events recorded from now on
+void setIteration(int iteration);
+
+/// \brief Write the recorded trace events in the Chrome trace event format,
+///        to be opened with chrome://tracing or Perfetto. Call it while no traced code runs.
+void writeChromeTrace(std::ostream & out);
+
+/// \brief Write the recorded trace events into a file in the Chrome trace event format
+void writeChromeTrace(const std::string & filename);
+
+/**
+ * \class ScopedPhase
+ * \brief Records the time spent in its scope for a phase, and optionally for the dynamic type of an error term
+ *
+ * Every thread records into its own counters, which are only read when collect() is called.
+ * Scopes without an error term also emit a trace event while tracing.
+ * While instrumentation and tracing are disabled a scope costs one relaxed atomic load.
+ */
+class ScopedPhase {
+ public:
+  explicit ScopedPhase(Phase phase) : ScopedPhase(phase, detail::flags.load(std::memory_order_relaxed)) { }
+
+  template <typename ErrorTermType>
+  ScopedPhase(Phase phase, const ErrorTermType & errorTerm) : ScopedPhase(phase, detail::flags.load(std::memory_order_relaxed) & detail::Recording) {
+    // Per error term scopes are too fine grained for a timeline
+    if (UNLIKELY(_flags != 0))
+      _type = &typeid(errorTerm);
+  }
+
+  ~ScopedPhase() {
+    if (UNLIKELY(_flags != 0))
+      detail::finish(_phase, _start, _type, _flags);
+  }
+
+  ScopedPhase(const ScopedPhase &) = delete;
+  ScopedPhase & operator=(const ScopedPhase &) = delete;
+
+ private:
+  ScopedPhase(Phase phase, unsigned flags) : _phase(phase), _type(nullptr), _flags(flags), _start(flags != 0 ? detail::now() : 0) { }
+
+  Phase _phase;
+  const std::type_info * _type;
+  unsigned _flags;
+  std::uint64_t _start;
+};
+
+/**
+ * \class ScopedTrace
+ * \brief Emits a trace event spanning its scope while tracing.
+ *
+ * \p name must outlive the trace, usually it is a string literal.
+ */
+class ScopedTrace {
+ public:
+  explicit ScopedTrace(const char * name) : _name(name), _active(isTracing()), _start(_active ? detail::now() : 0) { }
+
+  ~ScopedTrace() {
+    if (UNLIKELY(_active))
+      detail::trace(_name, _start);
+  }
+
+  ScopedTrace(const ScopedTrace &) = delete;
+  ScopedTrace & operator=(const ScopedTrace &) = delete;
+
+ private:
+  const char * _name;
+  bool _active;
+  std::uint64_t _start;
+};
+
+} // namespace instrumentation
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_INSTRUMENTATION_HPP_ */
@@ -4,6 +4,7 @@
 #include <sparse_block_matrix/linear_solver_cholmod.h>
 #include <sparse_block_matrix/linear_solver_spqr.h>
 #include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
 #include <sm/PropertyTree.hpp>
 
 namespace aslam {
@@ -63,12 +64,15 @@ namespace aslam {
       //       A little bit of effort should make this possible by initializing the structure and adding
       //       a mutex for each block and having writers for each jacobian that have a list of mutexes.
       //       Save it for later.
+      instrumentation::ScopedTrace trace("Build system");
       _H._M.clear(false);
       _rhs.setZero();
       std::vector<ErrorTerm*>::iterator it, it_end;
       it = _errorTerms.begin();
       it_end = _errorTerms.end();
       for (; it != it_end; ++it) {
+        if (UNLIKELY(_deadline.isExceeded()))
+          SM_THROW(util::Deadline::Exceeded, "The deadline passed before all error terms were processed");
         (*it)->buildHessian(_H._M, _rhs, useMEstimator);
       }
     }
@@ -88,7 +92,12 @@ namespace aslam {
       }
       // Solve the system
       outDx.resize(_H._M.rows());
-      bool solutionSuccess = _solver->solve(_H._M, &outDx[0], &_rhs[0]);
+      bool solutionSuccess;
+      {
+        // The block solver factorizes and solves in one call
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+        solutionSuccess = _solver->solve(_H._M, &outDx[0], &_rhs[0]);
+      }
       if (_useDiagonalConditioner) {
         // Un-augment the diagonal
         int rowBase = 0;
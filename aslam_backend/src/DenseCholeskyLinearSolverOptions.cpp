@@ -0,0 +1,41 @@
+#include "aslam/backend/DenseCholeskyLinearSolverOptions.h"
+
+namespace aslam {
+  namespace backend {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+    DenseCholeskyLinearSolverOptions::DenseCholeskyLinearSolverOptions() :
+        useLdlt(false),
+        minReciprocalCondition(1e-12),
+        rowBlockSize(64),
+        threadMemoryBudget(size_t(1) << 28) {
+    }
+
+    DenseCholeskyLinearSolverOptions::DenseCholeskyLinearSolverOptions(
+        const DenseCholeskyLinearSolverOptions& other) :
+        useLdlt(other.useLdlt),
+        minReciprocalCondition(other.minReciprocalCondition),
+        rowBlockSize(other.rowBlockSize),
+        threadMemoryBudget(other.threadMemoryBudget) {
+    }
+
+    DenseCholeskyLinearSolverOptions&
+    DenseCholeskyLinearSolverOptions::operator =
+        (const DenseCholeskyLinearSolverOptions& other) {
+      if (this != &other) {
+        useLdlt = other.useLdlt;
+        minReciprocalCondition = other.minReciprocalCondition;
+        rowBlockSize = other.rowBlockSize;
+        threadMemoryBudget = other.threadMemoryBudget;
+      }
+      return *this;
+    }
+
+    DenseCholeskyLinearSolverOptions::~DenseCholeskyLinearSolverOptions() {
+    }
+
+  }
+}
@@ -0,0 +1,217 @@
+#include <aslam/backend/DenseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/JacobianContainerSparse.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <Eigen/Dense>
+#include <boost/bind.hpp>
+#include <sm/PropertyTree.hpp>
+
+#include <memory>
+
+namespace aslam {
+  namespace backend {
+
+    namespace {
+
+      /// \brief Factorize the lower triangle of A in place and solve A x = b.
+      ///        Returns false if the factorization failed or is ill-conditioned.
+      template <typename Decomposition>
+      bool factorizeInPlaceAndSolve(Eigen::MatrixXd& A, const Eigen::VectorXd& b, double minReciprocalCondition, Eigen::VectorXd& outX)
+      {
+        std::unique_ptr<Decomposition> decomposition;
+        {
+          instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+          decomposition.reset(new Decomposition(A));
+        }
+        if (decomposition->info() != Eigen::Success || !(decomposition->rcond() >= minReciprocalCondition))
+          return false;
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
+        outX = decomposition->solve(b);
+        return true;
+      }
+
+    }
+
+    DenseCholeskyLinearSystemSolver::DenseCholeskyLinearSystemSolver(const DenseCholeskyLinearSolverOptions& options) :
+        _numQrFallbacks(0), _options(options) {
+    }
+
+    DenseCholeskyLinearSystemSolver::DenseCholeskyLinearSystemSolver(const sm::PropertyTree& config) :
+        _numQrFallbacks(0) {
+      // USING C++11 would allow to do constructor delegation and more elegant code
+      _options.useLdlt = config.getBool("useLdlt", _options.useLdlt);
+      _options.minReciprocalCondition = config.getDouble("minReciprocalCondition", _options.minReciprocalCondition);
+      _options.rowBlockSize = config.getInt("rowBlockSize", _options.rowBlockSize);
+      _options.threadMemoryBudget = config.getInt("threadMemoryBudget", _options.threadMemoryBudget);
+    }
+
+    DenseCholeskyLinearSystemSolver::~DenseCholeskyLinearSystemSolver()
+    {
+    }
+
+    void DenseCholeskyLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& /* dvs */, const std::vector<ErrorTerm*>& /* errors */, bool useDiagonalConditioner)
+    {
+      _useDiagonalConditioner = useDiagonalConditioner;
+      _H.resize(_JCols, _JCols);
+      _hessianDiagonal.resize(_JCols);
+      _threadHessians.clear();
+      _threadRhs.clear();
+      _threadRowBlocks.clear();
+      _threadRowBlockErrors.clear();
+    }
+
+    void DenseCholeskyLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
+    {
+      instrumentation::ScopedTrace trace("Build system");
+      // Every thread but the first one needs its own copy of the normal equations
+      const size_t hessianBytes = std::max<size_t>(1, _JCols * _JCols * sizeof(double));
+      nThreads = std::max<size_t>(1, std::min(std::min(nThreads, _errorTerms.size()), 1 + _options.threadMemoryBudget / hessianBytes));
+      _threadHessians.resize(nThreads - 1);
+      _threadRhs.resize(nThreads - 1);
+      for (size_t t = 0; t + 1 < nThreads; ++t) {
+        _threadHessians[t].setZero(_JCols, _JCols);
+        _threadRhs[t].setZero(_JCols);
+      }
+      _threadRowBlocks.resize(nThreads);
+      _threadRowBlockErrors.resize(nThreads);
+      for (size_t t = 0; t < nThreads; ++t) {
+        _threadRowBlocks[t].setZero(_options.rowBlockSize, _JCols);
+        _threadRowBlockErrors[t].setZero(_options.rowBlockSize);
+      }
+      _H.setZero();
+      _rhs.setZero(_JCols);
+
+      // The errors were evaluated before, the Jacobians are evaluated and accumulated per error term
+      setupThreadedJob(boost::bind(&DenseCholeskyLinearSystemSolver::accumulateNormalEquations, this, _1, _2, _3, _4), nThreads, useMEstimator);
+
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly);
+      for (size_t t = 0; t + 1 < nThreads; ++t) {
+        _H.triangularView<Eigen::Upper>() += _threadHessians[t];
+        _rhs += _threadRhs[t];
+      }
+      _hessianDiagonal = _H.diagonal();
+    }
+
+    void DenseCholeskyLinearSystemSolver::accumulateNormalEquations(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator)
+    {
+      instrumentation::ScopedTrace trace("Accumulate normal equations (thread)");
+      Eigen::MatrixXd& H = threadId == 0 ? _H : _threadHessians[threadId - 1];
+      Eigen::VectorXd& rhs = threadId == 0 ? _rhs : _threadRhs[threadId - 1];
+      Eigen::MatrixXd& rowBlock = _threadRowBlocks[threadId];
+      Eigen::VectorXd& rowBlockErrors = _threadRowBlockErrors[threadId];
+      size_t numRows = 0;
+      for (size_t i = startIdx; i < endIdx; ++i) {
+        if (deadlinePassed())
+          return;
+        ErrorTerm* e = _errorTerms[i];
+        const size_t dim = e->dimension();
+        JacobianContainerSparse<Eigen::Dynamic> jc(dim);
+        e->getWeightedJacobians(jc, useMEstimator);
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly, *e);
+        const auto ei = _e.segment(e->rowBase(), dim);
+        size_t cols = 0;
+        for (auto it = jc.begin(); it != jc.end(); ++it)
+          cols += it->second.cols();
+
+        if (2 * cols >= _JCols && dim <= _options.rowBlockSize) {
+          // The error term touches most of the normal equations: collect its rows for a rank-k update
+          if (numRows + dim > _options.rowBlockSize) {
+            flushRowBlock(threadId, numRows);
+            numRows = 0;
+          }
+          for (auto it = jc.begin(); it != jc.end(); ++it)
+            rowBlock.block(numRows, it->first->columnBase(), dim, it->second.cols()) = it->second;
+          rowBlockErrors.segment(numRows, dim) = ei;
+          numRows += dim;
+        } else {
+          // Update the blocks of the design variable pairs in the upper triangle
+          for (auto a = jc.begin(); a != jc.end(); ++a) {
+            const int ca = a->first->columnBase();
+            rhs.segment(ca, a->second.cols()).noalias() += a->second.transpose() * ei;
+            for (auto b = jc.begin(); b != jc.end(); ++b) {
+              const int cb = b->first->columnBase();
+              if (cb >= ca)
+                H.block(ca, cb, a->second.cols(), b->second.cols()).noalias() += a->second.transpose() * b->second;
+            }
+          }
+        }
+      }
+      flushRowBlock(threadId, numRows);
+    }
+
+    void DenseCholeskyLinearSystemSolver::flushRowBlock(size_t threadId, size_t numRows)
+    {
+      if (numRows == 0)
+        return;
+      Eigen::MatrixXd& H = threadId == 0 ? _H : _threadHessians[threadId - 1];
+      Eigen::VectorXd& rhs = threadId == 0 ? _rhs : _threadRhs[threadId - 1];
+      auto rows = _threadRowBlocks[threadId].topRows(numRows);
+      H.selfadjointView<Eigen::Upper>().rankUpdate(rows.transpose());
+      rhs.noalias() += rows.transpose() * _threadRowBlockErrors[threadId].head(numRows);
+      rows.setZero();
+    }
+
+    bool DenseCholeskyLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
+    {
+      const Eigen::Index n = _JCols;
+      Eigen::VectorXd diagonal = _hessianDiagonal;
+      if (_useDiagonalConditioner)
+        diagonal += _diagonalConditioner.cwiseAbs2();
+
+      // The damped system is copied into the lower triangle and factorized in place. The strictly upper
+      // triangle and _hessianDiagonal keep the undamped system for the next solve.
+      for (Eigen::Index j = 0; j + 1 < n; ++j)
+        _H.col(j).tail(n - j - 1) = _H.row(j).tail(n - j - 1).transpose();
+      _H.diagonal() = diagonal;
+      const bool success = _options.useLdlt ?
+          factorizeInPlaceAndSolve< Eigen::LDLT<Eigen::Ref<Eigen::MatrixXd>, Eigen::Lower> >(_H, _rhs, _options.minReciprocalCondition, outDx) :
+          factorizeInPlaceAndSolve< Eigen::LLT<Eigen::Ref<Eigen::MatrixXd>, Eigen::Lower> >(_H, _rhs, _options.minReciprocalCondition, outDx);
+      if (success)
+        return true;
+
+      // Singular or ill-conditioned: fall back to a rank revealing QR decomposition of the damped normal equations
+      ++_numQrFallbacks;
+      const Eigen::MatrixXd upper = _H.triangularView<Eigen::StrictlyUpper>();
+      Eigen::MatrixXd A = upper + upper.transpose();
+      A.diagonal() = diagonal;
+      Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr;
+      {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+        qr.compute(A);
+      }
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
+      outDx = qr.solve(_rhs);
+      return true;
+    }
+
+    double DenseCholeskyLinearSystemSolver::rhsJtJrhs()
+    {
+      // rhs^T J^T J rhs from the upper triangle
+      const Eigen::VectorXd upperRhs = _H.triangularView<Eigen::StrictlyUpper>() * _rhs;
+      return _rhs.dot(_hessianDiagonal.cwiseProduct(_rhs)) + 2.0 * _rhs.dot(upperRhs);
+    }
+
+    void DenseCholeskyLinearSystemSolver::getHessian(Eigen::MatrixXd& outH) const
+    {
+      const Eigen::MatrixXd upper = _H.triangularView<Eigen::StrictlyUpper>();
+      outH = upper + upper.transpose();
+      outH.diagonal() = _hessianDiagonal;
+    }
+
+    const DenseCholeskyLinearSolverOptions&
+    DenseCholeskyLinearSystemSolver::getOptions() const {
+      return _options;
+    }
+
+    DenseCholeskyLinearSolverOptions&
+    DenseCholeskyLinearSystemSolver::getOptions() {
+      return _options;
+    }
+
+    void DenseCholeskyLinearSystemSolver::setOptions(
+        const DenseCholeskyLinearSolverOptions& options) {
+      _options = options;
+    }
+
+  } // namespace backend
+} // namespace aslam
@@ -25,16 +25,25 @@ namespace aslam {
 /* Constructors and Destructor                                                */
 /******************************************************************************/
 
-      DenseQRLinearSolverOptions::DenseQRLinearSolverOptions() {}
-        
-      
+    DenseQRLinearSolverOptions::DenseQRLinearSolverOptions() :
+        useSinglePrecision(false),
+        maxRefinementIterations(5),
+        refinementTolerance(1e-12) {
+    }
+
     DenseQRLinearSolverOptions::DenseQRLinearSolverOptions(
-        const DenseQRLinearSolverOptions& /* other */) {
+        const DenseQRLinearSolverOptions& other) :
+        useSinglePrecision(other.useSinglePrecision),
+        maxRefinementIterations(other.maxRefinementIterations),
+        refinementTolerance(other.refinementTolerance) {
     }
 
     DenseQRLinearSolverOptions& DenseQRLinearSolverOptions::operator =
         (const DenseQRLinearSolverOptions& other) {
       if (this != &other) {
+        useSinglePrecision = other.useSinglePrecision;
+        maxRefinementIterations = other.maxRefinementIterations;
+        refinementTolerance = other.refinementTolerance;
       }
       return *this;
     }
@@ -1,5 +1,7 @@
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
 #include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <algorithm>
 #include <Eigen/Dense> // householderQr.solve
 #include <sm/PropertyTree.hpp>
 
@@ -10,9 +12,11 @@ namespace aslam {
         _options(options) {
     }
 
-  DenseQrLinearSystemSolver::DenseQrLinearSystemSolver(const sm::PropertyTree& /* config */) {
-      // NO OPTIONS CURRENTLY IMPLEMENTED
+  DenseQrLinearSystemSolver::DenseQrLinearSystemSolver(const sm::PropertyTree& config) {
       // USING C++11 would allow to do constructor delegation and more elegant code
+      _options.useSinglePrecision = config.getBool("useSinglePrecision", _options.useSinglePrecision);
+      _options.maxRefinementIterations = config.getInt("maxRefinementIterations", _options.maxRefinementIterations);
+      _options.refinementTolerance = config.getDouble("refinementTolerance", _options.refinementTolerance);
     }
 
     DenseQrLinearSystemSolver::~DenseQrLinearSystemSolver()
@@ -21,25 +25,42 @@ namespace aslam {
 
     const Matrix* DenseQrLinearSystemSolver::Jacobian() const
     {
-      return &_J;
+      return _options.useSinglePrecision ? nullptr : &_J;
     }
 
-  void DenseQrLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& /* dvs */, const std::vector<ErrorTerm*>& /* errors */, bool /* useDiagonalConditioner */)
+  void DenseQrLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& /* dvs */, const std::vector<ErrorTerm*>& /* errors */, bool useDiagonalConditioner)
     {
+      _useDiagonalConditioner = useDiagonalConditioner;
       // \todo Verify that this is similar to the "reserve()" feature in a standard vector.
-      _J._M.resize(_JRows, _JCols);
+      if (_options.useSinglePrecision) {
+        // Room for the rows of the diagonal conditioner, so damped solves don't reallocate
+        _Jf.resize(_JRows + (useDiagonalConditioner ? _JCols : 0), _JCols);
+        _J._M.resize(0, 0);
+      } else {
+        _J._M.resize(_JRows, _JCols);
+        _Jf.resize(0, 0);
+      }
     }
 
     void DenseQrLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
     {
-      _J._M.setZero();
-      setupThreadedJob(boost::bind(&DenseQrLinearSystemSolver::evaluateJacobians, this, _1, _2, _3, _4), nThreads, useMEstimator);
-      _rhs = _J._M.transpose() * _e;
+      instrumentation::ScopedTrace trace("Build system");
+      if (!takeEvaluatedJacobians(useMEstimator)) {
+        beginJacobianEvaluation();
+        setupThreadedJob(boost::bind(&DenseQrLinearSystemSolver::evaluateJacobians, this, _1, _2, _3, _4), nThreads, useMEstimator);
+      }
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly);
+      if (_options.useSinglePrecision)
+        leftMultiplySinglePrecision(_e, _rhs);
+      else
+        _rhs = _J._M.transpose() * _e;
     }
 
 
     bool DenseQrLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
     {
+      if (_options.useSinglePrecision)
+        return solveSystemSinglePrecision(outDx);
       if (_useDiagonalConditioner) {
         // Append the diagonal. Thanks to the ceres developers for this trick.
         _J._M.conservativeResize(_JRows + _JCols, Eigen::NoChange);
@@ -48,7 +69,15 @@ namespace aslam {
         _e.conservativeResize(_JRows + _JCols);
         _e.tail(_JCols) = Eigen::VectorXd::Zero(_JCols);
       }
-      outDx = _J._M.colPivHouseholderQr().solve(_e);
+      Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr;
+      {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+        qr.compute(_J._M);
+      }
+      {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
+        outDx = qr.solve(_e);
+      }
       if (_useDiagonalConditioner) {
         // Remove the diagonal
         _J._M.conservativeResize(_JRows, Eigen::NoChange);
@@ -57,17 +86,94 @@ namespace aslam {
       return true;
     }
 
+    bool DenseQrLinearSystemSolver::solveSystemSinglePrecision(Eigen::VectorXd& outDx)
+    {
+      if (_useDiagonalConditioner) {
+        // Same augmentation as in double precision, in the rows preallocated for it
+        _Jf.bottomRows(_JCols) = _diagonalConditioner.cast<float>().asDiagonal();
+      }
+      Eigen::ColPivHouseholderQR<Eigen::MatrixXf> qr;
+      {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+        qr.compute(_Jf);
+      }
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
+      Eigen::VectorXf ef = Eigen::VectorXf::Zero(_Jf.rows());
+      ef.head(_JRows) = _e.cast<float>();
+      outDx = qr.solve(ef).cast<double>();
+
+      // Iterative refinement on the normal equations (J^T J + D^2) dx = J^T e. The residual is
+      // accumulated in double, the correction reuses the single precision factor
+      // J P = Q R, i.e. J^T J = P R^T R P^T. A rank deficient factor can't be refined.
+      if (qr.rank() < _Jf.cols())
+        return true;
+      const auto R = qr.matrixR().topLeftCorner(_JCols, _JCols).triangularView<Eigen::Upper>();
+      Eigen::VectorXd Jdx, r;
+      for (size_t i = 0; i < _options.maxRefinementIterations; ++i) {
+        rightMultiplySinglePrecision(outDx, Jdx);
+        leftMultiplySinglePrecision(_e - Jdx, r);
+        if (_useDiagonalConditioner)
+          r -= _diagonalConditioner.cwiseAbs2().cwiseProduct(outDx);
+        Eigen::VectorXf correction = qr.colsPermutation().transpose() * r.cast<float>();
+        R.transpose().solveInPlace(correction);
+        R.solveInPlace(correction);
+        const Eigen::VectorXd ddx = (qr.colsPermutation() * correction).cast<double>();
+        outDx += ddx;
+        if (ddx.norm() <= _options.refinementTolerance * outDx.norm())
+          break;
+      }
+      return true;
+    }
+
+    void DenseQrLinearSystemSolver::rightMultiplySinglePrecision(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const
+    {
+      // Column by column to not materialize a double copy of the Jacobian
+      outY.setZero(_JRows);
+      for (Eigen::Index c = 0; c < _Jf.cols(); ++c)
+        outY.noalias() += _Jf.col(c).head(_JRows).cast<double>() * x[c];
+    }
+
+    void DenseQrLinearSystemSolver::leftMultiplySinglePrecision(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const
+    {
+      outY.resize(_Jf.cols());
+      for (Eigen::Index c = 0; c < _Jf.cols(); ++c)
+        outY[c] = _Jf.col(c).head(_JRows).cast<double>().dot(x);
+    }
+
 
   void DenseQrLinearSystemSolver::evaluateJacobians(size_t /* threadId */, size_t startIdx, size_t endIdx, bool useMEstimator)
     {
+      instrumentation::ScopedTrace trace("Evaluate Jacobians (thread)");
       for (size_t i = startIdx; i < endIdx; ++i) {
-        JacobianContainerSparse<Eigen::Dynamic> jc(_errorTerms[i]->dimension());
-        ErrorTerm* e = _errorTerms[i];
-        e->getWeightedJacobians(jc, useMEstimator);
-        auto it = jc.begin();
-        for (; it != jc.end(); ++it) {
+        if (deadlinePassed())
+          return;
+        linearizeErrorTerm(i, useMEstimator);
+      }
+    }
+
+    void DenseQrLinearSystemSolver::beginJacobianEvaluation()
+    {
+      if (_options.useSinglePrecision) {
+        SM_ASSERT_EQ(Exception, (size_t)_Jf.cols(), _JCols, "The precision was changed after the matrix structure was initialized");
+        _Jf.topRows(_JRows).setZero();
+      } else {
+        SM_ASSERT_EQ(Exception, (size_t)_J._M.rows(), _JRows, "The precision was changed after the matrix structure was initialized");
+        _J._M.setZero();
+      }
+    }
+
+    void DenseQrLinearSystemSolver::linearizeErrorTerm(size_t i, bool useMEstimator)
+    {
+      JacobianContainerSparse<Eigen::Dynamic> jc(_errorTerms[i]->dimension());
+      ErrorTerm* e = _errorTerms[i];
+      e->getWeightedJacobians(jc, useMEstimator);
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly, *e);
+      auto it = jc.begin();
+      for (; it != jc.end(); ++it) {
+        if (_options.useSinglePrecision)
+          _Jf.block(e->rowBase(), it->first->columnBase(), it->second.rows(), it->second.cols()) = it->second.cast<float>();
+        else
           _J._M.block(e->rowBase(), it->first->columnBase(), it->second.rows(), it->second.cols()) = it->second;
-        }
       }
     }
 
@@ -89,7 +195,10 @@ namespace aslam {
       
     double DenseQrLinearSystemSolver::rhsJtJrhs() {
         Eigen::VectorXd Jrhs;
-        _J.rightMultiply(_rhs, Jrhs);
+        if (_options.useSinglePrecision)
+          rightMultiplySinglePrecision(_rhs, Jrhs);
+        else
+          _J.rightMultiply(_rhs, Jrhs);
         return Jrhs.squaredNorm();
     }
       
@@ -97,8 +206,14 @@ namespace aslam {
 
     const Eigen::MatrixXd& DenseQrLinearSystemSolver::getJacobian() const
     {
+     SM_ASSERT_FALSE(Exception, _options.useSinglePrecision, "The Jacobian is stored in single precision");
      return _J._M;
     }
 
+    Eigen::MatrixXf::ConstRowsBlockXpr DenseQrLinearSystemSolver::getJacobianSinglePrecision() const
+    {
+     return _Jf.topRows(std::min<Eigen::Index>(_JRows, _Jf.rows()));
+    }
+
   } // namespace backend
 } // namespace aslam
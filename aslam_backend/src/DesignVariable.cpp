@@ -1,11 +1,13 @@
 #include <aslam/backend/DesignVariable.hpp>
 #include <aslam/backend/CacheInterface.hpp>
 
+#include <atomic>
+
 namespace aslam {
   namespace backend {
 
     DesignVariable::DesignVariable() :
-      _blockIndex(-1), _columnBase(-1), _isMarginalized(false), _isActive(false), _scaling(1.0)
+      _blockIndex(-1), _columnBase(-1), _isMarginalized(false), _isActive(false), _scaling(1.0), _version(nextVersion())
     {
     }
 
@@ -75,6 +77,23 @@ namespace aslam {
     _cacheNodes.push_back(cn);
   }
 
+  std::uint64_t DesignVariable::nextVersion() {
+    static std::atomic<std::uint64_t> counter(0);
+    return ++counter;
+  }
+
+  namespace {
+    std::atomic<std::uint64_t> constantsVersionStamp(0);
+  }
+
+  void DesignVariable::invalidateConstants() {
+    constantsVersionStamp.store(nextVersion(), std::memory_order_release);
+  }
+
+  std::uint64_t DesignVariable::constantsVersion() {
+    return constantsVersionStamp.load(std::memory_order_acquire);
+  }
+
   void DesignVariable::invalidateCacheImplementation() {
     // reset the cache
     for (const auto cn : _cacheNodes) {
@@ -14,6 +14,7 @@ namespace aslam {
     /// \brief evaluate the Jacobians.
     void ErrorTerm::evaluateJacobians(JacobianContainer & outJ)
     {
+      instrumentation::ScopedPhase phase(instrumentation::Phase::JacobianEvaluation, *this);
       evaluateJacobiansImplementation(outJ);
     }
 
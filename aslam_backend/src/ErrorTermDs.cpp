@@ -9,9 +9,7 @@ namespace aslam {
 
     ErrorTermDs::ErrorTermDs(int dimensionErrorTerm) : 
         _jacobians(dimensionErrorTerm),
-        _dimensionErrorTerm(dimensionErrorTerm),
-        _evalJacobianTimer("ErrorTerm: Evaluate Jacobian", true),
-        _buildHessianTimer("ErrorTerm: Build Hessian", true)
+        _dimensionErrorTerm(dimensionErrorTerm)
     {
       _sqrtInvR = inverse_covariance_t::Identity(dimensionErrorTerm, dimensionErrorTerm);
     }
@@ -78,15 +76,12 @@ namespace aslam {
     void ErrorTermDs::buildHessianImplementation(SparseBlockMatrix& outHessian, Eigen::VectorXd& outRhs, bool useMEstimator)
     {
       JacobianContainerSparse<Eigen::Dynamic> J(dimension());
-      _evalJacobianTimer.start();
       evaluateJacobians(J);
-      _evalJacobianTimer.stop();
-      _buildHessianTimer.start();
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly, *this);
       double sqrtWeight = 1.0;
       if (useMEstimator)
         sqrtWeight = sqrt(_mEstimatorPolicy->getWeight(getRawSquaredError()));
       J.evaluateHessian(_error, sqrtWeight * _sqrtInvR, outHessian, outRhs);
-      _buildHessianTimer.stop();
     }
 
     void ErrorTermDs::clearJacobians()
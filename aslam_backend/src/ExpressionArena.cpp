@@ -0,0 +1,96 @@
+#include <aslam/backend/ExpressionArena.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <aslam/Exceptions.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    namespace {
+      thread_local ExpressionArena * currentArena = nullptr;
+    }
+
+    struct ExpressionArena::Slabs {
+      explicit Slabs(std::size_t slabSize) : slabSize(slabSize) { }
+      ~Slabs() {
+        for (char * slab : slabs)
+          std::free(slab);
+      }
+      std::size_t slabSize;
+      std::vector<char *> slabs;
+      char * cursor = nullptr;
+      std::size_t remaining = 0;
+      std::size_t bytesAllocated = 0;
+    };
+
+    ExpressionArena::Scope::Scope(ExpressionArena & arena) : _previous(currentArena)
+    {
+      currentArena = &arena;
+    }
+
+    ExpressionArena::Scope::~Scope()
+    {
+      currentArena = _previous;
+    }
+
+    ExpressionArena::ExpressionArena(std::size_t slabSize) : _slabSize(slabSize), _slabs(new Slabs(slabSize))
+    {
+      SM_ASSERT_GT(aslam::Exception, slabSize, 0u, "The slab size has to be positive");
+    }
+
+    ExpressionArena::~ExpressionArena()
+    {
+    }
+
+    void * ExpressionArena::allocate(std::size_t size, std::size_t alignment)
+    {
+      return allocate(*_slabs, size, alignment);
+    }
+
+    void * ExpressionArena::allocate(Slabs & slabs, std::size_t size, std::size_t alignment)
+    {
+      std::size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(slabs.cursor) % alignment) % alignment;
+      if (slabs.cursor == nullptr || padding + size > slabs.remaining) {
+        // Oversized requests get a slab of their own
+        const std::size_t slabSize = std::max(slabs.slabSize, size + alignment);
+        char * slab = static_cast<char *>(std::malloc(slabSize));
+        if (slab == nullptr)
+          throw std::bad_alloc();
+        slabs.slabs.push_back(slab);
+        slabs.cursor = slab;
+        slabs.remaining = slabSize;
+        padding = (alignment - reinterpret_cast<std::uintptr_t>(slab) % alignment) % alignment;
+      }
+      void * p = slabs.cursor + padding;
+      slabs.cursor += padding + size;
+      slabs.remaining -= padding + size;
+      slabs.bytesAllocated += size;
+      return p;
+    }
+
+    void ExpressionArena::release()
+    {
+      _slabs.reset(new Slabs(_slabSize));
+    }
+
+    std::size_t ExpressionArena::numSlabs() const
+    {
+      return _slabs->slabs.size();
+    }
+
+    std::size_t ExpressionArena::numBytesAllocated() const
+    {
+      return _slabs->bytesAllocated;
+    }
+
+    ExpressionArena * ExpressionArena::current()
+    {
+      return currentArena;
+    }
+
+  } // namespace backend
+} // namespace aslam
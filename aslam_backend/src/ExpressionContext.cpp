@@ -0,0 +1,73 @@
+#include <aslam/backend/ExpressionContext.hpp>
+
+#include <algorithm>
+
+namespace aslam {
+  namespace backend {
+
+    namespace {
+      thread_local ExpressionContext * currentContext = nullptr;
+      const std::size_t kMinPurgeThreshold = 1024;
+    }
+
+    ExpressionContext::Scope::Scope(ExpressionContext & context) : _previous(currentContext)
+    {
+      currentContext = &context;
+    }
+
+    ExpressionContext::Scope::~Scope()
+    {
+      currentContext = _previous;
+    }
+
+    ExpressionContext::ExpressionContext() : _purgeThreshold(kMinPurgeThreshold)
+    {
+    }
+
+    ExpressionContext::~ExpressionContext()
+    {
+    }
+
+    void ExpressionContext::registerEntry(std::size_t hash, std::unique_ptr<Entry> entry)
+    {
+      if (_table.size() >= _purgeThreshold) {
+        purge();
+        _purgeThreshold = std::max(kMinPurgeThreshold, 2 * _table.size());
+      }
+      _table.emplace(hash, std::move(entry));
+    }
+
+    std::size_t ExpressionContext::numUniqueNodes() const
+    {
+      std::size_t n = 0;
+      for (const auto & entry : _table)
+        if (!entry.second->node.expired())
+          ++n;
+      return n;
+    }
+
+    void ExpressionContext::clear()
+    {
+      _table.clear();
+      _purgeThreshold = kMinPurgeThreshold;
+      _numLookups = 0;
+      _numHits = 0;
+    }
+
+    void ExpressionContext::purge()
+    {
+      for (auto it = _table.begin(); it != _table.end(); ) {
+        if (it->second->node.expired())
+          it = _table.erase(it);
+        else
+          ++it;
+      }
+    }
+
+    ExpressionContext * ExpressionContext::current()
+    {
+      return currentContext;
+    }
+
+  } // namespace backend
+} // namespace aslam
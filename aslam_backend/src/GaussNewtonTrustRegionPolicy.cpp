@@ -38,6 +38,11 @@ namespace aslam {
             return false;
         }
 
+        bool GaussNewtonTrustRegionPolicy::linearizesEveryStep() const
+        {
+            return true;
+        }
+
     bool GaussNewtonTrustRegionPolicy::requiresAugmentedDiagonal() const {
       return false;
     }
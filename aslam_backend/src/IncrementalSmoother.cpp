@@ -0,0 +1,653 @@
+#include <aslam/backend/IncrementalSmoother.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+#include <aslam/backend/Cholmod.hpp>
+#include <aslam/backend/JacobianContainerSparse.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <sm/PropertyTree.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    IncrementalSmootherOptions::IncrementalSmootherOptions() {}
+
+    IncrementalSmootherOptions::IncrementalSmootherOptions(const sm::ConstPropertyTree& config) {
+      relinearizeThreshold = config.getDouble("relinearizeThreshold", relinearizeThreshold);
+      relinearizeInterval = config.getInt("relinearizeInterval", relinearizeInterval);
+      reorderInterval = config.getInt("reorderInterval", reorderInterval);
+      wildfireThreshold = config.getDouble("wildfireThreshold", wildfireThreshold);
+      useMEstimator = config.getBool("useMEstimator", useMEstimator);
+      verbose = config.getBool("verbose", verbose);
+    }
+
+    IncrementalSmoother::IncrementalSmoother(const Options& options) :
+        _options(options), _residual(0.0), _numUpdates(0)
+    {
+    }
+
+    IncrementalSmoother::IncrementalSmoother(const sm::ConstPropertyTree& config) :
+        _options(config), _residual(0.0), _numUpdates(0)
+    {
+    }
+
+    IncrementalSmoother::~IncrementalSmoother()
+    {
+    }
+
+    void IncrementalSmoother::update(const std::vector<DesignVariable*>& newDesignVariables, const std::vector<ErrorTerm*>& newErrorTerms)
+    {
+      instrumentation::ScopedTrace trace("Incremental smoother update");
+      _lastUpdate = UpdateStatistics();
+      _lastUpdate.numNewDesignVariables = newDesignVariables.size();
+      _lastUpdate.numNewErrorTerms = newErrorTerms.size();
+      ++_numUpdates;
+
+      _recentVariables.clear();
+      for (DesignVariable* dv : newDesignVariables) {
+        addVariable(dv);
+        _recentVariables.push_back(_variables.size() - 1);
+      }
+      std::vector<size_t> newFactors;
+      newFactors.reserve(newErrorTerms.size());
+      for (ErrorTerm* errorTerm : newErrorTerms) {
+        newFactors.push_back(addFactor(errorTerm));
+        const Factor& factor = _factors.back();
+        _recentVariables.insert(_recentVariables.end(), factor.variables.begin(), factor.variables.end());
+      }
+      std::sort(_recentVariables.begin(), _recentVariables.end());
+      _recentVariables.erase(std::unique(_recentVariables.begin(), _recentVariables.end()), _recentVariables.end());
+
+      linearize(newFactors);
+
+      const bool relinearizing = _options.relinearizeInterval > 0 && _numUpdates % _options.relinearizeInterval == 0;
+      const bool reordering = _options.reorderInterval > 0 && _numUpdates % _options.reorderInterval == 0;
+      // When reordering, the new factors are factorized with all others
+      if (!reordering) {
+        for (size_t f : newFactors)
+          addFactorRows(_factors[f]);
+      }
+      std::vector<size_t> relinearizedFactors;
+      if (relinearizing)
+        relinearizedFactors = relinearizeVariables();
+      if (reordering || !relinearizedFactors.empty())
+        refactor(reordering, relinearizedFactors);
+      backSubstitute();
+
+      _options.verbose && std::cout << "Incremental smoother update " << _numUpdates << ": " << _lastUpdate.numNewDesignVariables
+          << " new design variables, " << _lastUpdate.numNewErrorTerms << " new error terms, "
+          << _lastUpdate.numRelinearizedDesignVariables << " relinearized design variables, "
+          << _lastUpdate.numGivensRotations << " Givens rotations, " << _lastUpdate.numRefactoredRows << " refactored rows, "
+          << _lastUpdate.numBackSubstitutedRows << " back substituted rows"
+          << (_lastUpdate.refactored ? ", refactored" : "") << (_lastUpdate.reordered ? ", reordered" : "") << std::endl;
+    }
+
+    void IncrementalSmoother::relinearize(bool reorder)
+    {
+      _lastUpdate = UpdateStatistics();
+      const std::vector<size_t> factors = relinearizeVariables();
+      if (reorder || !factors.empty())
+        refactor(reorder, factors);
+      backSubstitute();
+    }
+
+    size_t IncrementalSmoother::numNonZeros() const
+    {
+      size_t nnz = 0;
+      for (const SparseRow& row : _R)
+        nnz += row.size();
+      return nnz;
+    }
+
+    Eigen::VectorXd IncrementalSmoother::delta(size_t i) const
+    {
+      SM_ASSERT_LT(Exception, i, _variables.size(), "Index out of bounds");
+      const Variable& variable = _variables[i];
+      return Eigen::Map<const Eigen::VectorXd>(_delta.data() + variable.column, variable.dim);
+    }
+
+    double IncrementalSmoother::linearizedSquaredError() const
+    {
+      double error = _residual;
+      for (size_t i = 0; i < _R.size(); ++i) {
+        double r = -_d[i];
+        for (const auto& entry : _R[i])
+          r += entry.second * _delta[entry.first];
+        error += r * r;
+      }
+      return error;
+    }
+
+    void IncrementalSmoother::addVariable(DesignVariable* dv)
+    {
+      SM_ASSERT_TRUE(Exception, dv != NULL, "Null design variable");
+      SM_ASSERT_TRUE(Exception, dv->isActive(), "Only active design variables can be added");
+      SM_ASSERT_TRUE(Exception, _variableIndices.find(dv) == _variableIndices.end(), "The design variable was already added");
+
+      // New design variables are ordered last
+      Variable variable;
+      variable.dv = dv;
+      variable.dim = dv->minimalDimensions();
+      variable.column = _R.size();
+      dv->getParameters(variable.linearizationPoint);
+      dv->setBlockIndex(_variables.size());
+      dv->setColumnBase(variable.column);
+
+      _variableIndices[dv] = _variables.size();
+      _variables.push_back(variable);
+      _variableFactors.emplace_back();
+      const size_t numColumns = _R.size() + variable.dim;
+      _R.resize(numColumns);
+      _columnRows.resize(numColumns);
+      _d.resize(numColumns, 0.0);
+      _delta.resize(numColumns, 0.0);
+      _columnVariables.resize(numColumns, _variables.size() - 1);
+    }
+
+    size_t IncrementalSmoother::addFactor(ErrorTerm* errorTerm)
+    {
+      SM_ASSERT_TRUE(Exception, errorTerm != NULL, "Null error term");
+      Factor factor;
+      factor.errorTerm = errorTerm;
+      for (const DesignVariable* dv : errorTerm->designVariables()) {
+        if (!dv->isActive())
+          continue;
+        auto it = _variableIndices.find(dv);
+        SM_ASSERT_TRUE(Exception, it != _variableIndices.end(), "An error term depends on a design variable which was not added to the smoother");
+        factor.variables.push_back(it->second);
+      }
+      std::sort(factor.variables.begin(), factor.variables.end());
+      factor.variables.erase(std::unique(factor.variables.begin(), factor.variables.end()), factor.variables.end());
+
+      const size_t index = _factors.size();
+      for (size_t v : factor.variables)
+        _variableFactors[v].push_back(index);
+      _factors.push_back(factor);
+      return index;
+    }
+
+    void IncrementalSmoother::linearize(const std::vector<size_t>& factors)
+    {
+      // The design variables hold their estimates. Move the ones which differ to their linearization points.
+      std::vector<size_t> variables;
+      for (size_t f : factors)
+        variables.insert(variables.end(), _factors[f].variables.begin(), _factors[f].variables.end());
+      std::sort(variables.begin(), variables.end());
+      variables.erase(std::unique(variables.begin(), variables.end()), variables.end());
+      std::vector<std::pair<size_t, Eigen::MatrixXd> > estimates;
+      for (size_t v : variables) {
+        Variable& variable = _variables[v];
+        if (delta(v).isZero(0.0))
+          continue;
+        estimates.emplace_back(v, Eigen::MatrixXd());
+        variable.dv->getParameters(estimates.back().second);
+        variable.dv->setParameters(variable.linearizationPoint);
+      }
+
+      try {
+        Eigen::VectorXd e;
+        for (size_t f : factors) {
+          Factor& factor = _factors[f];
+          ErrorTerm* errorTerm = factor.errorTerm;
+          errorTerm->evaluateError();
+          errorTerm->getWeightedError(e, _options.useMEstimator);
+          factor.rhs = -e;
+
+          std::vector<int> offsets(factor.variables.size());
+          int numColumns = 0;
+          for (size_t k = 0; k < factor.variables.size(); ++k) {
+            offsets[k] = numColumns;
+            numColumns += _variables[factor.variables[k]].dim;
+          }
+          JacobianContainerSparse<Eigen::Dynamic> jc(errorTerm->dimension());
+          errorTerm->getWeightedJacobians(jc, _options.useMEstimator);
+          factor.jacobian.setZero(errorTerm->dimension(), numColumns);
+          for (auto it = jc.begin(); it != jc.end(); ++it) {
+            const size_t v = _variableIndices.at(it->first);
+            const size_t k = std::lower_bound(factor.variables.begin(), factor.variables.end(), v) - factor.variables.begin();
+            SM_ASSERT_TRUE(Exception, k < factor.variables.size() && factor.variables[k] == v, "The error term has a Jacobian with respect to a design variable it doesn't depend on");
+            factor.jacobian.middleCols(offsets[k], it->second.cols()) += it->second;
+          }
+        }
+      } catch (...) {
+        for (const auto& estimate : estimates)
+          _variables[estimate.first].dv->setParameters(estimate.second);
+        throw;
+      }
+      for (const auto& estimate : estimates)
+        _variables[estimate.first].dv->setParameters(estimate.second);
+      _lastUpdate.numLinearizedErrorTerms += factors.size();
+    }
+
+    std::vector<size_t> IncrementalSmoother::relinearizeVariables()
+    {
+      std::vector<size_t> factors;
+      for (size_t v = 0; v < _variables.size(); ++v) {
+        Variable& variable = _variables[v];
+        if (variable.dim == 0 || delta(v).lpNorm<Eigen::Infinity>() <= _options.relinearizeThreshold)
+          continue;
+        // The design variable holds the estimate
+        variable.dv->getParameters(variable.linearizationPoint);
+        std::fill(_delta.begin() + variable.column, _delta.begin() + variable.column + variable.dim, 0.0);
+        factors.insert(factors.end(), _variableFactors[v].begin(), _variableFactors[v].end());
+        ++_lastUpdate.numRelinearizedDesignVariables;
+      }
+      std::sort(factors.begin(), factors.end());
+      factors.erase(std::unique(factors.begin(), factors.end()), factors.end());
+
+      // Keep the residual plus the squared norm of d equal to the squared norm of the right hand sides
+      double squaredNorm = 0.0;
+      for (size_t f : factors)
+        squaredNorm -= _factors[f].rhs.squaredNorm();
+      linearize(factors);
+      for (size_t f : factors)
+        squaredNorm += _factors[f].rhs.squaredNorm();
+      _residual += squaredNorm;
+      return factors;
+    }
+
+    void IncrementalSmoother::addFactorRows(const Factor& factor)
+    {
+      SparseRow row;
+      for (int r = 0; r < factor.jacobian.rows(); ++r) {
+        row.clear();
+        int offset = 0;
+        for (size_t v : factor.variables) {
+          const Variable& variable = _variables[v];
+          for (int c = 0; c < variable.dim; ++c) {
+            const double value = factor.jacobian(r, offset + c);
+            if (value != 0.0)
+              row.emplace_back(variable.column + c, value);
+          }
+          offset += variable.dim;
+        }
+        std::sort(row.begin(), row.end());
+        addRow(row, factor.rhs[r]);
+      }
+    }
+
+    void IncrementalSmoother::addRow(SparseRow& row, double rhs)
+    {
+      while (!row.empty()) {
+        const int k = row.front().first;
+        SparseRow& Rk = _R[k];
+        if (Rk.empty()) {
+          // The first information on this column
+          for (auto it = row.begin() + 1; it != row.end(); ++it)
+            _columnRows[it->first].push_back(k);
+          Rk.swap(row);
+          _d[k] = rhs;
+          _dirtyRows.insert(k);
+          return;
+        }
+        givens(k, row, rhs);
+      }
+      _residual += rhs * rhs;
+    }
+
+    void IncrementalSmoother::givens(int k, SparseRow& row, double& rhs)
+    {
+      // Rotate row k of R and the row such that the leading entry of the row vanishes
+      SparseRow& Rk = _R[k];
+      const double r = Rk.front().second;
+      const double a = row.front().second;
+      const double rho = std::hypot(r, a);
+      const double c = r / rho;
+      const double s = a / rho;
+
+      SparseRow newRk, newRow;
+      newRk.reserve(Rk.size() + row.size());
+      newRow.reserve(Rk.size() + row.size());
+      newRk.emplace_back(k, rho);
+      auto i = Rk.begin() + 1, j = row.begin() + 1;
+      while (i != Rk.end() || j != row.end()) {
+        if (j == row.end() || (i != Rk.end() && i->first < j->first)) {
+          newRk.emplace_back(i->first, c * i->second);
+          const double value = -s * i->second;
+          if (value != 0.0)
+            newRow.emplace_back(i->first, value);
+          ++i;
+        } else if (i == Rk.end() || j->first < i->first) {
+          // Fill-in
+          newRk.emplace_back(j->first, s * j->second);
+          _columnRows[j->first].push_back(k);
+          newRow.emplace_back(j->first, c * j->second);
+          ++j;
+        } else {
+          newRk.emplace_back(i->first, c * i->second + s * j->second);
+          const double value = -s * i->second + c * j->second;
+          if (value != 0.0)
+            newRow.emplace_back(i->first, value);
+          ++i;
+          ++j;
+        }
+      }
+      const double dk = _d[k];
+      _d[k] = c * dk + s * rhs;
+      rhs = -s * dk + c * rhs;
+      Rk.swap(newRk);
+      row.swap(newRow);
+      _dirtyRows.insert(k);
+      ++_lastUpdate.numGivensRotations;
+    }
+
+    void IncrementalSmoother::refactor(bool reorder, const std::vector<size_t>& factors)
+    {
+      int firstColumn = _R.size();
+      if (reorder) {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+        computeOrdering();
+        firstColumn = 0;
+      } else {
+        // The rows above the first column of the factors don't depend on their linearization
+        for (size_t f : factors)
+          for (size_t v : _factors[f].variables)
+            firstColumn = std::min(firstColumn, _variables[v].column);
+      }
+      if (!factorize(firstColumn)) {
+        _options.verbose && std::cout << "The Schur complement is not positive definite. Refactoring with Givens rotations.\n";
+        rotateAllFactors();
+      }
+      _lastUpdate.refactored = true;
+      _lastUpdate.reordered = reorder;
+    }
+
+    bool IncrementalSmoother::factorize(int firstColumn)
+    {
+      const int numColumns = _R.size();
+      const int n = numColumns - firstColumn;
+      // With R = [R_AA R_AB; 0 R_BB] split at firstColumn, R_BB' R_BB = J_B' J_B - R_AB' R_AB and
+      // R_BB' d_B = J_B' rhs - R_AB' d_A, where J_B are the columns of the Jacobian from firstColumn on.
+      // K holds the upper triangle of R_BB' R_BB as (row, value) entries per column.
+      std::vector<SparseRow> K(n);
+      std::vector<double> g(n, 0.0);
+      std::vector<int> rowsAbove;
+      {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly);
+        std::vector<size_t> factors;
+        for (int j = firstColumn; j < numColumns; j += _variables[_columnVariables[j]].dim) {
+          const std::vector<size_t>& variableFactors = _variableFactors[_columnVariables[j]];
+          factors.insert(factors.end(), variableFactors.begin(), variableFactors.end());
+        }
+        std::sort(factors.begin(), factors.end());
+        factors.erase(std::unique(factors.begin(), factors.end()), factors.end());
+
+        // The (Jacobian column, column of K) pairs of a factor
+        std::vector<std::pair<int, int> > columns;
+        for (size_t f : factors) {
+          const Factor& factor = _factors[f];
+          columns.clear();
+          int offset = 0;
+          for (size_t v : factor.variables) {
+            const Variable& variable = _variables[v];
+            if (variable.column >= firstColumn) {
+              for (int c = 0; c < variable.dim; ++c)
+                columns.emplace_back(offset + c, variable.column - firstColumn + c);
+            }
+            offset += variable.dim;
+          }
+          for (const auto& a : columns) {
+            g[a.second] += factor.jacobian.col(a.first).dot(factor.rhs);
+            for (const auto& b : columns) {
+              if (a.second <= b.second)
+                K[b.second].emplace_back(a.second, factor.jacobian.col(a.first).dot(factor.jacobian.col(b.first)));
+            }
+          }
+        }
+
+        for (int j = firstColumn; j < numColumns; ++j) {
+          for (int row : _columnRows[j]) {
+            if (row < firstColumn)
+              rowsAbove.push_back(row);
+          }
+        }
+        std::sort(rowsAbove.begin(), rowsAbove.end());
+        rowsAbove.erase(std::unique(rowsAbove.begin(), rowsAbove.end()), rowsAbove.end());
+        for (int i : rowsAbove) {
+          const SparseRow& Ri = _R[i];
+          const auto begin = std::find_if(Ri.begin(), Ri.end(), [firstColumn](const std::pair<int, double>& entry) { return entry.first >= firstColumn; });
+          for (auto a = begin; a != Ri.end(); ++a) {
+            g[a->first - firstColumn] -= a->second * _d[i];
+            for (auto b = a; b != Ri.end(); ++b)
+              K[b->first - firstColumn].emplace_back(a->first - firstColumn, -a->second * b->second);
+          }
+        }
+      }
+
+      // Columns without information are left out and keep empty rows
+      std::vector<int> index(n, -1), columnOf;
+      std::vector<int> colPtr(1, 0), rowInd;
+      std::vector<double> values;
+      for (int j = 0; j < n; ++j) {
+        SparseRow& Kj = K[j];
+        std::sort(Kj.begin(), Kj.end());
+        size_t last = 0;
+        for (size_t k = 1; k < Kj.size(); ++k) {
+          if (Kj[k].first == Kj[last].first)
+            Kj[last].second += Kj[k].second;
+          else
+            Kj[++last] = Kj[k];
+        }
+        if (!Kj.empty())
+          Kj.resize(last + 1);
+        if (Kj.empty() || Kj.back().first != j || Kj.back().second == 0.0)
+          continue;
+        index[j] = columnOf.size();
+        columnOf.push_back(j);
+        for (const auto& entry : Kj) {
+          if (index[entry.first] >= 0) {
+            rowInd.push_back(index[entry.first]);
+            values.push_back(entry.second);
+          }
+        }
+        colPtr.push_back(rowInd.size());
+      }
+
+      std::vector<SparseRow> rows(n);
+      if (!columnOf.empty()) {
+        cholmod_sparse A;
+        A.nrow = columnOf.size();
+        A.ncol = columnOf.size();
+        A.nzmax = rowInd.size();
+        A.p = colPtr.data();
+        A.i = rowInd.data();
+        A.nz = NULL;
+        A.x = values.data();
+        A.z = NULL;
+        A.stype = 1;
+        A.itype = CholmodIndexTraits<int>::IType;
+        A.xtype = CholmodValueTraits<double>::XType;
+        A.dtype = CholmodValueTraits<double>::DType;
+        A.sorted = 1;
+        A.packed = 1;
+
+        Cholmod<int> cholmod;
+        cholmod_factor* L = cholmod.analyzeNatural(&A);
+        if (!cholmod.factorize(&A, L) || !cholmod.toSimplicialLL(L)) {
+          cholmod.free(L);
+          return false;
+        }
+        // The rows of R_BB are the columns of L
+        const int* Lp = static_cast<const int*>(L->p);
+        const int* Li = static_cast<const int*>(L->i);
+        const double* Lx = static_cast<const double*>(L->x);
+        for (size_t c = 0; c < columnOf.size(); ++c) {
+          SparseRow& row = rows[columnOf[c]];
+          for (int k = Lp[c]; k < Lp[c + 1]; ++k)
+            row.emplace_back(firstColumn + columnOf[Li[k]], Lx[k]);
+          std::sort(row.begin(), row.end());
+        }
+        cholmod.free(L);
+      }
+
+      // Replace the rows from firstColumn on and solve R_BB' d_B = g by forward substitution
+      double squaredNorm = 0.0;
+      for (int j = firstColumn; j < numColumns; ++j) {
+        std::vector<int>& columnRows = _columnRows[j];
+        columnRows.erase(std::remove_if(columnRows.begin(), columnRows.end(), [firstColumn](int row) { return row >= firstColumn; }), columnRows.end());
+      }
+      for (int j = 0; j < n; ++j) {
+        const int i = firstColumn + j;
+        squaredNorm += _d[i] * _d[i];
+        _R[i].swap(rows[j]);
+        _d[i] = 0.0;
+        const SparseRow& Ri = _R[i];
+        if (!Ri.empty()) {
+          _d[i] = g[j] / Ri.front().second;
+          for (auto it = Ri.begin() + 1; it != Ri.end(); ++it) {
+            g[it->first - firstColumn] -= it->second * _d[i];
+            _columnRows[it->first].push_back(i);
+          }
+        }
+        squaredNorm -= _d[i] * _d[i];
+        // Columns without information get their delta reset too
+        _dirtyRows.insert(_dirtyRows.end(), i);
+      }
+      if (firstColumn == 0) {
+        squaredNorm = 0.0;
+        for (const Factor& factor : _factors)
+          squaredNorm += factor.rhs.squaredNorm();
+        for (double d : _d)
+          squaredNorm -= d * d;
+        _residual = std::max(squaredNorm, 0.0);
+      } else {
+        _residual = std::max(_residual + squaredNorm, 0.0);
+      }
+      // The rows above depend on the delta of the refactored rows
+      _dirtyRows.insert(rowsAbove.begin(), rowsAbove.end());
+      _lastUpdate.numRefactoredRows += n;
+      return true;
+    }
+
+    void IncrementalSmoother::rotateAllFactors()
+    {
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Factorization);
+      const size_t numColumns = _R.size();
+      _R.assign(numColumns, SparseRow());
+      _columnRows.assign(numColumns, std::vector<int>());
+      _d.assign(numColumns, 0.0);
+      _residual = 0.0;
+      for (const Factor& factor : _factors)
+        addFactorRows(factor);
+      // Columns without information get their delta reset too
+      for (size_t i = 0; i < numColumns; ++i)
+        _dirtyRows.insert(_dirtyRows.end(), i);
+    }
+
+    void IncrementalSmoother::computeOrdering()
+    {
+      const int numBlocks = _variables.size();
+      if (numBlocks == 0 || _factors.empty())
+        return;
+      // The block pattern of J^T with one row per design variable and one column per error term
+      std::vector<int> colPtr(_factors.size() + 1, 0);
+      std::vector<int> rowInd;
+      for (size_t f = 0; f < _factors.size(); ++f) {
+        rowInd.insert(rowInd.end(), _factors[f].variables.begin(), _factors[f].variables.end());
+        colPtr[f + 1] = rowInd.size();
+      }
+      if (rowInd.empty())
+        return;
+      cholmod_sparse A;
+      A.nrow = numBlocks;
+      A.ncol = _factors.size();
+      A.nzmax = rowInd.size();
+      A.p = colPtr.data();
+      A.i = rowInd.data();
+      A.nz = NULL;
+      A.x = NULL;
+      A.z = NULL;
+      A.stype = 0;
+      A.itype = CholmodIndexTraits<int>::IType;
+      A.xtype = CHOLMOD_PATTERN;
+      A.dtype = CholmodValueTraits<double>::DType;
+      A.sorted = 1;
+      A.packed = 1;
+
+      // The design variables of the latest update go last
+      std::vector<int> cmember;
+      if (!_recentVariables.empty() && _recentVariables.size() < _variables.size()) {
+        cmember.assign(numBlocks, 0);
+        for (size_t v : _recentVariables)
+          cmember[v] = 1;
+      }
+
+      Cholmod<int> cholmod;
+      std::vector<int> blockOrdering(numBlocks);
+      bool success = cmember.empty() ? cholmod.colamd(&A, blockOrdering.data()) : cholmod.ccolamd(&A, cmember.data(), blockOrdering.data());
+      // E.g. CHOLMOD was built without the partition module
+      if (!success)
+        success = cholmod.colamd(&A, blockOrdering.data());
+      if (!success) {
+        _options.verbose && std::cout << "The fill-reducing ordering failed. Keeping the current ordering.\n";
+        return;
+      }
+      if (!cmember.empty())
+        std::stable_sort(blockOrdering.begin(), blockOrdering.end(), [&cmember](int a, int b) { return cmember[a] < cmember[b]; });
+
+      // Move delta to the new columns
+      std::vector<double> delta(_delta.size());
+      int column = 0;
+      for (int b : blockOrdering) {
+        Variable& variable = _variables[b];
+        std::copy(_delta.begin() + variable.column, _delta.begin() + variable.column + variable.dim, delta.begin() + column);
+        std::fill(_columnVariables.begin() + column, _columnVariables.begin() + column + variable.dim, b);
+        variable.column = column;
+        variable.dv->setColumnBase(column);
+        column += variable.dim;
+      }
+      _delta.swap(delta);
+    }
+
+    void IncrementalSmoother::backSubstitute()
+    {
+      std::vector<size_t> changedVariables;
+      {
+        instrumentation::ScopedPhase phase(instrumentation::Phase::Solve);
+        // Rows only depend on the rows below them, so the dirty rows are solved from the bottom up
+        while (!_dirtyRows.empty()) {
+          const auto last = std::prev(_dirtyRows.end());
+          const int i = *last;
+          _dirtyRows.erase(last);
+          ++_lastUpdate.numBackSubstitutedRows;
+
+          // Columns without information keep their linearization point
+          double x = 0.0;
+          const SparseRow& Ri = _R[i];
+          if (!Ri.empty()) {
+            double sum = _d[i];
+            for (auto it = Ri.begin() + 1; it != Ri.end(); ++it)
+              sum -= it->second * _delta[it->first];
+            x = sum / Ri.front().second;
+          }
+          const double change = std::fabs(x - _delta[i]);
+          if (change == 0.0 || change < _options.wildfireThreshold)
+            continue;
+          _delta[i] = x;
+          changedVariables.push_back(_columnVariables[i]);
+          for (int row : _columnRows[i])
+            _dirtyRows.insert(row);
+        }
+      }
+
+      std::sort(changedVariables.begin(), changedVariables.end());
+      changedVariables.erase(std::unique(changedVariables.begin(), changedVariables.end()), changedVariables.end());
+      instrumentation::ScopedPhase phase(instrumentation::Phase::StateUpdate);
+      for (size_t v : changedVariables)
+        setEstimate(v);
+    }
+
+    void IncrementalSmoother::setEstimate(size_t v)
+    {
+      Variable& variable = _variables[v];
+      variable.dv->setParameters(variable.linearizationPoint);
+      Eigen::VectorXd dx = delta(v) * variable.dv->scaling();
+      if (!dx.isZero(0.0))
+        variable.dv->update(dx.data(), variable.dim);
+    }
+
+  } // namespace backend
+} // namespace aslam
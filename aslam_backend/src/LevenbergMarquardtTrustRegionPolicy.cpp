@@ -1,5 +1,8 @@
 #include <aslam/backend/LevenbergMarquardtTrustRegionPolicy.hpp>
 #include <sm/PropertyTree.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <cmath>
+#include <limits>
 
 namespace aslam {
     namespace backend {
@@ -9,7 +12,9 @@ namespace aslam {
         _gammaInit(3),
         _betaInit(2),
         _pInit(3),
-        _muInit(2)
+        _muInit(2),
+        _numSpeculativeLambdas(1),
+        _speculativeLambdaFactor(10)
     {
 
     }
@@ -18,7 +23,9 @@ namespace aslam {
         _gammaInit(3),
         _betaInit(2),
         _pInit(3),
-        _muInit(2)
+        _muInit(2),
+        _numSpeculativeLambdas(1),
+        _speculativeLambdaFactor(10)
     {
 
     }
@@ -29,6 +36,10 @@ namespace aslam {
       _betaInit   = config.getDouble("betaInit", 2.0); 
       _pInit      = config.getInt("pInit", 3);
       _muInit     = config.getDouble("muInit", 2.0);
+      _numSpeculativeLambdas = 1;
+      _speculativeLambdaFactor = 10;
+      setNumSpeculativeLambdas(config.getInt("numSpeculativeLambdas", _numSpeculativeLambdas));
+      setSpeculativeLambdaFactor(config.getDouble("speculativeLambdaFactor", _speculativeLambdaFactor));
     }
     
         LevenbergMarquardtTrustRegionPolicy::~LevenbergMarquardtTrustRegionPolicy() {}
@@ -43,6 +54,8 @@ namespace aslam {
           _beta = _betaInit;
           _p = _pInit;
           _mu = _muInit;
+          // Start with the current damping as the expected winner
+          _lastBestSpeculativeLambda = (_numSpeculativeLambdas - 1) / 2;
             
         }
         
@@ -84,14 +97,83 @@ namespace aslam {
                 }
             }
             
+            if (_numSpeculativeLambdas > 1 && canEvaluateTrialSteps())
+                return solveSpeculatively(nThreads, outDx);
+
             _solver->setConstantConditioner(_lambda);
             return _solver->solveSystem(outDx);
         }
+
+        bool LevenbergMarquardtTrustRegionPolicy::solveSpeculatively(int nThreads, Eigen::VectorXd& outDx)
+        {
+            instrumentation::ScopedTrace trace("Speculative LM");
+            // All damped systems are solved before the first trial, as trials overwrite the solver's error vector.
+            // They share the linearization and the symbolic analysis, only the numeric factorization is redone.
+            const int first = -(_numSpeculativeLambdas - 1) / 2;
+            std::vector<double> lambdas(_numSpeculativeLambdas);
+            std::vector<Eigen::VectorXd> steps(_numSpeculativeLambdas);
+            std::vector<bool> solved(_numSpeculativeLambdas);
+            for (int i = 0; i < _numSpeculativeLambdas; ++i) {
+                lambdas[i] = _lambda * std::pow(_speculativeLambdaFactor, first + i);
+                _solver->setConstantConditioner(lambdas[i]);
+                solved[i] = _solver->solveSystem(steps[i]);
+            }
+
+            // The design variables hold one state at a time, so the trials run one after another,
+            // each evaluating the error terms with nThreads. The error terms keep the errors of the
+            // last trial, which spares the optimizer evaluating the returned step if it was the last.
+            // So the damping which won the last iteration is tried last.
+            if (_lastBestSpeculativeLambda >= _numSpeculativeLambdas)
+                _lastBestSpeculativeLambda = (_numSpeculativeLambdas - 1) / 2;
+            std::vector<int> order;
+            for (int i = 0; i < _numSpeculativeLambdas; ++i)
+                if (i != _lastBestSpeculativeLambda)
+                    order.push_back(i);
+            order.push_back(_lastBestSpeculativeLambda);
+
+            int best = -1, lastEvaluated = -1;
+            double bestJ = std::numeric_limits<double>::infinity();
+            for (int i : order) {
+                if (!solved[i])
+                    continue;
+                const double J = evaluateTrialStep(steps[i], nThreads);
+                lastEvaluated = i;
+                if (best < 0 || J < bestJ) {
+                    best = i;
+                    bestJ = J;
+                }
+            }
+            if (best < 0)
+                return false;
+            _lastBestSpeculativeLambda = best;
+            if (best == lastEvaluated)
+                setEvaluatedStepError(bestJ);
+
+            // The next rho is computed with the damping of the returned step
+            _lambda = lambdas[best];
+            _solver->setConstantConditioner(_lambda);
+            outDx.swap(steps[best]);
+            return true;
+        }
+
+        void LevenbergMarquardtTrustRegionPolicy::setNumSpeculativeLambdas(int numLambdas)
+        {
+            SM_ASSERT_GE(Exception, numLambdas, 1, "At least one damping value has to be tried");
+            _numSpeculativeLambdas = numLambdas;
+        }
+
+        void LevenbergMarquardtTrustRegionPolicy::setSpeculativeLambdaFactor(double factor)
+        {
+            SM_ASSERT_GT(Exception, factor, 1.0, "The damping values must be spread by a factor greater than one");
+            _speculativeLambdaFactor = factor;
+        }
         
         /// \brief print the current state to a stream (no newlines).
         std::ostream & LevenbergMarquardtTrustRegionPolicy::printState(std::ostream & out) const
         {
             out << "LM - lambda:" << _lambda << " mu:" << _mu;
+            if (_numSpeculativeLambdas > 1)
+                out << " speculative lambdas:" << _numSpeculativeLambdas;
             return out;
         }
 
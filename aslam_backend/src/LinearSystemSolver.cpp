@@ -4,12 +4,18 @@
 
 #include <aslam/backend/ErrorTerm.hpp>
 #include <aslam/backend/OptimizerCallbackManager.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
 
 namespace aslam {
   namespace backend {
 
     LinearSystemSolver::LinearSystemSolver() :
-      _acceptConstantErrorTerms(false)
+      _acceptConstantErrorTerms(false),
+      _jacobiansEvaluated(false),
+      _jacobiansUseMEstimator(false),
+      _numFusedEvaluations(0),
+      _numSavedJacobianPasses(0),
+      _deadlineExceeded(false)
     {
     }
     LinearSystemSolver::~LinearSystemSolver() {}
@@ -18,8 +24,11 @@ namespace aslam {
     {
       SM_ASSERT_LT_DBG(Exception, threadId, _threadLocalErrors.size(), "Index out of bounds in thread " << threadId);
       SM_ASSERT_LE_DBG(Exception, endIdx, _errorTerms.size(), "Index out of bounds in thread " << threadId);
+      instrumentation::ScopedTrace trace("Evaluate errors (thread)");
       Eigen::VectorXd e;
       for (size_t i = startIdx; i < endIdx; ++i) {
+        if (deadlinePassed())
+          return;
         SM_ASSERT_TRUE_DBG(Exception, _errorTerms[i] != NULL, "Null error term " << i);
         _threadLocalErrors[threadId] += _errorTerms[i]->evaluateError();
         _errorTerms[i]->getWeightedError(e, useMEstimator);
@@ -27,6 +36,38 @@ namespace aslam {
       }
     }
 
+    void LinearSystemSolver::evaluateErrorsAndJacobians(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator)
+    {
+      SM_ASSERT_LT_DBG(Exception, threadId, _threadLocalErrors.size(), "Index out of bounds in thread " << threadId);
+      SM_ASSERT_LE_DBG(Exception, endIdx, _errorTerms.size(), "Index out of bounds in thread " << threadId);
+      instrumentation::ScopedTrace trace("Evaluate errors and Jacobians (thread)");
+      Eigen::VectorXd e;
+      for (size_t i = startIdx; i < endIdx; ++i) {
+        if (deadlinePassed())
+          return;
+        SM_ASSERT_TRUE_DBG(Exception, _errorTerms[i] != NULL, "Null error term " << i);
+        _threadLocalErrors[threadId] += _errorTerms[i]->evaluateError();
+        _errorTerms[i]->getWeightedError(e, useMEstimator);
+        _e.segment(_errorTerms[i]->rowBase(), _errorTerms[i]->dimension()) = -e;
+        // The error term is still in cache
+        linearizeErrorTerm(i, useMEstimator);
+      }
+    }
+
+    void LinearSystemSolver::linearizeErrorTerm(size_t /* i */, bool /* useMEstimator */)
+    {
+      SM_THROW(Exception, "The " << name() << " solver doesn't support evaluating the Jacobians together with the errors");
+    }
+
+    bool LinearSystemSolver::takeEvaluatedJacobians(bool useMEstimator)
+    {
+      const bool evaluated = _jacobiansEvaluated && _jacobiansUseMEstimator == useMEstimator;
+      _jacobiansEvaluated = false;
+      if (evaluated)
+        ++_numSavedJacobianPasses;
+      return evaluated;
+    }
+
     struct SafeJobReturnValue {
       SafeJobReturnValue(const std::exception& e) : _e(e) {}
 
@@ -54,6 +95,7 @@ namespace aslam {
 
     void LinearSystemSolver::setupThreadedJob(boost::function<void(size_t, size_t, size_t, bool)> job, size_t nThreads, bool useMEstimator)
     {
+      _deadlineExceeded = false;
       if (nThreads <= 1) {
         job(0, 0, _errorTerms.size(), useMEstimator);
       } else {
@@ -80,15 +122,37 @@ namespace aslam {
           }
         }
       }
+      if (_deadlineExceeded)
+        SM_THROW(util::Deadline::Exceeded, "The deadline passed before all error terms were processed");
     }
 
 
     double LinearSystemSolver::evaluateError(size_t nThreads, bool useMEstimator, callback::Manager * callback)
     {
+      return evaluateErrorTerms(nThreads, useMEstimator, callback, false);
+    }
+
+    double LinearSystemSolver::evaluateErrorAndJacobians(size_t nThreads, bool useMEstimator, callback::Manager * callback)
+    {
+      return evaluateErrorTerms(nThreads, useMEstimator, callback, supportsFusedEvaluation());
+    }
+
+    double LinearSystemSolver::evaluateErrorTerms(size_t nThreads, bool useMEstimator, callback::Manager * callback, bool evaluateJacobians)
+    {
+      instrumentation::ScopedTrace trace(evaluateJacobians ? "Evaluate errors and Jacobians" : "Evaluate errors");
       nThreads = std::max((size_t)1, nThreads);
       _threadLocalErrors.clear();
       _threadLocalErrors.resize(nThreads, 0.0);
-      setupThreadedJob(boost::bind(&LinearSystemSolver::evaluateErrors, this, _1, _2, _3, _4), nThreads, useMEstimator);
+      _jacobiansEvaluated = false;
+      if (evaluateJacobians) {
+        beginJacobianEvaluation();
+        setupThreadedJob(boost::bind(&LinearSystemSolver::evaluateErrorsAndJacobians, this, _1, _2, _3, _4), nThreads, useMEstimator);
+        _jacobiansEvaluated = true;
+        _jacobiansUseMEstimator = useMEstimator;
+        ++_numFusedEvaluations;
+      } else {
+        setupThreadedJob(boost::bind(&LinearSystemSolver::evaluateErrors, this, _1, _2, _3, _4), nThreads, useMEstimator);
+      }
       // Gather the squared error results from the multiple threads.
       if(callback) callback->issueCallback(callback::event::RESIDUALS_UPDATED{0, 0});
       double error = 0.0;
@@ -122,6 +186,7 @@ namespace aslam {
 
     void LinearSystemSolver::initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner)
     {
+      _jacobiansEvaluated = false;
       setOrdering(dvs, errors);
       _errorTerms = errors;
       // Figure out the size of the Jacobian matrix.
@@ -0,0 +1,305 @@
+#include <aslam/backend/LinearSystemSolverSelector.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+#include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/Cholmod.hpp>
+#include <aslam/backend/DenseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/DesignVariable.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#ifndef QRSOLVER_DISABLED
+#include <aslam/backend/SparseQrLinearSystemSolver.hpp>
+#endif
+#include <aslam/backend/util/Deadline.hpp>
+#include <sm/PropertyTree.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    std::ostream& operator<<(std::ostream& out, const LinearSystemStructure& structure)
+    {
+      out << structure.numRows << " x " << structure.numCols << " Jacobian with " << structure.jacobianNnz << " nonzeros, "
+          << structure.numDesignVariables << " design variables of dimension " << structure.minBlockDimension << " to "
+          << structure.maxBlockDimension << " (mean " << structure.meanBlockDimension << "), " << structure.numErrorTerms
+          << " error terms, estimated factor density " << structure.factorDensity()
+          << (structure.rankDeficiencyHint ? ", likely rank deficient" : "");
+      return out;
+    }
+
+    LinearSystemSolverSelectorOptions::LinearSystemSolverSelectorOptions() {}
+
+    LinearSystemSolverSelectorOptions::LinearSystemSolverSelectorOptions(const sm::ConstPropertyTree& config) {
+      backend = config.getString("backend", backend);
+      denseFlopCost = config.getDouble("denseFlopCost", denseFlopCost);
+      sparseOverhead = config.getDouble("sparseOverhead", sparseOverhead);
+      sparseNonzeroCost = config.getDouble("sparseNonzeroCost", sparseNonzeroCost);
+      blockCholeskyFlopCost = config.getDouble("blockCholeskyFlopCost", blockCholeskyFlopCost);
+      maxDenseMemory = config.getInt("maxDenseMemory", maxDenseMemory);
+      calibrate = config.getBool("calibrate", calibrate);
+      calibrationRuns = config.getInt("calibrationRuns", calibrationRuns);
+      verbose = config.getBool("verbose", verbose);
+    }
+
+    LinearSystemSolverSelector::LinearSystemSolverSelector(const Options& options) : _options(options)
+    {
+    }
+
+    LinearSystemSolverSelector::LinearSystemSolverSelector(const sm::ConstPropertyTree& config) : _options(config)
+    {
+    }
+
+    LinearSystemSolverSelector::~LinearSystemSolverSelector()
+    {
+    }
+
+    std::vector<std::string> LinearSystemSolverSelector::backends()
+    {
+#ifndef QRSOLVER_DISABLED
+      return { "dense_cholesky", "dense_qr", "sparse_cholesky", "block_cholesky", "sparse_qr" };
+#else
+      return { "dense_cholesky", "dense_qr", "sparse_cholesky", "block_cholesky" };
+#endif
+    }
+
+    boost::shared_ptr<LinearSystemSolver> LinearSystemSolverSelector::getSolver(const std::string& backend)
+    {
+      boost::shared_ptr<LinearSystemSolver>& solver = _solvers[backend];
+      if (solver)
+        return solver;
+      if (backend == "sparse_cholesky")
+        solver.reset(new SparseCholeskyLinearSystemSolver());
+      else if (backend == "block_cholesky")
+        solver.reset(new BlockCholeskyLinearSystemSolver());
+      else if (backend == "dense_cholesky")
+        solver.reset(new DenseCholeskyLinearSystemSolver());
+      else if (backend == "dense_qr")
+        solver.reset(new DenseQrLinearSystemSolver());
+#ifndef QRSOLVER_DISABLED
+      else if (backend == "sparse_qr")
+        solver.reset(new SparseQrLinearSystemSolver());
+#endif
+      else {
+        _solvers.erase(backend);
+        SM_THROW(Exception, "Unknown linear system solver backend " << backend);
+      }
+      return solver;
+    }
+
+    void LinearSystemSolverSelector::setSolver(const std::string& backend, const boost::shared_ptr<LinearSystemSolver>& solver)
+    {
+      SM_ASSERT_TRUE(Exception, solver != nullptr, "Null linear system solver");
+      SM_ASSERT_EQ(Exception, solver->name(), backend, "The solver is not a " << backend << " solver");
+      _solvers[backend] = solver;
+    }
+
+    LinearSystemStructure LinearSystemSolverSelector::analyze(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors)
+    {
+      LinearSystemStructure s;
+      s.numDesignVariables = dvs.size();
+      s.numErrorTerms = errors.size();
+      if (dvs.empty())
+        return s;
+
+      std::unordered_map<const DesignVariable*, int> blockIndex;
+      std::vector<int> blockDim(dvs.size());
+      s.minBlockDimension = std::numeric_limits<int>::max();
+      for (size_t b = 0; b < dvs.size(); ++b) {
+        blockIndex[dvs[b]] = b;
+        blockDim[b] = dvs[b]->minimalDimensions();
+        s.numCols += blockDim[b];
+        s.minBlockDimension = std::min(s.minBlockDimension, blockDim[b]);
+        s.maxBlockDimension = std::max(s.maxBlockDimension, blockDim[b]);
+      }
+      s.meanBlockDimension = double(s.numCols) / dvs.size();
+
+      // The block pattern of J^T with one row per design variable and one column per error term, and the number
+      // of error rows observing each design variable
+      std::vector<int> colPtr(1, 0);
+      std::vector<int> rowInd;
+      std::vector<size_t> observations(dvs.size(), 0);
+      for (const ErrorTerm* error : errors) {
+        const size_t begin = rowInd.size();
+        int cols = 0;
+        for (const DesignVariable* dv : error->designVariables()) {
+          auto it = blockIndex.find(dv);
+          if (!dv->isActive() || it == blockIndex.end())
+            continue;
+          rowInd.push_back(it->second);
+          cols += blockDim[it->second];
+          observations[it->second] += error->dimension();
+        }
+        std::sort(rowInd.begin() + begin, rowInd.end());
+        colPtr.push_back(rowInd.size());
+        s.numRows += error->dimension();
+        s.jacobianNnz += size_t(error->dimension()) * cols;
+        s.normalEquationsFlops += double(error->dimension()) * cols * cols;
+      }
+      s.rankDeficiencyHint = s.numRows < s.numCols;
+      for (size_t b = 0; b < dvs.size(); ++b)
+        s.rankDeficiencyHint = s.rankDeficiencyHint || observations[b] < size_t(blockDim[b]);
+      if (rowInd.empty())
+        return s;
+
+      // The symbolic analysis of the design variable graph. The scalar columns of a block column of the factor
+      // are assumed to have as many nonzeros as the block column has blocks times the mean block dimension.
+      cholmod_sparse A;
+      A.nrow = dvs.size();
+      A.ncol = errors.size();
+      A.nzmax = rowInd.size();
+      A.p = colPtr.data();
+      A.i = rowInd.data();
+      A.nz = NULL;
+      A.x = NULL;
+      A.z = NULL;
+      A.stype = 0;
+      A.itype = CholmodIndexTraits<int>::IType;
+      A.xtype = CHOLMOD_PATTERN;
+      A.dtype = CholmodValueTraits<double>::DType;
+      A.sorted = 1;
+      A.packed = 1;
+      Cholmod<int> cholmod;
+      cholmod_factor* L = cholmod.analyze(&A);
+      const int* perm = static_cast<const int*>(L->Perm);
+      const int* colCount = static_cast<const int*>(L->ColCount);
+      for (size_t k = 0; k < L->n; ++k) {
+        const double columnNnz = std::min(double(s.numCols), colCount[k] * s.meanBlockDimension);
+        s.factorNnz += blockDim[perm[k]] * columnNnz;
+        s.factorFlops += blockDim[perm[k]] * columnNnz * columnNnz;
+      }
+      cholmod.free(L);
+      return s;
+    }
+
+    double LinearSystemSolverSelector::estimateCost(const LinearSystemStructure& s, const std::string& backend) const
+    {
+      const double sparseCholeskyFlops = s.normalEquationsFlops + s.factorFlops;
+      const double sparseOverhead = _options.sparseOverhead + _options.sparseNonzeroCost * (s.jacobianNnz + s.factorNnz);
+      if (backend == "dense_cholesky") {
+        if (double(s.numCols) * s.numCols * sizeof(double) > _options.maxDenseMemory)
+          return -1.0;
+        // Accumulating J^T J per error term and its dense Cholesky factorization
+        return _options.denseFlopCost * (s.normalEquationsFlops + s.numCols * double(s.numCols) * s.numCols / 3.0);
+      }
+      if (backend == "dense_qr") {
+        if (double(s.numRows) * s.numCols * sizeof(double) > _options.maxDenseMemory)
+          return -1.0;
+        // Householder QR of the m x n Jacobian
+        return _options.denseFlopCost * 2.0 * s.numRows * s.numCols * s.numCols;
+      }
+      if (backend == "sparse_cholesky")
+        return sparseOverhead + sparseCholeskyFlops;
+      if (backend == "block_cholesky")
+        return sparseOverhead + sparseCholeskyFlops * _options.blockCholeskyFlopCost / std::max(1.0, s.meanBlockDimension);
+      if (backend == "sparse_qr")
+        // The R factor has the pattern of the Cholesky factor, but the Householder reflections applied to the
+        // rows of J cost about twice as much as forming J^T J
+        return sparseOverhead + 2.0 * sparseCholeskyFlops;
+      SM_THROW(Exception, "Unknown linear system solver backend " << backend);
+    }
+
+    boost::shared_ptr<LinearSystemSolver> LinearSystemSolverSelector::select(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors,
+                                                                             bool requiresAugmentedDiagonal)
+    {
+      _decision = Decision();
+      _decision.structure = analyze(dvs, errors);
+      const LinearSystemStructure& s = _decision.structure;
+
+      if (_options.backend != "auto") {
+        _decision.backend = _options.backend;
+        _decision.reason = "set in the options";
+      } else {
+        std::vector<std::string> candidates = backends();
+        // The sparse QR solver doesn't support an augmented diagonal
+        if (requiresAugmentedDiagonal)
+          candidates.erase(std::remove(candidates.begin(), candidates.end(), "sparse_qr"), candidates.end());
+        std::ostringstream reason;
+        // Without damping, a rank deficient J^T J can't be factorized with Cholesky
+        if (s.rankDeficiencyHint && !requiresAugmentedDiagonal) {
+          candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](const std::string& c) { return c.find("_qr") == std::string::npos; }),
+                           candidates.end());
+          reason << "rank revealing QR for a likely rank deficient system, ";
+        }
+
+        if (_options.calibrate) {
+          const std::vector<size_t> calibratedStructure = { s.numRows, s.numCols, s.jacobianNnz, s.numDesignVariables, s.numErrorTerms, requiresAugmentedDiagonal };
+          if (calibratedStructure != _calibratedStructure || _calibratedBackend.empty()) {
+            calibrate(dvs, errors, requiresAugmentedDiagonal, candidates);
+            _calibratedStructure = calibratedStructure;
+          }
+          _decision.backend = _calibratedBackend;
+          _decision.costs = _calibrationTimes;
+          reason << "fastest in the calibration run";
+        } else {
+          double minCost = std::numeric_limits<double>::max();
+          for (const std::string& c : candidates) {
+            const double cost = _costModel ? _costModel(s, c) : estimateCost(s, c);
+            if (cost < 0.0)
+              continue;
+            _decision.costs[c] = cost;
+            if (cost < minCost) {
+              minCost = cost;
+              _decision.backend = c;
+            }
+          }
+          reason << "lowest " << (_costModel ? "user" : "estimated") << " cost";
+        }
+        SM_ASSERT_FALSE(Exception, _decision.backend.empty(), "None of the linear system solver backends is applicable");
+        _decision.reason = reason.str();
+      }
+
+      if (_options.verbose) {
+        std::cout << "LinearSystemSolverSelector: " << s << "\n";
+        for (const auto& cost : _decision.costs)
+          std::cout << "  " << cost.first << ": " << cost.second << "\n";
+        std::cout << "LinearSystemSolverSelector: Using the " << _decision.backend << " solver (" << _decision.reason << ")\n";
+      }
+      return getSolver(_decision.backend);
+    }
+
+    void LinearSystemSolverSelector::calibrate(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors,
+                                               bool requiresAugmentedDiagonal, const std::vector<std::string>& candidates)
+    {
+      _calibratedBackend.clear();
+      _calibrationTimes.clear();
+      double minTime = std::numeric_limits<double>::max();
+      for (const std::string& c : candidates) {
+        // Exclude the dense solvers which would run out of memory
+        if (estimateCost(_decision.structure, c) < 0.0)
+          continue;
+        boost::shared_ptr<LinearSystemSolver> solver = getSolver(c);
+        try {
+          solver->initMatrixStructure(dvs, errors, requiresAugmentedDiagonal);
+          solver->evaluateError(1, false);
+          if (requiresAugmentedDiagonal)
+            solver->setConstantConditioner(1e-3);
+          Eigen::VectorXd dx;
+          bool success = true;
+          const auto start = util::Deadline::Clock::now();
+          for (int run = 0; run < std::max(1, _options.calibrationRuns) && success; ++run) {
+            solver->buildSystem(1, false);
+            success = solver->solveSystem(dx);
+          }
+          const double time = std::chrono::duration<double>(util::Deadline::Clock::now() - start).count() / std::max(1, _options.calibrationRuns);
+          if (!success) {
+            _options.verbose && std::cout << "LinearSystemSolverSelector: The " << c << " solver failed in the calibration run\n";
+            continue;
+          }
+          _calibrationTimes[c] = time;
+          if (time < minTime) {
+            minTime = time;
+            _calibratedBackend = c;
+          }
+        } catch (const std::exception& e) {
+          _options.verbose && std::cout << "LinearSystemSolverSelector: The " << c << " solver failed in the calibration run: " << e.what() << "\n";
+        }
+      }
+    }
+
+  } // namespace backend
+} // namespace aslam
@@ -7,12 +7,16 @@
 
 #include "aslam/backend/Marginalizer.hpp"
 
-#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
-#include <Eigen/QR>
+#include <aslam/backend/JacobianContainerSparse.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
 #include <Eigen/Dense>
-#include <aslam/backend/DenseMatrix.hpp>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 #include <sm/logging.hpp>
 #include <sm/timing/Timer.hpp>
@@ -20,6 +24,66 @@
 namespace aslam {
 namespace backend {
 
+namespace {
+
+typedef Eigen::SparseMatrix<double> SparseMatrix;
+typedef Eigen::Triplet<double> Triplet;
+
+/// \brief Evaluates the weighted errors of the error terms in [startIdx, endIdx) into b and
+///        collects their weighted Jacobians as triplets of the sparse Jacobian.
+void evaluateErrorTermRange(const std::vector<aslam::backend::ErrorTerm*>& errorTerms, bool useMEstimator, Eigen::VectorXd& b,
+                            size_t /* threadId */, size_t startIdx, size_t endIdx, std::vector<Triplet>& triplets)
+{
+  Eigen::VectorXd e;
+  for (size_t i = startIdx; i < endIdx; ++i) {
+    aslam::backend::ErrorTerm* et = errorTerms[i];
+    et->evaluateError();
+    et->getWeightedError(e, useMEstimator);
+    b.segment(et->rowBase(), et->dimension()) = -e;
+
+    JacobianContainerSparse<Eigen::Dynamic> jc(et->dimension());
+    et->getWeightedJacobians(jc, useMEstimator);
+    for (auto it = jc.begin(); it != jc.end(); ++it) {
+      const Eigen::MatrixXd& Ji = it->second;
+      const int colBase = it->first->columnBase();
+      for (int c = 0; c < Ji.cols(); ++c)
+        for (int r = 0; r < Ji.rows(); ++r)
+          if (Ji(r, c) != 0.0)
+            triplets.push_back(Triplet(et->rowBase() + r, colBase + c, Ji(r, c)));
+    }
+  }
+}
+
+/// \brief Threshold below which a pivot of an LDL^T factorization is considered zero.
+double rankTolerance(const Eigen::VectorXd& D, int n)
+{
+  const double maxPivot = D.size() > 0 ? D.cwiseAbs().maxCoeff() : 0.0;
+  return std::numeric_limits<double>::epsilon() * n * maxPivot;
+}
+
+/// \brief Cheap rank estimate from the pivots of an LDL^T factorization of a block of J^T J.
+int estimateRank(const Eigen::VectorXd& D, int n)
+{
+  const double tolerance = rankTolerance(D, n);
+  int rank = 0;
+  for (int i = 0; i < D.size(); ++i)
+    if (D[i] > tolerance)
+      ++rank;
+  return rank;
+}
+
+/// \brief Whether all pivots D of a sparse LDL^T factorization of A exceed relativeTolerance times
+///        the largest diagonal entry of A. The factorization does not pivot, so the rounding error of
+///        a pivot scales with the diagonal of A rather than with the largest pivot.
+bool hasPositivePivots(const Eigen::VectorXd& D, const SparseMatrix& A, double relativeTolerance)
+{
+  const Eigen::VectorXd diagonal = A.diagonal();
+  const double maxDiagonal = diagonal.size() > 0 ? diagonal.cwiseAbs().maxCoeff() : 0.0;
+  return (D.array() > relativeTolerance * maxDiagonal).all();
+}
+
+} // namespace
+
 void marginalize(
 			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
 			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
@@ -95,88 +159,140 @@ void marginalize(
 				dim += (*it)->dimension();
 			}
 
-		  aslam::backend::DenseQrLinearSystemSolver qrSolver;
-      qrSolver.initMatrixStructure(inDesignVariables, inErrorTerms, false);
-
 		  SM_INFO_STREAM("Marginalization optimization problem initialized with " << inDesignVariables.size() << " design variables and " << inErrorTerms.size() << " error terrms");
 		  SM_INFO_STREAM("The Jacobian matrix is " << dim << " x " << columnBase);
 
-		  qrSolver.evaluateError(numThreads, useMEstimator);
-		  qrSolver.buildSystem(numThreads, useMEstimator);
-
-
-		  const Eigen::MatrixXd& jacobian = qrSolver.getJacobian();
-		  const Eigen::VectorXd& b = qrSolver.e();
-
 		  // check dimension of jacobian
-		  int jrows = jacobian.rows();
-		  int jcols = jacobian.cols();
+		  int jrows = dim;
+		  int jcols = columnBase;
+		  if (jrows < jcols)
+		  {
+			  SM_THROW(aslam::Exception, "underdetermined LSE!");
+		  }
+		  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(jcols), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " rows of the covariance because the system only has " << jcols << " columns.");
 
 		  int dimOfRemainingDesignVariables = jcols - dimOfDesignVariablesToRemove;
-		  //int dimOfPriorErrorTerm = jrows;
-
-		  sm::timing::Timer t1("Rank Computation");
-		  // check the rank
-		  Eigen::FullPivLU<Eigen::MatrixXd> lu_decomp(jacobian);
-		  //lu_decomp.setThreshold(1e-20);
-		  double threshold = lu_decomp.threshold();
-		  int rank = lu_decomp.rank();
-		  int fullRank = std::min(jacobian.rows(), jacobian.cols());
-		  SM_DEBUG_STREAM("Rank of jacobian: " << rank << " (full rank: " << fullRank << ", threshold: " << threshold << ")");
-		  bool rankDeficient = rank < fullRank;
-		  if(rankDeficient)
+
+		  // Evaluate the weighted errors and the sparse weighted Jacobian in parallel.
+		  sm::timing::Timer t1("Jacobian evaluation");
+		  Eigen::VectorXd b(jrows);
+		  numThreads = std::max<size_t>(1, std::min(numThreads, inErrorTerms.size()));
+		  std::vector< std::vector<Triplet> > threadTriplets(numThreads);
+		  util::runThreadedFunction<std::vector<Triplet> >(
+		      boost::bind(&evaluateErrorTermRange, boost::cref(inErrorTerms), useMEstimator, boost::ref(b), _1, _2, _3, _4),
+		      inErrorTerms.size(), threadTriplets);
+		  std::vector<Triplet> triplets;
+		  for (auto& tt : threadTriplets)
 		  {
-			  SM_WARN("Marginalization jacobian is rank deficient!");
+		    triplets.insert(triplets.end(), tt.begin(), tt.end());
+		    std::vector<Triplet>().swap(tt);
 		  }
+		  SparseMatrix J(jrows, jcols);
+		  J.setFromTriplets(triplets.begin(), triplets.end());
+		  std::vector<Triplet>().swap(triplets);
 		  t1.stop();
-		  //SM_ASSERT_FALSE(aslam::Exception, rankDeficient, "Right now, we don't want the jacobian to be rank deficient - ever...");
 
-		  Eigen::MatrixXd R_reduced;
-		  Eigen::VectorXd d_reduced;
-		  if (jrows < jcols)
+		  // The indices are not needed beyond the Jacobian, so restore them before anything below can throw.
+		  for (size_t i = 0; i < inDesignVariables.size(); ++i) {
+		    inDesignVariables[i]->setBlockIndex(originalBlockIndices[i]);
+		    inDesignVariables[i]->setColumnBase(originalColumnBase[i]);
+		  }
+		  int index = 0;
+		  for(std::vector<aslam::backend::ErrorTerm*>::iterator it = inErrorTerms.begin(); it != inErrorTerms.end(); ++it)
 		  {
-			  SM_THROW(aslam::Exception, "underdetermined LSE!");
-			  // underdetermined LSE, don't do QR
-			  R_reduced = jacobian.block(0, dimOfDesignVariablesToRemove, jrows, jcols - dimOfDesignVariablesToRemove);
-			  d_reduced = b;
-
-		  } else {
-			  // PTF: Do we know what will happen when the jacobian matrix is rank deficient?
-			  // MB: yes, bad things!
-
-              // do QR decomposition
-			  sm::timing::Timer myTimer("QR Decomposition");
-        Eigen::HouseholderQR<Eigen::MatrixXd> qr(jacobian);
-			  Eigen::MatrixXd Q = qr.householderQ();
-			  Eigen::MatrixXd R = qr.matrixQR().triangularView<Eigen::Upper>();
-			  Eigen::VectorXd d = Q.transpose()*b;
-			  myTimer.stop();
-
-			  if(numTopRowsInCov > 0)
-			  {
-          sm::timing::Timer myTimer("Covariance computation");
-          Eigen::FullPivLU<Eigen::MatrixXd> lu_decomp(R);
-          Eigen::MatrixXd Rinv = lu_decomp.inverse();
-          Eigen::MatrixXd covariance = Rinv * Rinv.transpose();
-          outCov = covariance.block(0, 0, numTopRowsInCov, numTopRowsInCov);
-          myTimer.stop();
-			  }
+		    (*it)->setRowBase(originalRowBase[index++]);
+		  }
 
-//			  size_t numRowsToKeep = rank - dimOfDesignVariablesToRemove;
-//			  SM_ASSERT_TRUE_DBG(aslam::Exception, rankDeficient || (numRowsToKeep == dimOfRemainingDesignVariables), "must be the same if full rank!");
+		  // Build the normal equations H dx = g and eliminate the removed block with the Schur complement
+		  //   S  = H22 - H21 H11^-1 H12
+		  //   g' = g2  - H21 H11^-1 g1
+		  // Only H11 is factorized; it is sparse and usually small.
+		  sm::timing::Timer t2("Schur complement");
+		  const SparseMatrix H = (J.transpose() * J).pruned();
+		  const Eigen::VectorXd g = J.transpose() * b;
+		  const int nr = dimOfDesignVariablesToRemove;
+		  const int nk = dimOfRemainingDesignVariables;
+
+		  int rank = 0;
+		  Eigen::MatrixXd S = Eigen::MatrixXd(H.bottomRightCorner(nk, nk));
+		  Eigen::VectorXd gReduced = g.tail(nk);
+		  if (nr > 0)
+		  {
+		    const SparseMatrix H11 = H.topLeftCorner(nr, nr);
+		    const SparseMatrix H12 = H.topRightCorner(nr, nk);
+		    Eigen::MatrixXd H11invH12;
+		    Eigen::VectorXd H11invg1;
+		    // The sparse LDL^T is only trusted while H11 is comfortably nonsingular.
+		    Eigen::SimplicialLDLT<SparseMatrix> ldlt11(H11);
+		    if (ldlt11.info() == Eigen::Success && hasPositivePivots(ldlt11.vectorD(), H11, std::sqrt(std::numeric_limits<double>::epsilon())))
+		    {
+		      rank += nr;
+		      H11invH12 = ldlt11.solve(Eigen::MatrixXd(H12));
+		      H11invg1 = ldlt11.solve(g.head(nr));
+		    } else
+		    {
+		      // The LDL^T pivots of a singular H11 vanish and its solves return inf/NaN. H12 = J1^T J2 and
+		      // g1 = J1^T b lie in the range of H11 = J1^T J1, so any solution of these consistent systems
+		      // yields the same Schur complement; a rank-revealing QR provides one.
+		      SM_WARN("The Hessian block of the design variables to remove is rank deficient, falling back to a rank-revealing QR.");
+		      const Eigen::MatrixXd denseH11(H11);
+		      Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr11(denseH11);
+		      rank += qr11.rank();
+		      H11invH12 = qr11.solve(Eigen::MatrixXd(H12));
+		      H11invg1 = qr11.solve(g.head(nr));
+		    }
+		    S.noalias() -= H12.transpose() * H11invH12;
+		    gReduced.noalias() -= H12.transpose() * H11invg1;
+		  }
+		  t2.stop();
 
-			  // get the top left block
-			  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(R.rows()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " rows of R because it only has " << R.rows() << " rows.");
-			  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(R.cols()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " cols of R because it only has " << R.cols() << " cols.");
-			  //outRtop = R.block(0, 0, numTopRowsInRtop, numTopRowsInRtop);
+		  // Factorize S = P^T L D L^T P and write the prior as R = D^1/2 L^T P, d = D^-1/2 L^-1 P g'.
+		  // This satisfies R^T R = S and R^T d = g', which is all the prior error term needs.
+		  // Pivots that vanish numerically give zero rows in R and d.
+		  sm::timing::Timer t3("Prior factorization");
+		  Eigen::MatrixXd R_reduced;
+		  Eigen::VectorXd d_reduced;
+		  Eigen::LDLT<Eigen::MatrixXd> ldltS(S);
+		  const Eigen::VectorXd& D = ldltS.vectorD();
+		  const double tolerance = rankTolerance(D, jcols);
+		  rank += estimateRank(D, jcols);
+
+		  R_reduced = ldltS.matrixU();
+		  R_reduced = R_reduced * ldltS.transpositionsP().transpose();
+		  d_reduced = ldltS.transpositionsP() * gReduced;
+		  ldltS.matrixL().solveInPlace(d_reduced);
+		  for (int i = 0; i < nk; ++i)
+		  {
+		    if (D[i] > tolerance)
+		    {
+		      const double sqrtD = std::sqrt(D[i]);
+		      R_reduced.row(i) *= sqrtD;
+		      d_reduced[i] /= sqrtD;
+		    } else
+		    {
+		      R_reduced.row(i).setZero();
+		      d_reduced[i] = 0.0;
+		    }
+		  }
+		  t3.stop();
 
-        // cut off the zero rows at the bottom
-        R_reduced = R.block(dimOfDesignVariablesToRemove, dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables, dimOfRemainingDesignVariables);
-        //R_reduced = R.block(dimOfDesignVariablesToRemove, dimOfDesignVariablesToRemove, numRowsToKeep, dimOfRemainingDesignVariables);
+		  int fullRank = std::min(jrows, jcols);
+		  SM_DEBUG_STREAM("Rank of jacobian: " << rank << " (full rank: " << fullRank << ")");
+		  if(rank < fullRank)
+		  {
+			  SM_WARN("Marginalization jacobian is rank deficient!");
+		  }
 
-        d_reduced = d.segment(dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables);
-        //d_reduced = d.segment(dimOfDesignVariablesToRemove, numRowsToKeep);
-        //dimOfPriorErrorTerm = dimOfRemainingDesignVariables;
+		  if(numTopRowsInCov > 0)
+		  {
+		    // Only the requested top-left block of H^-1 is needed, so solve for these columns alone.
+		    sm::timing::Timer myTimer("Covariance computation");
+		    Eigen::SimplicialLDLT<SparseMatrix> ldltH(H);
+		    SM_ASSERT_TRUE(aslam::Exception, ldltH.info() == Eigen::Success && hasPositivePivots(ldltH.vectorD(), H, std::numeric_limits<double>::epsilon() * jcols),
+		                   "The marginalization Hessian is rank deficient, so the requested covariance block is undefined!");
+		    const Eigen::MatrixXd X = ldltH.solve(Eigen::MatrixXd::Identity(jcols, numTopRowsInCov));
+		    outCov = X.topRows(numTopRowsInCov);
+		    myTimer.stop();
 		  }
 
 		  // now create the new error term
@@ -184,17 +300,6 @@ void marginalize(
 
 		  outPriorErrorTermPtr.swap(err);
 
-		  // restore initial block indices to prevent side effects
-      for (size_t i = 0; i < inDesignVariables.size(); ++i) {
-          inDesignVariables[i]->setBlockIndex(originalBlockIndices[i]);
-          inDesignVariables[i]->setColumnBase(originalColumnBase[i]);
-      }
-      int index = 0;
-      for(std::vector<aslam::backend::ErrorTerm*>::iterator it = inErrorTerms.begin(); it != inErrorTerms.end(); ++it)
-      {
-          (*it)->setRowBase(originalRowBase[index++]);
-      }
-
       t0.stop();
 }
 
@@ -21,24 +21,18 @@ namespace aslam {
     /// when the problem is cleared or goes out of scope.
     void OptimizationProblem::addDesignVariable(DesignVariable* dv, bool problemOwnsVariable)
     {
-      // \todo This is also bad and slow.
-      for (unsigned i = 0; i < _designVariables.size(); ++i) {
-        SM_ASSERT_NE(std::runtime_error, dv, _designVariables[i].get(), "That design variable has already been added");
-      }
       if (problemOwnsVariable)
-        _designVariables.push_back(boost::shared_ptr<DesignVariable>(dv));
+        addDesignVariable(boost::shared_ptr<DesignVariable>(dv));
       else
-        _designVariables.push_back(boost::shared_ptr<DesignVariable>(dv, sm::null_deleter()));
+        addDesignVariable(boost::shared_ptr<DesignVariable>(dv, sm::null_deleter()));
     }
 
 
     /// \brief Add a design variable to the problem.
     void OptimizationProblem::addDesignVariable(boost::shared_ptr<DesignVariable> dv)
     {
-      // \todo This is also bad and slow.
-      for (unsigned i = 0; i < _designVariables.size(); ++i) {
-        SM_ASSERT_NE(std::runtime_error, dv.get(), _designVariables[i].get(), "That design variable has already been added");
-      }
+      const bool inserted = _designVariableIndex.emplace(dv.get(), _designVariables.size()).second;
+      SM_ASSERT_TRUE(std::runtime_error, inserted, "That design variable has already been added");
       _designVariables.push_back(dv);
     }
 
@@ -70,35 +64,51 @@ namespace aslam {
     /// \brief Add an error term to the problem
     void OptimizationProblem::addErrorTerm(const boost::shared_ptr<ErrorTerm> & et)
     {
+      const bool inserted = _errorTermIndex.emplace(et.get(), _errorTerms.size()).second;
+      SM_ASSERT_TRUE(std::runtime_error, inserted, "That error term has already been added");
       _errorTerms.push_back(et);
-      // add this error term to the multi-map
+      // add this error term to the map
       for (size_t i = 0; i < et->numDesignVariables(); ++i) {
         DesignVariable* dv = et->designVariable(i);
         SM_ASSERT_TRUE_DBG(aslam::InvalidArgumentException, isDesignVariableInProblem(dv), "It is illegal to add an error term that contains a missing design variable. Add the design variables to the problem before adding the error terms.");
-        _errorTermMap.insert(std::make_pair(dv, et.get()));
+        _errorTermMap[dv].insert(et.get());
       }
     }
 
     /// \brief Add a scalar non-squared error term to the problem
     void OptimizationProblem::addErrorTerm(const boost::shared_ptr<ScalarNonSquaredErrorTerm> & et)
     {
+      const bool inserted = _sNSErrorTermIndex.emplace(et.get(), _sNSErrorTerms.size()).second;
+      SM_ASSERT_TRUE(std::runtime_error, inserted, "That error term has already been added");
       _sNSErrorTerms.push_back(et);
-      // add this error term to the multi-map
+      // add this error term to the map
       for (size_t i = 0; i < et->numDesignVariables(); ++i) {
         DesignVariable* dv = et->designVariable(i);
         SM_ASSERT_TRUE_DBG(aslam::InvalidArgumentException, isDesignVariableInProblem(dv), "It is illegal to add an error term that contains a missing design variable. Add the design variables to the problem before adding the error terms.");
-        _errorTermMapSns.insert(std::make_pair(dv, et.get()));
+        _errorTermMapSns[dv].insert(et.get());
       }
     }
 
 
-    bool OptimizationProblem::isDesignVariableInProblem(const DesignVariable* dv)
+    bool OptimizationProblem::isDesignVariableInProblem(const DesignVariable* dv) const
     {
-      for (size_t i = 0; i < _designVariables.size(); ++i) {
-        if (_designVariables[i].get() == dv)
-          return true;
-      }
-      return false;
+      return _designVariableIndex.count(dv) > 0;
+    }
+
+    bool OptimizationProblem::isErrorTermInProblem(const ErrorTerm* et) const
+    {
+      return _errorTermIndex.count(et) > 0;
+    }
+
+    void OptimizationProblem::reserve(size_t numDesignVariables, size_t numErrorTerms, size_t numNonSquaredErrorTerms)
+    {
+      _designVariables.reserve(numDesignVariables);
+      _designVariableIndex.reserve(numDesignVariables);
+      _errorTermMap.reserve(numDesignVariables);
+      _errorTerms.reserve(numErrorTerms);
+      _errorTermIndex.reserve(numErrorTerms);
+      _sNSErrorTerms.reserve(numNonSquaredErrorTerms);
+      _sNSErrorTermIndex.reserve(numNonSquaredErrorTerms);
     }
 
     /// \brief clear the design variables and error terms.
@@ -107,8 +117,20 @@ namespace aslam {
       _errorTerms.clear();
       _sNSErrorTerms.clear();
       _designVariables.clear();
+      _designVariableIndex.clear();
+      _errorTermIndex.clear();
+      _sNSErrorTermIndex.clear();
       _errorTermMap.clear();
       _errorTermMapSns.clear();
+      if (_expressionArena)
+        _expressionArena->release();
+    }
+
+    ExpressionArena & OptimizationProblem::expressionArena()
+    {
+      if (!_expressionArena)
+        _expressionArena.reset(new ExpressionArena());
+      return *_expressionArena;
     }
 
 
@@ -158,75 +180,88 @@ namespace aslam {
 
     void OptimizationProblem::getErrorsImplementation(const DesignVariable* dv, std::set<ErrorTerm*>& outErrorSet)
     {
-      error_map_t::iterator it, it_end;
-      // I'm not sure why this const cast is necessary but I get a failure on OSX if it isn't here.
-      // Also, somehow this is painfully slow.
-      boost::tie(it, it_end) = _errorTermMap.equal_range(const_cast<DesignVariable*>(dv));
-      for (; it != it_end; ++it) {
-        outErrorSet.insert(it->second);
-      }
+      auto it = _errorTermMap.find(dv);
+      if (it != _errorTermMap.end())
+        outErrorSet.insert(it->second.begin(), it->second.end());
     }
 
     void OptimizationProblem::getNonSquaredErrorsImplementation(const DesignVariable* dv, std::set<ScalarNonSquaredErrorTerm*>& outErrorSet)
     {
-      error_map_sns_t::iterator it, it_end;
-      // I'm not sure why this const cast is necessary but I get a failure on OSX if it isn't here.
-      // Also, somehow this is painfully slow.
-      boost::tie(it, it_end) = _errorTermMapSns.equal_range(const_cast<DesignVariable*>(dv));
-      for (; it != it_end; ++it) {
-        outErrorSet.insert(it->second);
-      }
+      auto it = _errorTermMapSns.find(dv);
+      if (it != _errorTermMapSns.end())
+        outErrorSet.insert(it->second.begin(), it->second.end());
     }
 
-    /// \brief Remove the error term
-    void OptimizationProblem::removeErrorTerm(const ErrorTerm* et)
-    {
-      // For each design variable associated with this error term
-      for (size_t i = 0; i < et->numDesignVariables(); ++i) {
-        const DesignVariable* dv = et->designVariable(i);
-        error_map_t::iterator it, it_end;
-        boost::tie(it, it_end) = _errorTermMap.equal_range(const_cast<DesignVariable*>(dv));
-        for (; it != it_end; it++) {
-          if (it->second == et) {
-            // remove the reference from the multi-map.
-            _errorTermMap.erase(it);
-            break;
-          }
+    namespace {
+      /// \brief Remove the element at \p index by moving the last element into its place
+      template <typename T>
+      void swapRemove(std::vector< boost::shared_ptr<T> > & elements, std::unordered_map<const T*, size_t> & index, typename std::unordered_map<const T*, size_t>::iterator it)
+      {
+        const size_t i = it->second;
+        index.erase(it);
+        if (i + 1 != elements.size()) {
+          elements[i] = std::move(elements.back());
+          index[elements[i].get()] = i;
         }
+        elements.pop_back();
       }
-      // now remove the design variable.
-      // This sucks. \todo Make this more efficient.
-      std::vector< boost::shared_ptr<ErrorTerm> >::iterator eit = _errorTerms.begin();
-      for (; eit != _errorTerms.end(); ++eit) {
-        if (eit->get() == et) {
-          // remove this error term from the set of error terms.
-          _errorTerms.erase(eit);
-          break;
+
+      /// \brief Remove \p et from the error sets of all its design variables
+      template <typename ErrorMap, typename Error>
+      void removeFromErrorMap(ErrorMap & map, const Error* et)
+      {
+        for (size_t i = 0; i < et->numDesignVariables(); ++i) {
+          auto it = map.find(et->designVariable(i));
+          if (it == map.end())
+            continue;
+          it->second.erase(const_cast<Error*>(et));
+          if (it->second.empty())
+            map.erase(it);
         }
       }
     }
 
+    /// \brief Remove the error term
+    void OptimizationProblem::removeErrorTerm(const ErrorTerm* et)
+    {
+      auto it = _errorTermIndex.find(et);
+      if (it == _errorTermIndex.end())
+        return;
+      // The problem may own the error term, so it has to be unlinked before it is released
+      removeFromErrorMap(_errorTermMap, et);
+      swapRemove(_errorTerms, _errorTermIndex, it);
+    }
+
+    /// \brief Remove the scalar non-squared error term
+    void OptimizationProblem::removeErrorTerm(const ScalarNonSquaredErrorTerm* et)
+    {
+      auto it = _sNSErrorTermIndex.find(et);
+      if (it == _sNSErrorTermIndex.end())
+        return;
+      removeFromErrorMap(_errorTermMapSns, et);
+      swapRemove(_sNSErrorTerms, _sNSErrorTermIndex, it);
+    }
+
     /// \brief Remove the design variable
     void OptimizationProblem::removeDesignVariable(const DesignVariable* dv)
     {
-      // Remove any error terms from the project
-      error_map_t::iterator it, it2, it_end;
-      boost::tie(it, it_end) = _errorTermMap.equal_range(const_cast<DesignVariable*>(dv));
-      std::vector<ErrorTerm*> terms;
-      for (; it != it_end; ++it) {
-        terms.push_back(it->second);
+      // Remove any error terms from the problem
+      auto eit = _errorTermMap.find(dv);
+      if (eit != _errorTermMap.end()) {
+        const std::vector<ErrorTerm*> terms(eit->second.begin(), eit->second.end());
+        for (ErrorTerm* et : terms)
+          removeErrorTerm(et);
       }
-      for (size_t i = 0; i < terms.size(); ++i) {
-        removeErrorTerm(terms[i]);
+      auto sit = _errorTermMapSns.find(dv);
+      if (sit != _errorTermMapSns.end()) {
+        const std::vector<ScalarNonSquaredErrorTerm*> terms(sit->second.begin(), sit->second.end());
+        for (ScalarNonSquaredErrorTerm* et : terms)
+          removeErrorTerm(et);
       }
       // Now remove the design variable itself.
-      std::vector< boost::shared_ptr<DesignVariable> >::iterator dit = _designVariables.begin();
-      for (; dit != _designVariables.end(); ++dit) {
-        if (dit->get() == dv) {
-          _designVariables.erase(dit);
-          return;
-        }
-      }
+      auto it = _designVariableIndex.find(dv);
+      if (it != _designVariableIndex.end())
+        swapRemove(_designVariables, _designVariableIndex, it);
     }
 
     size_t OptimizationProblem::countActiveDesignVariables() {
@@ -15,7 +15,12 @@
 #include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/LinearSystemSolverSelector.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <aslam/backend/util/Deadline.hpp>
 #include <sm/PropertyTree.hpp>
+#include <sm/logging.hpp>
+#include <boost/bind.hpp>
 
 
 template <typename T>
@@ -32,11 +37,40 @@ T getDeprecatedPropertyIfItExists(const sm::ConstPropertyTree& config, const std
   return v;
 }
 
+namespace {
+  // The trace is a diagnostic: failing to write it must neither fail a successful
+  // optimization nor replace the exception of a failed one.
+  void writeTraceFile(const std::string & filename) {
+    try {
+      aslam::backend::instrumentation::writeChromeTrace(filename);
+    } catch (const std::exception & e) {
+      SM_ERROR_STREAM("Failed to write the optimizer trace: " << e.what());
+    }
+  }
+}
+
 namespace aslam {
     namespace backend {
 
         void Optimizer2::Status::resetImplementation() {
           srv = SolutionReturnValue();
+          iterationTime = 0.0;
+        }
+
+        namespace {
+          /// \brief Sets the deadline of a solver for its lifetime
+          struct ScopedSolverDeadline {
+            ScopedSolverDeadline(LinearSystemSolver& solver, const util::Deadline& deadline) : solver(solver) { solver.setDeadline(deadline); }
+            ~ScopedSolverDeadline() { solver.setDeadline(util::Deadline()); }
+            LinearSystemSolver& solver;
+          };
+
+          /// \brief Lets a trust region policy try steps for its lifetime
+          struct ScopedTrialStepEvaluator {
+            ScopedTrialStepEvaluator(TrustRegionPolicy& policy, const TrustRegionPolicy::TrialStepEvaluator& evaluator) : policy(policy) { policy.setTrialStepEvaluator(evaluator); }
+            ~ScopedTrialStepEvaluator() { policy.setTrialStepEvaluator(TrustRegionPolicy::TrialStepEvaluator()); }
+            TrustRegionPolicy& policy;
+          };
         }
 
         Optimizer2::Optimizer2(const Options& options) :
@@ -54,8 +88,12 @@ namespace aslam {
           options.doSchurComplement = config.getBool("doSchurComplement", options.doSchurComplement);
           options.verbose = config.getBool("verbose", options.verbose);
           options.linearSolverMaximumFails = config.getInt("linearSolverMaximumFails", options.linearSolverMaximumFails);
+          options.fuseErrorAndJacobianEvaluation = config.getBool("fuseErrorAndJacobianEvaluation", options.fuseErrorAndJacobianEvaluation);
+          options.timeLimit = config.getDouble("timeLimit", options.timeLimit);
           options.numThreadsJacobian = getDeprecatedPropertyIfItExists(config, "nThreads", "numThreadsJacobian", (int)options.numThreadsJacobian, static_cast<int(sm::ConstPropertyTree::*)(const std::string&, int) const>(&sm::ConstPropertyTree::getInt));
           options.numThreadsError = config.getInt("numThreadsError", options.numThreadsError);
+          options.traceFile = config.getString("traceFile", options.traceFile);
+          options.traceBufferSize = config.getInt("traceBufferSize", options.traceBufferSize);
           options.linearSystemSolver = linearSystemSolver;
           options.trustRegionPolicy = trustRegionPolicy;
           _options = options;
@@ -79,7 +117,7 @@ namespace aslam {
 
 
           // \todo remove this check when the sparse qr solver supports an augmented diagonal
-          if(_solver->name() == "sparse_qr" && _trustRegionPolicy->name() == "levenberg_marquardt") {
+          if(_solver && _solver->name() == "sparse_qr" && _trustRegionPolicy->name() == "levenberg_marquardt") {
             _options.verbose && std::cout << "The sparse_qr solver is not compatible with levenberg_marquardt. Changing to the dog_leg trust region policy\n";
             _trustRegionPolicy.reset( new DogLegTrustRegionPolicy() );
           }
@@ -91,7 +129,10 @@ namespace aslam {
 
         void Optimizer2::initializeLinearSolver()
         {
-          if( ! _options.linearSystemSolver ) {
+          if( ! _options.linearSystemSolver && _options.linearSystemSolverSelector ) {
+            // Selected from the structure of the problem in initializeImplementation()
+            return;
+          } else if( ! _options.linearSystemSolver ) {
             _options.verbose && std::cout << "No linear system solver set in the options. Defaulting to the sparse_cholesky solver\n";
             _solver.reset(new SparseCholeskyLinearSystemSolver());
           } else {
@@ -105,8 +146,16 @@ namespace aslam {
         {
             OptimizerProblemManagerBase::initializeImplementation();
             initializeLinearSolver();
+            if( ! _options.linearSystemSolver && _options.linearSystemSolverSelector ) {
+              // The sparse_qr solver can't be used if the trust region policy damps the system
+              const bool requiresAugmentedDiagonal = ! _options.trustRegionPolicy || _options.trustRegionPolicy->requiresAugmentedDiagonal();
+              _solver = _options.linearSystemSolverSelector->select(getDesignVariables(), problemManager().getErrorTerms(), requiresAugmentedDiagonal);
+              _options.verbose && std::cout << "Selected the " << _solver->name() << " linear system solver ("
+                  << _options.linearSystemSolverSelector->lastDecision().reason << ")\n";
+            }
             initializeTrustRegionPolicy();
 
+            _isFactorizedAtState = _p_isFactorizedAtState = false;
             Timer initMx("Optimizer2: Initialize---Matrices");
             // Set up the block matrix structure.
             _solver->initMatrixStructure(getDesignVariables(), problemManager().getErrorTerms(), _trustRegionPolicy->requiresAugmentedDiagonal());
@@ -145,26 +194,37 @@ namespace aslam {
 
       SolutionReturnValue Optimizer2::optimize()
       {
-        OptimizerProblemManagerBase::optimize();
+        if (_options.traceFile.empty()) {
+          OptimizerProblemManagerBase::optimize();
+          return _status.srv;
+        }
+        instrumentation::startTracing(_options.traceBufferSize);
+        try {
+          OptimizerProblemManagerBase::optimize();
+        } catch (...) {
+          // The trace of a failed run is the most interesting one
+          instrumentation::stopTracing();
+          writeTraceFile(_options.traceFile);
+          throw;
+        }
+        instrumentation::stopTracing();
+        writeTraceFile(_options.traceFile);
         return _status.srv;
       }
 
         void Optimizer2::optimizeImplementation()
         {
-            Timer timeErr("Optimizer2: evaluate error", true);
-            Timer timeSchur("Optimizer2: Schur complement", true);
-            Timer timeBackSub("Optimizer2: Back substitution", true);
-            Timer timeSolve("Optimizer2: Build and solve linear system", true);
             // Select the design variables and (eventually) the error terms involved in the optimization.
             SolutionReturnValue & srv = _status.srv;
             _status.numIterations = srv.iterations;
+            _proceedInstruction = callback::ProceedInstruction::CONTINUE;
 
             _p_J = -1.0;
+            _isFactorizedAtState = _p_isFactorizedAtState = false;
 
-            // This sets _J
-            timeErr.start();
-            evaluateError(true);
-            timeErr.stop();
+            instrumentation::setIteration(srv.iterations);
+            // This sets _J. Every policy linearizes the initial state.
+            evaluateErrorAndJacobians(true);
             _p_J = _status.error;
             srv.JStart = _p_J;
             // *** while not done
@@ -179,22 +239,52 @@ namespace aslam {
 
             SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
             _trustRegionPolicy->setSolver(_solver);
+            ScopedTrialStepEvaluator trialStepEvaluator(*_trustRegionPolicy, boost::bind(&Optimizer2::evaluateTrialStep, this, _1, _2));
             _trustRegionPolicy->optimizationStarting(_status.error);
 
             issueCallback<callback::event::OPTIMIZATION_INITIALIZED>();
 
+            // The time limit bounds the iterations, the initial error is always evaluated
+            const util::Deadline deadline = _options.timeLimit > 0.0 ? util::Deadline(_options.timeLimit) : util::Deadline();
+            ScopedSolverDeadline solverDeadline(*_solver, deadline);
+            bool timeLimitReached = false;
+            // Policies which don't revert regressions may end on a worse state than the previous one
+            bool lastStepRegressed = false;
+            double previousJ = _p_J;
+
             // Loop until convergence
-            while (srv.iterations <  _options.maxIterations &&
+            while (_proceedInstruction == callback::ProceedInstruction::CONTINUE &&
+                   srv.iterations <  _options.maxIterations &&
                    srv.failedIterations < _options.maxIterations &&
                    ((deltaX > _options.convergenceDeltaX &&
                      fabs(deltaJ) > _options.convergenceDeltaError) ||
                     linearSolverFailure)) {
-
-                timeSolve.start();
-                bool solutionSuccess = _trustRegionPolicy->solveSystem(_status.error, previousIterationFailed, _options.numThreadsError, _dx);
+                // Don't start an iteration which is not expected to finish in time
+                if (deadline.remaining() < _status.iterationTime) {
+                    timeLimitReached = true;
+                    break;
+                }
+                const util::Deadline::Clock::time_point iterationStart = util::Deadline::Clock::now();
+                instrumentation::setIteration(srv.iterations);
+                instrumentation::ScopedTrace trace("Iteration");
+
+                bool solutionSuccess;
+                try {
+                    solutionSuccess = _trustRegionPolicy->solveSystem(_status.error, previousIterationFailed, _options.numThreadsError, _dx);
+                } catch (const util::Deadline::Exceeded&) {
+                    _isFactorizedAtState = false;
+                    timeLimitReached = true;
+                    break;
+                }
+                _isFactorizedAtState = solutionSuccess;
                 SM_ASSERT_EQ(Exception, problemManager().numOptParameters(), size_t(_dx.size()), "_trustRegionPolicy->solveSystem yielded dx with wrong size!");
-                timeSolve.stop();
                 issueCallback<callback::event::LINEAR_SYSTEM_SOLVED>();
+                if (_proceedInstruction != callback::ProceedInstruction::CONTINUE)
+                    break;
+                if (deadline.isExceeded()) {
+                    timeLimitReached = true;
+                    break;
+                }
 
                 if (!solutionSuccess) {
                     _options.verbose && std::cout << "[WARNING] System solution failed\n";
@@ -203,14 +293,25 @@ namespace aslam {
                     srv.failedIterations++;
                 } else {
                     /// Apply the state update. _A, _b, _dx, and _H are passed in implicitly.
-                    timeBackSub.start();
-                    deltaX = applyStateUpdate();
-                    timeBackSub.stop();
+                    deltaX = applyStateUpdate(_dx);
                     issueCallback<callback::event::DESIGN_VARIABLES_UPDATED>();
                     // This sets _J
-                    timeErr.start();
-                    evaluateError(true);
-                    timeErr.stop();
+                    try {
+                        double trialJ;
+                        if (_trustRegionPolicy->takeEvaluatedStepError(trialJ) && !_trustRegionPolicy->linearizesEveryStep() &&
+                            _callbackManager.numCallbacks(typeid(callback::event::RESIDUALS_UPDATED)) == 0)
+                            useEvaluatedError(trialJ);
+                        else if (_trustRegionPolicy->linearizesEveryStep())
+                            evaluateErrorAndJacobians(true);
+                        else
+                            evaluateError(true);
+                    } catch (const util::Deadline::Exceeded&) {
+                        // The error of the new state is unknown, go back to the last evaluated state
+                        revertLastStateUpdate();
+                        lastStepRegressed = false;
+                        timeLimitReached = true;
+                        break;
+                    }
                     deltaJ = _p_J - _status.error;
                     // This was a regression.
                     if( _trustRegionPolicy->revertOnFailure() )
@@ -230,6 +331,8 @@ namespace aslam {
                     }
                     else
                     {
+                        lastStepRegressed = deltaJ < 0.0;
+                        previousJ = _p_J;
                         _p_J = _status.error;
                     }
                     srv.iterations++;
@@ -239,14 +342,33 @@ namespace aslam {
                     _options.verbose && _trustRegionPolicy->printState(std::cout);
                     _options.verbose && std::cout << std::endl;
                 }
+                // An exponential moving average with weight 1/2, so that the slower first iteration with the
+                // symbolic factorization fades out after a few iterations
+                const double iterationTime = std::chrono::duration<double>(util::Deadline::Clock::now() - iterationStart).count();
+                _status.iterationTime = _status.iterationTime > 0.0 ? 0.5 * (_status.iterationTime + iterationTime) : iterationTime;
             } // if the linear solver failed / else
+
+            const bool stoppedEarly = timeLimitReached || _proceedInstruction != callback::ProceedInstruction::CONTINUE;
+            if (stoppedEarly && lastStepRegressed) {
+                // Return the better of the last two states
+                _options.verbose && std::cout << "Stopped after a regression. Reverting\n";
+                revertLastStateUpdate();
+                _p_J = previousJ;
+            }
             srv.JFinal = _status.error = _p_J;
             srv.dXFinal = deltaX;
             srv.dJFinal = deltaJ;
             srv.linearSolverFailure = linearSolverFailure;
 
             //TODO make _status.convergence a set!
-            if(srv.iterations >= _options.maxIterations){
+            if (timeLimitReached) {
+              _options.verbose && std::cout << "Time limit reached after " << srv.iterations << " iterations\n";
+              _status.convergence = TIME_LIMIT;
+            } else if (_proceedInstruction == callback::ProceedInstruction::SUCCEED) {
+              _status.convergence = STOPPED;
+            } else if (_proceedInstruction == callback::ProceedInstruction::FAIL) {
+              _status.convergence = FAILURE;
+            } else if(srv.iterations >= _options.maxIterations){
               _status.convergence = MAX_ITERATIONS;
             } else if(linearSolverFailure || srv.failedIterations >= _options.maxIterations){
               _status.convergence = FAILURE;
@@ -272,39 +394,81 @@ namespace aslam {
             }
 
 
-            double Optimizer2::applyStateUpdate()
+            double Optimizer2::applyStateUpdate(const Eigen::VectorXd& dx)
             {
+                instrumentation::ScopedPhase phase(instrumentation::Phase::StateUpdate);
+                _p_isFactorizedAtState = _isFactorizedAtState;
+                _isFactorizedAtState = false;
                 // Apply the update to the dense state.
                 int startIdx = 0;
                 for (DesignVariable* d : getDesignVariables()) {
                     const int dbd = d->minimalDimensions();
-                    Eigen::VectorXd dxS = _dx.segment(startIdx, dbd);
+                    Eigen::VectorXd dxS = dx.segment(startIdx, dbd);
                     dxS *= d->scaling();
                     d->update(&dxS[0], dbd);
                     startIdx += dbd;
                 }
                 // Track the maximum delta
                 // \todo: should this be some other metric?
-                double deltaX = _dx.array().abs().maxCoeff();
+                double deltaX = dx.array().abs().maxCoeff();
                 return deltaX;
             }
 
+            double Optimizer2::evaluateTrialStep(const Eigen::VectorXd& dx, int nThreads)
+            {
+                SM_ASSERT_EQ(Exception, problemManager().numOptParameters(), size_t(dx.size()), "The trial step has the wrong size");
+                instrumentation::ScopedTrace trace("Evaluate trial step");
+                applyStateUpdate(dx);
+                double J;
+                try {
+                    _status.numErrorEvaluations++;
+                    J = _solver->evaluateError(nThreads, true);
+                } catch (...) {
+                    revertLastStateUpdate();
+                    throw;
+                }
+                revertLastStateUpdate();
+                return J;
+            }
+
 
 
 
 
             void Optimizer2::revertLastStateUpdate()
             {
+                instrumentation::ScopedPhase phase(instrumentation::Phase::StateUpdate);
                 for (DesignVariable * d : getDesignVariables()) {
                     d->revertUpdate();
                 }
+                _isFactorizedAtState = _p_isFactorizedAtState;
+                _solver->discardEvaluatedJacobians();
             }
 
             double Optimizer2::evaluateError(bool useMEstimator)
             {
               SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
+              _status.numErrorEvaluations++;
               _status.error = _solver->evaluateError(_options.numThreadsError, useMEstimator, &_callbackManager);
-              _callbackManager.issueCallback(callback::event::COST_UPDATED{_status.error, _p_J});
+              proceed(_callbackManager.issueCallback(callback::event::COST_UPDATED{_status.error, _p_J}));
+              return _status.error;
+            }
+
+            void Optimizer2::useEvaluatedError(double J)
+            {
+              _status.error = J;
+              proceed(_callbackManager.issueCallback(callback::event::COST_UPDATED{_status.error, _p_J}));
+            }
+
+            double Optimizer2::evaluateErrorAndJacobians(bool useMEstimator)
+            {
+              SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
+              // Residual callbacks may change the weights of the Jacobians, which would then be stale.
+              if (!_options.fuseErrorAndJacobianEvaluation || _callbackManager.numCallbacks(typeid(callback::event::RESIDUALS_UPDATED)) > 0)
+                return evaluateError(useMEstimator);
+              _status.numErrorEvaluations++;
+              _status.error = _solver->evaluateErrorAndJacobians(_options.numThreadsError, useMEstimator, &_callbackManager);
+              proceed(_callbackManager.issueCallback(callback::event::COST_UPDATED{_status.error, _p_J}));
               return _status.error;
             }
 
@@ -324,6 +488,12 @@ namespace aslam {
             void Optimizer2::printTiming() const
             {
                 sm::timing::Timing::print(std::cout);
+                if (_solver) {
+                  std::cout << "Fused error and Jacobian passes: " << _solver->numFusedEvaluations()
+                            << ", Jacobian passes saved: " << _solver->numSavedJacobianPasses() << std::endl;
+                }
+                if (instrumentation::isEnabled())
+                  instrumentation::collect().print(std::cout);
             }
 
 
@@ -341,8 +511,6 @@ namespace aslam {
 
             void Optimizer2::computeDiagonalCovariances(SparseBlockMatrix& outP, double lambda)
             {
-                SM_THROW(Exception, "Broken");
-
                 std::vector<std::pair<int, int> > blockIndices;
                 for (size_t i = 0; i < getDesignVariables().size(); ++i) {
                     blockIndices.push_back(std::make_pair(i, i));
@@ -350,17 +518,64 @@ namespace aslam {
                 computeCovarianceBlocks(blockIndices, outP, lambda);
             }
 
-    void Optimizer2::computeCovarianceBlocks(const std::vector<std::pair<int, int> > & /* blockIndices */, SparseBlockMatrix& /* outP */, double /* lambda */)
+    void Optimizer2::computeCovarianceBlocks(const std::vector<std::pair<int, int> > & blockIndices, SparseBlockMatrix& outP, double lambda)
             {
-                SM_THROW(Exception, "Broken");
-
+              Timer timer("Optimizer2: Compute covariance blocks");
+              std::vector<int> rowBlockIndices;
+              int columnBase = 0;
+              for (const DesignVariable* dv : getDesignVariables()) {
+                columnBase += dv->minimalDimensions();
+                rowBlockIndices.push_back(columnBase);
+              }
+
+              // The last factor of the optimization can be used if it is the factor of the same Hessian, i.e. the
+              // state didn't change since the last linear solve, the conditioner matches and the error terms were
+              // not reweighted by M-estimators.
+              boost::shared_ptr<SparseCholeskyLinearSystemSolver> solver = boost::dynamic_pointer_cast<SparseCholeskyLinearSystemSolver>(_solver);
+              if (solver && _isFactorizedAtState && isInitialized() && solver->isFactorizedWithConstantConditioner(lambda)) {
+                bool usesMEstimator = false;
+                for (ErrorTerm* e : problemManager().getErrorTerms())
+                  usesMEstimator = usesMEstimator || !e->getMEstimatorPolicy<NoMEstimator>();
+                if (!usesMEstimator) {
+                  _options.verbose && std::cout << "Reusing the factor of the last linear solve for the covariance computation.\n";
+                  bool success = solver->computeCovarianceBlocks(rowBlockIndices, blockIndices, outP, _options.numThreadsJacobian);
+                  SM_ASSERT_TRUE(Exception, success, "Unable to retrieve covariance");
+                  return;
+                }
+              }
+
+              // Otherwise the Hessian is linearized at the current state with the options and the ordering groups
+              // of the optimization solver. The covariance solver is kept, so its symbolic analysis is reused while
+              // the structure of the problem doesn't change.
+              if (!_covarianceSolver)
+                _covarianceSolver.reset(new SparseCholeskyLinearSystemSolver());
+              if (solver) {
+                _covarianceSolver->setOptions(solver->getOptions());
+                _covarianceSolver->clearOrderingGroups();
+                for (const auto& group : solver->getOrderingGroups())
+                  _covarianceSolver->setOrderingGroup(group.first, group.second);
+              }
+              _options.verbose && std::cout << "Factorizing the Hessian with diagonal conditioner " << lambda << " for the covariance computation.\n";
+              _covarianceSolver->initMatrixStructure(getDesignVariables(), problemManager().getErrorTerms(), true);
+              _covarianceSolver->evaluateError(_options.numThreadsError, false);
+              _covarianceSolver->setConstantConditioner(lambda);
+              _covarianceSolver->buildSystem(_options.numThreadsJacobian, false);
+              Eigen::VectorXd dx;
+              SM_ASSERT_TRUE(Exception, _covarianceSolver->solveSystem(dx), "Unable to factorize the Hessian");
+              bool success = _covarianceSolver->computeCovarianceBlocks(rowBlockIndices, blockIndices, outP, _options.numThreadsJacobian);
+              SM_ASSERT_TRUE(Exception, success, "Unable to retrieve covariance");
             }
 
 
-    void Optimizer2::computeCovariances(SparseBlockMatrix& /* outP */, double /* lambda */)
+    void Optimizer2::computeCovariances(SparseBlockMatrix& outP, double lambda)
             {
-                SM_THROW(Exception, "Broken");
-
+              std::vector<std::pair<int, int> > blockIndices;
+              for (size_t i = 0; i < getDesignVariables().size(); ++i) {
+                for (size_t j = i; j < getDesignVariables().size(); ++j) {
+                  blockIndices.push_back(std::make_pair(i, j));
+                }
+              }
+              computeCovarianceBlocks(blockIndices, outP, lambda);
             }
 
         void Optimizer2::computeHessian(SparseBlockMatrix& outH, double lambda)
@@ -385,13 +600,18 @@ namespace aslam {
 
 
         const Matrix * Optimizer2::getJacobian() const {
-            return _solver->Jacobian();
+            return _solver ? _solver->Jacobian() : nullptr;
         }
 
         template <typename Event>
         void Optimizer2::issueCallback(){
-          //TODO (HannesSommer) use ProceedInstruction value in the Optimizer
-          _callbackManager.issueCallback(Event{_status.error, 0});
+          proceed(_callbackManager.issueCallback(Event{_status.error, 0}));
+        }
+
+        void Optimizer2::proceed(callback::ProceedInstruction instruction){
+          // The first instruction to stop wins
+          if (_proceedInstruction == callback::ProceedInstruction::CONTINUE)
+            _proceedInstruction = instruction;
         }
 
         } // namespace backend
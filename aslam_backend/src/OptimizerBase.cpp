@@ -93,6 +93,12 @@ std::ostream& operator<<(std::ostream& out, const ConvergenceStatus& convergence
     case ConvergenceStatus::MAX_ITERATIONS:
       out << "MAX_ITERATIONS";
       break;
+    case ConvergenceStatus::TIME_LIMIT:
+      out << "TIME_LIMIT";
+      break;
+    case ConvergenceStatus::STOPPED:
+      out << "STOPPED";
+      break;
   }
   return out;
 }
@@ -1,4 +1,5 @@
 #include <aslam/backend/OptimizerCallbackManager.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
 #include <map>
 #include <vector>
 #include <algorithm>
@@ -46,7 +47,12 @@ std::size_t Registry::numCallbacks(std::type_index event) const {
 }
 
 ProceedInstruction Manager::issueCallback(const Event & arg) {
-  for(auto & c : data->callbacks[std::type_index(typeid(arg))]){
+  std::vector<OptimizerCallback> & callbacks = data->callbacks[std::type_index(typeid(arg))];
+  if(callbacks.empty()){
+    return ProceedInstruction::CONTINUE;
+  }
+  instrumentation::ScopedTrace trace("Callbacks");
+  for(auto & c : callbacks){
     auto r =  c(arg);
     if(r != ProceedInstruction::CONTINUE){
       return r;
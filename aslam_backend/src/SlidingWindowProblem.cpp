@@ -0,0 +1,294 @@
+#include <aslam/backend/SlidingWindowProblem.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+#include <aslam/backend/DesignVariable.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/Marginalizer.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/util/Deadline.hpp>
+#include <sm/boost/null_deleter.hpp>
+#include <sm/PropertyTree.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    namespace {
+
+      double secondsSince(const util::Deadline::Clock::time_point& start)
+      {
+        return std::chrono::duration<double>(util::Deadline::Clock::now() - start).count();
+      }
+
+    }
+
+    SlidingWindowProblemOptions::SlidingWindowProblemOptions() {}
+
+    SlidingWindowProblemOptions::SlidingWindowProblemOptions(const sm::ConstPropertyTree& config) {
+      useMEstimator = config.getBool("useMEstimator", useMEstimator);
+      numThreadsMarginalization = config.getInt("numThreadsMarginalization", numThreadsMarginalization);
+      verbose = config.getBool("verbose", verbose);
+    }
+
+    SlidingWindowProblem::SlidingWindowProblem(const Optimizer2Options& optimizerOptions, const Options& options) :
+        _options(options), _optimizer(new Optimizer2(optimizerOptions)), _windowChanged(true)
+    {
+      initializeOptimizer();
+    }
+
+    SlidingWindowProblem::SlidingWindowProblem(const sm::ConstPropertyTree& config, boost::shared_ptr<LinearSystemSolver> linearSystemSolver, boost::shared_ptr<TrustRegionPolicy> trustRegionPolicy) :
+        _options(config), _optimizer(new Optimizer2(config, linearSystemSolver, trustRegionPolicy)), _windowChanged(true)
+    {
+      initializeOptimizer();
+    }
+
+    SlidingWindowProblem::~SlidingWindowProblem()
+    {
+    }
+
+    void SlidingWindowProblem::initializeOptimizer()
+    {
+      // The solver keeps the structure of the system from one window to the next, so it must not be replaced on
+      // every initialization
+      Optimizer2Options& options = _optimizer->options();
+      if (!options.linearSystemSolver && !options.linearSystemSolverSelector)
+        options.linearSystemSolver.reset(new SparseCholeskyLinearSystemSolver());
+      // The optimizer doesn't own the window it is part of
+      _optimizer->setProblem(boost::shared_ptr<OptimizationProblemBase>(this, sm::null_deleter()));
+    }
+
+    void SlidingWindowProblem::addDesignVariable(DesignVariable* dv, bool problemOwnsVariable)
+    {
+      if (problemOwnsVariable)
+        addDesignVariable(boost::shared_ptr<DesignVariable>(dv));
+      else
+        addDesignVariable(boost::shared_ptr<DesignVariable>(dv, sm::null_deleter()));
+    }
+
+    void SlidingWindowProblem::addDesignVariable(const boost::shared_ptr<DesignVariable>& dv)
+    {
+      SM_ASSERT_TRUE(Exception, dv != nullptr, "Null design variable");
+      const bool inserted = _designVariableSet.insert(dv.get()).second;
+      SM_ASSERT_TRUE(Exception, inserted, "That design variable has already been added");
+      _designVariables.push_back(dv);
+      _windowChanged = true;
+    }
+
+    void SlidingWindowProblem::addErrorTerm(ErrorTerm* et, bool problemOwnsErrorTerm)
+    {
+      if (problemOwnsErrorTerm)
+        addErrorTerm(boost::shared_ptr<ErrorTerm>(et));
+      else
+        addErrorTerm(boost::shared_ptr<ErrorTerm>(et, sm::null_deleter()));
+    }
+
+    void SlidingWindowProblem::addErrorTerm(const boost::shared_ptr<ErrorTerm>& et)
+    {
+      SM_ASSERT_TRUE(Exception, et != nullptr, "Null error term");
+      SM_ASSERT_TRUE(Exception, _errorTermSet.find(et.get()) == _errorTermSet.end(), "That error term has already been added");
+      for (const DesignVariable* dv : et->designVariables()) {
+        SM_ASSERT_TRUE(Exception, !dv->isActive() || isDesignVariableInProblem(dv),
+                       "The error term depends on an active design variable which is not in the window");
+        SM_ASSERT_TRUE(Exception, !isMarkedForRemoval(dv), "The error term depends on a design variable marked for removal");
+      }
+      _errorTermSet.insert(et.get());
+      for (const DesignVariable* dv : et->designVariables())
+        _errorTermMap[dv].insert(et.get());
+      _errorTerms.push_back(et);
+      _windowChanged = true;
+    }
+
+    void SlidingWindowProblem::markForRemoval(const DesignVariable* dv)
+    {
+      SM_ASSERT_TRUE(Exception, isDesignVariableInProblem(dv), "The design variable is not in the window");
+      _markedForRemoval.insert(dv);
+    }
+
+    bool SlidingWindowProblem::isMarkedForRemoval(const DesignVariable* dv) const
+    {
+      return _markedForRemoval.find(dv) != _markedForRemoval.end();
+    }
+
+    void SlidingWindowProblem::slide()
+    {
+      Timer timer("SlidingWindowProblem: Slide");
+      const auto start = util::Deadline::Clock::now();
+      _statistics = Statistics();
+      if (_markedForRemoval.empty())
+        return;
+
+      // The active design variables to marginalize and the error terms depending on them
+      std::vector<DesignVariable*> marginalizedDvs;
+      std::unordered_set<ErrorTerm*> marginalizedErrorSet;
+      for (const auto& dv : _designVariables) {
+        if (!isMarkedForRemoval(dv.get()))
+          continue;
+        auto it = _errorTermMap.find(dv.get());
+        if (it != _errorTermMap.end())
+          marginalizedErrorSet.insert(it->second.begin(), it->second.end());
+        if (dv->isActive())
+          marginalizedDvs.push_back(dv.get());
+      }
+      // In the order of the window to get the same prior for the same structure
+      std::vector<ErrorTerm*> marginalizedErrors;
+      for (const auto& et : _errorTerms)
+        if (marginalizedErrorSet.count(et.get()))
+          marginalizedErrors.push_back(et.get());
+
+      // The design variables remaining in the window which these error terms connect to get the prior
+      std::unordered_set<const DesignVariable*> connected;
+      for (ErrorTerm* et : marginalizedErrors)
+        for (const DesignVariable* dv : et->designVariables())
+          if (dv->isActive() && !isMarkedForRemoval(dv))
+            connected.insert(dv);
+      std::vector<DesignVariable*> dvs(marginalizedDvs);
+      for (const auto& dv : _designVariables)
+        if (connected.count(dv.get()))
+          dvs.push_back(dv.get());
+
+      boost::shared_ptr<MarginalizationPriorErrorTerm> prior;
+      if (!marginalizedErrors.empty() && dvs.size() > marginalizedDvs.size()) {
+        Eigen::MatrixXd covariance;
+        std::vector<DesignVariable*> covarianceDvs;
+        marginalize(dvs, marginalizedErrors, marginalizedDvs.size(), _options.useMEstimator, prior, covariance, covarianceDvs,
+                    0, _options.numThreadsMarginalization);
+      }
+
+      // Remove the marginalized design variables and error terms, keeping the order of the others
+      _designVariables.erase(std::remove_if(_designVariables.begin(), _designVariables.end(),
+                                            [this](const boost::shared_ptr<DesignVariable>& dv) { return isMarkedForRemoval(dv.get()); }),
+                             _designVariables.end());
+      for (const DesignVariable* dv : _markedForRemoval) {
+        _designVariableSet.erase(dv);
+        _errorTermMap.erase(dv);
+      }
+      for (ErrorTerm* et : marginalizedErrors) {
+        _errorTermSet.erase(et);
+        for (const DesignVariable* dv : et->designVariables()) {
+          auto it = _errorTermMap.find(dv);
+          if (it != _errorTermMap.end())
+            it->second.erase(et);
+        }
+      }
+      _errorTerms.erase(std::remove_if(_errorTerms.begin(), _errorTerms.end(),
+                                       [&marginalizedErrorSet](const boost::shared_ptr<ErrorTerm>& et) { return marginalizedErrorSet.count(et.get()) > 0; }),
+                        _errorTerms.end());
+      _priors.erase(std::remove_if(_priors.begin(), _priors.end(),
+                                   [&marginalizedErrorSet](const boost::shared_ptr<MarginalizationPriorErrorTerm>& et) { return marginalizedErrorSet.count(et.get()) > 0; }),
+                    _priors.end());
+
+      // The new prior goes after the remaining priors, in front of all other error terms
+      if (prior) {
+        _errorTerms.insert(_errorTerms.begin() + _priors.size(), prior);
+        _priors.push_back(prior);
+        _errorTermSet.insert(prior.get());
+        for (const DesignVariable* dv : prior->designVariables())
+          _errorTermMap[dv].insert(prior.get());
+        _statistics.priorDimension = prior->dimension();
+      }
+
+      _statistics.numMarginalizedDesignVariables = marginalizedDvs.size();
+      _statistics.numMarginalizedErrorTerms = marginalizedErrors.size();
+      _markedForRemoval.clear();
+      _windowChanged = true;
+      _statistics.marginalizationTime = secondsSince(start);
+      _options.verbose && std::cout << "SlidingWindowProblem: Marginalized " << _statistics.numMarginalizedDesignVariables << " design variables and "
+          << _statistics.numMarginalizedErrorTerms << " error terms into a prior of dimension " << _statistics.priorDimension
+          << " in " << _statistics.marginalizationTime << " s\n";
+    }
+
+    SolutionReturnValue SlidingWindowProblem::optimize()
+    {
+      if (_windowChanged) {
+        Timer timer("SlidingWindowProblem: Initialize");
+        const auto start = util::Deadline::Clock::now();
+        const SparseCholeskyLinearSystemSolver* solver = dynamic_cast<const SparseCholeskyLinearSystemSolver*>(_optimizer->getBaseSolver());
+        const size_t numStructureReuses = solver ? solver->numStructureReuses() : 0;
+        _optimizer->initialize();
+        // A LinearSystemSolverSelector may have chosen another solver
+        _statistics.structureReused = solver && solver == _optimizer->getBaseSolver() && solver->numStructureReuses() > numStructureReuses;
+        _statistics.initializationTime = secondsSince(start);
+        _windowChanged = false;
+      }
+      Timer timer("SlidingWindowProblem: Optimize");
+      const auto start = util::Deadline::Clock::now();
+      SolutionReturnValue srv = _optimizer->optimize();
+      _statistics.optimizationTime = secondsSince(start);
+      _options.verbose && std::cout << "SlidingWindowProblem: Initialized in " << _statistics.initializationTime << " s"
+          << (_statistics.structureReused ? " reusing the structure" : "") << ", optimized in " << _statistics.optimizationTime << " s\n";
+      return srv;
+    }
+
+    bool SlidingWindowProblem::isDesignVariableInProblem(const DesignVariable* dv) const
+    {
+      return _designVariableSet.find(dv) != _designVariableSet.end();
+    }
+
+    bool SlidingWindowProblem::isErrorTermInProblem(const ErrorTerm* et) const
+    {
+      return _errorTermSet.find(et) != _errorTermSet.end();
+    }
+
+    size_t SlidingWindowProblem::numDesignVariablesImplementation() const
+    {
+      return _designVariables.size();
+    }
+
+    DesignVariable* SlidingWindowProblem::designVariableImplementation(size_t i)
+    {
+      SM_ASSERT_LT_DBG(Exception, i, _designVariables.size(), "Index out of bounds");
+      return _designVariables[i].get();
+    }
+
+    const DesignVariable* SlidingWindowProblem::designVariableImplementation(size_t i) const
+    {
+      SM_ASSERT_LT_DBG(Exception, i, _designVariables.size(), "Index out of bounds");
+      return _designVariables[i].get();
+    }
+
+    size_t SlidingWindowProblem::numErrorTermsImplementation() const
+    {
+      return _errorTerms.size();
+    }
+
+    size_t SlidingWindowProblem::numNonSquaredErrorTermsImplementation() const
+    {
+      return 0;
+    }
+
+    ErrorTerm* SlidingWindowProblem::errorTermImplementation(size_t i)
+    {
+      SM_ASSERT_LT_DBG(Exception, i, _errorTerms.size(), "Index out of bounds");
+      return _errorTerms[i].get();
+    }
+
+    ScalarNonSquaredErrorTerm* SlidingWindowProblem::nonSquaredErrorTermImplementation(size_t /* i */)
+    {
+      SM_THROW(Exception, "A sliding window has no non-squared error terms");
+    }
+
+    const ErrorTerm* SlidingWindowProblem::errorTermImplementation(size_t i) const
+    {
+      SM_ASSERT_LT_DBG(Exception, i, _errorTerms.size(), "Index out of bounds");
+      return _errorTerms[i].get();
+    }
+
+    const ScalarNonSquaredErrorTerm* SlidingWindowProblem::nonSquaredErrorTermImplementation(size_t /* i */) const
+    {
+      SM_THROW(Exception, "A sliding window has no non-squared error terms");
+    }
+
+    void SlidingWindowProblem::getErrorsImplementation(const DesignVariable* dv, std::set<ErrorTerm*>& outErrorSet)
+    {
+      auto it = _errorTermMap.find(dv);
+      if (it != _errorTermMap.end())
+        outErrorSet.insert(it->second.begin(), it->second.end());
+    }
+
+    void SlidingWindowProblem::getNonSquaredErrorsImplementation(const DesignVariable* /* dv */, std::set<ScalarNonSquaredErrorTerm*>& /* outErrorSet */)
+    {
+    }
+
+  } // namespace backend
+} // namespace aslam
@@ -25,16 +25,26 @@ namespace aslam {
 /* Constructors and Destructor                                                */
 /******************************************************************************/
 
-      SparseCholeskyLinearSolverOptions::SparseCholeskyLinearSolverOptions() {}
+    SparseCholeskyLinearSolverOptions::SparseCholeskyLinearSolverOptions() :
+        covarianceMemoryBudget(0),
+        ordering(BlockAmd),
+        assembleNormalEquations(false) {
+    }
       
     SparseCholeskyLinearSolverOptions::SparseCholeskyLinearSolverOptions(
-        const SparseCholeskyLinearSolverOptions& /* other */) {
+        const SparseCholeskyLinearSolverOptions& other) :
+        covarianceMemoryBudget(other.covarianceMemoryBudget),
+        ordering(other.ordering),
+        assembleNormalEquations(other.assembleNormalEquations) {
     }
 
     SparseCholeskyLinearSolverOptions&
     SparseCholeskyLinearSolverOptions::operator =
         (const SparseCholeskyLinearSolverOptions& other) {
       if (this != &other) {
+        covarianceMemoryBudget = other.covarianceMemoryBudget;
+        ordering = other.ordering;
+        assembleNormalEquations = other.assembleNormalEquations;
       }
       return *this;
     }
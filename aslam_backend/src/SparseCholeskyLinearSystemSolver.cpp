@@ -1,20 +1,170 @@
+#include <algorithm>
+
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
+#include <sparse_block_matrix/marginal_covariance_cholesky.h>
 #include <sm/PropertyTree.hpp>
 
 namespace aslam {
   namespace backend {
-    SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const SparseCholeskyLinearSolverOptions& options) : _factor(NULL), _options(options) {}
-  SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const sm::PropertyTree& /* config */) :
-        _factor(NULL) {
-      // NO OPTIONS CURRENTLY IMPLEMENTED
+    SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const SparseCholeskyLinearSolverOptions& options) : _factor(NULL), _isFactorized(false), _useNormalEquations(false), _structureUnchanged(false), _numStructureReuses(0), _options(options) {}
+  SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const sm::PropertyTree& config) :
+        _factor(NULL), _isFactorized(false), _useNormalEquations(false), _structureUnchanged(false), _numStructureReuses(0) {
       // USING C++11 would allow to do constructor delegation and more elegant code
+      _options.covarianceMemoryBudget = config.getInt("covarianceMemoryBudget", _options.covarianceMemoryBudget);
+      _options.assembleNormalEquations = config.getBool("assembleNormalEquations", _options.assembleNormalEquations);
+      const std::string ordering = config.getString("ordering", "amd");
+      if (ordering == "scalar_amd")
+        _options.ordering = SparseCholeskyLinearSolverOptions::ScalarAmd;
+      else if (ordering == "amd")
+        _options.ordering = SparseCholeskyLinearSolverOptions::BlockAmd;
+      else if (ordering == "colamd")
+        _options.ordering = SparseCholeskyLinearSolverOptions::BlockColamd;
+      else if (ordering == "nested_dissection")
+        _options.ordering = SparseCholeskyLinearSolverOptions::BlockNestedDissection;
+      else
+        SM_THROW(Exception, "Unknown ordering " << ordering << ". Valid orderings are scalar_amd, amd, colamd and nested_dissection.");
     }
     SparseCholeskyLinearSystemSolver::~SparseCholeskyLinearSystemSolver() {}
 
+    void SparseCholeskyLinearSystemSolver::setOrdering(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors)
+    {
+      _structureUnchanged = false;
+      if (dvs.empty() || errors.empty()) {
+        _ordering.clear();
+        _structure.clear();
+        return;
+      }
+
+      // The block pattern of J^T with one row per design variable and one column per error term.
+      // CHOLMOD orders the rows of this matrix for the factorization of J^T J.
+      const int numBlocks = dvs.size();
+      std::vector<const DesignVariable*> blockDvs(numBlocks, NULL);
+      for (const DesignVariable* dv : dvs) {
+        SM_ASSERT_GE_LT(Exception, dv->blockIndex(), 0, numBlocks, "The design variables must have consecutive block indices");
+        blockDvs[dv->blockIndex()] = dv;
+      }
+      std::vector<int> colPtr(errors.size() + 1, 0);
+      std::vector<int> rowInd;
+      rowInd.reserve(2 * errors.size());
+      for (size_t c = 0; c < errors.size(); ++c) {
+        const size_t begin = rowInd.size();
+        for (const DesignVariable* dv : errors[c]->designVariables()) {
+          if (dv->isActive()) {
+            SM_ASSERT_GE_LT(Exception, dv->blockIndex(), 0, numBlocks, "An error term depends on an unknown design variable");
+            rowInd.push_back(dv->blockIndex());
+          }
+        }
+        std::sort(rowInd.begin() + begin, rowInd.end());
+        rowInd.erase(std::unique(rowInd.begin() + begin, rowInd.end()), rowInd.end());
+        colPtr[c + 1] = rowInd.size();
+      }
+
+      // Compact the constraint groups to 0..k-1
+      std::vector<int> cmember;
+      if (!_orderingGroups.empty()) {
+        cmember.resize(numBlocks);
+        for (int b = 0; b < numBlocks; ++b) {
+          auto it = _orderingGroups.find(blockDvs[b]);
+          cmember[b] = it == _orderingGroups.end() ? 0 : it->second;
+        }
+        std::vector<int> groups(cmember);
+        std::sort(groups.begin(), groups.end());
+        groups.erase(std::unique(groups.begin(), groups.end()), groups.end());
+        if (groups.size() == 1)
+          cmember.clear();
+        for (int& g : cmember)
+          g = std::lower_bound(groups.begin(), groups.end(), g) - groups.begin();
+      }
+
+      // The ordering and the pattern of the factor only depend on the block pattern, the columns and dimensions
+      // of the blocks and the ordering constraints. If they are the same as for the current ordering, e.g. after
+      // a sliding window moved by a state, the ordering and the symbolic factorization are kept.
+      std::vector<int> structure;
+      structure.reserve(3 + 2 * numBlocks + 2 * errors.size() + rowInd.size() + cmember.size());
+      structure.push_back(_options.ordering);
+      structure.push_back(numBlocks);
+      for (const DesignVariable* dv : blockDvs) {
+        SM_ASSERT_TRUE(Exception, dv != NULL, "The design variables must have consecutive block indices");
+        structure.push_back(dv->columnBase());
+        structure.push_back(dv->minimalDimensions());
+      }
+      for (size_t c = 0; c < errors.size(); ++c) {
+        structure.push_back(errors[c]->dimension());
+        structure.push_back(colPtr[c + 1] - colPtr[c]);
+      }
+      structure.insert(structure.end(), rowInd.begin(), rowInd.end());
+      structure.push_back(cmember.size());
+      structure.insert(structure.end(), cmember.begin(), cmember.end());
+      _structureUnchanged = structure == _structure;
+      _structure.swap(structure);
+      if (_structureUnchanged)
+        return;
+
+      _ordering.clear();
+      if (_options.ordering == SparseCholeskyLinearSolverOptions::ScalarAmd || rowInd.empty())
+        return;
+      cholmod_sparse A;
+      A.nrow = numBlocks;
+      A.ncol = errors.size();
+      A.nzmax = rowInd.size();
+      A.p = colPtr.data();
+      A.i = rowInd.data();
+      A.nz = NULL;
+      A.x = NULL;
+      A.z = NULL;
+      A.stype = 0;
+      A.itype = CholmodIndexTraits<int>::IType;
+      A.xtype = CHOLMOD_PATTERN;
+      A.dtype = CholmodValueTraits<double>::DType;
+      A.sorted = 1;
+      A.packed = 1;
+
+      std::vector<int> blockOrdering(numBlocks);
+      bool success = false;
+      switch (_options.ordering) {
+        case SparseCholeskyLinearSolverOptions::BlockColamd:
+          success = cmember.empty() ? _cholmod.colamd(&A, blockOrdering.data()) : _cholmod.ccolamd(&A, cmember.data(), blockOrdering.data());
+          break;
+        case SparseCholeskyLinearSolverOptions::BlockNestedDissection:
+          if (cmember.empty()) {
+            success = _cholmod.nestedDissection(&A, blockOrdering.data());
+            break;
+          }
+          // Nested dissection does not support constraints
+        default:
+          success = cmember.empty() ? _cholmod.amd(&A, blockOrdering.data()) : _cholmod.camd(&A, cmember.data(), blockOrdering.data());
+          break;
+      }
+      // E.g. CHOLMOD was built without METIS or the partition module
+      if (!success)
+        success = _cholmod.amd(&A, blockOrdering.data());
+      SM_ASSERT_TRUE(Exception, success, "The fill-reducing ordering of the design variable graph failed");
+      // Enforce the constraints if the ordering ignored them. This keeps a valid constrained ordering as it is.
+      if (!cmember.empty()) {
+        std::stable_sort(blockOrdering.begin(), blockOrdering.end(), [&cmember](int a, int b) { return cmember[a] < cmember[b]; });
+      }
+
+      // Expand the block ordering to the scalar columns
+      _ordering.reserve(dvs.back()->columnBase() + dvs.back()->minimalDimensions());
+      for (int b : blockOrdering) {
+        const DesignVariable* dv = blockDvs[b];
+        for (int k = 0; k < dv->minimalDimensions(); ++k)
+          _ordering.push_back(dv->columnBase() + k);
+      }
+    }
+
     void SparseCholeskyLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner)
     {
       _errorTerms = errors;
-      if (_factor) {
+      _isFactorized = false;
+      // The symbolic factorization stays valid if the pattern of the matrix to factorize is the same
+      const bool keepFactor = _structureUnchanged && useDiagonalConditioner == _useDiagonalConditioner &&
+          _options.assembleNormalEquations == _useNormalEquations;
+      if (_factor && keepFactor) {
+        ++_numStructureReuses;
+      } else if (_factor) {
         _cholmod.free(_factor);
         _factor = NULL;
       }
@@ -22,6 +172,16 @@ namespace aslam {
       _useDiagonalConditioner = useDiagonalConditioner;
       _jacobianBuilder.initMatrixStructure(dvs, errors);
       CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      _useNormalEquations = _options.assembleNormalEquations;
+      if (_useNormalEquations) {
+        initNormalEquationsStructure(dvs, errors);
+        _cholmod.view(_rhs, &_cholmodRhs);
+        return;
+      }
+      _hessianColPtr.clear();
+      _hessianRowInd.clear();
+      _hessianValues.clear();
+      _normalEquationsTerms.clear();
       if (_useDiagonalConditioner) {
         J_transpose.pushConstantDiagonalBlock(1.0);
       }
@@ -39,37 +199,192 @@ namespace aslam {
     void SparseCholeskyLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
     {
       //std::cout << "build system\n";
-      _jacobianBuilder.buildSystem(nThreads, useMEstimator);
+      if (!takeEvaluatedJacobians(useMEstimator)) {
+        _jacobianBuilder.setDeadline(_deadline);
+        _jacobianBuilder.buildSystem(nThreads, useMEstimator);
+      }
       CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly);
       J_transpose.rightMultiply(_e, _rhs);
+      if (_useNormalEquations)
+        buildNormalEquations(nThreads);
       // std::cout << "build system complete\n";
     }
 
+    void SparseCholeskyLinearSystemSolver::initNormalEquationsStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors)
+    {
+      const CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      const std::vector<int>& colPtr = J_transpose.col_ptr();
+      const std::vector<int>& rowInd = J_transpose.row_ind();
+
+      // The design variable blocks in the order of their columns
+      std::vector<const DesignVariable*> blocks(dvs.begin(), dvs.end());
+      std::sort(blocks.begin(), blocks.end(), [](const DesignVariable* a, const DesignVariable* b) { return a->columnBase() < b->columnBase(); });
+      const int numBlocks = blocks.size();
+      _blockColumnBase.resize(numBlocks);
+      _blockColumnDim.resize(numBlocks);
+      std::vector<int> columnToBlock(_JCols, -1);
+      for (int b = 0; b < numBlocks; ++b) {
+        _blockColumnBase[b] = blocks[b]->columnBase();
+        _blockColumnDim[b] = blocks[b]->minimalDimensions();
+        for (int k = 0; k < _blockColumnDim[b]; ++k)
+          columnToBlock[_blockColumnBase[b] + k] = b;
+      }
+
+      // Every pair of design variables of an error term contributes to one block in the upper triangle.
+      // The rows of J^T are sorted, so are the design variable segments of an error term.
+      std::vector<std::vector<std::pair<int, NormalEquationsTerm> > > contributions(numBlocks);
+      std::vector<std::pair<int, int> > segments;
+      int eRow = 0;
+      for (const ErrorTerm* error : errors) {
+        const int dim = error->dimension();
+        const int valueStart = colPtr[eRow];
+        const int rows = colPtr[eRow + 1] - valueStart;
+        segments.clear();
+        for (int r = 0; r < rows; r += _blockColumnDim[segments.back().first]) {
+          const int b = columnToBlock[rowInd[valueStart + r]];
+          SM_ASSERT_GE(Exception, b, 0, "The Jacobian refers to an unknown design variable");
+          segments.push_back(std::make_pair(b, r));
+        }
+        for (size_t j = 0; j < segments.size(); ++j) {
+          for (size_t i = 0; i <= j; ++i) {
+            NormalEquationsTerm term = { valueStart, rows, dim, segments[i].second, _blockColumnDim[segments[i].first], segments[j].second, 0 };
+            contributions[segments[j].first].push_back(std::make_pair(segments[i].first, term));
+          }
+        }
+        eRow += dim;
+      }
+
+      // The scalar pattern. The diagonal block is always present and is the last block of its block column,
+      // so the last entry of each column is on the diagonal.
+      _hessianColPtr.assign(1, 0);
+      _hessianRowInd.clear();
+      _normalEquationsTerms.assign(numBlocks, std::vector<NormalEquationsTerm>());
+      std::vector<int> blockRows, blockRowOffsets;
+      for (int B = 0; B < numBlocks; ++B) {
+        blockRows.assign(1, B);
+        for (const auto& c : contributions[B])
+          blockRows.push_back(c.first);
+        std::sort(blockRows.begin(), blockRows.end());
+        blockRows.erase(std::unique(blockRows.begin(), blockRows.end()), blockRows.end());
+        blockRowOffsets.resize(blockRows.size());
+        int offset = 0;
+        for (size_t i = 0; i < blockRows.size(); ++i) {
+          blockRowOffsets[i] = offset;
+          offset += _blockColumnDim[blockRows[i]];
+        }
+        for (int k = 0; k < _blockColumnDim[B]; ++k) {
+          for (int A : blockRows) {
+            const int n = A == B ? k + 1 : _blockColumnDim[A];
+            for (int r = 0; r < n; ++r)
+              _hessianRowInd.push_back(_blockColumnBase[A] + r);
+          }
+          _hessianColPtr.push_back(_hessianRowInd.size());
+        }
+        _normalEquationsTerms[B].reserve(contributions[B].size());
+        for (const auto& c : contributions[B]) {
+          NormalEquationsTerm term = c.second;
+          term.hessianRowOffset = blockRowOffsets[std::lower_bound(blockRows.begin(), blockRows.end(), c.first) - blockRows.begin()];
+          _normalEquationsTerms[B].push_back(term);
+        }
+      }
+      SM_ASSERT_EQ(Exception, _hessianColPtr.size(), _JCols + 1, "The design variable blocks do not cover all columns");
+      _hessianValues.assign(_hessianRowInd.size(), 0.0);
+
+      // View the upper triangle as a symmetric cholmod matrix
+      _cholmodLhs.nrow = _JCols;
+      _cholmodLhs.ncol = _JCols;
+      _cholmodLhs.nzmax = _hessianValues.size();
+      _cholmodLhs.p = _hessianColPtr.data();
+      _cholmodLhs.i = _hessianRowInd.data();
+      _cholmodLhs.nz = NULL;
+      _cholmodLhs.x = _hessianValues.data();
+      _cholmodLhs.z = NULL;
+      _cholmodLhs.stype = 1;
+      _cholmodLhs.itype = CholmodIndexTraits<int>::IType;
+      _cholmodLhs.xtype = CholmodValueTraits<double>::XType;
+      _cholmodLhs.dtype = CholmodValueTraits<double>::DType;
+      _cholmodLhs.sorted = 1;
+      _cholmodLhs.packed = 1;
+    }
+
+    void SparseCholeskyLinearSystemSolver::buildNormalEquations(size_t nThreads)
+    {
+      instrumentation::ScopedPhase phase(instrumentation::Phase::Assembly);
+      util::runThreadedJob(boost::bind(&SparseCholeskyLinearSystemSolver::buildNormalEquationsBlockColumns, this, _1, _2, _3), _normalEquationsTerms.size(), std::max<size_t>(nThreads, 1));
+    }
+
+    void SparseCholeskyLinearSystemSolver::buildNormalEquationsBlockColumns(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      instrumentation::ScopedTrace trace("Build normal equations (thread)");
+      const double* jtValues = _jacobianBuilder.J_transpose().values().data();
+      Eigen::MatrixXd block;
+      for (size_t B = startIdx; B < endIdx; ++B) {
+        const int columnBase = _blockColumnBase[B];
+        const int dim = _blockColumnDim[B];
+        std::fill(_hessianValues.begin() + _hessianColPtr[columnBase], _hessianValues.begin() + _hessianColPtr[columnBase + dim], 0.0);
+        for (const NormalEquationsTerm& term : _normalEquationsTerms[B]) {
+          Eigen::Map<const Eigen::MatrixXd> Jt(jtValues + term.valueStart, term.rows, term.cols);
+          block.noalias() = Jt.middleRows(term.rowOffsetA, term.dimA) * Jt.middleRows(term.rowOffsetB, dim).transpose();
+          // Only the upper triangle of diagonal blocks is stored
+          const bool isDiagonal = term.rowOffsetA == term.rowOffsetB;
+          for (int k = 0; k < dim; ++k) {
+            double* column = &_hessianValues[_hessianColPtr[columnBase + k] + term.hessianRowOffset];
+            const int n = isDiagonal ? k + 1 : term.dimA;
+            for (int r = 0; r < n; ++r)
+              column[r] += block(r, k);
+          }
+        }
+      }
+    }
+
     bool SparseCholeskyLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
     {
       CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
-      if (_useDiagonalConditioner) {
-        J_transpose.pushDiagonalBlock(_diagonalConditioner);
+      if (_useNormalEquations) {
+        if (_useDiagonalConditioner) {
+          // Keep the diagonal to remove the conditioner exactly after the factorization
+          _hessianDiagonal.resize(_JCols);
+          for (size_t j = 0; j < _JCols; ++j) {
+            double& d = _hessianValues[_hessianColPtr[j + 1] - 1];
+            _hessianDiagonal[j] = d;
+            d += _diagonalConditioner[j] * _diagonalConditioner[j];
+          }
+        }
+      } else {
+        if (_useDiagonalConditioner) {
+          J_transpose.pushDiagonalBlock(_diagonalConditioner);
+        }
+        J_transpose.getView(&_cholmodLhs);
       }
-      J_transpose.getView(&_cholmodLhs);
       _cholmod.view(_rhs, &_cholmodRhs);
       // std::cout << "solve system\n";
       if (!_factor) {
         // std::cout << "\tAnalyze system\n";
         // Now do the symbolic analysis with cholmod.
-        _factor = _cholmod.analyze(&_cholmodLhs);
+        _factor = _ordering.empty() ? _cholmod.analyze(&_cholmodLhs) : _cholmod.analyze(&_cholmodLhs, _ordering.data());
         //  std::cout << "\tanalyze system complete\n";
       }
       // Now we can solve the system.
       outDx.resize(J_transpose.rows());
       cholmod_dense* sol = _cholmod.solve(&_cholmodLhs, _factor, &_cholmodRhs);
       if (_useDiagonalConditioner) {
-        J_transpose.popDiagonalBlock();
+        if (_useNormalEquations) {
+          for (size_t j = 0; j < _JCols; ++j)
+            _hessianValues[_hessianColPtr[j + 1] - 1] = _hessianDiagonal[j];
+        } else {
+          J_transpose.popDiagonalBlock();
+        }
       }
+      _isFactorized = (sol != NULL);
       if (!sol) {
         std::cout << "Solution failed\n";
         return false;
       }
+      if (_useDiagonalConditioner)
+        _factorConditioner = _diagonalConditioner;
+      else
+        _factorConditioner.resize(0);
       try {
         SM_ASSERT_EQ_DBG(Exception, (int)sol->nrow, (int)outDx.size(), "Unexpected solution size");
         SM_ASSERT_EQ_DBG(Exception, sol->ncol, 1, "Unexpected solution size");
@@ -110,9 +425,69 @@ namespace aslam {
         return Jrhs.squaredNorm();
     }
       
+    bool SparseCholeskyLinearSystemSolver::isFactorizedWithConstantConditioner(double lambda) const {
+      if (!_isFactorized)
+        return false;
+      if (_factorConditioner.size() == 0)
+        return lambda == 0.0;
+      return (_factorConditioner.array() == lambda).all();
+    }
+
+    bool SparseCholeskyLinearSystemSolver::computeCovarianceBlocks(const std::vector<int>& rowBlockIndices, const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP, size_t nThreads)
+    {
+      if (!_isFactorized)
+        return false;
+      SM_ASSERT_EQ(Exception, (size_t)_factor->n, _JCols, "The factor does not match the system size");
+      SM_ASSERT_FALSE(Exception, rowBlockIndices.empty(), "No blocks given");
+      SM_ASSERT_EQ(Exception, (size_t)rowBlockIndices.back(), _JCols, "The block structure does not match the system size");
+      for (size_t i = 0; i < blockIndices.size(); ++i) {
+        SM_ASSERT_GE_LT(Exception, blockIndices[i].first, 0, (int)rowBlockIndices.size(), "Block row out of range");
+        SM_ASSERT_GE_LT(Exception, blockIndices[i].second, 0, (int)rowBlockIndices.size(), "Block column out of range");
+      }
+
+      // The sparse inverse needs a simplicial LL' factor. Convert a copy to keep the
+      // (possibly supernodal) factor used by solveSystem() intact.
+      cholmod_factor* L = _cholmod.copy(_factor);
+      if (!_cholmod.toSimplicialLL(L)) {
+        _cholmod.free(L);
+        return false;
+      }
+      const int n = L->n;
+      const int* perm = static_cast<const int*>(L->Perm);
+      std::vector<int> permInv(n);
+      for (int i = 0; i < n; ++i)
+        permInv[perm[i]] = i;
+
+      sparse_block_matrix::MarginalCovarianceCholesky mcc;
+      mcc.setNumThreads(nThreads);
+      mcc.setMemoryBudget(_options.covarianceMemoryBudget);
+      mcc.setCholeskyFactor(n, static_cast<int*>(L->p), static_cast<int*>(L->i), static_cast<double*>(L->x), permInv.data());
+      try {
+        mcc.computeCovariance(outP, rowBlockIndices, blockIndices);
+      } catch (...) {
+        _cholmod.free(L);
+        throw;
+      }
+      _cholmod.free(L);
+      return true;
+    }
+
+    void SparseCholeskyLinearSystemSolver::setOrderingGroup(const DesignVariable* dv, int group) {
+      SM_ASSERT_TRUE(Exception, dv != NULL, "Null design variable");
+      _orderingGroups[dv] = group;
+    }
+
+    void SparseCholeskyLinearSystemSolver::clearOrderingGroups() {
+      _orderingGroups.clear();
+    }
+
     void SparseCholeskyLinearSystemSolver::handleNewAcceptConstantErrorTerms() {
       _jacobianBuilder.J_transpose().setAcceptConstantErrorTerms(isAcceptConstantErrorTerms());
     }
+
+    void SparseCholeskyLinearSystemSolver::linearizeErrorTerm(size_t i, bool useMEstimator) {
+      _jacobianBuilder.linearizeErrorTerm(i, useMEstimator);
+    }
   } // namespace backend
 }  // namespace aslam
 
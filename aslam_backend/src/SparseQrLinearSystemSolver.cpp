@@ -54,7 +54,10 @@ namespace aslam {
     void SparseQrLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
     {
       //std::cout << "build system\n";
-      _jacobianBuilder.buildSystem(nThreads, useMEstimator);
+      if (!takeEvaluatedJacobians(useMEstimator)) {
+        _jacobianBuilder.setDeadline(_deadline);
+        _jacobianBuilder.buildSystem(nThreads, useMEstimator);
+      }
       CompressedColumnMatrix<SuiteSparse_long>& J_transpose = _jacobianBuilder.J_transpose();
       J_transpose.rightMultiply(_e, _rhs);
       //std::cout << "build system complete\n";
@@ -193,5 +196,9 @@ namespace aslam {
     void SparseQrLinearSystemSolver::handleNewAcceptConstantErrorTerms() {
       _jacobianBuilder.J_transpose().setAcceptConstantErrorTerms(isAcceptConstantErrorTerms());
     }
+
+    void SparseQrLinearSystemSolver::linearizeErrorTerm(size_t i, bool useMEstimator) {
+      _jacobianBuilder.linearizeErrorTerm(i, useMEstimator);
+    }
   } // namespace backend
 } // namespace aslam
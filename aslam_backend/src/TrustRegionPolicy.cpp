@@ -3,7 +3,7 @@
 namespace aslam {
     namespace backend {
         
-        TrustRegionPolicy::TrustRegionPolicy(){}
+        TrustRegionPolicy::TrustRegionPolicy() : _evaluatedStepError(0.0), _hasEvaluatedStepError(false) {}
         TrustRegionPolicy::~TrustRegionPolicy(){}
             
 
@@ -24,6 +24,11 @@ namespace aslam {
             return true;
         }
 
+        bool TrustRegionPolicy::linearizesEveryStep() const
+        {
+            return false;
+        }
+
             
         /// \brief called by the optimizer when an optimization is starting
         void TrustRegionPolicy::optimizationStarting(double J)
@@ -43,11 +48,21 @@ namespace aslam {
             }
             _J = J;
 
+            _hasEvaluatedStepError = false;
             const bool success = solveSystemImplementation(J, previousIterationFailed, nThreads, outDx);
             _isFirstIteration = false;
             return success;
         }
 
+        bool TrustRegionPolicy::takeEvaluatedStepError(double& outJ)
+        {
+            if (!_hasEvaluatedStepError)
+                return false;
+            _hasEvaluatedStepError = false;
+            outJ = _evaluatedStepError;
+            return true;
+        }
+
         double TrustRegionPolicy::get_dJ()
         {
             return _p_J - _J;
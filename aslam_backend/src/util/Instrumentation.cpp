@@ -0,0 +1,444 @@
+#include <aslam/backend/util/Instrumentation.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/core/demangle.hpp>
+
+#include <aslam/Exceptions.hpp>
+
+namespace aslam {
+namespace backend {
+namespace instrumentation {
+
+namespace detail {
+  std::atomic<unsigned> flags(0);
+}
+
+namespace {
+
+  int bucket(std::uint64_t ns) {
+    int b = 0;
+    while (ns > 1 && b < NumHistogramBuckets - 1) {
+      ns >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+  /// \brief Counters written by one thread only, so plain loads and stores suffice
+  struct AtomicCounters {
+    AtomicCounters() { clear(); }
+    std::atomic<std::uint64_t> count, totalNs, maxNs;
+
+    void record(std::uint64_t ns) {
+      count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      totalNs.store(totalNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+      if (ns > maxNs.load(std::memory_order_relaxed))
+        maxNs.store(ns, std::memory_order_relaxed);
+    }
+    void load(Counters & out) const {
+      out.count = count.load(std::memory_order_relaxed);
+      out.totalNs = totalNs.load(std::memory_order_relaxed);
+      out.maxNs = maxNs.load(std::memory_order_relaxed);
+    }
+    void clear() {
+      count.store(0, std::memory_order_relaxed);
+      totalNs.store(0, std::memory_order_relaxed);
+      maxNs.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  typedef std::array<Counters, NumPhases> type_counters_t;
+
+  /// \brief Aggregated counters with the error term types still identified by their id
+  struct Totals {
+    std::array<Statistics, NumPhases> phases;
+    std::vector<type_counters_t> types;
+  };
+
+  struct ThreadBuffer;
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBuffer *> threads;
+    Totals retired; /// \brief Counters of the threads which finished
+    std::unordered_map<std::type_index, int> typeIds;
+    std::vector<std::string> typeNames;
+  };
+
+  Registry & registry() {
+    // Never destroyed, threads may still retire during static destruction
+    static Registry * r = new Registry;
+    return *r;
+  }
+
+  struct ThreadBuffer {
+    ThreadBuffer() {
+      for (auto & h : histograms)
+        for (auto & c : h)
+          c.store(0, std::memory_order_relaxed);
+      Registry & r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.threads.push_back(this);
+    }
+
+    ~ThreadBuffer() {
+      Registry & r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      addTo(r.retired);
+      r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+    }
+
+    void record(Phase phase, std::uint64_t ns, const std::type_info * errorTermType) {
+      const int p = static_cast<int>(phase);
+      phases[p].record(ns);
+      std::atomic<std::uint64_t> & h = histograms[p][bucket(ns)];
+      h.store(h.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      if (errorTermType != nullptr) {
+        const int id = typeId(*errorTermType);
+        types[id][p].record(ns);
+        numTypes.store(std::max(numTypes.load(std::memory_order_relaxed), id + 1), std::memory_order_release);
+      }
+    }
+
+    int typeId(const std::type_info & type) {
+      auto it = typeIds.find(type);
+      if (it != typeIds.end())
+        return it->second;
+      Registry & r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      auto inserted = r.typeIds.emplace(type, int(r.typeNames.size()));
+      if (inserted.second) {
+        if (r.typeNames.size() + 1 < size_t(MaxErrorTermTypes)) {
+          r.typeNames.push_back(boost::core::demangle(type.name()));
+        } else {
+          inserted.first->second = MaxErrorTermTypes - 1;
+          if (r.typeNames.size() < size_t(MaxErrorTermTypes))
+            r.typeNames.push_back("<other error term types>");
+        }
+      }
+      return typeIds[type] = inserted.first->second;
+    }
+
+    void addTo(Totals & totals) const {
+      for (int p = 0; p < NumPhases; ++p) {
+        Statistics s;
+        phases[p].load(s);
+        for (int b = 0; b < NumHistogramBuckets; ++b)
+          s.histogram[b] = histograms[p][b].load(std::memory_order_relaxed);
+        totals.phases[p].add(s);
+      }
+      const int n = numTypes.load(std::memory_order_acquire);
+      if (int(totals.types.size()) < n)
+        totals.types.resize(n);
+      for (int t = 0; t < n; ++t) {
+        for (int p = 0; p < NumPhases; ++p) {
+          Counters c;
+          types[t][p].load(c);
+          totals.types[t][p].add(c);
+        }
+      }
+    }
+
+    void clear() {
+      for (int p = 0; p < NumPhases; ++p) {
+        phases[p].clear();
+        for (auto & c : histograms[p])
+          c.store(0, std::memory_order_relaxed);
+      }
+      for (auto & t : types)
+        for (auto & c : t)
+          c.clear();
+    }
+
+    std::array<AtomicCounters, NumPhases> phases;
+    std::array<std::array<std::atomic<std::uint64_t>, NumHistogramBuckets>, NumPhases> histograms;
+    std::array<std::array<AtomicCounters, NumPhases>, MaxErrorTermTypes> types;
+    std::atomic<int> numTypes{0};
+    /// \brief Thread private cache of the global type ids
+    std::unordered_map<std::type_index, int> typeIds;
+  };
+
+  ThreadBuffer & threadBuffer() {
+    // Constructed on first use, i.e. only in threads recording anything
+    static thread_local ThreadBuffer buffer;
+    return buffer;
+  }
+
+  struct TraceEvent {
+    const char * name;
+    std::uint64_t start;
+    std::uint64_t end;
+    int iteration;
+  };
+
+  /// \brief Ring buffer of trace events, written by one thread at a time
+  struct TraceBuffer {
+    TraceBuffer(std::size_t size, int tid) : events(size), tid(tid), written(0) { }
+
+    void push(const TraceEvent & event) {
+      const std::uint64_t w = written.load(std::memory_order_relaxed);
+      events[w % events.size()] = event;
+      written.store(w + 1, std::memory_order_release);
+    }
+
+    std::vector<TraceEvent> events;
+    const int tid;
+    std::atomic<std::uint64_t> written;
+  };
+
+  struct Tracer {
+    std::mutex mutex;
+    /// \brief All buffers of the current trace, one per concurrently traced thread
+    std::vector<std::shared_ptr<TraceBuffer> > buffers;
+    /// \brief Buffers released by finished threads, reused by new threads
+    std::vector<std::shared_ptr<TraceBuffer> > released;
+    std::size_t eventsPerBuffer = 0;
+    std::uint64_t start = 0;
+    std::atomic<unsigned> generation{0};
+    std::atomic<int> iteration{-1};
+  };
+
+  Tracer & tracer() {
+    // Never destroyed, see registry()
+    static Tracer * t = new Tracer;
+    return *t;
+  }
+
+  /// \brief The trace buffer of a thread. The lock is only taken when a thread traces
+  ///        the first time in a trace, e.g. the short lived worker threads of the solvers.
+  struct ThreadTraceHandle {
+    ~ThreadTraceHandle() {
+      if (!buffer)
+        return;
+      Tracer & t = tracer();
+      std::lock_guard<std::mutex> lock(t.mutex);
+      if (generation == t.generation.load(std::memory_order_relaxed))
+        t.released.push_back(buffer);
+    }
+
+    TraceBuffer & get() {
+      Tracer & t = tracer();
+      const unsigned current = t.generation.load(std::memory_order_acquire);
+      if (UNLIKELY(!buffer || generation != current)) {
+        std::lock_guard<std::mutex> lock(t.mutex);
+        generation = t.generation.load(std::memory_order_relaxed);
+        if (!t.released.empty()) {
+          buffer = t.released.back();
+          t.released.pop_back();
+        } else {
+          buffer = std::make_shared<TraceBuffer>(t.eventsPerBuffer, int(t.buffers.size()));
+          t.buffers.push_back(buffer);
+        }
+      }
+      return *buffer;
+    }
+
+    std::shared_ptr<TraceBuffer> buffer;
+    unsigned generation = 0;
+  };
+
+  ThreadTraceHandle & threadTraceHandle() {
+    static thread_local ThreadTraceHandle handle;
+    return handle;
+  }
+
+  void traceEvent(const char * name, std::uint64_t start, std::uint64_t end) {
+    threadTraceHandle().get().push(TraceEvent{name, start, end, tracer().iteration.load(std::memory_order_relaxed)});
+  }
+
+  void writeJsonString(std::ostream & out, const char * s) {
+    out << '"';
+    for (; *s != '\0'; ++s) {
+      if (*s == '"' || *s == '\\')
+        out << '\\';
+      out << *s;
+    }
+    out << '"';
+  }
+
+} // namespace
+
+const char * name(Phase phase) {
+  switch (phase) {
+    case Phase::ErrorEvaluation: return "Error evaluation";
+    case Phase::JacobianEvaluation: return "Jacobian evaluation";
+    case Phase::Assembly: return "Assembly";
+    case Phase::Factorization: return "Factorization";
+    case Phase::Solve: return "Solve";
+    case Phase::StateUpdate: return "State update";
+  }
+  return "Unknown";
+}
+
+void Counters::add(const Counters & other) {
+  count += other.count;
+  totalNs += other.totalNs;
+  maxNs = std::max(maxNs, other.maxNs);
+}
+
+void Statistics::add(const Statistics & other) {
+  Counters::add(other);
+  for (int b = 0; b < NumHistogramBuckets; ++b)
+    histogram[b] += other.histogram[b];
+}
+
+double Statistics::quantileNs(double q) const {
+  std::uint64_t n = 0;
+  for (int b = 0; b < NumHistogramBuckets; ++b) {
+    n += histogram[b];
+    if (n > 0 && double(n) >= q * double(count))
+      return std::min(double(maxNs), std::ldexp(1.0, b + 1));
+  }
+  return double(maxNs);
+}
+
+void Report::print(std::ostream & out) const {
+  out << std::left << std::setw(22) << "Phase" << std::right << std::setw(12) << "Count" << std::setw(14) << "Total [ms]"
+      << std::setw(12) << "Mean [us]" << std::setw(12) << "p90 [us]" << std::setw(12) << "Max [us]" << std::endl;
+  for (int p = 0; p < NumPhases; ++p) {
+    const Statistics & s = phases[p];
+    out << std::left << std::setw(22) << name(static_cast<Phase>(p)) << std::right << std::setw(12) << s.count
+        << std::setw(14) << s.totalNs * 1e-6 << std::setw(12) << s.meanNs() * 1e-3
+        << std::setw(12) << s.quantileNs(0.9) * 1e-3 << std::setw(12) << s.maxNs * 1e-3 << std::endl;
+  }
+  for (const auto & type : errorTermTypes) {
+    out << type.first << std::endl;
+    for (int p = 0; p < NumPhases; ++p) {
+      const Counters & c = type.second[p];
+      if (c.count == 0)
+        continue;
+      out << "  " << std::left << std::setw(20) << name(static_cast<Phase>(p)) << std::right << std::setw(12) << c.count
+          << std::setw(14) << c.totalNs * 1e-6 << std::setw(12) << c.meanNs() * 1e-3
+          << std::setw(12) << "" << std::setw(12) << c.maxNs * 1e-3 << std::endl;
+    }
+  }
+}
+
+namespace detail {
+  void finish(Phase phase, std::uint64_t start, const std::type_info * errorTermType, unsigned flags) {
+    const std::uint64_t end = now();
+    if (flags & Recording)
+      threadBuffer().record(phase, end - start, errorTermType);
+    if (flags & Tracing)
+      traceEvent(name(phase), start, end);
+  }
+
+  void trace(const char * name, std::uint64_t start) {
+    traceEvent(name, start, now());
+  }
+}
+
+void setEnabled(bool enabled) {
+  if (enabled)
+    detail::flags.fetch_or(detail::Recording, std::memory_order_relaxed);
+  else
+    detail::flags.fetch_and(~unsigned(detail::Recording), std::memory_order_relaxed);
+}
+
+Report collect() {
+  Registry & r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  Totals totals = r.retired;
+  for (const ThreadBuffer * thread : r.threads)
+    thread->addTo(totals);
+
+  Report report;
+  report.phases = totals.phases;
+  for (size_t t = 0; t < totals.types.size(); ++t) {
+    const type_counters_t & c = totals.types[t];
+    if (std::any_of(c.begin(), c.end(), [](const Counters & p) { return p.count > 0; }))
+      report.errorTermTypes[r.typeNames[t]] = c;
+  }
+  return report;
+}
+
+void reset() {
+  Registry & r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.retired = Totals();
+  for (ThreadBuffer * thread : r.threads)
+    thread->clear();
+}
+
+void startTracing(std::size_t eventsPerBuffer) {
+  SM_ASSERT_GT(aslam::InvalidArgumentException, eventsPerBuffer, 0u, "The trace buffers need room for at least one event");
+  Tracer & t = tracer();
+  {
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.buffers.clear();
+    t.released.clear();
+    t.eventsPerBuffer = eventsPerBuffer;
+    t.start = detail::now();
+    t.iteration.store(-1, std::memory_order_relaxed);
+    // Threads still holding a buffer of the previous trace switch over on their next event
+    t.generation.fetch_add(1, std::memory_order_release);
+  }
+  // The calling thread gets the first lane
+  threadTraceHandle().get();
+  detail::flags.fetch_or(detail::Tracing, std::memory_order_relaxed);
+}
+
+void stopTracing() {
+  detail::flags.fetch_and(~unsigned(detail::Tracing), std::memory_order_relaxed);
+}
+
+void setIteration(int iteration) {
+  tracer().iteration.store(iteration, std::memory_order_relaxed);
+}
+
+void writeChromeTrace(std::ostream & out) {
+  struct Event {
+    TraceEvent event;
+    int tid;
+  };
+  std::vector<Event> events;
+  Tracer & t = tracer();
+  std::uint64_t start;
+  {
+    std::lock_guard<std::mutex> lock(t.mutex);
+    start = t.start;
+    for (const auto & buffer : t.buffers) {
+      const std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+      const std::uint64_t size = buffer->events.size();
+      for (std::uint64_t i = written - std::min(written, size); i < written; ++i)
+        events.push_back(Event{buffer->events[i % size], buffer->tid});
+    }
+  }
+  std::stable_sort(events.begin(), events.end(), [](const Event & a, const Event & b) { return a.event.start < b.event.start; });
+
+  const std::ios::fmtflags formatFlags = out.flags();
+  const std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent & e = events[i].event;
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(out, e.name);
+    // Timestamps and durations are in microseconds
+    out << ",\"cat\":\"aslam\",\"ph\":\"X\",\"ts\":" << (e.start >= start ? e.start - start : 0) * 1e-3
+        << ",\"dur\":" << (e.end - e.start) * 1e-3 << ",\"pid\":1,\"tid\":" << events[i].tid
+        << ",\"args\":{\"iteration\":" << e.iteration << "}}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+  out.flags(formatFlags);
+  out.precision(precision);
+}
+
+void writeChromeTrace(const std::string & filename) {
+  std::ofstream out(filename.c_str());
+  SM_ASSERT_TRUE(aslam::Exception, out.good(), "Failed to open the trace file " << filename);
+  writeChromeTrace(out);
+  SM_ASSERT_TRUE(aslam::Exception, out.good(), "Failed to write the trace file " << filename);
+}
+
+} // namespace instrumentation
+} // namespace backend
+} // namespace aslam
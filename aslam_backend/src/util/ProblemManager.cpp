@@ -6,6 +6,7 @@
 #include <aslam/backend/JacobianContainerDense.hpp>
 
 #include <aslam/backend/util/ThreadedRangeProcessor.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
 
 
 #include <sm/logging.hpp>
@@ -187,6 +188,7 @@ double ProblemManager::evaluateError(const size_t nThreads /*= 1*/) const {
 void ProblemManager::applyStateUpdate(const ColumnVectorType& dx)
 {
   Timer t("ProblemManager: Apply state update", false);
+  instrumentation::ScopedPhase phase(instrumentation::Phase::StateUpdate);
   // Apply the update to the dense state.
   int startIdx = 0;
   for (size_t i = 0; i < _designVariables.size(); i++) {
@@ -202,6 +204,7 @@ void ProblemManager::applyStateUpdate(const ColumnVectorType& dx)
 void ProblemManager::revertLastStateUpdate()
 {
   Timer t("ProblemManager: Revert last state update", false);
+  instrumentation::ScopedPhase phase(instrumentation::Phase::StateUpdate);
   for (size_t i = 0; i < _designVariables.size(); i++)
     _designVariables[i]->revertUpdate();
 }
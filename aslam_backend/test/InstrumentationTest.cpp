@@ -0,0 +1,161 @@
+#include <sm/eigen/gtest.hpp>
+
+#include <sstream>
+
+#include "SampleDvAndError.hpp"
+
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+
+using namespace aslam::backend;
+
+TEST(InstrumentationTestSuite, testPhasesAndErrorTermTypes)
+{
+  using namespace aslam::backend::instrumentation;
+  const int D = 4;
+  const int E = 20;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  try {
+    buildSystem(D, E, dvs, errs);
+    DenseQrLinearSystemSolver solver;
+    solver.initMatrixStructure(dvs, errs, false);
+
+    // Nothing is recorded while disabled
+    reset();
+    ASSERT_FALSE(isEnabled());
+    solver.evaluateError(2, false);
+    Report report = collect();
+    for (int p = 0; p < NumPhases; ++p)
+      EXPECT_EQ(0u, report.phases[p].count) << name(static_cast<Phase>(p));
+    EXPECT_TRUE(report.errorTermTypes.empty());
+
+    setEnabled(true);
+    solver.evaluateError(2, false);
+    solver.buildSystem(2, false);
+    Eigen::VectorXd dx;
+    ASSERT_TRUE(solver.solveSystem(dx));
+    setEnabled(false);
+
+    // The worker threads have finished, their counters are retired
+    report = collect();
+    EXPECT_EQ(errs.size(), report.phase(Phase::ErrorEvaluation).count);
+    EXPECT_EQ(errs.size(), report.phase(Phase::JacobianEvaluation).count);
+    EXPECT_EQ(errs.size() + 1, report.phase(Phase::Assembly).count);
+    EXPECT_EQ(1u, report.phase(Phase::Factorization).count);
+    EXPECT_EQ(1u, report.phase(Phase::Solve).count);
+    EXPECT_EQ(0u, report.phase(Phase::StateUpdate).count);
+
+    for (int p = 0; p < NumPhases; ++p) {
+      const Statistics & s = report.phases[p];
+      std::uint64_t n = 0;
+      for (std::uint64_t h : s.histogram)
+        n += h;
+      EXPECT_EQ(s.count, n) << name(static_cast<Phase>(p));
+      EXPECT_LE(s.maxNs, s.totalNs);
+      if (s.count > 0) {
+        EXPECT_LE(s.quantileNs(0.5), s.quantileNs(1.0));
+        EXPECT_DOUBLE_EQ(double(s.maxNs), s.quantileNs(1.0));
+      }
+    }
+
+    // The sample system cycles through three error term types
+    ASSERT_EQ(3u, report.errorTermTypes.size());
+    ASSERT_EQ(1u, report.errorTermTypes.count("LinearErr3"));
+    std::uint64_t numEvaluations = 0;
+    for (const auto & type : report.errorTermTypes) {
+      const auto & counters = type.second;
+      numEvaluations += counters[static_cast<int>(Phase::ErrorEvaluation)].count;
+      EXPECT_EQ(counters[static_cast<int>(Phase::ErrorEvaluation)].count, counters[static_cast<int>(Phase::JacobianEvaluation)].count) << type.first;
+      EXPECT_EQ(counters[static_cast<int>(Phase::ErrorEvaluation)].count, counters[static_cast<int>(Phase::Assembly)].count) << type.first;
+    }
+    EXPECT_EQ(errs.size(), numEvaluations);
+    EXPECT_EQ(6u, report.errorTermTypes.at("LinearErr3")[static_cast<int>(Phase::ErrorEvaluation)].count);
+
+    std::ostringstream out;
+    report.print(out);
+    EXPECT_NE(std::string::npos, out.str().find("Factorization"));
+
+    reset();
+    report = collect();
+    EXPECT_EQ(0u, report.phase(Phase::ErrorEvaluation).count);
+    EXPECT_TRUE(report.errorTermTypes.empty());
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    setEnabled(false);
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(InstrumentationTestSuite, testChromeTrace)
+{
+  using namespace aslam::backend::instrumentation;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  try {
+    buildSystem(4, 20, dvs, errs);
+    DenseQrLinearSystemSolver solver;
+    solver.initMatrixStructure(dvs, errs, false);
+
+    ASSERT_FALSE(isTracing());
+    startTracing(64);
+    ASSERT_TRUE(isTracing());
+    ASSERT_FALSE(isEnabled());
+    setIteration(3);
+    solver.evaluateError(2, false);
+    solver.buildSystem(2, false);
+    Eigen::VectorXd dx;
+    ASSERT_TRUE(solver.solveSystem(dx));
+    stopTracing();
+    // Not recorded anymore
+    solver.evaluateError(2, false);
+
+    std::ostringstream out;
+    writeChromeTrace(out);
+    const std::string trace = out.str();
+    EXPECT_EQ(0u, trace.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, trace.find("\"displayTimeUnit\":\"ms\"}"));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Evaluate errors\""));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Evaluate Jacobians (thread)\""));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Factorization\""));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Solve\""));
+    EXPECT_NE(std::string::npos, trace.find("\"iteration\":3"));
+    // Per error term scopes are not traced
+    EXPECT_EQ(std::string::npos, trace.find("\"name\":\"Error evaluation\""));
+
+    size_t numEvents = 0, numThreadEvents = 0;
+    for (size_t pos = trace.find("\"ph\":\"X\""); pos != std::string::npos; pos = trace.find("\"ph\":\"X\"", pos + 1))
+      ++numEvents;
+    for (size_t pos = trace.find("(thread)"); pos != std::string::npos; pos = trace.find("(thread)", pos + 1))
+      ++numThreadEvents;
+    // Two calls with two worker ranges each, the assembly of the right hand side, factorization and solve
+    EXPECT_EQ(4u, numThreadEvents);
+    EXPECT_EQ(9u, numEvents);
+    // The calling thread has the first lane. Concurrent workers get their own lanes,
+    // workers started later reuse them, so there are at most two worker lanes.
+    EXPECT_NE(std::string::npos, trace.find("\"tid\":0"));
+    EXPECT_NE(std::string::npos, trace.find("\"tid\":1"));
+    EXPECT_EQ(std::string::npos, trace.find("\"tid\":3"));
+
+    // The ring buffers keep the latest events only
+    startTracing(1);
+    solver.evaluateError(1, false);
+    solver.evaluateError(1, false);
+    stopTracing();
+    out.str("");
+    writeChromeTrace(out);
+    EXPECT_EQ(std::string::npos, out.str().find("\"tid\":1"));
+    numEvents = 0;
+    for (size_t pos = out.str().find("\"ph\":\"X\""); pos != std::string::npos; pos = out.str().find("\"ph\":\"X\"", pos + 1))
+      ++numEvents;
+    EXPECT_EQ(1u, numEvents);
+
+    EXPECT_THROW(writeChromeTrace("/nonexistent/directory/trace.json"), std::exception);
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    stopTracing();
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
@@ -326,6 +326,56 @@ TEST(JacobianContainerTests, testChainRule)
   }
 }
 
+template <int Rows>
+void testFixedSizeChainRule(const int rows)
+{
+  using namespace aslam::backend;
+  DummyDesignVariable<3> dv1;
+  dv1.setBlockIndex(0);
+  dv1.setActive(true);
+  DummyDesignVariable<2> dv2;
+  dv2.setBlockIndex(1);
+  dv2.setActive(true);
+
+  const Eigen::MatrixXd C1 = Eigen::MatrixXd::Random(rows, 3);
+  const Eigen::Matrix3d C2 = Eigen::Matrix3d::Random();
+  const Eigen::Matrix3d J1 = Eigen::Matrix3d::Random();
+  const Eigen::Matrix<double, 3, 2> J2 = Eigen::Matrix<double, 3, 2>::Random();
+
+  for (bool useFixedSize : {true, false}) {
+    SCOPED_TRACE(useFixedSize ? "Fixed-size kernels" : "Dynamic kernels");
+    JacobianContainerSparse<Rows> jc(rows);
+    jc.setUseFixedSizeChainRule(useFixedSize);
+    ASSERT_EQ(useFixedSize, jc.useFixedSizeChainRule());
+    // The chain rule matrices are popped once the applied containers go out of scope
+    auto addJacobians = [&](JacobianContainer& jc2) {
+      jc2.add(&dv1, J1);
+      jc2.add(&dv2, J2);
+      jc2.add(&dv1);
+    };
+    auto applyC2 = [&](JacobianContainer& jc1) { addJacobians(jc1.apply(C2)); };
+    applyC2(jc.apply(C1));
+    ASSERT_TRUE(jc.chainRuleEmpty());
+    sm::eigen::assertNear(C1 * C2 * J1 + C1 * C2, jc.Jacobian(&dv1), 1e-12, SM_SOURCE_FILE_POS, "Checking the chain rule of the 3x3 Jacobian");
+    sm::eigen::assertNear(C1 * C2 * J2, jc.Jacobian(&dv2), 1e-12, SM_SOURCE_FILE_POS, "Checking the chain rule of the 3x2 Jacobian");
+  }
+}
+
+TEST(JacobianContainerTests, testFixedSizeChainRule)
+{
+  try {
+    // The fixed-size kernels are used up to MaxFixedSizeRows rows, more rows take the dynamic path
+    for (int rows = 1; rows <= aslam::backend::MatrixStack::MaxFixedSizeRows + 1; ++rows) {
+      SCOPED_TRACE(::testing::Message() << "Rows: " << rows);
+      testFixedSizeChainRule<Eigen::Dynamic>(rows);
+    }
+    testFixedSizeChainRule<2>(2);
+    testFixedSizeChainRule<8>(8);
+  } catch (const std::exception& e) {
+    FAIL() << "Exception: " << e.what();
+  }
+}
+
 TEST(JacobianContainerTests, testAddContainers)
 {
   try {
@@ -1,10 +1,13 @@
 #include <sm/eigen/gtest.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 #include "SampleDvAndError.hpp"
 
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/DenseCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/SparseQrLinearSystemSolver.hpp>
 #include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
@@ -91,6 +94,128 @@ TEST(LinearSolverTestSuite, testDenseQr)
 }
 */
 
+TEST(LinearSolverTestSuite, testDenseCholesky)
+{
+  using namespace aslam::backend;
+  const int D = 4;
+  const int E = 20;
+  const bool useM = false;
+  for (int nThreads = 0; nThreads < 4; ++nThreads) {
+    for (bool useDiag : {false, true}) {
+      SCOPED_TRACE(((useDiag ? "With Diagonal and " : "No Diagonal and ") + boost::lexical_cast<std::string>(nThreads) + " threads").c_str());
+      compareSolvers<SparseCholeskyLinearSystemSolver, DenseCholeskyLinearSystemSolver>(D, E, useM, useDiag, nThreads);
+    }
+  }
+}
+
+TEST(LinearSolverTestSuite, testDenseCholeskyRepeatedSolves)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  try {
+    buildSystem(4, 20, dvs, errs);
+    DenseCholeskyLinearSolverOptions options;
+    // Flush the rank-k updates after almost every error term touching most of the columns
+    options.rowBlockSize = 3;
+    DenseCholeskyLinearSystemSolver solver, rankK(options), ldlt;
+    ldlt.getOptions().useLdlt = true;
+    DenseQrLinearSystemSolver reference;
+    for (LinearSystemSolver* s : std::vector<LinearSystemSolver*>{&solver, &rankK, &ldlt, &reference}) {
+      s->initMatrixStructure(dvs, errs, true);
+      s->evaluateError(2, false);
+      s->buildSystem(2, false);
+    }
+    Eigen::MatrixXd H;
+    solver.getHessian(H);
+    sm::eigen::assertNear(H, reference.getJacobian().transpose() * reference.getJacobian(), 1e-8, SM_SOURCE_FILE_POS, "Checking the normal equations");
+    EXPECT_NEAR(reference.rhsJtJrhs(), solver.rhsJtJrhs(), 1e-8 * std::abs(reference.rhsJtJrhs()));
+
+    // The system is damped in place and can be solved again with another damping without rebuilding it
+    for (double lambda : {1e-3, 1.0, 1e3, 1e-3}) {
+      SCOPED_TRACE(("lambda " + boost::lexical_cast<std::string>(lambda)).c_str());
+      Eigen::VectorXd dx, dxReference;
+      reference.setConstantConditioner(std::sqrt(lambda));
+      ASSERT_TRUE(reference.solveSystem(dxReference));
+      for (DenseCholeskyLinearSystemSolver* s : {&solver, &rankK, &ldlt}) {
+        s->setConstantConditioner(std::sqrt(lambda));
+        ASSERT_TRUE(s->solveSystem(dx));
+        sm::eigen::assertNear(dx, dxReference, 1e-6, SM_SOURCE_FILE_POS, "Checking the solutions");
+      }
+      EXPECT_NEAR(reference.rhsJtJrhs(), solver.rhsJtJrhs(), 1e-8 * std::abs(reference.rhsJtJrhs()));
+    }
+    EXPECT_EQ(0u, solver.numQrFallbacks());
+
+    // An ill-conditioned factorization falls back to QR
+    solver.getOptions().minReciprocalCondition = 2.0;
+    Eigen::VectorXd dx, dxReference;
+    ASSERT_TRUE(solver.solveSystem(dx));
+    ASSERT_TRUE(reference.solveSystem(dxReference));
+    EXPECT_EQ(1u, solver.numQrFallbacks());
+    sm::eigen::assertNear(dx, dxReference, 1e-6, SM_SOURCE_FILE_POS, "Checking the QR fallback");
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSolverTestSuite, testDenseQrSinglePrecision)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  const int D = 4;
+  const int E = 20;
+  const bool useM = false;
+  for (bool useDiag : {false, true}) {
+    SCOPED_TRACE(useDiag ? "With Diagonal" : "No Diagonal");
+    try {
+      buildSystem(D, E, dvs, errs);
+      DenseQRLinearSolverOptions options;
+      options.useSinglePrecision = true;
+      DenseQrLinearSystemSolver single(options), unrefined(options), reference;
+      options.maxRefinementIterations = 0;
+      unrefined.setOptions(options);
+      Eigen::VectorXd diag;
+      for (DenseQrLinearSystemSolver* solver : {&single, &unrefined, &reference}) {
+        solver->initMatrixStructure(dvs, errs, useDiag);
+        if (diag.size() == 0)
+          diag = Eigen::VectorXd::Random(solver->JCols());
+        if (useDiag)
+          solver->setConditioner(diag);
+        solver->evaluateError(1, useM);
+        solver->buildSystem(1, useM);
+      }
+      EXPECT_EQ(nullptr, single.Jacobian());
+      ASSERT_EQ(single.JRows(), (size_t)single.getJacobianSinglePrecision().rows());
+      sm::eigen::assertNear(single.getJacobianSinglePrecision().cast<double>(), reference.getJacobian(), 1e-6, SM_SOURCE_FILE_POS, "Checking the Jacobians");
+      sm::eigen::assertNear(single.rhs(), reference.rhs(), 1e-5, SM_SOURCE_FILE_POS, "Checking right-hand sides");
+
+      Eigen::VectorXd dxSingle, dxUnrefined, dxReference;
+      ASSERT_TRUE(single.solveSystem(dxSingle));
+      ASSERT_TRUE(unrefined.solveSystem(dxUnrefined));
+      ASSERT_TRUE(reference.solveSystem(dxReference));
+      sm::eigen::assertNear(dxSingle, dxReference, 1e-5, SM_SOURCE_FILE_POS, "Checking the solutions");
+
+      // The refined solution solves the problem with the single precision Jacobian to double accuracy
+      Eigen::MatrixXd J = Eigen::MatrixXd::Zero(single.JRows() + (useDiag ? single.JCols() : 0), single.JCols());
+      J.topRows(single.JRows()) = single.getJacobianSinglePrecision().cast<double>();
+      Eigen::VectorXd e = Eigen::VectorXd::Zero(J.rows());
+      e.head(single.JRows()) = single.e();
+      if (useDiag)
+        J.bottomRows(single.JCols()) = diag.asDiagonal();
+      const Eigen::VectorXd dxExact = J.colPivHouseholderQr().solve(e);
+      sm::eigen::assertNear(dxSingle, dxExact, 1e-10, SM_SOURCE_FILE_POS, "Checking the refined solution");
+      EXPECT_LT((dxSingle - dxExact).norm(), (dxUnrefined - dxExact).norm());
+      deleteSystem(dvs, errs);
+    } catch (const std::exception& e) {
+      deleteSystem(dvs, errs);
+      FAIL() << e.what();
+    }
+  }
+}
+
 TEST(LinearSolverTestSuite, testSparseCholesky)
 {
   using namespace aslam::backend;
@@ -114,6 +239,214 @@ TEST(LinearSolverTestSuite, testSparseCholesky)
   }
 }
 
+TEST(LinearSolverTestSuite, testSparseCholeskyBlockOrderings)
+{
+  using namespace aslam::backend;
+  const SparseCholeskyLinearSolverOptions::Ordering orderings[] = {
+    SparseCholeskyLinearSolverOptions::ScalarAmd,
+    SparseCholeskyLinearSolverOptions::BlockAmd,
+    SparseCholeskyLinearSolverOptions::BlockColamd,
+    SparseCholeskyLinearSolverOptions::BlockNestedDissection
+  };
+  for (bool constrained : {false, true}) {
+    for (SparseCholeskyLinearSolverOptions::Ordering ordering : orderings) {
+      SCOPED_TRACE(("Ordering " + boost::lexical_cast<std::string>(ordering) + (constrained ? " with constraints" : "")).c_str());
+      std::vector<DesignVariable*> dvs;
+      std::vector<ErrorTerm*> errs;
+      try {
+        buildSystem(6, 30, dvs, errs);
+        SparseCholeskyLinearSolverOptions options;
+        options.ordering = ordering;
+        SparseCholeskyLinearSystemSolver S1(options);
+        if (constrained) {
+          S1.setOrderingGroup(dvs[0], 2);
+          S1.setOrderingGroup(dvs[3], 1);
+        }
+        S1.initMatrixStructure(dvs, errs, false);
+        BlockCholeskyLinearSystemSolver S2;
+        S2.initMatrixStructure(dvs, errs, false);
+
+        const std::vector<int>& perm = S1.getOrdering();
+        if (ordering == SparseCholeskyLinearSolverOptions::ScalarAmd) {
+          EXPECT_TRUE(perm.empty());
+        } else {
+          ASSERT_EQ(S1.JCols(), perm.size());
+          std::vector<int> sorted(perm);
+          std::sort(sorted.begin(), sorted.end());
+          std::vector<int> identity(perm.size());
+          std::iota(identity.begin(), identity.end(), 0);
+          EXPECT_EQ(identity, sorted);
+          // The columns of a design variable stay together
+          for (size_t i = 0; i < perm.size(); i += 2) {
+            EXPECT_EQ(0, perm[i] % 2);
+            EXPECT_EQ(perm[i] + 1, perm[i + 1]);
+          }
+          if (constrained) {
+            // dvs[3] is eliminated second to last and dvs[0] last
+            EXPECT_EQ(dvs[3]->columnBase(), perm[perm.size() - 4]);
+            EXPECT_EQ(dvs[0]->columnBase(), perm[perm.size() - 2]);
+          }
+        }
+
+        S1.evaluateError(1, false);
+        S2.evaluateError(1, false);
+        S1.buildSystem(1, false);
+        S2.buildSystem(1, false);
+        Eigen::VectorXd dxS1, dxS2;
+        ASSERT_TRUE(S1.solveSystem(dxS1));
+        ASSERT_TRUE(S2.solveSystem(dxS2));
+        ASSERT_DOUBLE_MX_EQ(dxS2, dxS1, 1e-6, "Checking the solutions");
+        deleteSystem(dvs, errs);
+      } catch (const std::exception& e) {
+        deleteSystem(dvs, errs);
+        FAIL() << e.what();
+      }
+    }
+  }
+}
+
+TEST(LinearSolverTestSuite, testSparseCholeskyNormalEquations)
+{
+  using namespace aslam::backend;
+  for (int nThreads = 0; nThreads < 4; ++nThreads) {
+    for (bool useDiag : {false, true}) {
+      SCOPED_TRACE(((useDiag ? "With" : "No") + std::string(" diagonal and ") + boost::lexical_cast<std::string>(nThreads) + " threads").c_str());
+      std::vector<DesignVariable*> dvs;
+      std::vector<ErrorTerm*> errs;
+      try {
+        buildSystem(5, 25, dvs, errs);
+        SparseCholeskyLinearSolverOptions options;
+        options.assembleNormalEquations = true;
+        SparseCholeskyLinearSystemSolver S1(options);
+        S1.initMatrixStructure(dvs, errs, useDiag);
+        BlockCholeskyLinearSystemSolver S2;
+        S2.initMatrixStructure(dvs, errs, useDiag);
+        S1.evaluateError(nThreads, false);
+        S2.evaluateError(nThreads, false);
+        S1.buildSystem(nThreads, false);
+        S2.buildSystem(nThreads, false);
+        ASSERT_DOUBLE_MX_EQ(S2.rhs(), S1.rhs(), 1e-6, "Checking right-hand sides");
+        // Solve twice with different conditioners without rebuilding the system
+        for (double lambda : {1.0, 0.1}) {
+          if (useDiag) {
+            S1.setConstantConditioner(lambda);
+            S2.setConstantConditioner(lambda);
+          }
+          Eigen::VectorXd dxS1, dxS2;
+          ASSERT_TRUE(S1.solveSystem(dxS1));
+          ASSERT_TRUE(S2.solveSystem(dxS2));
+          ASSERT_DOUBLE_MX_EQ(dxS2, dxS1, 1e-6, "Checking the solutions");
+        }
+        deleteSystem(dvs, errs);
+      } catch (const std::exception& e) {
+        deleteSystem(dvs, errs);
+        FAIL() << e.what();
+      }
+    }
+  }
+}
+
+template<typename SOLVER_TYPE>
+void compareFusedEvaluation(bool useM, int nThreads)
+{
+  SCOPED_TRACE(typeid(SOLVER_TYPE).name());
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  try {
+    buildSystem(4, 20, dvs, errs);
+    SOLVER_TYPE S1, S2;
+    S1.initMatrixStructure(dvs, errs, false);
+    S2.initMatrixStructure(dvs, errs, false);
+    ASSERT_TRUE(S1.supportsFusedEvaluation());
+    ASSERT_NEAR(S2.evaluateError(nThreads, useM), S1.evaluateErrorAndJacobians(nThreads, useM), 1e-9);
+    ASSERT_DOUBLE_MX_EQ(S2.e(), S1.e(), 1e-9, "Checking the error vectors");
+    S1.buildSystem(nThreads, useM);
+    S2.buildSystem(nThreads, useM);
+    EXPECT_EQ(1u, S1.numFusedEvaluations());
+    EXPECT_EQ(1u, S1.numSavedJacobianPasses());
+    EXPECT_EQ(0u, S2.numSavedJacobianPasses());
+    ASSERT_DOUBLE_MX_EQ(S2.rhs(), S1.rhs(), 1e-9, "Checking right-hand sides");
+    Eigen::VectorXd dxS1, dxS2;
+    ASSERT_TRUE(S1.solveSystem(dxS1));
+    ASSERT_TRUE(S2.solveSystem(dxS2));
+    ASSERT_DOUBLE_MX_EQ(dxS2, dxS1, 1e-9, "Checking the solutions");
+
+    // The Jacobians are used once, with the same M-estimator setting only
+    S1.buildSystem(nThreads, useM);
+    S1.evaluateErrorAndJacobians(nThreads, useM);
+    S1.buildSystem(nThreads, !useM);
+    S1.evaluateErrorAndJacobians(nThreads, useM);
+    S1.discardEvaluatedJacobians();
+    S1.buildSystem(nThreads, useM);
+    EXPECT_EQ(3u, S1.numFusedEvaluations());
+    EXPECT_EQ(1u, S1.numSavedJacobianPasses());
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSolverTestSuite, testFusedErrorAndJacobianEvaluation)
+{
+  using namespace aslam::backend;
+  for (int nThreads = 0; nThreads < 4; ++nThreads) {
+    for (bool useM : {false, true}) {
+      SCOPED_TRACE(((useM ? "With" : "No") + std::string(" M-estimator and ") + boost::lexical_cast<std::string>(nThreads) + " threads").c_str());
+      compareFusedEvaluation<DenseQrLinearSystemSolver>(useM, nThreads);
+      compareFusedEvaluation<SparseCholeskyLinearSystemSolver>(useM, nThreads);
+      compareFusedEvaluation<SparseQrLinearSystemSolver>(useM, nThreads);
+    }
+  }
+
+  // Solvers without support evaluate the errors only
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(4, 20, dvs, errs);
+  BlockCholeskyLinearSystemSolver solver;
+  solver.initMatrixStructure(dvs, errs, false);
+  EXPECT_FALSE(solver.supportsFusedEvaluation());
+  EXPECT_NO_THROW(solver.evaluateErrorAndJacobians(2, false));
+  EXPECT_NO_THROW(solver.buildSystem(2, false));
+  EXPECT_EQ(0u, solver.numFusedEvaluations());
+  EXPECT_EQ(0u, solver.numSavedJacobianPasses());
+  deleteSystem(dvs, errs);
+}
+
+TEST(LinearSolverTestSuite, testDeadline)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  try {
+    buildSystem(4, 20, dvs, errs);
+    DenseQrLinearSystemSolver S1;
+    SparseCholeskyLinearSystemSolver S2;
+    BlockCholeskyLinearSystemSolver S3;
+    DenseCholeskyLinearSystemSolver S4;
+    for (LinearSystemSolver* solver : std::vector<LinearSystemSolver*>{&S1, &S2, &S3, &S4}) {
+      SCOPED_TRACE(solver->name());
+      solver->initMatrixStructure(dvs, errs, false);
+      solver->setDeadline(util::Deadline(60.0));
+      EXPECT_NO_THROW(solver->evaluateError(2, false));
+      EXPECT_NO_THROW(solver->buildSystem(2, false));
+      solver->setDeadline(util::Deadline(-1.0));
+      EXPECT_THROW(solver->evaluateError(2, false), util::Deadline::Exceeded);
+      EXPECT_THROW(solver->evaluateErrorAndJacobians(2, false), util::Deadline::Exceeded);
+      EXPECT_THROW(solver->buildSystem(2, false), util::Deadline::Exceeded);
+      solver->setDeadline(util::Deadline());
+      EXPECT_NO_THROW(solver->evaluateError(2, false));
+      EXPECT_NO_THROW(solver->buildSystem(2, false));
+    }
+    EXPECT_TRUE(std::isinf(util::Deadline().remaining()));
+    EXPECT_FALSE(util::Deadline().isExceeded());
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
 TEST(LinearSolverTestSuite, testSparseQR)
 {
   using namespace aslam::backend;
@@ -117,6 +117,9 @@ TEST(MatrixStackTestSuites, testMatrixStack)
       EXPECT_ANY_THROW(stack.push(M2)); // incompatible matrix sizes
       sm::eigen::assertEqual(M1, stack.top(), SM_SOURCE_FILE_POS, "Testing push() of multiple matrices");
 
+      // The dynamic kernels compute exactly the dynamic product
+      EXPECT_TRUE(stack.useFixedSizeKernels());
+      stack.setUseFixedSizeKernels(false);
       const auto M3 = Eigen::Matrix<double, numRows, numRows>::Random().eval();
       Eigen::MatrixXd expected = M1;
       for (size_t i=0; i<10; ++i) {
@@ -124,6 +127,44 @@ TEST(MatrixStackTestSuites, testMatrixStack)
         expected = expected*M3;
         sm::eigen::assertEqual(expected, stack.top(), SM_SOURCE_FILE_POS, "Testing push() of multiple matrices");
       }
+      stack.setUseFixedSizeKernels(true);
+    }
+
+    // The fixed-size kernels compute the same products up to rounding
+    {
+      SCOPED_TRACE("Testing push() of multiple matrices with fixed-size kernels");
+
+      while(!stack.empty()) // clear stack
+        stack.pop();
+
+      const auto M1 = Eigen::Matrix<double, numRows, numRows>::Random().eval();
+      stack.push(M1);
+      const auto M3 = Eigen::Matrix<double, numRows, numRows>::Random().eval();
+      Eigen::MatrixXd expected = M1;
+      for (size_t i=0; i<10; ++i) {
+        EXPECT_NO_THROW(stack.push(M3));
+        expected = expected*M3;
+        sm::eigen::assertNear(expected, stack.top(), 1e-12 * expected.norm(), SM_SOURCE_FILE_POS, "Testing push() of multiple matrices with fixed-size kernels");
+      }
+    }
+
+    // The dynamic kernels have to compute the same products
+    {
+      SCOPED_TRACE("Testing push() of multiple matrices with dynamic kernels");
+
+      while(!stack.empty()) // clear stack
+        stack.pop();
+      EXPECT_TRUE(stack.useFixedSizeKernels());
+      stack.setUseFixedSizeKernels(false);
+
+      const auto M1 = Eigen::Matrix<double, numRows, numRows>::Random().eval();
+      const auto M2 = Eigen::Matrix<double, numRows, 2>::Random().eval();
+      const Eigen::MatrixXd M3 = Eigen::MatrixXd::Random(2, 5);
+      stack.push(M1);
+      stack.push(M2);
+      stack.push(M3);
+      sm::eigen::assertNear(M1*M2*M3, stack.top(), 1e-12, SM_SOURCE_FILE_POS, "Testing push() of multiple matrices with dynamic kernels");
+      stack.setUseFixedSizeKernels(true);
     }
   }
   catch(std::exception const & e)
@@ -0,0 +1,210 @@
+/*
+ * Profiling.cpp
+ *
+ * Profiles the construction and modification of optimization problems and the slides of a sliding window.
+ */
+
+// standard includes
+#include <vector>
+#include <string>
+
+// boost includes
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/OptimizationProblem.hpp>
+#include <aslam/backend/DesignVariable.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/SlidingWindowProblem.hpp>
+
+#include "DummyDesignVariable.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+  /// \brief An error term between two consecutive design variables of a chain
+  class ChainError : public ErrorTermFs<3> {
+   public:
+    ChainError(DesignVariable* dv0, DesignVariable* dv1) {
+      setDesignVariables(dv0, dv1);
+    }
+   protected:
+    double evaluateErrorImplementation() override { return 0.0; }
+    void evaluateJacobiansImplementation(JacobianContainer & /* J */) override { }
+  };
+
+  /// \brief A state of a chain which is updated additively
+  class ChainState : public DesignVariable {
+   public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Eigen::Vector3d _v, _p_v;
+    ChainState() : _v(Eigen::Vector3d::Random()), _p_v(_v) {}
+   protected:
+    void revertUpdateImplementation() override { _v = _p_v; }
+    void updateImplementation(const double* dp, int /* size */) override { _p_v = _v; _v += Eigen::Map<const Eigen::Vector3d>(dp); }
+    int minimalDimensionsImplementation() const override { return 3; }
+    void getParametersImplementation(Eigen::MatrixXd& value) const override { value = _v; }
+    void setParametersImplementation(const Eigen::MatrixXd& value) override { _p_v = _v; _v = value; }
+  };
+
+  /// \brief A linear error term on the difference of two states of a chain, or on a single state
+  class LinearChainError : public ErrorTermFs<3> {
+   public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    LinearChainError(ChainState* dv0, ChainState* dv1) : _dv0(dv0), _dv1(dv1), _measurement(Eigen::Vector3d::Random()) {
+      if (_dv1)
+        setDesignVariables(dv0, dv1);
+      else
+        setDesignVariables(dv0);
+    }
+   protected:
+    double evaluateErrorImplementation() override {
+      setError(_dv1 ? Eigen::Vector3d(_dv1->_v - _dv0->_v - _measurement) : Eigen::Vector3d(_dv0->_v - _measurement));
+      return evaluateChiSquaredError();
+    }
+    void evaluateJacobiansImplementation(JacobianContainer & J) override {
+      if (_dv1) {
+        J.add(_dv0, -Eigen::Matrix3d::Identity());
+        J.add(_dv1, Eigen::Matrix3d::Identity());
+      } else {
+        J.add(_dv0, Eigen::Matrix3d::Identity());
+      }
+    }
+   private:
+    ChainState* _dv0;
+    ChainState* _dv1;
+    Eigen::Vector3d _measurement;
+  };
+
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nDesignVariables = 200000;
+    size_t nErrorTermsPerDv = 2;
+    size_t windowSize = 20;
+    size_t nSlides = 500;
+    bool noSingle = false, noBulk = false, noRemove = false, noSlidingWindow = false;
+
+    namespace po = boost::program_options;
+    po::options_description desc("aslam_backend profiling options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-design-variables", po::value(&nDesignVariables)->default_value(nDesignVariables), "Number of design variables")
+      ("num-error-terms-per-dv", po::value(&nErrorTermsPerDv)->default_value(nErrorTermsPerDv), "Number of error terms connecting each design variable to its successors")
+      ("no-single", po::bool_switch(&noSingle), "Don't profile adding design variables and error terms one by one")
+      ("no-bulk", po::bool_switch(&noBulk), "Don't profile adding design variables and error terms as ranges")
+      ("no-remove", po::bool_switch(&noRemove), "Don't profile removing design variables")
+      ("window-size", po::value(&windowSize)->default_value(windowSize), "Number of states in the sliding window")
+      ("num-slides", po::value(&nSlides)->default_value(nSlides), "Number of slides of the sliding window")
+      ("no-sliding-window", po::bool_switch(&noSlidingWindow), "Don't profile the slides of a sliding window")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    // ********************** //
+    //   Problem construction //
+    // ********************** //
+
+    vector< boost::shared_ptr<DesignVariable> > dvs;
+    vector< boost::shared_ptr<ErrorTerm> > ets;
+    dvs.reserve(nDesignVariables);
+    for (size_t i = 0; i < nDesignVariables; ++i)
+      dvs.push_back(boost::shared_ptr<DesignVariable>(new DummyDesignVariable<3>()));
+    for (size_t i = 0; i < nDesignVariables; ++i)
+      for (size_t j = 1; j <= nErrorTermsPerDv && i + j < nDesignVariables; ++j)
+        ets.push_back(boost::shared_ptr<ErrorTerm>(new ChainError(dvs[i].get(), dvs[i + j].get())));
+
+    if (!noSingle) {
+      OptimizationProblem problem;
+      {
+        sm::timing::Timer timer("OptimizationProblem -- Single: addDesignVariable", false);
+        for (auto& dv : dvs)
+          problem.addDesignVariable(dv);
+      }
+      {
+        sm::timing::Timer timer("OptimizationProblem -- Single: addErrorTerm", false);
+        for (auto& et : ets)
+          problem.addErrorTerm(et);
+      }
+    }
+
+    if (!noBulk) {
+      OptimizationProblem problem;
+      {
+        sm::timing::Timer timer("OptimizationProblem -- Bulk: addDesignVariables", false);
+        problem.addDesignVariables(dvs.begin(), dvs.end());
+      }
+      {
+        sm::timing::Timer timer("OptimizationProblem -- Bulk: addErrorTerms", false);
+        problem.addErrorTerms(ets.begin(), ets.end());
+      }
+
+      if (!noRemove) {
+        // Remove every other design variable together with its error terms
+        sm::timing::Timer timer("OptimizationProblem -- removeDesignVariable", false);
+        for (size_t i = 0; i < dvs.size(); i += 2)
+          problem.removeDesignVariable(dvs[i].get());
+      }
+    }
+
+    if (!noSlidingWindow) {
+      // A window moving along a chain with an absolute and two relative error terms per state.
+      // The timers give the latency per slide.
+      Optimizer2Options options;
+      options.maxIterations = 1;
+      SlidingWindowProblem window(options);
+      vector<ChainState*> states;
+      size_t nStructureReuses = 0;
+      double marginalizationTime = 0.0, initializationTime = 0.0;
+      for (size_t i = 0; i < windowSize + nSlides; ++i) {
+        states.push_back(new ChainState());
+        window.addDesignVariable(states.back(), true);
+        window.addErrorTerm(new LinearChainError(states[i], nullptr), true);
+        for (size_t j = 1; j <= 2 && j <= i; ++j)
+          window.addErrorTerm(new LinearChainError(states[i - j], states[i]), true);
+        if (i >= windowSize) {
+          sm::timing::Timer timer("SlidingWindowProblem -- Per slide: slide", false);
+          window.markForRemoval(states[i - windowSize]);
+          window.slide();
+        }
+        sm::timing::Timer timer("SlidingWindowProblem -- Per slide: optimize", false);
+        window.optimize();
+        timer.stop();
+        if (i >= windowSize) {
+          marginalizationTime += window.statistics().marginalizationTime;
+          initializationTime += window.statistics().initializationTime;
+          nStructureReuses += window.statistics().structureReused;
+        }
+      }
+      SM_INFO_STREAM("The sliding window reused the structure of the linear system in " << nStructureReuses << " of " << nSlides << " slides");
+      SM_INFO_STREAM("Mean marginalization time per slide: " << marginalizationTime / nSlides << " s, mean initialization time per slide: " << initializationTime / nSlides << " s");
+    }
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
@@ -87,6 +87,17 @@ protected:
     _v = value;
   }
 
+  /// Computes the difference to the linearization point xHat
+  void minimalDifferenceImplementation(const Eigen::MatrixXd& xHat, Eigen::VectorXd& outDifference) const override {
+    outDifference = _v - xHat;
+  }
+
+  /// Computes the difference to the linearization point xHat and its Jacobian
+  void minimalDifferenceAndJacobianImplementation(const Eigen::MatrixXd& xHat, Eigen::VectorXd& outDifference, Eigen::MatrixXd& outJacobian) const override {
+    minimalDifferenceImplementation(xHat, outDifference);
+    outJacobian = Eigen::Matrix2d::Identity();
+  }
+
 };
 
 class LinearErr : public aslam::backend::ErrorTermFs<2> {
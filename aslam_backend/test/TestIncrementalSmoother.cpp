@@ -0,0 +1,264 @@
+#include <sm/eigen/gtest.hpp>
+#include <sm/random.hpp>
+
+#include <aslam/backend/IncrementalSmoother.hpp>
+#include <aslam/backend/JacobianContainerSparse.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "SampleDvAndError.hpp"
+
+namespace {
+
+/// \brief The distance between two points
+class RangeErr : public aslam::backend::ErrorTermFs<1> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  Point2d* _p1;
+  Point2d* _p2;
+  double _range;
+
+  RangeErr(Point2d* p1, Point2d* p2, double range) : _p1(p1), _p2(p2), _range(range) {
+    setDesignVariables(_p1, _p2);
+    setInvR(Eigen::Matrix<double, 1, 1>::Constant(100.0));
+  }
+
+  double evaluateErrorImplementation() override {
+    setError(Eigen::Matrix<double, 1, 1>::Constant((_p2->_v - _p1->_v).norm() - _range));
+    return evaluateChiSquaredError();
+  }
+
+  void evaluateJacobiansImplementation(aslam::backend::JacobianContainer & J) override {
+    const Eigen::RowVector2d d = (_p2->_v - _p1->_v).normalized().transpose();
+    J.add(_p1, -d);
+    J.add(_p2, d);
+  }
+};
+
+/// \brief The gradient of the squared error at the current state, indexed by block index
+Eigen::VectorXd gradient(size_t numPoints, boost::ptr_vector<aslam::backend::ErrorTerm>& errs)
+{
+  using namespace aslam::backend;
+  Eigen::VectorXd g = Eigen::VectorXd::Zero(2 * numPoints);
+  Eigen::VectorXd e;
+  for (ErrorTerm& err : errs) {
+    err.evaluateError();
+    err.getWeightedError(e, false);
+    JacobianContainerSparse<Eigen::Dynamic> jc(err.dimension());
+    err.getWeightedJacobians(jc, false);
+    for (auto it = jc.begin(); it != jc.end(); ++it)
+      g.segment(2 * it->first->blockIndex(), 2) += it->second.transpose() * e;
+  }
+  return g;
+}
+
+}
+
+TEST(IncrementalSmootherTestSuite, testLinearChainMatchesBatchSolution)
+{
+  using namespace aslam::backend;
+  try {
+    srand(5);
+    sm::random::seed(5);
+    boost::ptr_vector<Point2d> points;
+    boost::ptr_vector<ErrorTerm> errs;
+    IncrementalSmootherOptions options;
+    options.reorderInterval = 7;
+    IncrementalSmoother smoother(options);
+    for (int i = 0; i < 40; ++i) {
+      points.push_back(new Point2d(Eigen::Vector2d::Random()));
+      points.back().setActive(true);
+      std::vector<ErrorTerm*> newErrs;
+      if (i % 5 == 0)
+        newErrs.push_back(new LinearErr(&points[i]));
+      if (i > 0)
+        newErrs.push_back(new LinearErr2(&points[i - 1], &points[i]));
+      // Loop closures
+      if (i > 0 && i % 9 == 0)
+        newErrs.push_back(new LinearErr2(&points[i / 3], &points[i]));
+      for (ErrorTerm* err : newErrs)
+        errs.push_back(err);
+      smoother.update({&points.back()}, newErrs);
+
+      ASSERT_EQ(points.size(), smoother.numDesignVariables());
+      ASSERT_EQ(errs.size(), smoother.numErrorTerms());
+      EXPECT_EQ((i + 1) % 7 == 0, smoother.lastUpdate().reordered) << i;
+      // The problem is linear, the estimate is the minimum
+      Eigen::VectorXd g = gradient(points.size(), errs);
+      ASSERT_LT(g.lpNorm<Eigen::Infinity>(), 1e-8) << "Update " << i;
+    }
+    // No relinearization, the linearized error is the error
+    double error = 0.0;
+    for (ErrorTerm& err : errs)
+      error += err.evaluateError();
+    EXPECT_NEAR(error, smoother.linearizedSquaredError(), 1e-8 * error);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(IncrementalSmootherTestSuite, testCostScalesWithTheChange)
+{
+  using namespace aslam::backend;
+  try {
+    srand(6);
+    sm::random::seed(6);
+    boost::ptr_vector<Point2d> points;
+    boost::ptr_vector<ErrorTerm> errs;
+    IncrementalSmootherOptions options;
+    options.relinearizeInterval = 0;
+    options.reorderInterval = 0;
+    // Changes of the estimate far from the new states are not propagated
+    options.wildfireThreshold = 1e-6;
+    IncrementalSmoother smoother(options);
+    std::vector<IncrementalSmoother::UpdateStatistics> statistics;
+    for (int i = 0; i < 300; ++i) {
+      points.push_back(new Point2d(Eigen::Vector2d::Random()));
+      points.back().setActive(true);
+      std::vector<ErrorTerm*> newErrs;
+      newErrs.push_back(new LinearErr(&points[i]));
+      if (i > 0)
+        newErrs.push_back(new LinearErr2(&points[i - 1], &points[i]));
+      for (ErrorTerm* err : newErrs)
+        errs.push_back(err);
+      smoother.update({&points.back()}, newErrs);
+      statistics.push_back(smoother.lastUpdate());
+      EXPECT_FALSE(smoother.lastUpdate().refactored);
+    }
+    // Appending to the chain only touches the last rows of R
+    EXPECT_EQ(statistics[20].numGivensRotations, statistics[299].numGivensRotations);
+    // At most one rotation per entry of the four new rows
+    EXPECT_LE(statistics[299].numGivensRotations, 4u * 4);
+    EXPECT_LT(statistics[299].numBackSubstitutedRows, 100u);
+    EXPECT_EQ(2u, statistics[299].numLinearizedErrorTerms);
+    // R of a chain is block bidiagonal: a triangular and a full 2x2 block per design variable
+    EXPECT_LE(smoother.numNonZeros(), 7u * points.size());
+    EXPECT_LT(gradient(points.size(), errs).lpNorm<Eigen::Infinity>(), 1e-3);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(IncrementalSmootherTestSuite, testRelinearization)
+{
+  using namespace aslam::backend;
+  try {
+    srand(7);
+    sm::random::seed(7);
+    boost::ptr_vector<Point2d> points;
+    boost::ptr_vector<ErrorTerm> errs;
+    std::vector<Eigen::Vector2d> truth;
+    IncrementalSmootherOptions options;
+    options.relinearizeThreshold = 1e-3;
+    options.relinearizeInterval = 4;
+    options.reorderInterval = 0;
+    IncrementalSmoother smoother(options);
+    size_t numRelinearized = 0;
+    for (int i = 0; i < 20; ++i) {
+      truth.push_back(Eigen::Vector2d(i, std::sin(i)));
+      points.push_back(new Point2d(truth.back() + 0.2 * Eigen::Vector2d::Random()));
+      points.back().setActive(true);
+      std::vector<ErrorTerm*> newErrs;
+      newErrs.push_back(new LinearErr(&points[i]));
+      if (i > 0)
+        newErrs.push_back(new RangeErr(&points[i - 1], &points[i], (truth[i] - truth[i - 1]).norm()));
+      for (ErrorTerm* err : newErrs)
+        errs.push_back(err);
+      smoother.update({&points.back()}, newErrs);
+      numRelinearized += smoother.lastUpdate().numRelinearizedDesignVariables;
+      if (i % 4 != 3)
+        EXPECT_EQ(0u, smoother.lastUpdate().numRelinearizedDesignVariables) << i;
+    }
+    EXPECT_GT(numRelinearized, 0u);
+
+    // Relinearizing until nothing moves converges to a minimum
+    for (int k = 0; k < 50; ++k) {
+      smoother.relinearize(k % 2 == 0);
+      if (smoother.lastUpdate().numRelinearizedDesignVariables == 0)
+        break;
+    }
+    EXPECT_EQ(0u, smoother.lastUpdate().numRelinearizedDesignVariables);
+    EXPECT_LT(gradient(points.size(), errs).lpNorm<Eigen::Infinity>(), 1e-2);
+    for (size_t i = 0; i < points.size(); ++i)
+      EXPECT_LE(smoother.delta(i).lpNorm<Eigen::Infinity>(), options.relinearizeThreshold);
+
+    // Design variables have to be added before their error terms
+    Point2d unknown(Eigen::Vector2d::Zero());
+    unknown.setActive(true);
+    RangeErr err(&points[0], &unknown, 1.0);
+    EXPECT_THROW(smoother.update({}, {&err}), std::exception);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(IncrementalSmootherTestSuite, testRelinearizationRefactorsTheLastRows)
+{
+  using namespace aslam::backend;
+  try {
+    srand(8);
+    sm::random::seed(8);
+    boost::ptr_vector<Point2d> points;
+    boost::ptr_vector<ErrorTerm> errs;
+    IncrementalSmootherOptions options;
+    options.relinearizeInterval = 0;
+    options.reorderInterval = 0;
+    options.wildfireThreshold = 1e-10;
+    IncrementalSmoother smoother(options);
+    auto addPoint = [&]() {
+      const size_t i = points.size();
+      points.push_back(new Point2d(Eigen::Vector2d::Random()));
+      points.back().setActive(true);
+      std::vector<ErrorTerm*> newErrs;
+      newErrs.push_back(new LinearErr(&points[i]));
+      if (i > 0)
+        newErrs.push_back(new LinearErr2(&points[i - 1], &points[i]));
+      for (ErrorTerm* err : newErrs)
+        errs.push_back(err);
+      smoother.update({&points.back()}, newErrs);
+    };
+    for (int i = 0; i < 100; ++i)
+      addPoint();
+
+    // Relinearizing every design variable refactors all of R
+    smoother.options().relinearizeThreshold = 0.0;
+    smoother.relinearize();
+    EXPECT_EQ(points.size(), smoother.lastUpdate().numRelinearizedDesignVariables);
+    EXPECT_EQ(smoother.numColumns(), smoother.lastUpdate().numRefactoredRows);
+    EXPECT_EQ(0u, smoother.lastUpdate().numGivensRotations);
+
+    // A new design variable moves the last design variables of the chain the most.
+    // Relinearize only those moving more than any of the first 80.
+    addPoint();
+    double threshold = 0.0;
+    for (size_t i = 0; i < 80; ++i)
+      threshold = std::max(threshold, smoother.delta(i).lpNorm<Eigen::Infinity>());
+    smoother.options().relinearizeThreshold = threshold;
+    std::vector<Eigen::Vector2d> estimates;
+    for (const Point2d& point : points)
+      estimates.push_back(point._v);
+    smoother.relinearize();
+
+    const IncrementalSmoother::UpdateStatistics& statistics = smoother.lastUpdate();
+    ASSERT_GT(statistics.numRelinearizedDesignVariables, 0u);
+    EXPECT_TRUE(statistics.refactored);
+    EXPECT_FALSE(statistics.reordered);
+    // Only the rows from the first column of the error terms on the relinearized design variables are refactored
+    EXPECT_EQ(0u, statistics.numGivensRotations);
+    EXPECT_GT(statistics.numRefactoredRows, 0u);
+    EXPECT_LE(statistics.numRefactoredRows, 2u * (points.size() - 79));
+    EXPECT_LT(statistics.numBackSubstitutedRows, smoother.numColumns() / 2);
+    // The problem is linear, relinearizing doesn't move the estimate
+    for (size_t i = 0; i < points.size(); ++i)
+      EXPECT_LT((points[i]._v - estimates[i]).lpNorm<Eigen::Infinity>(), 1e-6) << i;
+    EXPECT_LT(gradient(points.size(), errs).lpNorm<Eigen::Infinity>(), 1e-6);
+
+    // Reordering refactors all of R
+    smoother.relinearize(true);
+    EXPECT_TRUE(smoother.lastUpdate().reordered);
+    EXPECT_EQ(smoother.numColumns(), smoother.lastUpdate().numRefactoredRows);
+    EXPECT_LT(gradient(points.size(), errs).lpNorm<Eigen::Infinity>(), 1e-6);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -0,0 +1,158 @@
+#include <sm/eigen/gtest.hpp>
+#include <sm/random.hpp>
+
+#include <aslam/backend/LinearSystemSolverSelector.hpp>
+#include <aslam/backend/Optimizer2.hpp>
+#include <aslam/backend/OptimizationProblem.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "SampleDvAndError.hpp"
+
+namespace {
+
+using namespace aslam::backend;
+
+/// \brief Points with absolute error terms and relative error terms between every pair (dense) or neighbours (chain)
+struct Problem {
+  std::vector< boost::shared_ptr<Point2d> > points;
+  std::vector< boost::shared_ptr<ErrorTerm> > errs;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errPtrs;
+
+  Problem(int numPoints, bool dense, int numAbsolutePerPoint = 1) {
+    for (int i = 0; i < numPoints; ++i) {
+      points.emplace_back(new Point2d(Eigen::Vector2d::Random()));
+      dvs.push_back(points.back().get());
+    }
+    for (int i = 0; i < numPoints; ++i) {
+      for (int k = 0; k < numAbsolutePerPoint; ++k)
+        errs.emplace_back(new LinearErr(points[i].get()));
+      for (int j = dense ? 0 : i - 1; j < i; ++j)
+        if (j >= 0)
+          errs.emplace_back(new LinearErr2(points[j].get(), points[i].get()));
+    }
+    for (const auto& e : errs)
+      errPtrs.push_back(e.get());
+  }
+};
+
+}
+
+TEST(LinearSystemSolverSelectorTestSuite, testStructureAnalysis)
+{
+  try {
+    sm::random::seed(3);
+    Problem chain(10, false);
+    const LinearSystemStructure s = LinearSystemSolverSelector::analyze(chain.dvs, chain.errPtrs);
+    EXPECT_EQ(20u, s.numCols);
+    EXPECT_EQ(2u * (10 + 9), s.numRows);
+    EXPECT_EQ(10u, s.numDesignVariables);
+    EXPECT_EQ(19u, s.numErrorTerms);
+    EXPECT_EQ(2u * 2 * 10 + 2u * 4 * 9, s.jacobianNnz);
+    EXPECT_EQ(2, s.minBlockDimension);
+    EXPECT_EQ(2, s.maxBlockDimension);
+    EXPECT_DOUBLE_EQ(2.0, s.meanBlockDimension);
+    EXPECT_FALSE(s.rankDeficiencyHint);
+    // A chain has no fill: every block column of the factor has at most two blocks
+    EXPECT_GT(s.factorNnz, 0.0);
+    EXPECT_LE(s.factorNnz, 2.0 * 4 * 10);
+    EXPECT_LT(s.factorDensity(), 0.5);
+
+    // Everything is connected to everything else
+    Problem dense(10, true);
+    EXPECT_NEAR(1.0, LinearSystemSolverSelector::analyze(dense.dvs, dense.errPtrs).factorDensity(), 0.15);
+
+    // Fewer rows than columns
+    Problem underdetermined(2, false, 0);
+    EXPECT_TRUE(LinearSystemSolverSelector::analyze(underdetermined.dvs, underdetermined.errPtrs).rankDeficiencyHint);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSystemSolverSelectorTestSuite, testSelection)
+{
+  try {
+    sm::random::seed(5);
+    LinearSystemSolverSelector selector;
+
+    // A small dense problem is solved densely
+    Problem dense(10, true, 5);
+    EXPECT_EQ("dense_cholesky", selector.select(dense.dvs, dense.errPtrs, true)->name());
+    EXPECT_EQ("dense_cholesky", selector.lastDecision().backend);
+    EXPECT_FALSE(selector.lastDecision().costs.empty());
+
+    // A long chain sparsely
+    Problem chain(2000, false);
+    EXPECT_EQ("sparse_cholesky", selector.select(chain.dvs, chain.errPtrs, true)->name());
+    // The backends are kept
+    EXPECT_EQ(selector.getSolver("sparse_cholesky"), selector.select(chain.dvs, chain.errPtrs, true));
+
+    // A rank deficient system without damping needs a rank revealing solver
+    Problem underdetermined(2, false, 0);
+    EXPECT_NE(std::string::npos, selector.select(underdetermined.dvs, underdetermined.errPtrs, false)->name().find("_qr"));
+
+    // The user's cost model overrides the built-in one
+    selector.setCostModel([](const LinearSystemStructure&, const std::string& backend) { return backend == "block_cholesky" ? 1.0 : 10.0; });
+    EXPECT_EQ("block_cholesky", selector.select(chain.dvs, chain.errPtrs, true)->name());
+    selector.setCostModel(LinearSystemSolverSelector::CostModel());
+    EXPECT_EQ("sparse_cholesky", selector.select(chain.dvs, chain.errPtrs, true)->name());
+
+    // So do the options
+    selector.options().backend = "dense_qr";
+    EXPECT_EQ("dense_qr", selector.select(chain.dvs, chain.errPtrs, true)->name());
+    selector.options().backend = "unknown";
+    EXPECT_THROW(selector.select(chain.dvs, chain.errPtrs, true), std::exception);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSystemSolverSelectorTestSuite, testOptimizer2UsesTheSelectedSolver)
+{
+  try {
+    sm::random::seed(7);
+    Problem dense(8, true, 3);
+    std::vector<Eigen::Vector2d> initial;
+    boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem());
+    for (const auto& p : dense.points) {
+      initial.push_back(p->_v);
+      problem->addDesignVariable(p);
+    }
+    for (const auto& e : dense.errs)
+      problem->addErrorTerm(e);
+
+    Optimizer2Options options;
+    options.trustRegionPolicy.reset(new GaussNewtonTrustRegionPolicy());
+    options.linearSystemSolver.reset(new SparseCholeskyLinearSystemSolver());
+    options.maxIterations = 5;
+    {
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(problem);
+      optimizer.optimize();
+    }
+    std::vector<Eigen::Vector2d> solution;
+    for (size_t i = 0; i < dense.points.size(); ++i) {
+      solution.push_back(dense.points[i]->_v);
+      dense.points[i]->_v = initial[i];
+    }
+
+    options.linearSystemSolver.reset();
+    options.linearSystemSolverSelector.reset(new LinearSystemSolverSelector());
+    options.linearSystemSolverSelector->options().calibrate = true;
+    Optimizer2 optimizer(options);
+    // No solver is allocated before the selection
+    EXPECT_EQ(nullptr, optimizer.getBaseSolver());
+    optimizer.setProblem(problem);
+    optimizer.optimize();
+    const std::string& backend = options.linearSystemSolverSelector->lastDecision().backend;
+    EXPECT_EQ(backend, optimizer.getBaseSolver()->name());
+    // The solvers were timed
+    EXPECT_EQ(1u, options.linearSystemSolverSelector->lastDecision().costs.count(backend));
+    for (size_t i = 0; i < dense.points.size(); ++i)
+      sm::eigen::assertNear(dense.points[i]->_v, solution[i], 1e-6, SM_SOURCE_FILE_POS, "The selected solver found another solution");
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
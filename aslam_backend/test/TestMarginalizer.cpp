@@ -0,0 +1,121 @@
+#include <sm/eigen/gtest.hpp>
+#include <sm/random.hpp>
+
+#include <aslam/backend/Marginalizer.hpp>
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/JacobianContainerSparse.hpp>
+#include <Eigen/Dense>
+
+#include "SampleDvAndError.hpp"
+
+TEST(MarginalizerTestSuite, testPriorMatchesDenseSchurComplement)
+{
+  using namespace aslam::backend;
+  try {
+    const int D = 6;
+    const int E = 40;
+    const int numToRemove = 2;
+    const size_t numTopRowsInCov = 5;
+    srand(3);
+    sm::random::seed(3);
+    std::vector<DesignVariable*> dvs;
+    std::vector<ErrorTerm*> errs;
+    buildSystem(D, E, dvs, errs);
+
+    // Dense reference: the normal equations of the full problem.
+    DenseQrLinearSystemSolver qrSolver;
+    qrSolver.initMatrixStructure(dvs, errs, false);
+    qrSolver.evaluateError(1, false);
+    qrSolver.buildSystem(1, false);
+    const Eigen::MatrixXd J = qrSolver.getJacobian();
+    const Eigen::MatrixXd H = J.transpose() * J;
+    const Eigen::VectorXd g = J.transpose() * qrSolver.e();
+    const int nr = 2 * numToRemove;
+    const int nk = H.cols() - nr;
+    const Eigen::MatrixXd H11inv = H.topLeftCorner(nr, nr).inverse();
+    const Eigen::MatrixXd S = H.bottomRightCorner(nk, nk) - H.bottomLeftCorner(nk, nr) * H11inv * H.topRightCorner(nr, nk);
+    const Eigen::VectorXd gS = g.tail(nk) - H.bottomLeftCorner(nk, nr) * H11inv * g.head(nr);
+    const Eigen::MatrixXd Hinv = H.inverse();
+
+    for (size_t numThreads = 1; numThreads <= 4; numThreads += 3) {
+      boost::shared_ptr<MarginalizationPriorErrorTerm> prior;
+      Eigen::MatrixXd cov;
+      std::vector<DesignVariable*> dvsInCov;
+      marginalize(dvs, errs, numToRemove, false, prior, cov, dvsInCov, numTopRowsInCov, numThreads);
+      ASSERT_TRUE(prior.get() != nullptr);
+      ASSERT_EQ(D - numToRemove, prior->numDesignVariables());
+      ASSERT_EQ(3u, dvsInCov.size());
+
+      // The prior e(x) = -(d - R dx) has Jacobian R and error -d at the linearization point.
+      Eigen::VectorXd e;
+      prior->evaluateError();
+      prior->getWeightedError(e, false);
+      JacobianContainerSparse<Eigen::Dynamic> jc(prior->dimension());
+      prior->getWeightedJacobians(jc, false);
+      Eigen::MatrixXd R(prior->dimension(), nk);
+      for (int i = 0; i < prior->numDesignVariables(); ++i) {
+        DesignVariable* dv = prior->getDesignVariable(i);
+        R.middleCols(2 * i, dv->minimalDimensions()) = jc.Jacobian(dv);
+      }
+
+      sm::eigen::assertNear(R.transpose() * R, S, 1e-8, SM_SOURCE_FILE_POS, "R^T R must be the Schur complement");
+      sm::eigen::assertNear(R.transpose() * e, -gS, 1e-8, SM_SOURCE_FILE_POS, "R^T d must be the reduced right hand side");
+      sm::eigen::assertNear(cov, Hinv.topLeftCorner(numTopRowsInCov, numTopRowsInCov), 1e-8, SM_SOURCE_FILE_POS, "Covariance block mismatch");
+    }
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(MarginalizerTestSuite, testRankDeficientRemovedBlock)
+{
+  using namespace aslam::backend;
+  try {
+    srand(5);
+    sm::random::seed(5);
+    // p0 is only observed along one direction (equal Jacobian columns), so the Hessian block of the removed variable is singular.
+    Point2d p0(Eigen::Vector2d::Random()), p1(Eigen::Vector2d::Random()), p2(Eigen::Vector2d::Random());
+    LinearErr2 e01(&p0, &p1);
+    e01._J1 = Eigen::Vector2d::Random() * Eigen::RowVector2d::Ones();
+    LinearErr e1(&p1), e2(&p2);
+    LinearErr2 e12(&p1, &p2);
+    std::vector<DesignVariable*> dvs = { &p0, &p1, &p2 };
+    std::vector<ErrorTerm*> errs = { &e01, &e1, &e2, &e12 };
+
+    DenseQrLinearSystemSolver qrSolver;
+    qrSolver.initMatrixStructure(dvs, errs, false);
+    qrSolver.evaluateError(1, false);
+    qrSolver.buildSystem(1, false);
+    const Eigen::MatrixXd J = qrSolver.getJacobian();
+    const Eigen::MatrixXd H = J.transpose() * J;
+    const Eigen::VectorXd g = J.transpose() * qrSolver.e();
+    const Eigen::JacobiSVD<Eigen::MatrixXd> svd11(H.topLeftCorner(2, 2), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::MatrixXd S = H.bottomRightCorner(4, 4) - H.bottomLeftCorner(4, 2) * svd11.solve(H.topRightCorner(2, 4));
+    const Eigen::VectorXd gS = g.tail(4) - H.bottomLeftCorner(4, 2) * svd11.solve(g.head(2));
+
+    boost::shared_ptr<MarginalizationPriorErrorTerm> prior;
+    Eigen::MatrixXd cov;
+    std::vector<DesignVariable*> dvsInCov;
+    marginalize(dvs, errs, 1, false, prior, cov, dvsInCov);
+    ASSERT_TRUE(prior.get() != nullptr);
+
+    Eigen::VectorXd e;
+    prior->evaluateError();
+    prior->getWeightedError(e, false);
+    JacobianContainerSparse<Eigen::Dynamic> jc(prior->dimension());
+    prior->getWeightedJacobians(jc, false);
+    Eigen::MatrixXd R(prior->dimension(), 4);
+    R.leftCols(2) = jc.Jacobian(&p1);
+    R.rightCols(2) = jc.Jacobian(&p2);
+    ASSERT_TRUE(R.allFinite());
+    ASSERT_TRUE(e.allFinite());
+    sm::eigen::assertNear(R.transpose() * R, S, 1e-8, SM_SOURCE_FILE_POS, "R^T R must be the Schur complement");
+    sm::eigen::assertNear(R.transpose() * e, -gS, 1e-8, SM_SOURCE_FILE_POS, "R^T d must be the reduced right hand side");
+
+    // The full Hessian is singular as well, so its covariance is undefined.
+    EXPECT_THROW(marginalize(dvs, errs, 1, false, prior, cov, dvsInCov, 2), aslam::Exception);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -193,3 +193,72 @@ TEST(OptimizationProblemTestSuite,  testAddRemoveErrorTerm1)
   ASSERT_EQ(1, (int)et2.count(&et21));
   ASSERT_EQ(1, (int)et2.count(&et22));
 }
+
+
+TEST(OptimizationProblemTestSuite, testAddTwice)
+{
+  OptimizationProblem op;
+  Dv dv1;
+  Et1 et1(&dv1);
+  op.addDesignVariable(&dv1, false);
+  ASSERT_THROW(op.addDesignVariable(&dv1, false), std::runtime_error);
+  ASSERT_EQ(1, (int)op.numDesignVariables());
+  op.addErrorTerm(&et1, false);
+  ASSERT_THROW(op.addErrorTerm(&et1, false), std::runtime_error);
+  ASSERT_EQ(1, (int)op.numErrorTerms());
+}
+
+
+TEST(OptimizationProblemTestSuite, testAddRangeAndRemove)
+{
+  const int n = 100;
+  std::vector< boost::shared_ptr<Dv> > dvs;
+  std::vector< boost::shared_ptr<Et2> > ets;
+  for (int i = 0; i < n; ++i) {
+    dvs.push_back(boost::shared_ptr<Dv>(new Dv));
+    if (i > 0)
+      ets.push_back(boost::shared_ptr<Et2>(new Et2(dvs[i-1].get(), dvs[i].get())));
+  }
+
+  OptimizationProblem op;
+  op.reserve(n, n - 1);
+  op.addDesignVariables(dvs.begin(), dvs.end());
+  op.addErrorTerms(ets.begin(), ets.end());
+  ASSERT_EQ(n, (int)op.numDesignVariables());
+  ASSERT_EQ(n - 1, (int)op.numErrorTerms());
+
+  // Removing a design variable in the middle removes the two error terms touching it
+  const int k = n / 2;
+  op.removeDesignVariable(dvs[k].get());
+  ASSERT_EQ(n - 1, (int)op.numDesignVariables());
+  ASSERT_EQ(n - 3, (int)op.numErrorTerms());
+  ASSERT_FALSE(op.isDesignVariableInProblem(dvs[k].get()));
+  ASSERT_FALSE(op.isErrorTermInProblem(ets[k-1].get()));
+  ASSERT_FALSE(op.isErrorTermInProblem(ets[k].get()));
+
+  // The remaining design variables and error terms are still indexed correctly
+  std::set<const DesignVariable*> remaining;
+  for (size_t i = 0; i < op.numDesignVariables(); ++i)
+    remaining.insert(op.designVariable(i));
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(i != k, op.isDesignVariableInProblem(dvs[i].get()));
+    ASSERT_EQ(i != k ? 1u : 0u, remaining.count(dvs[i].get()));
+  }
+  std::set<ErrorTerm*> errors;
+  op.getErrors(dvs[k-1].get(), errors);
+  ASSERT_EQ(1, (int)errors.size());
+  ASSERT_EQ(1, (int)errors.count(ets[k-2].get()));
+  errors.clear();
+  op.getErrors(dvs[k+1].get(), errors);
+  ASSERT_EQ(1, (int)errors.size());
+  ASSERT_EQ(1, (int)errors.count(ets[k+1].get()));
+
+  while (op.numErrorTerms() > 0) {
+    ASSERT_TRUE(op.isErrorTermInProblem(op.errorTerm(0)));
+    op.removeErrorTerm(op.errorTerm(0));
+  }
+  ASSERT_EQ(0, (int)op.numErrorTerms());
+  errors.clear();
+  op.getErrors(dvs[0].get(), errors);
+  ASSERT_EQ(0, (int)errors.size());
+}
@@ -11,6 +11,8 @@
 #include <aslam/backend/LineSearchTrustRegionPolicy.hpp>
 #include <aslam/backend/SparseQrLinearSystemSolver.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <chrono>
+#include <thread>
 #include <aslam/backend/test/ErrorTermTester.hpp>
 
 #include "SampleDvAndError.hpp"
@@ -74,3 +76,183 @@ TEST(Optimizer2TestSuite, compareAllCombinationsOfSolversAndTrustRegionPolicies)
     FAIL() << e.what();
   }
 }
+
+TEST(Optimizer2TestSuite, testCovarianceBlocksMatchDenseInverse)
+{
+  using namespace aslam::backend;
+  const int D = 6;
+  const int E = 30;
+  const int seed = 2;
+  try {
+    boost::shared_ptr<OptimizationProblem> problem = buildProblem(seed, D, E);
+    Optimizer2Options options;
+    options.linearSystemSolver.reset(new SparseCholeskyLinearSystemSolver());
+    options.trustRegionPolicy.reset(new GaussNewtonTrustRegionPolicy());
+    options.maxIterations = 3;
+    options.numThreadsJacobian = 3;
+    Optimizer2 optimizer(options);
+    optimizer.setProblem(problem);
+    optimizer.optimize();
+
+    // The Hessian is relinearized at the current state for every lambda
+    for (double lambda : {0.0, 0.5}) {
+      SparseBlockMatrix H;
+      optimizer.computeHessian(H, lambda);
+      const Eigen::MatrixXd P = Eigen::MatrixXd(H.toDense().selfadjointView<Eigen::Upper>()).inverse();
+
+      SparseBlockMatrix covariance;
+      optimizer.computeCovariances(covariance, lambda);
+      for (int r = 0; r < D; ++r) {
+        for (int c = r; c < D; ++c) {
+          const Eigen::MatrixXd* block = covariance.block(r, c);
+          ASSERT_TRUE(block != nullptr);
+          sm::eigen::assertNear(*block, P.block(2 * r, 2 * c, 2, 2), 1e-8, SM_SOURCE_FILE_POS, "Covariance block mismatch");
+        }
+      }
+
+      SparseBlockMatrix diagonal;
+      optimizer.computeDiagonalCovariances(diagonal, lambda);
+      for (int r = 0; r < D; ++r) {
+        ASSERT_TRUE(diagonal.block(r, r) != nullptr);
+        sm::eigen::assertNear(*diagonal.block(r, r), P.block(2 * r, 2 * r, 2, 2), 1e-8, SM_SOURCE_FILE_POS, "Diagonal covariance block mismatch");
+        if (r + 1 < D)
+          ASSERT_TRUE(diagonal.block(r, r + 1) == nullptr);
+      }
+    }
+
+    // Stopped before the update is applied, the factor of the last solve is reused at the current state
+    {
+      Optimizer2 stopped(options);
+      stopped.setProblem(buildProblem(seed, D, E));
+      stopped.callback().add<callback::event::LINEAR_SYSTEM_SOLVED>([]() { return callback::ProceedInstruction::SUCCEED; });
+      stopped.optimize();
+      SparseBlockMatrix H;
+      stopped.computeHessian(H, 0.0);
+      const Eigen::MatrixXd P = Eigen::MatrixXd(H.toDense().selfadjointView<Eigen::Upper>()).inverse();
+      SparseBlockMatrix covariance;
+      stopped.computeCovariances(covariance, 0.0);
+      for (int r = 0; r < D; ++r) {
+        for (int c = r; c < D; ++c) {
+          const Eigen::MatrixXd* block = covariance.block(r, c);
+          ASSERT_TRUE(block != nullptr);
+          sm::eigen::assertNear(*block, P.block(2 * r, 2 * c, 2, 2), 1e-8, SM_SOURCE_FILE_POS, "Covariance block mismatch");
+        }
+      }
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(Optimizer2TestSuite, testProceedInstructionsAndTimeLimit)
+{
+  using namespace aslam::backend;
+  using namespace aslam::backend::callback;
+  try {
+    Optimizer2Options options;
+    options.linearSystemSolver.reset(new DenseQrLinearSystemSolver());
+    options.trustRegionPolicy.reset(new LevenbergMarquardtTrustRegionPolicy());
+    options.maxIterations = 100;
+    options.convergenceDeltaX = 1e-300;
+    options.convergenceDeltaError = 1e-300;
+
+    // A callback stops after the second solution, before the update is applied
+    {
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(buildProblem(1, 4, 20));
+      int numSolved = 0;
+      optimizer.callback().add<event::LINEAR_SYSTEM_SOLVED>([&]() {
+        return ++numSolved == 2 ? ProceedInstruction::SUCCEED : ProceedInstruction::CONTINUE;
+      });
+      SolutionReturnValue srv = optimizer.optimize();
+      EXPECT_EQ(2, numSolved);
+      EXPECT_EQ(1, srv.iterations);
+      EXPECT_EQ(STOPPED, optimizer.getStatus().convergence);
+      EXPECT_TRUE(optimizer.getStatus().success());
+      EXPECT_LE(srv.JFinal, srv.JStart);
+      EXPECT_DOUBLE_EQ(srv.JFinal, optimizer.evaluateError(true));
+    }
+    {
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(buildProblem(1, 4, 20));
+      optimizer.callback().add<event::COST_UPDATED>([]() { return ProceedInstruction::FAIL; });
+      SolutionReturnValue srv = optimizer.optimize();
+      EXPECT_EQ(0, srv.iterations);
+      EXPECT_EQ(FAILURE, optimizer.getStatus().convergence);
+    }
+
+    // The time is up within the first iteration, the initial state is kept
+    options.timeLimit = 0.01;
+    {
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(buildProblem(1, 4, 20));
+      optimizer.callback().add<event::LINEAR_SYSTEM_SOLVED>([]() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+      SolutionReturnValue srv = optimizer.optimize();
+      EXPECT_EQ(0, srv.iterations);
+      EXPECT_EQ(TIME_LIMIT, optimizer.getStatus().convergence);
+      EXPECT_DOUBLE_EQ(srv.JStart, srv.JFinal);
+      EXPECT_DOUBLE_EQ(srv.JStart, optimizer.evaluateError(true));
+    }
+
+    // No iteration is started which is not expected to finish in time
+    options.timeLimit = 0.07;
+    {
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(buildProblem(1, 4, 20));
+      optimizer.callback().add<event::LINEAR_SYSTEM_SOLVED>([]() { std::this_thread::sleep_for(std::chrono::milliseconds(40)); });
+      SolutionReturnValue srv = optimizer.optimize();
+      EXPECT_EQ(TIME_LIMIT, optimizer.getStatus().convergence);
+      EXPECT_EQ(1, srv.iterations);
+      EXPECT_GE(optimizer.getStatus().iterationTime, 0.04);
+      EXPECT_LE(srv.JFinal, srv.JStart);
+      // The solver is usable without the deadline afterwards
+      EXPECT_NO_THROW(optimizer.evaluateError(true));
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(Optimizer2TestSuite, testSpeculativeLevenbergMarquardt)
+{
+  using namespace aslam::backend;
+  using namespace aslam::backend::callback;
+  try {
+    Optimizer2Options options;
+    options.maxIterations = 100;
+    options.convergenceDeltaX = 1e-8;
+    options.convergenceDeltaError = 1e-12;
+
+    // Strong initial damping takes many short steps
+    std::vector<SolutionReturnValue> results;
+    for (int numLambdas : {1, 3}) {
+      boost::shared_ptr<LevenbergMarquardtTrustRegionPolicy> policy(new LevenbergMarquardtTrustRegionPolicy(100.0));
+      policy->setNumSpeculativeLambdas(numLambdas);
+      options.trustRegionPolicy = policy;
+      options.linearSystemSolver.reset(new DenseQrLinearSystemSolver());
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(buildProblem(3, 4, 20));
+      int numCostUpdates = 0;
+      optimizer.callback().add<event::COST_UPDATED>([&]() { ++numCostUpdates; });
+      results.push_back(optimizer.optimize());
+      EXPECT_TRUE(optimizer.getStatus().success());
+      // The trial steps issue no callbacks and leave the state as it was
+      EXPECT_EQ(1 + results.back().iterations, numCostUpdates);
+      // The step returned after its trial is not evaluated again
+      const size_t numErrorEvaluations = optimizer.getStatus().numErrorEvaluations;
+      if (numLambdas == 1)
+        EXPECT_EQ(size_t(1 + results.back().iterations), numErrorEvaluations);
+      else
+        EXPECT_LT(numErrorEvaluations, size_t(1 + results.back().iterations * (numLambdas + 1)));
+      EXPECT_DOUBLE_EQ(results.back().JFinal, optimizer.evaluateError(true));
+    }
+    EXPECT_LT(results[1].iterations, results[0].iterations);
+    EXPECT_NEAR(results[0].JFinal, results[1].JFinal, 1e-6);
+
+    LevenbergMarquardtTrustRegionPolicy policy;
+    EXPECT_THROW(policy.setNumSpeculativeLambdas(0), std::exception);
+    EXPECT_THROW(policy.setSpeculativeLambdaFactor(1.0), std::exception);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -0,0 +1,134 @@
+#include <sm/eigen/gtest.hpp>
+#include <sm/random.hpp>
+
+#include <aslam/backend/SlidingWindowProblem.hpp>
+#include <aslam/backend/OptimizationProblem.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "SampleDvAndError.hpp"
+
+TEST(SlidingWindowProblemTestSuite, testMarginalizationMatchesBatchSolution)
+{
+  using namespace aslam::backend;
+  try {
+    srand(8);
+    sm::random::seed(8);
+    const int N = 16;
+    const int W = 4;
+    // A chain with an absolute and a relative linear error term per state
+    std::vector< boost::shared_ptr<Point2d> > points;
+    std::vector< std::vector< boost::shared_ptr<ErrorTerm> > > errs(N);
+    std::vector<Eigen::Vector2d> initial;
+    for (int i = 0; i < N; ++i) {
+      points.emplace_back(new Point2d(Eigen::Vector2d::Random()));
+      initial.push_back(points.back()->_v);
+      errs[i].emplace_back(new LinearErr(points[i].get()));
+      if (i > 0)
+        errs[i].emplace_back(new LinearErr2(points[i - 1].get(), points[i].get()));
+    }
+
+    Optimizer2Options options;
+    options.trustRegionPolicy.reset(new GaussNewtonTrustRegionPolicy());
+    options.linearSystemSolver.reset(new SparseCholeskyLinearSystemSolver());
+    options.convergenceDeltaX = 1e-10;
+    options.maxIterations = 5;
+
+    // The batch solution over all states
+    boost::shared_ptr<OptimizationProblem> batch(new OptimizationProblem());
+    for (int i = 0; i < N; ++i) {
+      batch->addDesignVariable(points[i]);
+      for (const auto& err : errs[i])
+        batch->addErrorTerm(err);
+    }
+    Optimizer2 optimizer(options);
+    optimizer.setProblem(batch);
+    optimizer.optimize();
+    std::vector<Eigen::Vector2d> solution;
+    for (int i = 0; i < N; ++i) {
+      solution.push_back(points[i]->_v);
+      points[i]->_v = initial[i];
+    }
+
+    // The problem is linear, so the marginalization is exact and the window ends up at the batch solution
+    options.trustRegionPolicy.reset(new GaussNewtonTrustRegionPolicy());
+    options.linearSystemSolver.reset(new SparseCholeskyLinearSystemSolver());
+    SlidingWindowProblem window(options);
+    for (int i = 0; i < N; ++i) {
+      window.addDesignVariable(points[i]);
+      for (const auto& err : errs[i])
+        window.addErrorTerm(err);
+      if (i >= W) {
+        window.markForRemoval(points[i - W].get());
+        window.slide();
+        const SlidingWindowProblem::Statistics& statistics = window.statistics();
+        EXPECT_EQ(1u, statistics.numMarginalizedDesignVariables);
+        // The previous prior is replaced
+        EXPECT_EQ(i == W ? 2u : 3u, statistics.numMarginalizedErrorTerms);
+        EXPECT_EQ(2u, statistics.priorDimension);
+        EXPECT_EQ(1u, window.priors().size());
+        EXPECT_FALSE(window.isDesignVariableInProblem(points[i - W].get()));
+        ASSERT_EQ(size_t(W), window.numDesignVariables());
+        ASSERT_EQ(size_t(2 * W), window.numErrorTerms());
+      }
+      window.optimize();
+      // From the second slide on the window has the same structure after every slide
+      EXPECT_EQ(i > W, window.statistics().structureReused) << i;
+    }
+    for (int i = N - W; i < N; ++i)
+      sm::eigen::assertNear(points[i]->_v, solution[i], 1e-6, SM_SOURCE_FILE_POS, "The window differs from the batch solution");
+
+    const SparseCholeskyLinearSystemSolver* solver = dynamic_cast<const SparseCholeskyLinearSystemSolver*>(window.optimizer().getBaseSolver());
+    ASSERT_TRUE(solver != nullptr);
+    EXPECT_EQ(size_t(N - W - 1), solver->numStructureReuses());
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(SlidingWindowProblemTestSuite, testWindowBookkeeping)
+{
+  using namespace aslam::backend;
+  try {
+    SlidingWindowProblem window;
+    boost::shared_ptr<Point2d> p0(new Point2d(Eigen::Vector2d::Zero()));
+    boost::shared_ptr<Point2d> p1(new Point2d(Eigen::Vector2d::Ones()));
+    boost::shared_ptr<Point2d> outside(new Point2d(Eigen::Vector2d::Ones()));
+    window.addDesignVariable(p0);
+    window.addDesignVariable(p1);
+    EXPECT_THROW(window.addDesignVariable(p0), std::exception);
+    EXPECT_THROW(window.addErrorTerm(boost::shared_ptr<ErrorTerm>(new LinearErr2(p1.get(), outside.get()))), std::exception);
+    EXPECT_THROW(window.markForRemoval(outside.get()), std::exception);
+
+    boost::shared_ptr<ErrorTerm> e0(new LinearErr(p0.get()));
+    boost::shared_ptr<ErrorTerm> e1(new LinearErr2(p0.get(), p1.get()));
+    window.addErrorTerm(e0);
+    window.addErrorTerm(e1);
+    std::set<ErrorTerm*> p1Errors;
+    window.getErrors(p1.get(), p1Errors);
+    EXPECT_EQ(1u, p1Errors.size());
+
+    // Nothing to marginalize
+    window.slide();
+    EXPECT_EQ(2u, window.numErrorTerms());
+    EXPECT_EQ(0u, window.statistics().numMarginalizedDesignVariables);
+
+    window.markForRemoval(p0.get());
+    EXPECT_TRUE(window.isMarkedForRemoval(p0.get()));
+    EXPECT_THROW(window.addErrorTerm(boost::shared_ptr<ErrorTerm>(new LinearErr(p0.get()))), std::exception);
+    window.slide();
+    EXPECT_FALSE(window.isMarkedForRemoval(p0.get()));
+    EXPECT_FALSE(window.isErrorTermInProblem(e0.get()));
+    EXPECT_FALSE(window.isErrorTermInProblem(e1.get()));
+    ASSERT_EQ(1u, window.numErrorTerms());
+    ASSERT_EQ(1u, window.priors().size());
+    EXPECT_EQ(window.priors().front().get(), window.errorTerm(0));
+    ASSERT_EQ(1, window.priors().front()->numDesignVariables());
+    EXPECT_EQ(p1.get(), window.priors().front()->getDesignVariable(0));
+    p1Errors.clear();
+    window.getErrors(p1.get(), p1Errors);
+    EXPECT_EQ(1u, p1Errors.count(window.priors().front().get()));
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -8,6 +8,8 @@
 
 namespace aslam {
   namespace backend {
+    /// \brief A vector design variable stored in external memory.
+    ///        Call invalidateCache() after writing to that memory directly, e.g. through data().
     template<int D>
     class DesignVariableMappedVector : public DesignVariable, public VectorExpressionNode<D>
     {
@@ -10,6 +10,7 @@
 #include <Eigen/Core>
 #include <sm/kinematics/RotationalKinematics.hpp>
 #include <aslam/backend/VectorExpressionNode.hpp>
+#include <aslam/backend/ValueCacheStamp.hpp>
 
 namespace aslam {
   namespace backend {
@@ -37,14 +38,15 @@ namespace aslam {
       ~EuclideanExpressionNodeMultiply() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Vector3d evaluateImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
 
       boost::shared_ptr<RotationExpressionNode> _lhs;
-      mutable Eigen::Matrix3d _C_lhs;
       boost::shared_ptr<EuclideanExpressionNode> _rhs;
-      mutable Eigen::Vector3d _p_rhs;
+      mutable Eigen::Vector3d _p;
+      mutable internal::ValueCacheStamp _valueStamp;
 
 
     };
@@ -70,9 +72,9 @@ namespace aslam {
        void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
 
        boost::shared_ptr<MatrixExpressionNode> _lhs;
-       mutable Eigen::Matrix3d _A_lhs;
        boost::shared_ptr<EuclideanExpressionNode> _rhs;
-       mutable Eigen::Vector3d _p_rhs;
+       mutable Eigen::Vector3d _p;
+       mutable internal::ValueCacheStamp _valueStamp;
 
      };
 
@@ -94,6 +96,7 @@ namespace aslam {
        ~EuclideanExpressionNodeCrossEuclidean() override;
 
      private:
+       friend class ExpressionTapeCompiler;
        Eigen::Vector3d evaluateImplementation() const override;
        void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
        void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -119,6 +122,7 @@ namespace aslam {
         ~EuclideanExpressionNodeAddEuclidean() override;
 
       private:
+        friend class ExpressionTapeCompiler;
         Eigen::Vector3d evaluateImplementation() const override;
         void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
         void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -144,6 +148,7 @@ namespace aslam {
        ~EuclideanExpressionNodeSubtractEuclidean() override;
 
      private:
+       friend class ExpressionTapeCompiler;
        Eigen::Vector3d evaluateImplementation() const override;
        void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
        void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -166,8 +171,9 @@ namespace aslam {
        EuclideanExpressionNodeConstant(const Eigen::Vector3d & p);
        ~EuclideanExpressionNodeConstant() override;
 
-         void set(const Eigen::Vector3d & p){ _p = p; }
+         void set(const Eigen::Vector3d & p){ DesignVariable::invalidateConstants(); _p = p; }
      private:
+       friend class ExpressionTapeCompiler;
          Eigen::Vector3d evaluateImplementation() const override;
          void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
          void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -191,6 +197,7 @@ namespace aslam {
        ~EuclideanExpressionNodeSubtractVector() override;
 
      private:
+       friend class ExpressionTapeCompiler;
        Eigen::Vector3d evaluateImplementation() const override;
        void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
        void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -215,6 +222,7 @@ namespace aslam {
         ~EuclideanExpressionNodeNegated() override;
 
       private:
+        friend class ExpressionTapeCompiler;
         Eigen::Vector3d evaluateImplementation() const override;
         void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
         void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -254,6 +262,7 @@ namespace aslam {
         ~EuclideanExpressionNodeTranslation() override;
 
       private:
+        friend class ExpressionTapeCompiler;
         Eigen::Vector3d evaluateImplementation() const override;
         void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
         void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -289,6 +298,7 @@ namespace aslam {
         ~EuclideanExpressionNodeFromHomogeneous() override;
 
       private:
+        friend class ExpressionTapeCompiler;
         Eigen::Vector3d evaluateImplementation() const override;
         void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
         void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -312,6 +322,7 @@ namespace aslam {
        ~EuclideanExpressionNodeElementwiseMultiplyEuclidean() override;
 
      private:
+       friend class ExpressionTapeCompiler;
        Eigen::Vector3d evaluateImplementation() const override;
        void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
        void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
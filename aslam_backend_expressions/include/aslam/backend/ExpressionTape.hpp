@@ -0,0 +1,217 @@
+#ifndef INCLUDE_ASLAM_BACKEND_EXPRESSIONTAPE_HPP_
+#define INCLUDE_ASLAM_BACKEND_EXPRESSIONTAPE_HPP_
+
+// standard includes
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+// Eigen includes
+#include <Eigen/Core>
+
+// self includes
+#include <aslam/backend/JacobianContainer.hpp>
+#include <aslam/backend/EuclideanExpression.hpp>
+#include <aslam/backend/EuclideanExpressionNode.hpp>
+#include <aslam/backend/RotationExpressionNode.hpp>
+#include <aslam/backend/HomogeneousExpressionNode.hpp>
+#include <aslam/backend/TransformationExpressionNode.hpp>
+
+namespace aslam {
+namespace backend {
+
+  /**
+   * \class ExpressionTape
+   * \brief A flat, topologically ordered program of typed operations compiled
+   *        from an expression DAG
+   *
+   * The tape only holds the structure of an expression. The values of the
+   * leaves (design variables and all nodes the compiler does not know) and of
+   * the constants are bound per instance by a CompiledEuclideanExpression.
+   * All expressions with the same structure can therefore share one tape.
+   *
+   * Every slot holds a 3x1 Euclidean vector, a 3x3 rotation matrix, a 4x1
+   * homogeneous point or a 4x4 transformation matrix. The Jacobians are
+   * accumulated in a single reverse sweep over the tape: the adjoint of a slot
+   * is the 3xd derivative of the result with respect to the d dimensional
+   * tangent space of the slot (3, 3, 4 and 6 respectively). A subexpression
+   * referenced along many paths owns one slot, so its adjoint is summed up
+   * before it is propagated further and every leaf is asked for its Jacobians
+   * exactly once, no matter how much the DAG fans out.
+   */
+  class ExpressionTape
+  {
+   public:
+    enum class OpCode : uint8_t {
+      EuclideanLeaf,            /// \brief out = leaf->evaluate()
+      RotationLeaf,             /// \brief out = leaf->toRotationMatrix()
+      RotateEuclidean,          /// \brief out = C(lhs) * p(rhs)
+      CrossEuclidean,           /// \brief out = p(lhs) x p(rhs)
+      AddEuclidean,             /// \brief out = p(lhs) + p(rhs)
+      SubtractEuclidean,        /// \brief out = p(lhs) - p(rhs)
+      NegateEuclidean,          /// \brief out = -p(lhs)
+      ElementwiseMultiplyEuclidean, /// \brief out = p(lhs) .* p(rhs)
+      MultiplyRotation,         /// \brief out = C(lhs) * C(rhs)
+      InverseRotation,          /// \brief out = C(lhs)^T
+      HomogeneousLeaf,          /// \brief out = leaf->toHomogeneous()
+      TransformationLeaf,       /// \brief out = leaf->toTransformationMatrix()
+      TransformHomogeneous,     /// \brief out = T(lhs) * ph(rhs)
+      HomogeneousFromEuclidean, /// \brief out = [p(lhs); 1]
+      EuclideanFromHomogeneous, /// \brief out = ph(lhs)[0:3] / ph(lhs)[3]
+      TranslationOfTransformation, /// \brief out = t of T(lhs)
+      RotationOfTransformation, /// \brief out = C of T(lhs)
+      ComposeTransformation,    /// \brief out = [C(lhs) p(rhs); 0 1]
+      MultiplyTransformation,   /// \brief out = T(lhs) * T(rhs)
+      InverseTransformation     /// \brief out = T(lhs)^-1
+    };
+
+    enum class SlotType : uint8_t {
+      Euclidean,
+      Rotation,
+      Homogeneous,
+      Transformation
+    };
+
+    struct Instruction {
+      OpCode op;
+      int out;  /// \brief Output slot
+      int lhs;  /// \brief First operand slot, or the leaf index for leaf operations
+      int rhs;  /// \brief Second operand slot, -1 for unary operations
+    };
+
+    /// \brief Number of instructions
+    std::size_t numInstructions() const { return _instructions.size(); }
+
+    /// \brief Number of value slots
+    std::size_t numSlots() const { return _slotTypes.size(); }
+
+    /// \brief Number of leaves an instance has to bind
+    std::size_t numLeaves() const { return _numEuclideanLeaves + _numRotationLeaves + _numHomogeneousLeaves + _numTransformationLeaves; }
+
+    /// \brief Number of doubles needed to store the values of all slots
+    std::size_t numValues() const { return _numValues; }
+
+    /// \brief Number of doubles needed to store the adjoints of all slots
+    std::size_t numAdjoints() const { return _numAdjoints; }
+
+    /// \brief The key identifying the structure of the tape
+    const std::string & structureKey() const { return _structureKey; }
+
+   private:
+    friend class ExpressionTapeCompiler;
+    friend class CompiledEuclideanExpression;
+
+    std::vector<Instruction> _instructions; /// \brief The instructions in topological order
+    std::vector<SlotType> _slotTypes; /// \brief The type of each slot
+    std::vector<int> _slotOffsets; /// \brief Offset of each slot into the value array
+    std::vector<int> _adjointOffsets; /// \brief Offset of each slot into the adjoint array
+    std::vector<bool> _needsAdjoint; /// \brief Whether a slot depends on at least one leaf
+    std::vector<int> _constantSlots; /// \brief The slots holding constants, in binding order
+    std::size_t _numValues = 0;
+    std::size_t _numAdjoints = 0;
+    std::size_t _numEuclideanLeaves = 0;
+    std::size_t _numRotationLeaves = 0;
+    std::size_t _numHomogeneousLeaves = 0;
+    std::size_t _numTransformationLeaves = 0;
+    int _resultSlot = -1;
+    std::string _structureKey;
+  };
+
+  /**
+   * \class CompiledEuclideanExpression
+   * \brief A Euclidean expression evaluated through a compiled ExpressionTape
+   *
+   * Behaves like an EuclideanExpression and can e.g. be passed to
+   * toErrorTerm(). The value and adjoint slots are preallocated per instance,
+   * so an instance must not be evaluated concurrently from several threads.
+   */
+  class CompiledEuclideanExpression
+  {
+   public:
+    typedef Eigen::Vector3d value_t;
+    typedef Eigen::Vector3d vector_t;
+    static constexpr const int Dimension = 3;
+
+    /// \brief Evaluate the expression
+    vector_t evaluate() const;
+    vector_t toValue() const { return evaluate(); }
+
+    /// \brief Evaluate the Jacobians
+    void evaluateJacobians(JacobianContainer & outJacobians) const;
+
+    /// \brief Evaluate the Jacobians and apply the chain rule.
+    template <typename DERIVED>
+    EIGEN_ALWAYS_INLINE void evaluateJacobians(JacobianContainer & outJacobians, const Eigen::MatrixBase<DERIVED> & applyChainRule) const {
+      evaluateJacobians(outJacobians.apply(applyChainRule));
+    }
+
+    void getDesignVariables(DesignVariable::set_t & designVariables) const;
+
+    /// \brief The interpreted expression this instance was compiled from
+    const EuclideanExpression & expression() const { return _expression; }
+
+    /// \brief The tape shared by all expressions with the same structure
+    boost::shared_ptr<const ExpressionTape> tape() const { return _tape; }
+
+   private:
+    friend class ExpressionTapeCompiler;
+
+    /// \brief Run the forward pass over the tape
+    void forward() const;
+
+    EuclideanExpression _expression; /// \brief Keeps the nodes alive
+    boost::shared_ptr<const ExpressionTape> _tape;
+    std::vector< boost::shared_ptr<EuclideanExpressionNode> > _euclideanLeaves;
+    std::vector< boost::shared_ptr<RotationExpressionNode> > _rotationLeaves;
+    std::vector< boost::shared_ptr<HomogeneousExpressionNode> > _homogeneousLeaves;
+    std::vector< boost::shared_ptr<TransformationExpressionNode> > _transformationLeaves;
+    mutable std::vector<double> _values; /// \brief Slot values, constants are written once at binding time
+    mutable std::vector<double> _adjoints; /// \brief 3xd adjoint per slot, column major
+  };
+
+  /**
+   * \class ExpressionTapeCompiler
+   * \brief Compiles expression DAGs into ExpressionTapes and shares the tapes
+   *        between all expressions with the same structure
+   *
+   * Euclidean, rotation, homogeneous and transformation nodes with a known
+   * operation are flattened into instructions, constant nodes are folded into
+   * constant slots. Every other
+   * node, in particular all design variables, becomes a leaf which is
+   * evaluated through its virtual interface.
+   */
+  class ExpressionTapeCompiler
+  {
+   public:
+    /// \brief Compile \p expression, reusing a cached tape if one with the same structure exists
+    CompiledEuclideanExpression compile(const EuclideanExpression & expression);
+
+    /// \brief Number of distinct tapes compiled so far
+    std::size_t numTapes() const;
+
+    /// \brief Drop all cached tapes. Already compiled expressions keep theirs.
+    void clear();
+
+   private:
+    struct Context;
+    int compileEuclidean(const boost::shared_ptr<EuclideanExpressionNode> & node, Context & context) const;
+    int compileRotation(const boost::shared_ptr<RotationExpressionNode> & node, Context & context) const;
+    int compileHomogeneous(const boost::shared_ptr<HomogeneousExpressionNode> & node, Context & context) const;
+    int compileTransformation(const boost::shared_ptr<TransformationExpressionNode> & node, Context & context) const;
+
+    std::map< std::string, boost::shared_ptr<const ExpressionTape> > _tapes; /// \brief Tapes indexed by structure key
+    mutable boost::mutex _mutex; /// \brief Protects \p _tapes
+  };
+
+  /// \brief Compile a single expression without sharing its tape
+  CompiledEuclideanExpression compileExpression(const EuclideanExpression & expression);
+
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_EXPRESSIONTAPE_HPP_ */
@@ -1,5 +1,7 @@
 #ifndef ASLAM_BACKEND_GENERIC_MATRIX_EXPRESSION_NODE_HPP
 #define ASLAM_BACKEND_GENERIC_MATRIX_EXPRESSION_NODE_HPP
+#include <aslam/backend/DesignVariable.hpp>
+#include <aslam/backend/ValueCacheStamp.hpp>
 #include <aslam/backend/JacobianContainer.hpp>
 #include <aslam/backend/Differential.hpp>
 
@@ -22,16 +24,14 @@ class GenericMatrixExpressionNode {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
  protected:
   mutable matrix_t _currentValue;
-  mutable bool _valueDirty;
+  mutable internal::ValueCacheStamp _valueStamp;
 
   inline GenericMatrixExpressionNode(const matrix_t & value)
-      : _currentValue(value),
-        _valueDirty(false) {
+      : _currentValue(value) {
   }
  public:
-  GenericMatrixExpressionNode(int rows = IRows, int cols = ICols, bool valueDirty = true)
-      : _currentValue(rows, cols),
-        _valueDirty(valueDirty) {
+  GenericMatrixExpressionNode(int rows = IRows, int cols = ICols)
+      : _currentValue(rows, cols) {
   }
   virtual ~GenericMatrixExpressionNode() {
   }
@@ -42,13 +42,11 @@ class GenericMatrixExpressionNode {
   inline const matrix_t & getCurrentValue() const {
     return _currentValue;
   }
+  /// \brief Evaluate the value. It is recomputed only if one of the design variables
+  ///        the node depends on changed or the node was invalidated.
   inline const matrix_t & evaluate() const {
-    evaluateImplementation();
-    /* TODO activate value caching again.
-    if (!isConstant() && _valueDirty) {
-      evaluateImplementation();
-      _valueDirty = false;
-    };*/
+    if (!isConstant())
+      _valueStamp.update(*this, [this]() { evaluateImplementation(); });
     return _currentValue;
   }
 
@@ -71,8 +69,10 @@ class GenericMatrixExpressionNode {
     return isConstantImplementation();
   }
 
+  /// \brief Force recomputing the value, e.g. if it depends on state that is not a design variable.
+  ///        Nodes that cached a value computed from this node are not invalidated.
   void inline invalidate() {
-    _valueDirty = true;
+    _valueStamp.invalidate();
   }
 
  protected:
@@ -96,7 +96,7 @@ class ConstantGenericMatrixExpressionNode : public GenericMatrixExpressionNode<I
       : base_t(value) {
   }
   ConstantGenericMatrixExpressionNode(int rows = IRows, int cols = ICols)
-      : base_t(rows, cols, false) {
+      : base_t(rows, cols) {
   }
  protected:
   virtual bool isConstantImplementation() const {
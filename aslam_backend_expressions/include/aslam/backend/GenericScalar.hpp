@@ -29,7 +29,7 @@ class GenericScalar : public GenericScalarExpressionNode<Scalar_>, public Design
   using DesignVariable::getParameters;
 
   const Scalar & getValue() const { return _p; }
-  void setValue(Scalar p) { _p = p; }
+  void setValue(Scalar p) { this->invalidateCache(); _p = p; }
  protected:
   /// \brief Revert the last state update.
   virtual void revertUpdateImplementation();
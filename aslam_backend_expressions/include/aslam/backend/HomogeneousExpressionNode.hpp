@@ -6,6 +6,8 @@
 #include <boost/shared_ptr.hpp>
 #include <Eigen/Core>
 #include "EuclideanExpression.hpp"
+#include <aslam/backend/ExpressionContext.hpp>
+#include <aslam/backend/ValueCacheStamp.hpp>
 
 
 namespace aslam {
@@ -62,14 +64,15 @@ namespace aslam {
       ~HomogeneousExpressionNodeMultiply() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Vector4d toHomogeneousImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
 
       boost::shared_ptr<TransformationExpressionNode> _lhs;
-      mutable Eigen::Matrix4d _T_lhs;
       boost::shared_ptr<HomogeneousExpressionNode> _rhs;
-      mutable Eigen::Vector4d _p_rhs;
+      mutable Eigen::Vector4d _p;
+      mutable internal::ValueCacheStamp _valueStamp;
     };
 
 
@@ -81,8 +84,9 @@ namespace aslam {
       HomogeneousExpressionNodeConstant(const Eigen::Vector4d & p);
       ~HomogeneousExpressionNodeConstant() override;
 
-        void set(const Eigen::Vector4d & p){ _p = p; }
+        void set(const Eigen::Vector4d & p){ DesignVariable::invalidateConstants(); _p = p; }
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Vector4d toHomogeneousImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -99,6 +103,7 @@ namespace aslam {
       ~HomogeneousExpressionNodeEuclidean() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Vector4d toHomogeneousImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -106,6 +111,8 @@ namespace aslam {
       boost::shared_ptr<EuclideanExpressionNode> _p;
     };
 
+    // The constant can be set, which must not change the points of other error terms
+    template <> struct IsShareableNode<HomogeneousExpressionNodeConstant> : std::false_type { };
 
   } // namespace backend
 } // namespace aslam
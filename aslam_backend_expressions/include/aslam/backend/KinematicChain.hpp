@@ -8,7 +8,11 @@
 #ifndef KINEMATICCHAIN_HPP_
 #define KINEMATICCHAIN_HPP_
 
+#include <unordered_map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/JacobianContainerSparse.hpp>
 #include "EuclideanExpression.hpp"
 #include "RotationExpression.hpp"
 #include "ScalarExpression.hpp"
@@ -16,6 +20,16 @@
 namespace aslam {
 namespace backend {
 
+/**
+ * \class CoordinateFrame
+ * \brief A frame in a tree of frames, given by its rotation, position, velocities
+ *        and accelerations relative to its parent
+ *
+ * The global expressions of a frame are built on first access, all at once and
+ * on top of the global expressions of the parent. The getters are thread-safe:
+ * if several threads race for the first access, only one set of global
+ * expressions is ever published, so all callers get the same expression nodes.
+ */
 class CoordinateFrame {
  public:
   CoordinateFrame() : pp(nullptr) {};
@@ -32,62 +46,39 @@ class CoordinateFrame {
   CoordinateFrame (boost::shared_ptr<const CoordinateFrame> parent, RotationExpression R_P_L = RotationExpression(), EuclideanExpression p = EuclideanExpression(), EuclideanExpression omega = EuclideanExpression(), EuclideanExpression v = EuclideanExpression(), EuclideanExpression alpha = EuclideanExpression(), EuclideanExpression a = EuclideanExpression())
     : pp(parent), R_P_L(R_P_L), p(p), v(v), a(a), omega(omega), alpha(alpha)
   {
-    if(!parent){
-      initGlobalsWithoutParent();
-    }
   }
 
   CoordinateFrame (RotationExpression R_P_L, EuclideanExpression p = EuclideanExpression(), EuclideanExpression omega = EuclideanExpression(), EuclideanExpression v = EuclideanExpression(), EuclideanExpression alpha = EuclideanExpression(), EuclideanExpression a = EuclideanExpression())
     : pp(nullptr), R_P_L(R_P_L), p(p), v(v), a(a), omega(omega), alpha(alpha)
   {
-    initGlobalsWithoutParent();
   }
 
-  const boost::shared_ptr<const CoordinateFrame> getParent() {
+  const boost::shared_ptr<const CoordinateFrame> getParent() const {
     return pp;
   }
 
   const RotationExpression & getR_G_L() const {
-    if(pp && R_G_L.isEmpty()){
-      R_G_L = pp->getR_G_L() * R_P_L;
-    }
-    return R_G_L;
+    return globals().R_G_L;
   }
 
   const EuclideanExpression & getOmegaG() const {
-    if(pp && omegaG.isEmpty()){
-      omegaG = pp->getOmegaG() + pp->getR_G_L() * omega;
-    }
-    return omegaG;
+    return globals().omegaG;
   }
 
   const EuclideanExpression & getAlphaG() const {
-    if(pp && alphaG.isEmpty()){
-      alphaG = pp->getAlphaG() + pp->getOmegaG().cross(pp->getR_G_L() * omega) + pp->getR_G_L() * alpha;
-    }
-    return alphaG;
+    return globals().alphaG;
   }
 
-
   const EuclideanExpression & getPG() const {
-    if(pp && pG.isEmpty()){
-      pG = pp->getPG() + pp->getR_G_L() * p;
-    }
-    return pG;
+    return globals().pG;
   }
 
   const EuclideanExpression & getVG() const {
-    if(pp && vG.isEmpty()){
-      vG = pp->getVG() + pp->getR_G_L() * v + pp->getOmegaG().cross(pp->getR_G_L() * p); //TODO have a caching variable for (pp->getR_G_L() * p)!
-    }
-    return vG;
+    return globals().vG;
   }
 
   const EuclideanExpression & getAG() const {
-    if(pp && aG.isEmpty()){
-      aG = pp->getAG() + pp->getR_G_L() * a + pp->getOmegaG().cross(pp->getR_G_L() * v) + pp->getAlphaG().cross(pp->getR_G_L() * p) + pp->getOmegaG().cross(pp->getOmegaG().cross(pp->getR_G_L() * p));
-    }
-    return aG;
+    return globals().aG;
   }
 
   const RotationExpression & getR_P_L() const {
@@ -109,13 +100,91 @@ class CoordinateFrame {
     return alpha;
   }
  private:
-  void initGlobalsWithoutParent();
+  /// \brief The expressions of the frame relative to the global frame
+  struct Globals {
+    RotationExpression R_G_L;
+    EuclideanExpression pG, vG, aG, omegaG, alphaG;
+  };
+
+  /// \brief Get the global expressions, building them on first access
+  const Globals & globals() const;
+
+  /// \brief Build the global expressions from the ones of the parent
+  boost::shared_ptr<const Globals> buildGlobals() const;
 
   boost::shared_ptr<const CoordinateFrame> pp;
-  mutable RotationExpression R_G_L;
   RotationExpression R_P_L; // converting coordinates from to this to global or parent frame
   EuclideanExpression p, v, a, omega, alpha;
-  mutable EuclideanExpression pG, vG, aG, omegaG, alphaG;
+  mutable boost::shared_ptr<const Globals> _globals; /// \brief Published once, accessed atomically
+};
+
+/**
+ * \class KinematicChainEvaluator
+ * \brief Evaluates the global rotations and positions of many frames of a frame
+ *        tree, and of batches of points attached to them, with their Jacobians
+ *
+ * Frames are evaluated numerically from their parent, so every frame of the
+ * tree is evaluated once per call to evaluate(), no matter how many query
+ * frames share it, instead of once per global expression it is part of. Only
+ * the local expressions of the frames are used, the global expressions of the
+ * CoordinateFrames are never built.
+ *
+ * The Jacobians are collected for active design variables only and require
+ * distinct block indices, just like for error terms. An evaluator must not be
+ * used from several threads concurrently, use one evaluator per thread instead.
+ */
+class KinematicChainEvaluator {
+ public:
+  SM_DEFINE_EXCEPTION(Exception, aslam::Exception);
+  typedef JacobianContainerSparse<3> jacobian_container_t;
+
+  /// \brief Evaluate \p frames and all of their ancestors, dropping the results of previous evaluations.
+  ///        The Jacobians are only computed if \p evaluateJacobians is true.
+  void evaluate(const std::vector<const CoordinateFrame*> & frames, bool evaluateJacobians = true);
+
+  /// \brief The rotation from the evaluated frame \p frame to the global frame
+  const Eigen::Matrix3d & getR_G_L(const CoordinateFrame & frame) const;
+
+  /// \brief The position of the evaluated frame \p frame in the global frame
+  const Eigen::Vector3d & getPG(const CoordinateFrame & frame) const;
+
+  /// \brief The Jacobians of the rotation of the evaluated frame \p frame
+  const jacobian_container_t & getR_G_LJacobians(const CoordinateFrame & frame) const;
+
+  /// \brief The Jacobians of the position of the evaluated frame \p frame
+  const jacobian_container_t & getPGJacobians(const CoordinateFrame & frame) const;
+
+  /// \brief Map the points \p pointsL given in the evaluated frame \p frame to the global frame, one point per column
+  void transformPoints(const CoordinateFrame & frame, const Eigen::Matrix3Xd & pointsL, Eigen::Matrix3Xd & outPointsG) const;
+
+  /**
+   * \brief Map the points \p pointsL given in the evaluated frame \p frame to the global frame
+   *        and compute the Jacobians of all points at once
+   *
+   * @param outDesignVariables The design variables the points depend on, ordered by block index
+   * @param outJacobians Rows 3i to 3i+2 hold the Jacobian of point i. The columns hold the
+   *                     minimal dimensions of \p outDesignVariables one after the other.
+   */
+  void transformPoints(const CoordinateFrame & frame, const Eigen::Matrix3Xd & pointsL, Eigen::Matrix3Xd & outPointsG,
+                       std::vector<DesignVariable*> & outDesignVariables, Eigen::MatrixXd & outJacobians) const;
+
+  /// \brief Number of frames evaluated by the last call to evaluate()
+  std::size_t numEvaluatedFrames() const { return _frames.size(); }
+
+ private:
+  struct FrameState {
+    FrameState() : JR_G_L(3, 10), JpG(3, 10) {}
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Eigen::Matrix3d R_G_L;
+    Eigen::Vector3d pG;
+    jacobian_container_t JR_G_L, JpG;
+  };
+
+  const FrameState & evaluateFrame(const CoordinateFrame & frame, bool evaluateJacobians);
+  const FrameState & state(const CoordinateFrame & frame) const;
+
+  std::unordered_map< const CoordinateFrame*, boost::shared_ptr<FrameState> > _frames;
+  bool _hasJacobians = false;
 };
 
 } // namespace backend
@@ -9,6 +9,8 @@
 namespace aslam {
   namespace backend {
     
+    /// \brief A Euclidean point design variable stored in external memory.
+    ///        Call invalidateCache() after writing to that memory directly.
     class MappedEuclideanPoint : public EuclideanExpressionNode, public DesignVariable
     {
     public:
@@ -27,7 +29,7 @@ namespace aslam {
 
       EuclideanExpression toExpression();
 
-        void set(const Eigen::Vector3d & p){ _p = p; _p_p = _p; }
+        void set(const Eigen::Vector3d & p){ invalidateCache(); _p = p; _p_p = _p; }
     private:
       Eigen::Vector3d evaluateImplementation() const override;
 
@@ -9,6 +9,8 @@
 namespace aslam {
   namespace backend {
     
+    /// \brief A homogeneous point design variable stored in external memory.
+    ///        Call invalidateCache() after writing to that memory directly.
     class MappedHomogeneousPoint : public HomogeneousExpressionNode, public DesignVariable
     {
     public:
@@ -10,6 +10,8 @@
 namespace aslam {
   namespace backend {
     
+    /// \brief A rotation quaternion design variable stored in external memory.
+    ///        Call invalidateCache() after writing to that memory directly.
     class MappedRotationQuaternion : public RotationExpressionNode, public DesignVariable
     {
     public:
@@ -29,7 +31,7 @@ namespace aslam {
 
       RotationExpression toExpression();
 
-      void set( const Eigen::Vector4d & q){ _q = q; _p_q = q; }
+      void set( const Eigen::Vector4d & q){ invalidateCache(); _q = q; _p_q = q; }
     private:
       Eigen::Matrix3d toRotationMatrixImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
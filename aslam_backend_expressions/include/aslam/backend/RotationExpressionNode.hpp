@@ -7,6 +7,7 @@
 #include <boost/shared_ptr.hpp>
 #include <set>
 #include <aslam/backend/TransformationExpressionNode.hpp>
+#include <aslam/backend/ValueCacheStamp.hpp>
 
 namespace aslam {
   namespace backend {
@@ -72,6 +73,7 @@ namespace aslam {
       ~ConstantRotationExpressionNode() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix3d toRotationMatrixImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
@@ -95,14 +97,15 @@ namespace aslam {
       ~RotationExpressionNodeMultiply() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix3d toRotationMatrixImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
 
       boost::shared_ptr<RotationExpressionNode> _lhs;
-      mutable Eigen::Matrix3d _C_lhs;
       boost::shared_ptr<RotationExpressionNode> _rhs;
-      mutable Eigen::Matrix3d _C_rhs;
+      mutable Eigen::Matrix3d _C;
+      mutable internal::ValueCacheStamp _valueStamp;
     };
 
 
@@ -120,12 +123,14 @@ namespace aslam {
       ~RotationExpressionNodeInverse() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix3d toRotationMatrixImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
 
       boost::shared_ptr<RotationExpressionNode> _dvRotation;
       mutable Eigen::Matrix3d _C;
+      mutable internal::ValueCacheStamp _valueStamp;
     };
 
     class RotationExpressionNodeTransformation : public RotationExpressionNode
@@ -136,6 +141,7 @@ namespace aslam {
       ~RotationExpressionNodeTransformation() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix3d toRotationMatrixImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
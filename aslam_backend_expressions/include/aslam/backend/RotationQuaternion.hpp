@@ -38,7 +38,7 @@ namespace aslam {
 
       const Eigen::Vector4d & getQuaternion(){ return _q; }
 
-      void set( const Eigen::Vector4d & q){ _q = q; _p_q = q; }
+      void set( const Eigen::Vector4d & q){ invalidateCache(); _q = q; _p_q = q; }
     private:
       Eigen::Matrix3d toRotationMatrixImplementation() const override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
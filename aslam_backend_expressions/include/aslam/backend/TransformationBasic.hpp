@@ -26,6 +26,7 @@ namespace aslam {
       RotationExpression toRotationExpression(const boost::shared_ptr<TransformationExpressionNode> & thisShared) const override;
       EuclideanExpression toEuclideanExpression(const boost::shared_ptr<TransformationExpressionNode> & thisShared) const override;
     private:
+      friend class ExpressionTapeCompiler;
       boost::shared_ptr<RotationExpressionNode> _rotation;
       boost::shared_ptr<EuclideanExpressionNode>  _translation;
     };
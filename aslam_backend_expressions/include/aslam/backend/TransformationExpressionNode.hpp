@@ -3,6 +3,7 @@
 
 #include <Eigen/Core>
 #include <aslam/backend/JacobianContainer.hpp>
+#include <aslam/backend/ValueCacheStamp.hpp>
 #include <boost/shared_ptr.hpp>
 #include <set>
 
@@ -61,14 +62,15 @@ namespace aslam {
       ~TransformationExpressionNodeMultiply() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix4d toTransformationMatrixImplementation() override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
 
       boost::shared_ptr<TransformationExpressionNode> _lhs;
-      Eigen::Matrix4d _T_lhs;
       boost::shared_ptr<TransformationExpressionNode> _rhs;
-      Eigen::Matrix4d _T_rhs;
+      Eigen::Matrix4d _T;
+      internal::ValueCacheStamp _valueStamp;
     };
 
 
@@ -89,12 +91,16 @@ namespace aslam {
       ~TransformationExpressionNodeInverse() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix4d toTransformationMatrixImplementation() override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
+      /// \brief The inverse, computed once for the current state
+      Eigen::Matrix4d inverse() const;
 
       boost::shared_ptr<TransformationExpressionNode> _dvTransformation;
-      Eigen::Matrix4d _T;
+      mutable Eigen::Matrix4d _T;
+      mutable internal::ValueCacheStamp _valueStamp;
     };
 
 
@@ -113,6 +119,7 @@ namespace aslam {
         ~TransformationExpressionNodeConstant() override;
 
     private:
+      friend class ExpressionTapeCompiler;
       Eigen::Matrix4d toTransformationMatrixImplementation() override;
       void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override;
       void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override;
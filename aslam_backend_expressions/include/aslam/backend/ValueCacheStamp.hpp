@@ -0,0 +1,110 @@
+#ifndef ASLAM_BACKEND_VALUE_CACHE_STAMP_HPP
+#define ASLAM_BACKEND_VALUE_CACHE_STAMP_HPP
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <aslam/backend/DesignVariable.hpp>
+
+namespace aslam {
+namespace backend {
+
+namespace internal {
+/**
+ * \brief Remembers for which design variable versions the value of a node was computed.
+ *
+ * Since version stamps are globally increasing, the largest version of all
+ * design variables a node depends on changes whenever one of them changes.
+ * DesignVariable::constantsVersion() is included, so that setting a constant
+ * node invalidates all values. Copies start out invalid.
+ */
+class ValueCacheStamp {
+ public:
+  ValueCacheStamp() : _version(0), _collected(false) {}
+  ValueCacheStamp(const ValueCacheStamp & /* other */) : ValueCacheStamp() {}
+  ValueCacheStamp & operator=(const ValueCacheStamp & /* other */) {
+    invalidate();
+    return *this;
+  }
+
+  /// \brief Force the next check to fail
+  void invalidate() {
+    _version.store(0, std::memory_order_release);
+  }
+
+  /// \brief Evaluate \p evaluateValue unless it was already evaluated for the current versions of the design variables \p node depends on
+  template <typename TNode, typename TEvaluate>
+  void update(const TNode & node, TEvaluate evaluateValue) {
+    // Without design variables nothing tells us when the value changes
+    const std::uint64_t version = currentVersion(node);
+    if (version == 0) {
+      evaluateValue();
+      return;
+    }
+
+    if (_version.load(std::memory_order_acquire) != version) {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (_version.load(std::memory_order_relaxed) != version) { // could be updated by another thread in the meantime
+        evaluateValue();
+        _version.store(version, std::memory_order_release);
+      }
+    }
+  }
+
+  /**
+   * \brief Return \p cachedValue, after storing the result of \p evaluateValue in it
+   *        unless it was already evaluated for the current versions of the design variables \p node depends on.
+   *
+   * Without design variables the result of \p evaluateValue is returned and \p cachedValue is
+   * not touched, so nodes sharing their cache between threads never write it concurrently.
+   */
+  template <typename TNode, typename TValue, typename TEvaluate>
+  TValue value(const TNode & node, TValue & cachedValue, TEvaluate evaluateValue) {
+    const std::uint64_t version = currentVersion(node);
+    if (version == 0)
+      return evaluateValue();
+
+    if (_version.load(std::memory_order_acquire) != version) {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (_version.load(std::memory_order_relaxed) != version) { // could be updated by another thread in the meantime
+        cachedValue = evaluateValue();
+        _version.store(version, std::memory_order_release);
+      }
+    }
+    return cachedValue;
+  }
+
+ private:
+  /// \brief The largest version of the design variables of \p node, 0 if it has none
+  template <typename TNode>
+  std::uint64_t currentVersion(const TNode & node) {
+    if (!_collected.load(std::memory_order_acquire)) {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (!_collected.load(std::memory_order_relaxed)) {
+        DesignVariable::set_t designVariables;
+        node.getDesignVariables(designVariables);
+        _designVariables.assign(designVariables.begin(), designVariables.end());
+        _collected.store(true, std::memory_order_release);
+      }
+    }
+    if (_designVariables.empty())
+      return 0;
+
+    std::uint64_t version = DesignVariable::constantsVersion();
+    for (const DesignVariable * dv : _designVariables)
+      version = std::max(version, dv->version());
+    return version;
+  }
+
+  std::atomic<std::uint64_t> _version; /// \brief The version the cached value belongs to, 0 if invalid
+  std::atomic<bool> _collected; /// \brief Whether \p _designVariables is initialized
+  std::vector<const DesignVariable *> _designVariables; /// \brief The design variables the node depends on
+  boost::mutex _mutex; /// \brief Serializes the evaluation of the value
+};
+}
+
+} // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_VALUE_CACHE_STAMP_HPP */
@@ -4,6 +4,7 @@
 #include <aslam/backend/JacobianContainer.hpp>
 #include <boost/shared_ptr.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 #include "VectorExpressionNode.hpp"
 #include <aslam/backend/ScalarExpression.hpp>
 #include <aslam/backend/ScalarExpressionNode.hpp>
@@ -55,6 +55,7 @@ namespace aslam {
       ~ConstantVectorExpressionNode() override = default;
       int getSize() const override { return value.rows(); }
      private:
+      friend class ExpressionTapeCompiler;
       vector_t evaluateImplementation() const override { return value; }
       void evaluateJacobiansImplementation(JacobianContainer &) const override {}
       void getDesignVariablesImplementation(DesignVariable::set_t &) const override {}
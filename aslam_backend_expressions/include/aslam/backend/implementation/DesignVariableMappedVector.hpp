@@ -37,6 +37,7 @@ namespace aslam {
     template<int D>
     void DesignVariableMappedVector<D>::updateMap(double * p)
     {
+        invalidateCache();
         new (&_v) Eigen::Map< vector_t >(p);
         // \todo make these debug asserts
         SM_ASSERT_EQ(Exception, _v.data(), p, "The remap syntax didn't work");
@@ -228,8 +228,8 @@ _TEMPLATE GenericMatrixExpression<ICols, IRows, TScalar> _CLASS::inverse() const
     }
 
     inline typename base_t::apply_diff_return_t applyDiff(const typename base_t::operand_t::tangent_vector_t & tangent_vector) const {
-      evaluateImplementation();
-      return - this->_currentValue * tangent_vector * this->_currentValue;
+      const typename result_t::matrix_t & inverse = this->evaluate();
+      return - inverse * tangent_vector * inverse;
     }
   };
 
@@ -15,7 +15,7 @@ namespace aslam {
     }
     template<int D>
     VectorExpression<D>::VectorExpression(const vector_t & v) :
-      _root(new ConstantVectorExpressionNode<D>(v))
+      _root(makeNode< ConstantVectorExpressionNode<D> >(v))
     {
     }
       
@@ -56,7 +56,7 @@ namespace aslam {
     template<int ComponentIndex>
     ScalarExpression VectorExpression<D>::toScalarExpression() const
     {
-      boost::shared_ptr<ScalarExpressionNode> newRoot( new ScalarExpressionNodeFromVectorExpression<D, ComponentIndex>(_root));
+      boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode< ScalarExpressionNodeFromVectorExpression<D, ComponentIndex> >(_root);
       return ScalarExpression(newRoot);
     }
 
@@ -1,6 +1,7 @@
 #include <aslam/backend/EuclideanExpression.hpp>
 #include <aslam/backend/EuclideanExpressionNode.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 #include <aslam/backend/HomogeneousExpression.hpp>
 #include <aslam/backend/HomogeneousExpressionNode.hpp>
 #include <aslam/backend/VectorExpression.hpp>
@@ -13,7 +14,7 @@ namespace aslam {
     HomogeneousExpression EuclideanExpression::toHomogeneousExpression() const
     {
       assert(!isEmpty());
-      boost::shared_ptr<HomogeneousExpressionNode> newRoot( new HomogeneousExpressionNodeEuclidean(_root) );
+      boost::shared_ptr<HomogeneousExpressionNode> newRoot = makeNode<HomogeneousExpressionNodeEuclidean>(_root);
       return HomogeneousExpression(newRoot);
     }
     
@@ -33,13 +34,13 @@ namespace aslam {
     {
       if(p.isEmpty() || this->isEmpty())
         return EuclideanExpression();
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeCrossEuclidean(_root, p._root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeCrossEuclidean>(_root, p._root);
       return EuclideanExpression(newRoot);
     }
 
     EuclideanExpression EuclideanExpression::elementwiseMultiply(const EuclideanExpression & p) const
     {
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeElementwiseMultiplyEuclidean(_root, p._root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeElementwiseMultiplyEuclidean>(_root, p._root);
       return EuclideanExpression(newRoot);
     }
 
@@ -49,7 +50,7 @@ namespace aslam {
         return *this;
       if(this->isEmpty())
         return p;
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeAddEuclidean(_root, p._root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeAddEuclidean>(_root, p._root);
       return EuclideanExpression(newRoot);
     }
 
@@ -59,7 +60,7 @@ namespace aslam {
         return *this;
       if(this->isEmpty())
         return p;
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeSubtractEuclidean(_root, p._root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeSubtractEuclidean>(_root, p._root);
       return EuclideanExpression(newRoot);
     }
 
@@ -67,7 +68,7 @@ namespace aslam {
     {
       if(this->isEmpty())
         return p;
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeSubtractVector(_root, p));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeSubtractVector>(_root, p);
       return EuclideanExpression(newRoot);
     }
 
@@ -75,7 +76,7 @@ namespace aslam {
     {
       if(this->isEmpty())
         return *this;
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeNegated(_root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeNegated>(_root);
       return EuclideanExpression(newRoot);
     }
 
@@ -83,7 +84,7 @@ namespace aslam {
     {
       if(this->isEmpty() || s.isEmpty())
         return EuclideanExpression();
-      boost::shared_ptr<EuclideanExpressionNode> newRoot(new EuclideanExpressionNodeScalarMultiply(_root, s._root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeScalarMultiply>(_root, s._root);
       return EuclideanExpression(newRoot);
     }
 
@@ -9,8 +9,6 @@ namespace aslam {
   EuclideanExpressionNodeMultiply::EuclideanExpressionNodeMultiply(boost::shared_ptr<RotationExpressionNode> lhs, boost::shared_ptr<EuclideanExpressionNode> rhs) :
     _lhs(lhs), _rhs(rhs)
   {
-    _C_lhs = _lhs->toRotationMatrix();
-    _p_rhs = _rhs->evaluate();
   }
 
   EuclideanExpressionNodeMultiply::~EuclideanExpressionNodeMultiply()
@@ -27,16 +25,13 @@ namespace aslam {
 
     Eigen::Vector3d EuclideanExpressionNodeMultiply::evaluateImplementation() const
     {
-      _C_lhs = _lhs->toRotationMatrix();
-      _p_rhs = _rhs->evaluate();
-
-      return _C_lhs * _p_rhs;
+      return _valueStamp.value(*this, _p, [this]() -> Eigen::Vector3d { return _lhs->toRotationMatrix() * _rhs->evaluate(); });
     }
 
     void EuclideanExpressionNodeMultiply::evaluateJacobiansImplementation(JacobianContainer & outJacobians) const
     {
-      _lhs->evaluateJacobians(outJacobians, sm::kinematics::crossMx(_C_lhs * _p_rhs));
-      _rhs->evaluateJacobians(outJacobians, _C_lhs);
+      _lhs->evaluateJacobians(outJacobians, sm::kinematics::crossMx(evaluate()));
+      _rhs->evaluateJacobians(outJacobians, _lhs->toRotationMatrix());
     }
 
     // -------------------------------------------------------
@@ -44,8 +39,6 @@ namespace aslam {
     EuclideanExpressionNodeMatrixMultiply::EuclideanExpressionNodeMatrixMultiply(boost::shared_ptr<MatrixExpressionNode> lhs, boost::shared_ptr<EuclideanExpressionNode> rhs) :
          _lhs(lhs), _rhs(rhs)
     {
-      _A_lhs = _lhs->evaluate();
-      _p_rhs = _rhs->evaluate();
     }
 
     EuclideanExpressionNodeMatrixMultiply::~EuclideanExpressionNodeMatrixMultiply()
@@ -63,18 +56,16 @@ namespace aslam {
     
     Eigen::Vector3d EuclideanExpressionNodeMatrixMultiply::evaluateImplementation() const
     {
-      _A_lhs = _lhs->evaluate();
-      _p_rhs = _rhs->evaluate();
-
-      return _A_lhs * _p_rhs;
+      return _valueStamp.value(*this, _p, [this]() -> Eigen::Vector3d { return _lhs->evaluate() * _rhs->evaluate(); });
     }
 
     void EuclideanExpressionNodeMatrixMultiply::evaluateJacobiansImplementation(JacobianContainer & outJacobians) const
     {
+      const Eigen::Vector3d p_rhs = _rhs->evaluate();
       Eigen::Matrix<double, 3,9> J_full;
-      J_full << _p_rhs(0) * Eigen::Matrix3d::Identity(), _p_rhs(1) * Eigen::Matrix3d::Identity(), _p_rhs(2) * Eigen::Matrix3d::Identity();
+      J_full << p_rhs(0) * Eigen::Matrix3d::Identity(), p_rhs(1) * Eigen::Matrix3d::Identity(), p_rhs(2) * Eigen::Matrix3d::Identity();
       _lhs->evaluateJacobians(outJacobians, J_full);
-      _rhs->evaluateJacobians(outJacobians, _A_lhs);
+      _rhs->evaluateJacobians(outJacobians, _lhs->evaluate());
     }
 
     // ----------------------------
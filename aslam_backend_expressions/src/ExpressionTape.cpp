@@ -0,0 +1,547 @@
+#include <aslam/backend/ExpressionTape.hpp>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+#include <sm/kinematics/rotations.hpp>
+#include <sm/kinematics/transformations.hpp>
+#include <sm/kinematics/homogeneous_coordinates.hpp>
+#include <aslam/backend/TransformationBasic.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    namespace {
+      typedef Eigen::Map<Eigen::Vector3d> VectorMap;
+      typedef Eigen::Map<const Eigen::Vector3d> ConstVectorMap;
+      typedef Eigen::Map<Eigen::Matrix3d> MatrixMap;
+      typedef Eigen::Map<const Eigen::Matrix3d> ConstMatrixMap;
+
+      inline VectorMap vec(double * p) { return VectorMap(p); }
+      inline ConstVectorMap vec(const double * p) { return ConstVectorMap(p); }
+      inline MatrixMap mat(double * p) { return MatrixMap(p); }
+      inline ConstMatrixMap mat(const double * p) { return ConstMatrixMap(p); }
+
+      inline Eigen::Map<Eigen::Vector4d> hom(double * p) { return Eigen::Map<Eigen::Vector4d>(p); }
+      inline Eigen::Map<const Eigen::Vector4d> hom(const double * p) { return Eigen::Map<const Eigen::Vector4d>(p); }
+      inline Eigen::Map<Eigen::Matrix4d> trafo(double * p) { return Eigen::Map<Eigen::Matrix4d>(p); }
+      inline Eigen::Map<const Eigen::Matrix4d> trafo(const double * p) { return Eigen::Map<const Eigen::Matrix4d>(p); }
+
+      /// \brief The 3xD adjoint stored at \p p
+      template <int D>
+      inline Eigen::Map< Eigen::Matrix<double, 3, D> > adjoint(double * p) { return Eigen::Map< Eigen::Matrix<double, 3, D> >(p); }
+
+      inline int valueSize(ExpressionTape::SlotType type)
+      {
+        switch (type) {
+          case ExpressionTape::SlotType::Euclidean: return 3;
+          case ExpressionTape::SlotType::Rotation: return 9;
+          case ExpressionTape::SlotType::Homogeneous: return 4;
+          case ExpressionTape::SlotType::Transformation: return 16;
+        }
+        return 0;
+      }
+
+      inline int tangentSize(ExpressionTape::SlotType type)
+      {
+        switch (type) {
+          case ExpressionTape::SlotType::Euclidean: return 3;
+          case ExpressionTape::SlotType::Rotation: return 3;
+          case ExpressionTape::SlotType::Homogeneous: return 4;
+          case ExpressionTape::SlotType::Transformation: return 6;
+        }
+        return 0;
+      }
+    }
+
+    ////////////////////////////////////////////
+    // CompiledEuclideanExpression
+    ////////////////////////////////////////////
+
+    void CompiledEuclideanExpression::forward() const
+    {
+      const ExpressionTape & tape = *_tape;
+      const int * offsets = tape._slotOffsets.data();
+      double * v = _values.data();
+
+      for (const ExpressionTape::Instruction & ins : tape._instructions) {
+        double * out = v + offsets[ins.out];
+        switch (ins.op) {
+          case ExpressionTape::OpCode::EuclideanLeaf:
+            vec(out) = _euclideanLeaves[ins.lhs]->evaluate();
+            break;
+          case ExpressionTape::OpCode::RotationLeaf:
+            mat(out) = _rotationLeaves[ins.lhs]->toRotationMatrix();
+            break;
+          case ExpressionTape::OpCode::RotateEuclidean:
+            vec(out).noalias() = mat(v + offsets[ins.lhs]) * vec(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::CrossEuclidean:
+            vec(out) = vec(v + offsets[ins.lhs]).cross(vec(v + offsets[ins.rhs]));
+            break;
+          case ExpressionTape::OpCode::AddEuclidean:
+            vec(out) = vec(v + offsets[ins.lhs]) + vec(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::SubtractEuclidean:
+            vec(out) = vec(v + offsets[ins.lhs]) - vec(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::NegateEuclidean:
+            vec(out) = -vec(v + offsets[ins.lhs]);
+            break;
+          case ExpressionTape::OpCode::ElementwiseMultiplyEuclidean:
+            vec(out) = vec(v + offsets[ins.lhs]).cwiseProduct(vec(v + offsets[ins.rhs]));
+            break;
+          case ExpressionTape::OpCode::MultiplyRotation:
+            mat(out).noalias() = mat(v + offsets[ins.lhs]) * mat(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::InverseRotation:
+            mat(out) = mat(v + offsets[ins.lhs]).transpose();
+            break;
+          case ExpressionTape::OpCode::HomogeneousLeaf:
+            hom(out) = _homogeneousLeaves[ins.lhs]->toHomogeneous();
+            break;
+          case ExpressionTape::OpCode::TransformationLeaf:
+            trafo(out) = _transformationLeaves[ins.lhs]->toTransformationMatrix();
+            break;
+          case ExpressionTape::OpCode::TransformHomogeneous:
+            hom(out).noalias() = trafo(v + offsets[ins.lhs]) * hom(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::HomogeneousFromEuclidean:
+            hom(out) << vec(v + offsets[ins.lhs]), 1.0;
+            break;
+          case ExpressionTape::OpCode::EuclideanFromHomogeneous:
+            vec(out) = sm::kinematics::fromHomogeneous(hom(v + offsets[ins.lhs]));
+            break;
+          case ExpressionTape::OpCode::TranslationOfTransformation:
+            vec(out) = trafo(v + offsets[ins.lhs]).topRightCorner<3,1>();
+            break;
+          case ExpressionTape::OpCode::RotationOfTransformation:
+            mat(out) = trafo(v + offsets[ins.lhs]).topLeftCorner<3,3>();
+            break;
+          case ExpressionTape::OpCode::ComposeTransformation:
+            trafo(out).setIdentity();
+            trafo(out).topLeftCorner<3,3>() = mat(v + offsets[ins.lhs]);
+            trafo(out).topRightCorner<3,1>() = vec(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::MultiplyTransformation:
+            trafo(out).noalias() = trafo(v + offsets[ins.lhs]) * trafo(v + offsets[ins.rhs]);
+            break;
+          case ExpressionTape::OpCode::InverseTransformation:
+          {
+            Eigen::Map<const Eigen::Matrix4d> T(v + offsets[ins.lhs]);
+            const Eigen::Matrix3d Ct = T.topLeftCorner<3,3>().transpose();
+            trafo(out).setIdentity();
+            trafo(out).topLeftCorner<3,3>() = Ct;
+            trafo(out).topRightCorner<3,1>().noalias() = -Ct * T.topRightCorner<3,1>();
+            break;
+          }
+        }
+      }
+    }
+
+    CompiledEuclideanExpression::vector_t CompiledEuclideanExpression::evaluate() const
+    {
+      forward();
+      return vec(_values.data() + _tape->_slotOffsets[_tape->_resultSlot]);
+    }
+
+    void CompiledEuclideanExpression::evaluateJacobians(JacobianContainer & outJacobians) const
+    {
+      // The chain rule matrices depend on the values of all intermediate
+      // slots, so they are refreshed before the reverse sweep.
+      forward();
+
+      const ExpressionTape & tape = *_tape;
+      if (!tape._needsAdjoint[tape._resultSlot])
+        return;
+
+      const int * offsets = tape._slotOffsets.data();
+      const int * adjointOffsets = tape._adjointOffsets.data();
+      const double * v = _values.data();
+      double * a = _adjoints.data();
+
+      // The adjoints of all operands of an instruction live in earlier slots,
+      // so visiting the instructions backwards finishes the accumulation of
+      // every adjoint before it is propagated.
+      std::fill(_adjoints.begin(), _adjoints.end(), 0.0);
+      mat(a + adjointOffsets[tape._resultSlot]).setIdentity();
+
+      for (auto it = tape._instructions.rbegin(); it != tape._instructions.rend(); ++it) {
+        const ExpressionTape::Instruction & ins = *it;
+        if (!tape._needsAdjoint[ins.out])
+          continue;
+        double * out = a + adjointOffsets[ins.out];
+        double * lhs = ins.lhs >= 0 ? a + adjointOffsets[ins.lhs] : nullptr;
+        double * rhs = ins.rhs >= 0 ? a + adjointOffsets[ins.rhs] : nullptr;
+        const bool needsLhs = ins.lhs >= 0 && tape._needsAdjoint[ins.lhs];
+        const bool needsRhs = ins.rhs >= 0 && tape._needsAdjoint[ins.rhs];
+        switch (ins.op) {
+          case ExpressionTape::OpCode::EuclideanLeaf:
+            _euclideanLeaves[ins.lhs]->evaluateJacobians(outJacobians, mat(out));
+            break;
+          case ExpressionTape::OpCode::RotationLeaf:
+            _rotationLeaves[ins.lhs]->evaluateJacobians(outJacobians, mat(out));
+            break;
+          case ExpressionTape::OpCode::HomogeneousLeaf:
+            _homogeneousLeaves[ins.lhs]->evaluateJacobians(outJacobians, adjoint<4>(out));
+            break;
+          case ExpressionTape::OpCode::TransformationLeaf:
+            _transformationLeaves[ins.lhs]->evaluateJacobians(outJacobians, adjoint<6>(out));
+            break;
+          case ExpressionTape::OpCode::RotateEuclidean:
+            if (needsLhs)
+              mat(lhs).noalias() += mat(out) * sm::kinematics::crossMx(vec(v + offsets[ins.out]));
+            if (needsRhs)
+              mat(rhs).noalias() += mat(out) * mat(v + offsets[ins.lhs]);
+            break;
+          case ExpressionTape::OpCode::CrossEuclidean:
+            if (needsLhs)
+              mat(lhs).noalias() -= mat(out) * sm::kinematics::crossMx(vec(v + offsets[ins.rhs]));
+            if (needsRhs)
+              mat(rhs).noalias() += mat(out) * sm::kinematics::crossMx(vec(v + offsets[ins.lhs]));
+            break;
+          case ExpressionTape::OpCode::AddEuclidean:
+            if (needsLhs)
+              mat(lhs) += mat(out);
+            if (needsRhs)
+              mat(rhs) += mat(out);
+            break;
+          case ExpressionTape::OpCode::SubtractEuclidean:
+            if (needsLhs)
+              mat(lhs) += mat(out);
+            if (needsRhs)
+              mat(rhs) -= mat(out);
+            break;
+          case ExpressionTape::OpCode::NegateEuclidean:
+            mat(lhs) -= mat(out);
+            break;
+          case ExpressionTape::OpCode::ElementwiseMultiplyEuclidean:
+            if (needsLhs)
+              mat(lhs) += mat(out) * vec(v + offsets[ins.rhs]).asDiagonal();
+            if (needsRhs)
+              mat(rhs) += mat(out) * vec(v + offsets[ins.lhs]).asDiagonal();
+            break;
+          case ExpressionTape::OpCode::MultiplyRotation:
+            if (needsLhs)
+              mat(lhs) += mat(out);
+            if (needsRhs)
+              mat(rhs).noalias() += mat(out) * mat(v + offsets[ins.lhs]);
+            break;
+          case ExpressionTape::OpCode::InverseRotation:
+            mat(lhs).noalias() -= mat(out) * mat(v + offsets[ins.out]);
+            break;
+          case ExpressionTape::OpCode::TransformHomogeneous:
+            if (needsLhs)
+              adjoint<6>(lhs).noalias() += adjoint<4>(out) * sm::kinematics::boxMinus(hom(v + offsets[ins.out]));
+            if (needsRhs)
+              adjoint<4>(rhs).noalias() += adjoint<4>(out) * trafo(v + offsets[ins.lhs]);
+            break;
+          case ExpressionTape::OpCode::HomogeneousFromEuclidean:
+            mat(lhs) += adjoint<4>(out).leftCols<3>();
+            break;
+          case ExpressionTape::OpCode::EuclideanFromHomogeneous:
+          {
+            Eigen::Matrix<double,3,4> Jh;
+            sm::kinematics::fromHomogeneous(hom(v + offsets[ins.lhs]), &Jh);
+            adjoint<4>(lhs).noalias() += mat(out) * Jh;
+            break;
+          }
+          case ExpressionTape::OpCode::TranslationOfTransformation:
+            adjoint<6>(lhs).leftCols<3>() += mat(out);
+            adjoint<6>(lhs).rightCols<3>().noalias() += mat(out) * sm::kinematics::crossMx(vec(v + offsets[ins.out]));
+            break;
+          case ExpressionTape::OpCode::RotationOfTransformation:
+            adjoint<6>(lhs).rightCols<3>() += mat(out);
+            break;
+          case ExpressionTape::OpCode::ComposeTransformation:
+            if (needsLhs) {
+              mat(lhs) += adjoint<6>(out).rightCols<3>();
+              mat(lhs).noalias() -= adjoint<6>(out).leftCols<3>() * sm::kinematics::crossMx(vec(v + offsets[ins.rhs]));
+            }
+            if (needsRhs)
+              mat(rhs) += adjoint<6>(out).leftCols<3>();
+            break;
+          case ExpressionTape::OpCode::MultiplyTransformation:
+            if (needsLhs)
+              adjoint<6>(lhs) += adjoint<6>(out);
+            if (needsRhs)
+              adjoint<6>(rhs).noalias() += adjoint<6>(out) * sm::kinematics::boxTimes(trafo(v + offsets[ins.lhs]));
+            break;
+          case ExpressionTape::OpCode::InverseTransformation:
+            adjoint<6>(lhs).noalias() -= adjoint<6>(out) * sm::kinematics::boxTimes(trafo(v + offsets[ins.out]));
+            break;
+        }
+      }
+    }
+
+    void CompiledEuclideanExpression::getDesignVariables(DesignVariable::set_t & designVariables) const
+    {
+      for (auto & leaf : _euclideanLeaves)
+        leaf->getDesignVariables(designVariables);
+      for (auto & leaf : _rotationLeaves)
+        leaf->getDesignVariables(designVariables);
+      for (auto & leaf : _homogeneousLeaves)
+        leaf->getDesignVariables(designVariables);
+      for (auto & leaf : _transformationLeaves)
+        leaf->getDesignVariables(designVariables);
+    }
+
+    ////////////////////////////////////////////
+    // ExpressionTapeCompiler
+    ////////////////////////////////////////////
+
+    struct ExpressionTapeCompiler::Context
+    {
+      ExpressionTape tape;
+      CompiledEuclideanExpression compiled;
+      std::vector<double> constants; /// \brief The values of the constant slots, in binding order
+      std::unordered_map<const void *, int> slots; /// \brief Node to slot, shared subexpressions get one slot
+
+      int addSlot(ExpressionTape::SlotType type, bool needsAdjoint)
+      {
+        tape._slotTypes.push_back(type);
+        tape._slotOffsets.push_back(static_cast<int>(tape._numValues));
+        tape._adjointOffsets.push_back(static_cast<int>(tape._numAdjoints));
+        tape._needsAdjoint.push_back(needsAdjoint);
+        tape._numValues += valueSize(type);
+        tape._numAdjoints += 3*tangentSize(type);
+        return static_cast<int>(tape._slotTypes.size()) - 1;
+      }
+
+      int addInstruction(ExpressionTape::OpCode op, ExpressionTape::SlotType type, int lhs, int rhs = -1)
+      {
+        const bool needsAdjoint = tape._needsAdjoint[lhs] || (rhs >= 0 && tape._needsAdjoint[rhs]);
+        const int out = addSlot(type, needsAdjoint);
+        tape._instructions.push_back(ExpressionTape::Instruction{op, out, lhs, rhs});
+        return out;
+      }
+
+      int addConstant(const Eigen::Vector3d & p)
+      {
+        const int slot = addSlot(ExpressionTape::SlotType::Euclidean, false);
+        tape._constantSlots.push_back(slot);
+        constants.insert(constants.end(), p.data(), p.data() + 3);
+        return slot;
+      }
+
+      int addConstant(const Eigen::Matrix3d & C)
+      {
+        const int slot = addSlot(ExpressionTape::SlotType::Rotation, false);
+        tape._constantSlots.push_back(slot);
+        constants.insert(constants.end(), C.data(), C.data() + 9);
+        return slot;
+      }
+
+      int addConstant(const Eigen::Vector4d & ph)
+      {
+        const int slot = addSlot(ExpressionTape::SlotType::Homogeneous, false);
+        tape._constantSlots.push_back(slot);
+        constants.insert(constants.end(), ph.data(), ph.data() + 4);
+        return slot;
+      }
+
+      int addConstant(const Eigen::Matrix4d & T)
+      {
+        const int slot = addSlot(ExpressionTape::SlotType::Transformation, false);
+        tape._constantSlots.push_back(slot);
+        constants.insert(constants.end(), T.data(), T.data() + 16);
+        return slot;
+      }
+
+      template <typename Node>
+      int addLeaf(ExpressionTape::OpCode op, ExpressionTape::SlotType type, const boost::shared_ptr<Node> & node, std::vector< boost::shared_ptr<Node> > & leaves)
+      {
+        const int slot = addSlot(type, true);
+        tape._instructions.push_back(ExpressionTape::Instruction{op, slot, static_cast<int>(leaves.size()), -1});
+        leaves.push_back(node);
+        return slot;
+      }
+    };
+
+    int ExpressionTapeCompiler::compileEuclidean(const boost::shared_ptr<EuclideanExpressionNode> & node, Context & c) const
+    {
+      SM_ASSERT_TRUE(Exception, static_cast<bool>(node), "Cannot compile an empty expression");
+      auto it = c.slots.find(node.get());
+      if (it != c.slots.end())
+        return it->second;
+
+      typedef ExpressionTape::OpCode Op;
+      const ExpressionTape::SlotType type = ExpressionTape::SlotType::Euclidean;
+      int slot;
+      if (auto n = dynamic_cast<const EuclideanExpressionNodeMultiply *>(node.get())) {
+        const int lhs = compileRotation(n->_lhs, c);
+        slot = c.addInstruction(Op::RotateEuclidean, type, lhs, compileEuclidean(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeCrossEuclidean *>(node.get())) {
+        const int lhs = compileEuclidean(n->_lhs, c);
+        slot = c.addInstruction(Op::CrossEuclidean, type, lhs, compileEuclidean(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeAddEuclidean *>(node.get())) {
+        const int lhs = compileEuclidean(n->_lhs, c);
+        slot = c.addInstruction(Op::AddEuclidean, type, lhs, compileEuclidean(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeSubtractEuclidean *>(node.get())) {
+        const int lhs = compileEuclidean(n->_lhs, c);
+        slot = c.addInstruction(Op::SubtractEuclidean, type, lhs, compileEuclidean(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeSubtractVector *>(node.get())) {
+        const int lhs = compileEuclidean(n->_lhs, c);
+        slot = c.addInstruction(Op::SubtractEuclidean, type, lhs, c.addConstant(n->_rhs));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeNegated *>(node.get())) {
+        slot = c.addInstruction(Op::NegateEuclidean, type, compileEuclidean(n->_operand, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeElementwiseMultiplyEuclidean *>(node.get())) {
+        const int lhs = compileEuclidean(n->_lhs, c);
+        slot = c.addInstruction(Op::ElementwiseMultiplyEuclidean, type, lhs, compileEuclidean(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeConstant *>(node.get())) {
+        slot = c.addConstant(n->_p);
+      } else if (auto n = dynamic_cast<const ConstantVectorExpressionNode<3> *>(node.get())) {
+        slot = c.addConstant(n->value);
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeFromHomogeneous *>(node.get())) {
+        slot = c.addInstruction(Op::EuclideanFromHomogeneous, type, compileHomogeneous(n->_root, c));
+      } else if (auto n = dynamic_cast<const EuclideanExpressionNodeTranslation *>(node.get())) {
+        slot = c.addInstruction(Op::TranslationOfTransformation, type, compileTransformation(n->_operand, c));
+      } else {
+        slot = c.addLeaf(Op::EuclideanLeaf, type, node, c.compiled._euclideanLeaves);
+      }
+      c.slots.emplace(node.get(), slot);
+      return slot;
+    }
+
+    int ExpressionTapeCompiler::compileRotation(const boost::shared_ptr<RotationExpressionNode> & node, Context & c) const
+    {
+      SM_ASSERT_TRUE(Exception, static_cast<bool>(node), "Cannot compile an empty expression");
+      auto it = c.slots.find(node.get());
+      if (it != c.slots.end())
+        return it->second;
+
+      typedef ExpressionTape::OpCode Op;
+      const ExpressionTape::SlotType type = ExpressionTape::SlotType::Rotation;
+      int slot;
+      if (auto n = dynamic_cast<const RotationExpressionNodeMultiply *>(node.get())) {
+        const int lhs = compileRotation(n->_lhs, c);
+        slot = c.addInstruction(Op::MultiplyRotation, type, lhs, compileRotation(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const RotationExpressionNodeInverse *>(node.get())) {
+        slot = c.addInstruction(Op::InverseRotation, type, compileRotation(n->_dvRotation, c));
+      } else if (auto n = dynamic_cast<const ConstantRotationExpressionNode *>(node.get())) {
+        slot = c.addConstant(n->_C);
+      } else if (auto n = dynamic_cast<const RotationExpressionNodeTransformation *>(node.get())) {
+        slot = c.addInstruction(Op::RotationOfTransformation, type, compileTransformation(n->_transformation, c));
+      } else {
+        slot = c.addLeaf(Op::RotationLeaf, type, node, c.compiled._rotationLeaves);
+      }
+      c.slots.emplace(node.get(), slot);
+      return slot;
+    }
+
+    int ExpressionTapeCompiler::compileHomogeneous(const boost::shared_ptr<HomogeneousExpressionNode> & node, Context & c) const
+    {
+      SM_ASSERT_TRUE(Exception, static_cast<bool>(node), "Cannot compile an empty expression");
+      auto it = c.slots.find(node.get());
+      if (it != c.slots.end())
+        return it->second;
+
+      typedef ExpressionTape::OpCode Op;
+      const ExpressionTape::SlotType type = ExpressionTape::SlotType::Homogeneous;
+      int slot;
+      if (auto n = dynamic_cast<const HomogeneousExpressionNodeMultiply *>(node.get())) {
+        const int lhs = compileTransformation(n->_lhs, c);
+        slot = c.addInstruction(Op::TransformHomogeneous, type, lhs, compileHomogeneous(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const HomogeneousExpressionNodeEuclidean *>(node.get())) {
+        slot = c.addInstruction(Op::HomogeneousFromEuclidean, type, compileEuclidean(n->_p, c));
+      } else if (auto n = dynamic_cast<const HomogeneousExpressionNodeConstant *>(node.get())) {
+        slot = c.addConstant(n->_p);
+      } else {
+        slot = c.addLeaf(Op::HomogeneousLeaf, type, node, c.compiled._homogeneousLeaves);
+      }
+      c.slots.emplace(node.get(), slot);
+      return slot;
+    }
+
+    int ExpressionTapeCompiler::compileTransformation(const boost::shared_ptr<TransformationExpressionNode> & node, Context & c) const
+    {
+      SM_ASSERT_TRUE(Exception, static_cast<bool>(node), "Cannot compile an empty expression");
+      auto it = c.slots.find(node.get());
+      if (it != c.slots.end())
+        return it->second;
+
+      typedef ExpressionTape::OpCode Op;
+      const ExpressionTape::SlotType type = ExpressionTape::SlotType::Transformation;
+      int slot;
+      const TransformationBasic * basic = dynamic_cast<const TransformationBasic *>(node.get());
+      if (auto n = dynamic_cast<const TransformationExpressionNodeMultiply *>(node.get())) {
+        const int lhs = compileTransformation(n->_lhs, c);
+        slot = c.addInstruction(Op::MultiplyTransformation, type, lhs, compileTransformation(n->_rhs, c));
+      } else if (auto n = dynamic_cast<const TransformationExpressionNodeInverse *>(node.get())) {
+        slot = c.addInstruction(Op::InverseTransformation, type, compileTransformation(n->_dvTransformation, c));
+      } else if (auto n = dynamic_cast<const TransformationExpressionNodeConstant *>(node.get())) {
+        slot = c.addConstant(n->_T);
+      } else if (basic && basic->_rotation && basic->_translation) {
+        const int lhs = compileRotation(basic->_rotation, c);
+        slot = c.addInstruction(Op::ComposeTransformation, type, lhs, compileEuclidean(basic->_translation, c));
+      } else {
+        slot = c.addLeaf(Op::TransformationLeaf, type, node, c.compiled._transformationLeaves);
+      }
+      c.slots.emplace(node.get(), slot);
+      return slot;
+    }
+
+    CompiledEuclideanExpression ExpressionTapeCompiler::compile(const EuclideanExpression & expression)
+    {
+      SM_ASSERT_FALSE(Exception, expression.isEmpty(), "Cannot compile an empty expression");
+
+      Context c;
+      c.tape._resultSlot = compileEuclidean(expression.root(), c);
+      c.tape._numEuclideanLeaves = c.compiled._euclideanLeaves.size();
+      c.tape._numRotationLeaves = c.compiled._rotationLeaves.size();
+      c.tape._numHomogeneousLeaves = c.compiled._homogeneousLeaves.size();
+      c.tape._numTransformationLeaves = c.compiled._transformationLeaves.size();
+
+      // The leaf indices are part of the instructions, so two expressions get
+      // the same key iff their instructions, constants and sharing patterns match.
+      std::ostringstream key;
+      for (const ExpressionTape::Instruction & ins : c.tape._instructions)
+        key << static_cast<int>(ins.op) << ',' << ins.out << ',' << ins.lhs << ',' << ins.rhs << ';';
+      key << '|';
+      for (int slot : c.tape._constantSlots)
+        key << slot << ',' << static_cast<int>(c.tape._slotTypes[slot]) << ';';
+      key << '|' << c.tape._resultSlot;
+      const std::string structureKey = key.str();
+      c.tape._structureKey = structureKey;
+
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+        auto it = _tapes.find(structureKey);
+        if (it == _tapes.end())
+          it = _tapes.emplace(structureKey, boost::shared_ptr<const ExpressionTape>(new ExpressionTape(std::move(c.tape)))).first;
+        c.compiled._tape = it->second;
+      }
+
+      CompiledEuclideanExpression & compiled = c.compiled;
+      const ExpressionTape & tape = *compiled._tape;
+      compiled._expression = expression;
+      compiled._values.assign(tape.numValues(), 0.0);
+      compiled._adjoints.assign(tape.numAdjoints(), 0.0);
+      const double * constant = c.constants.data();
+      for (int slot : tape._constantSlots) {
+        const int size = valueSize(tape._slotTypes[slot]);
+        std::copy(constant, constant + size, compiled._values.begin() + tape._slotOffsets[slot]);
+        constant += size;
+      }
+      return compiled;
+    }
+
+    std::size_t ExpressionTapeCompiler::numTapes() const
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      return _tapes.size();
+    }
+
+    void ExpressionTapeCompiler::clear()
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _tapes.clear();
+    }
+
+    CompiledEuclideanExpression compileExpression(const EuclideanExpression & expression)
+    {
+      ExpressionTapeCompiler compiler;
+      return compiler.compile(expression);
+    }
+
+  } // namespace backend
+} // namespace aslam
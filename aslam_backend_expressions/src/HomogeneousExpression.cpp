@@ -1,5 +1,6 @@
 #include <aslam/backend/HomogeneousExpression.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 #include <aslam/backend/HomogeneousExpressionNode.hpp>
 #include <aslam/backend/EuclideanExpressionNode.hpp>
 
@@ -27,13 +28,13 @@ namespace aslam {
 
       HomogeneousExpression::HomogeneousExpression(const Eigen::Vector4d & p)
       {
-          _root.reset(new HomogeneousExpressionNodeConstant(p));
+          _root = makeNode<HomogeneousExpressionNodeConstant>(p);
       }
 
       HomogeneousExpression::HomogeneousExpression(const Eigen::Vector3d & p)
       {
           Eigen::Vector4d ph(p[0],p[1],p[2],1.0);
-          _root.reset(new HomogeneousExpressionNodeConstant(ph));
+          _root = makeNode<HomogeneousExpressionNodeConstant>(ph);
       }
 
 
@@ -44,7 +45,7 @@ namespace aslam {
 
     EuclideanExpression HomogeneousExpression::toEuclideanExpression() const
      {
-       boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeFromHomogeneous(_root));
+       boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeFromHomogeneous>(_root);
        return EuclideanExpression(newRoot);
                                                            
     }
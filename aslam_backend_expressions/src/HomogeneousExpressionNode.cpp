@@ -42,8 +42,6 @@ namespace aslam {
 								     boost::shared_ptr<HomogeneousExpressionNode> rhs) :
       _lhs(lhs), _rhs(rhs)
     {
-      _T_lhs = _lhs->toTransformationMatrix();
-      _p_rhs = _rhs->toHomogeneous();
     }
 
     HomogeneousExpressionNodeMultiply::~HomogeneousExpressionNodeMultiply()
@@ -55,16 +53,13 @@ namespace aslam {
     
     Eigen::Vector4d HomogeneousExpressionNodeMultiply::toHomogeneousImplementation() const
     {
-      _T_lhs = _lhs->toTransformationMatrix();
-      _p_rhs = _rhs->toHomogeneous();
-
-      return _T_lhs * _p_rhs;
+      return _valueStamp.value(*this, _p, [this]() -> Eigen::Vector4d { return _lhs->toTransformationMatrix() * _rhs->toHomogeneous(); });
     }
 
     void HomogeneousExpressionNodeMultiply::evaluateJacobiansImplementation(JacobianContainer & outJacobians) const
     {
-      _lhs->evaluateJacobians(outJacobians, sm::kinematics::boxMinus(_T_lhs * _p_rhs));
-      _rhs->evaluateJacobians(outJacobians, _T_lhs);
+      _lhs->evaluateJacobians(outJacobians, sm::kinematics::boxMinus(toHomogeneous()));
+      _rhs->evaluateJacobians(outJacobians, _lhs->toTransformationMatrix());
     }
 
     void HomogeneousExpressionNodeMultiply::getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const
@@ -1,15 +1,161 @@
 #include <aslam/backend/KinematicChain.hpp>
 
+#include <set>
+#include <unordered_map>
+#include <sm/kinematics/rotations.hpp>
+
 namespace aslam {
 namespace backend {
 
-void aslam::backend::CoordinateFrame::initGlobalsWithoutParent() {
-  R_G_L = R_P_L;
-  pG = p;
-  omegaG = omega;
-  vG = v;
-  alphaG = alpha;
-  aG = a;
+const CoordinateFrame::Globals & CoordinateFrame::globals() const {
+  boost::shared_ptr<const Globals> globals = boost::atomic_load(&_globals);
+  if (!globals) {
+    // Another thread may publish its globals in the meantime, the first one wins
+    boost::shared_ptr<const Globals> built = buildGlobals();
+    if (boost::atomic_compare_exchange(&_globals, &globals, built))
+      globals = built;
+  }
+  return *globals;
+}
+
+boost::shared_ptr<const CoordinateFrame::Globals> CoordinateFrame::buildGlobals() const {
+  boost::shared_ptr<Globals> g(new Globals);
+  if (!pp) {
+    g->R_G_L = R_P_L;
+    g->pG = p;
+    g->omegaG = omega;
+    g->vG = v;
+    g->alphaG = alpha;
+    g->aG = a;
+    return g;
+  }
+
+  const Globals & parent = pp->globals();
+  const RotationExpression & R_G_P = parent.R_G_L;
+
+  // The local quantities rotated into the global frame, shared by several globals
+  const EuclideanExpression pRotated = R_G_P * p;
+  const EuclideanExpression vRotated = R_G_P * v;
+  const EuclideanExpression omegaRotated = R_G_P * omega;
+  const EuclideanExpression omegaCrossP = parent.omegaG.cross(pRotated);
+
+  g->R_G_L = R_G_P * R_P_L;
+  g->pG = parent.pG + pRotated;
+  g->omegaG = parent.omegaG + omegaRotated;
+  g->alphaG = parent.alphaG + parent.omegaG.cross(omegaRotated) + R_G_P * alpha;
+  g->vG = parent.vG + vRotated + omegaCrossP;
+  g->aG = parent.aG + R_G_P * a + parent.omegaG.cross(vRotated) + parent.alphaG.cross(pRotated) + parent.omegaG.cross(omegaCrossP);
+  return g;
+}
+
+void KinematicChainEvaluator::evaluate(const std::vector<const CoordinateFrame*> & frames, bool evaluateJacobians) {
+  _frames.clear();
+  _hasJacobians = evaluateJacobians;
+  for (const CoordinateFrame * frame : frames) {
+    SM_ASSERT_TRUE(Exception, frame != nullptr, "Null frame!");
+    evaluateFrame(*frame, evaluateJacobians);
+  }
+}
+
+const KinematicChainEvaluator::FrameState & KinematicChainEvaluator::evaluateFrame(const CoordinateFrame & frame, bool evaluateJacobians) {
+  auto it = _frames.find(&frame);
+  if (it != _frames.end())
+    return *it->second;
+
+  boost::shared_ptr<FrameState> s(new FrameState);
+  const Eigen::Matrix3d R_P_L = frame.getR_P_L().toRotationMatrix();
+  const Eigen::Vector3d p = frame.getPP().evaluate();
+
+  const boost::shared_ptr<const CoordinateFrame> parentFrame = frame.getParent();
+  if (!parentFrame) {
+    s->R_G_L = R_P_L;
+    s->pG = p;
+    if (evaluateJacobians) {
+      frame.getR_P_L().evaluateJacobians(s->JR_G_L);
+      frame.getPP().evaluateJacobians(s->JpG);
+    }
+  } else {
+    const FrameState & parent = evaluateFrame(*parentFrame, evaluateJacobians);
+    const Eigen::Vector3d pRotated = parent.R_G_L * p;
+    s->R_G_L = parent.R_G_L * R_P_L;
+    s->pG = parent.pG + pRotated;
+    if (evaluateJacobians) {
+      // Same chain rule as for R_G_P * R_P_L and p_G_P + R_G_P * p
+      const Eigen::Matrix3d pRotatedCross = sm::kinematics::crossMx(pRotated);
+      s->JR_G_L.add(parent.JR_G_L);
+      frame.getR_P_L().evaluateJacobians(s->JR_G_L.apply(parent.R_G_L));
+      s->JpG.add(parent.JpG);
+      s->JpG.add(parent.JR_G_L, &pRotatedCross);
+      frame.getPP().evaluateJacobians(s->JpG.apply(parent.R_G_L));
+    }
+  }
+
+  return *(_frames[&frame] = s);
+}
+
+const KinematicChainEvaluator::FrameState & KinematicChainEvaluator::state(const CoordinateFrame & frame) const {
+  auto it = _frames.find(&frame);
+  SM_ASSERT_TRUE(Exception, it != _frames.end(), "The frame has not been evaluated");
+  return *it->second;
+}
+
+const Eigen::Matrix3d & KinematicChainEvaluator::getR_G_L(const CoordinateFrame & frame) const {
+  return state(frame).R_G_L;
+}
+
+const Eigen::Vector3d & KinematicChainEvaluator::getPG(const CoordinateFrame & frame) const {
+  return state(frame).pG;
+}
+
+const KinematicChainEvaluator::jacobian_container_t & KinematicChainEvaluator::getR_G_LJacobians(const CoordinateFrame & frame) const {
+  SM_ASSERT_TRUE(Exception, _hasJacobians, "The Jacobians have not been evaluated");
+  return state(frame).JR_G_L;
+}
+
+const KinematicChainEvaluator::jacobian_container_t & KinematicChainEvaluator::getPGJacobians(const CoordinateFrame & frame) const {
+  SM_ASSERT_TRUE(Exception, _hasJacobians, "The Jacobians have not been evaluated");
+  return state(frame).JpG;
+}
+
+void KinematicChainEvaluator::transformPoints(const CoordinateFrame & frame, const Eigen::Matrix3Xd & pointsL, Eigen::Matrix3Xd & outPointsG) const {
+  const FrameState & s = state(frame);
+  outPointsG.noalias() = s.R_G_L * pointsL;
+  outPointsG.colwise() += s.pG;
+}
+
+void KinematicChainEvaluator::transformPoints(const CoordinateFrame & frame, const Eigen::Matrix3Xd & pointsL, Eigen::Matrix3Xd & outPointsG,
+                                              std::vector<DesignVariable*> & outDesignVariables, Eigen::MatrixXd & outJacobians) const {
+  SM_ASSERT_TRUE(Exception, _hasJacobians, "The Jacobians have not been evaluated");
+  const FrameState & s = state(frame);
+
+  // Lay out the design variables of both Jacobians next to each other
+  std::set<DesignVariable*, DesignVariable::BlockIndexOrdering> designVariables;
+  for (const auto & J : s.JR_G_L)
+    designVariables.insert(J.first);
+  for (const auto & J : s.JpG)
+    designVariables.insert(J.first);
+  outDesignVariables.assign(designVariables.begin(), designVariables.end());
+
+  std::unordered_map<const DesignVariable*, int> columns;
+  int cols = 0;
+  for (DesignVariable * dv : outDesignVariables) {
+    columns[dv] = cols;
+    cols += dv->minimalDimensions();
+  }
+  Eigen::Matrix<double, 3, Eigen::Dynamic> JR(3, cols), Jp(3, cols);
+  JR.setZero();
+  Jp.setZero();
+  for (const auto & J : s.JR_G_L)
+    JR.middleCols(columns[J.first], J.second.cols()) = J.second;
+  for (const auto & J : s.JpG)
+    Jp.middleCols(columns[J.first], J.second.cols()) = J.second;
+
+  // p_G = p_G_L + R_G_L * p_L, so every point only adds its own lever arm
+  Eigen::Matrix3Xd pointsRotated = s.R_G_L * pointsL;
+  outPointsG = pointsRotated.colwise() + s.pG;
+  outJacobians.resize(3 * pointsL.cols(), cols);
+  for (int i = 0; i < pointsL.cols(); ++i)
+    outJacobians.middleRows<3>(3 * i).noalias() = Jp + sm::kinematics::crossMx(pointsRotated.col(i)) * JR;
 }
 
 }  // namespace backend
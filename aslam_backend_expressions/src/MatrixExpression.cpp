@@ -2,6 +2,7 @@
 #include <aslam/backend/MatrixExpressionNode.hpp>
 #include <aslam/backend/EuclideanExpressionNode.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 
 namespace aslam {
 namespace backend {
@@ -29,7 +30,7 @@ Eigen::Matrix3d MatrixExpression::evaluate() const
 }
 
 EuclideanExpression MatrixExpression::operator*(const EuclideanExpression & p) const {
-  boost::shared_ptr<EuclideanExpressionNode> newRoot(new EuclideanExpressionNodeMatrixMultiply(_root, p._root));  // ##
+  boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeMatrixMultiply>(_root, p._root);  // ##
   return EuclideanExpression(newRoot);
 }
 
@@ -1,8 +1,8 @@
-#include <boost/make_shared.hpp>
 #include <aslam/backend/RotationExpression.hpp>
 #include <aslam/backend/RotationExpressionNode.hpp>
 #include <aslam/backend/EuclideanExpressionNode.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 
 namespace aslam {
   namespace backend {
@@ -25,7 +25,7 @@ namespace aslam {
     }
 
     RotationExpression::RotationExpression(const Eigen::Matrix3d & C) :
-      _root(boost::make_shared<ConstantRotationExpressionNode>(C))
+      _root(makeNode<ConstantRotationExpressionNode>(C))
     {
     }
 
@@ -40,7 +40,7 @@ namespace aslam {
     RotationExpression RotationExpression::inverse() const
     {
       if(isEmpty()) return *this;
-      boost::shared_ptr<RotationExpressionNode> newRoot( new RotationExpressionNodeInverse(_root) );
+      boost::shared_ptr<RotationExpressionNode> newRoot = makeNode<RotationExpressionNodeInverse>(_root);
       return RotationExpression(newRoot);
     }
 
@@ -57,7 +57,7 @@ namespace aslam {
         return *this;
       if(this->isEmpty())
         return p;
-      boost::shared_ptr<RotationExpressionNode> newRoot( new RotationExpressionNodeMultiply(_root, p._root));
+      boost::shared_ptr<RotationExpressionNode> newRoot = makeNode<RotationExpressionNodeMultiply>(_root, p._root);
       return RotationExpression(newRoot);
     }
 
@@ -67,7 +67,7 @@ namespace aslam {
         return EuclideanExpression();
       if(this->isEmpty())
         return EuclideanExpression();
-      boost::shared_ptr<EuclideanExpressionNode> newRoot( new EuclideanExpressionNodeMultiply(_root, p._root));
+      boost::shared_ptr<EuclideanExpressionNode> newRoot = makeNode<EuclideanExpressionNodeMultiply>(_root, p._root);
       return EuclideanExpression(newRoot);
       
     }
@@ -94,7 +94,7 @@ namespace aslam {
     
     EuclideanExpression RotationExpression::toParameters(sm::kinematics::RotationalKinematics::Ptr rk) const {
       assert(!isEmpty());
-      boost::shared_ptr<EuclideanExpressionNode> een( new EuclideanExpressionNodeRotationParameters(_root, rk));
+      boost::shared_ptr<EuclideanExpressionNode> een = makeNode<EuclideanExpressionNodeRotationParameters>(_root, rk);
       return EuclideanExpression(een);
     }
 
@@ -1,6 +1,7 @@
 #include <aslam/backend/ScalarExpression.hpp>
 #include <aslam/backend/ScalarExpressionNode.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 
 namespace aslam {
 namespace backend {
@@ -9,7 +10,7 @@ ScalarExpression::ScalarExpression() {
 }
 
 ScalarExpression::ScalarExpression(double value)
-    : _root(new ScalarExpressionNodeConstant(value)) {
+    : _root(makeNode<ScalarExpressionNodeConstant>(value)) {
 }
 
 ScalarExpression::ScalarExpression(ScalarExpressionNode * designVariable)
@@ -41,54 +42,54 @@ void ScalarExpression::getDesignVariables(DesignVariable::set_t & designVariable
 }
 
 ScalarExpression ScalarExpression::operator+(const ScalarExpression & s) const {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAdd(_root, s._root));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAdd>(_root, s._root);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression ScalarExpression::operator-(const ScalarExpression & s) const {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAdd(_root, s._root, -1.0));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAdd>(_root, s._root, -1.0);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression ScalarExpression::operator-(double s) const {
-  boost::shared_ptr<ScalarExpressionNode> constant(new ScalarExpressionNodeConstant(-s));
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAdd(_root, constant));
+  boost::shared_ptr<ScalarExpressionNode> constant = makeNode<ScalarExpressionNodeConstant>(-s);
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAdd>(_root, constant);
   return ScalarExpression(newRoot);
 
 }
 
 ScalarExpression ScalarExpression::operator-() const {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeNegated(_root));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeNegated>(_root);
   return ScalarExpression(newRoot);
 
 }
 
 
 ScalarExpression ScalarExpression::operator/(const ScalarExpression & s) const {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeDivide(_root, s._root));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeDivide>(_root, s._root);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression ScalarExpression::operator/(double s) const {
-  boost::shared_ptr<ScalarExpressionNode> constant(new ScalarExpressionNodeConstant(s));
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeDivide(_root, constant));
+  boost::shared_ptr<ScalarExpressionNode> constant = makeNode<ScalarExpressionNodeConstant>(s);
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeDivide>(_root, constant);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression ScalarExpression::operator+(double s) const {
-  boost::shared_ptr<ScalarExpressionNode> constant(new ScalarExpressionNodeConstant(s));
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAdd(_root, constant));
+  boost::shared_ptr<ScalarExpressionNode> constant = makeNode<ScalarExpressionNodeConstant>(s);
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAdd>(_root, constant);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression ScalarExpression::operator*(double s) const {
-  boost::shared_ptr<ScalarExpressionNode> constant(new ScalarExpressionNodeConstant(s));
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeMultiply(_root, constant));
+  boost::shared_ptr<ScalarExpressionNode> constant = makeNode<ScalarExpressionNodeConstant>(s);
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeMultiply>(_root, constant);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression ScalarExpression::operator*(const ScalarExpression & s) const {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeMultiply(_root, s._root));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeMultiply>(_root, s._root);
   return ScalarExpression(newRoot);
 }
 
@@ -131,37 +132,37 @@ ScalarExpression createUnaryScalarExpressionOp(double(* eval)(double), double(*
 }
 
 ScalarExpression sqrt(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeSqrt(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeSqrt>(e.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression log(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeLog(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeLog>(e.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression exp(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeExp(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeExp>(e.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression atan(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAtan(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAtan>(e.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression tanh(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeTanh(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeTanh>(e.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression atan2(const ScalarExpression& e0, const ScalarExpression& e1) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAtan2(e0.root(), e1.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAtan2>(e0.root(), e1.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression acos(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAcos(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAcos>(e.root());
   return ScalarExpression(newRoot);
 }
 
@@ -174,22 +175,22 @@ ScalarExpression cos(const ScalarExpression& e) {
 }
 
 ScalarExpression acosSquared(const ScalarExpression& e) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeAcosSquared(e.root()));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeAcosSquared>(e.root());
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression inverseSigmoid(const ScalarExpression& e, const double height, const double scale, const double shift) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodeInverseSigmoid(e.root(), height, scale, shift));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodeInverseSigmoid>(e.root(), height, scale, shift);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression powerExpression(const ScalarExpression& e, const int k) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionNodePower(e.root(), k));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionNodePower>(e.root(), k);
   return ScalarExpression(newRoot);
 }
 
 ScalarExpression piecewiseExpression(const ScalarExpression& e1, const ScalarExpression& e2, std::function<bool()> useFirst) {
-  boost::shared_ptr<ScalarExpressionNode> newRoot(new ScalarExpressionPiecewiseExpression(e1.root(), e2.root(), useFirst));
+  boost::shared_ptr<ScalarExpressionNode> newRoot = makeNode<ScalarExpressionPiecewiseExpression>(e1.root(), e2.root(), useFirst);
   return ScalarExpression(newRoot);
 }
 
@@ -1,5 +1,6 @@
 #include <aslam/backend/TransformationExpression.hpp>
 #include <sm/boost/null_deleter.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 #include <aslam/backend/TransformationExpressionNode.hpp>
 #include <aslam/backend/HomogeneousExpressionNode.hpp>
 #include <aslam/backend/EuclideanExpression.hpp>
@@ -27,7 +28,7 @@ namespace aslam {
 
     TransformationExpression::TransformationExpression(const Eigen::Matrix4d & T)
     {
-      _root.reset(new TransformationExpressionNodeConstant(T));
+      _root = makeNode<TransformationExpressionNodeConstant>(T);
     }
 
     TransformationExpression::TransformationExpression(const RotationExpression & rotation, const EuclideanExpression & translation)
@@ -86,7 +87,7 @@ namespace aslam {
     HomogeneousExpression TransformationExpression::operator*(const HomogeneousExpression & rhs) const
     {
       if(!_root) return rhs;
-      boost::shared_ptr<HomogeneousExpressionNode> newRoot( new HomogeneousExpressionNodeMultiply(_root, rhs._root));
+      boost::shared_ptr<HomogeneousExpressionNode> newRoot = makeNode<HomogeneousExpressionNodeMultiply>(_root, rhs._root);
       return HomogeneousExpression(newRoot);
     }
     
@@ -94,14 +95,14 @@ namespace aslam {
     {
       if(!_root) return rhs;
       if(!rhs._root) return *this;
-      boost::shared_ptr<TransformationExpressionNode> newRoot( new TransformationExpressionNodeMultiply(_root, rhs._root));
+      boost::shared_ptr<TransformationExpressionNode> newRoot = makeNode<TransformationExpressionNodeMultiply>(_root, rhs._root);
       return TransformationExpression(newRoot);
     }
 
     TransformationExpression TransformationExpression::inverse() const
     {
       if(!_root) return *this;
-      boost::shared_ptr<TransformationExpressionNode> newRoot( new TransformationExpressionNodeInverse(_root));
+      boost::shared_ptr<TransformationExpressionNode> newRoot = makeNode<TransformationExpressionNodeInverse>(_root);
       return TransformationExpression(newRoot);
     }
 
@@ -4,6 +4,7 @@
 #include <aslam/backend/EuclideanExpressionNode.hpp>
 #include <aslam/backend/RotationExpression.hpp>
 #include <aslam/backend/RotationExpressionNode.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
 #include <Eigen/Dense>
 
 namespace aslam {
@@ -47,14 +48,12 @@ namespace aslam {
 
     Eigen::Matrix4d TransformationExpressionNodeMultiply::toTransformationMatrixImplementation()
     {
-      _T_lhs = _lhs->toTransformationMatrix();
-      _T_rhs = _rhs->toTransformationMatrix();
-      return  _T_lhs * _T_rhs;
+      return _valueStamp.value(*this, _T, [this]() -> Eigen::Matrix4d { return _lhs->toTransformationMatrix() * _rhs->toTransformationMatrix(); });
     }
 
     void TransformationExpressionNodeMultiply::evaluateJacobiansImplementation(JacobianContainer & outJacobians) const
     {	
-      _rhs->evaluateJacobians(outJacobians,sm::kinematics::boxTimes(_T_lhs));
+      _rhs->evaluateJacobians(outJacobians,sm::kinematics::boxTimes(_lhs->toTransformationMatrix()));
       _lhs->evaluateJacobians(outJacobians);
     }
 
@@ -68,15 +67,19 @@ namespace aslam {
     
     TransformationExpressionNodeInverse::~TransformationExpressionNodeInverse(){}
 
+    Eigen::Matrix4d TransformationExpressionNodeInverse::inverse() const
+    {
+      return _valueStamp.value(*this, _T, [this]() -> Eigen::Matrix4d { return _dvTransformation->toTransformationMatrix().inverse(); });
+    }
+
     Eigen::Matrix4d TransformationExpressionNodeInverse::toTransformationMatrixImplementation()
     {
-      _T = _dvTransformation->toTransformationMatrix().inverse();
-      return  _T;
+      return inverse();
     }
 
     void TransformationExpressionNodeInverse::evaluateJacobiansImplementation(JacobianContainer & outJacobians) const
     {
-      _dvTransformation->evaluateJacobians(outJacobians, -sm::kinematics::boxTimes(_T));
+      _dvTransformation->evaluateJacobians(outJacobians, -sm::kinematics::boxTimes(inverse()));
     }
 
     void TransformationExpressionNodeInverse::getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const
@@ -94,12 +97,12 @@ namespace aslam {
 
   RotationExpression aslam::backend::TransformationExpressionNode::toRotationExpression(const boost::shared_ptr<TransformationExpressionNode>& thisShared) const {
     assert(thisShared.get() == this);
-    return boost::shared_ptr< RotationExpressionNode >( new RotationExpressionNodeTransformation( thisShared ) );
+    return RotationExpression( makeNode<RotationExpressionNodeTransformation>( thisShared ) );
   }
 
   EuclideanExpression aslam::backend::TransformationExpressionNode::toEuclideanExpression(const boost::shared_ptr<TransformationExpressionNode>& thisShared) const {
     assert(thisShared.get() == this);
-    return boost::shared_ptr< EuclideanExpressionNode >( new EuclideanExpressionNodeTranslation( thisShared ) );
+    return EuclideanExpression( makeNode<EuclideanExpressionNodeTranslation>( thisShared ) );
   }
 
   } // namespace backend
@@ -0,0 +1,474 @@
+/*
+ * Benchmark.cpp
+ *
+ * Benchmarks Optimizer2 end to end on reproducible synthetic problems of growing size:
+ * bundle adjustment, SE(3) pose graphs and a B-spline with a shared dense calibration.
+ * Every run is written as one CSV line to allow comparing builds against each other.
+ * By default every run has its own process, so that maxRssKb is the peak memory of that run.
+ */
+
+// standard includes
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// system includes
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// boost includes
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Eigen includes
+#include <Eigen/Geometry>
+
+// Schweizer Messer includes
+#include <sm/assert_macros.hpp>
+#include <sm/logging.hpp>
+#include <sm/kinematics/Transformation.hpp>
+
+// aslam backend includes
+#include <aslam/backend/OptimizationProblem.hpp>
+#include <aslam/backend/Optimizer2.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/SparseQrLinearSystemSolver.hpp>
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/util/Instrumentation.hpp>
+#include <aslam/backend/RotationQuaternion.hpp>
+#include <aslam/backend/EuclideanPoint.hpp>
+#include <aslam/backend/TransformationExpression.hpp>
+#include <aslam/backend/DesignVariableVector.hpp>
+#include <aslam/backend/ErrorTermTransformation.hpp>
+
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+  typedef std::mt19937 rng_t;
+
+  Eigen::Vector3d randomVector(rng_t & rng, double sigma) {
+    std::normal_distribution<double> n(0.0, sigma);
+    return Eigen::Vector3d(n(rng), n(rng), n(rng));
+  }
+
+  Eigen::Matrix3d randomRotation(rng_t & rng, double sigma) {
+    const Eigen::Vector3d aa = randomVector(rng, sigma);
+    const double angle = aa.norm();
+    if (angle < 1e-12)
+      return Eigen::Matrix3d::Identity();
+    return Eigen::AngleAxisd(angle, aa / angle).toRotationMatrix();
+  }
+
+  Eigen::Matrix4d transformation(const Eigen::Matrix3d & C, const Eigen::Vector3d & t) {
+    Eigen::Matrix4d T = Eigen::Matrix4d::Identity();
+    T.topLeftCorner<3, 3>() = C;
+    T.topRightCorner<3, 1>() = t;
+    return T;
+  }
+
+  Eigen::Matrix4d perturb(const Eigen::Matrix4d & T, rng_t & rng, double sigmaRotation, double sigmaTranslation) {
+    return T * transformation(randomRotation(rng, sigmaRotation), randomVector(rng, sigmaTranslation));
+  }
+
+  /// \brief A pose made of a rotation and a translation design variable
+  struct Pose {
+    Pose(boost::shared_ptr<OptimizationProblem> problem, const Eigen::Matrix4d & T, bool active)
+        : q(new RotationQuaternion(Eigen::Matrix3d(T.topLeftCorner<3, 3>()))),
+          t(new EuclideanPoint(Eigen::Vector3d(T.topRightCorner<3, 1>()))) {
+      q->setActive(active);
+      t->setActive(active);
+      problem->addDesignVariable(q);
+      problem->addDesignVariable(t);
+    }
+    TransformationExpression toExpression() const {
+      return TransformationExpression(RotationExpression(q.get()), EuclideanExpression(t.get()));
+    }
+    boost::shared_ptr<RotationQuaternion> q;
+    boost::shared_ptr<EuclideanPoint> t;
+  };
+
+  /// \brief Pinhole reprojection error of a point given in camera coordinates
+  class ReprojectionError : public ErrorTermFs<2> {
+   public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    ReprojectionError(const EuclideanExpression & p_c, const Eigen::Vector2d & y, double focalLength, double sigma)
+        : _p_c(p_c), _y(y), _f(focalLength) {
+      setInvR(Eigen::Matrix2d::Identity() / (sigma * sigma));
+      DesignVariable::set_t dvs;
+      _p_c.getDesignVariables(dvs);
+      setDesignVariablesIterator(dvs.begin(), dvs.end());
+    }
+   protected:
+    double evaluateErrorImplementation() override {
+      const Eigen::Vector3d p = _p_c.toEuclidean();
+      setError(Eigen::Vector2d(_f * p.head<2>() / p[2] - _y));
+      return evaluateChiSquaredError();
+    }
+    void evaluateJacobiansImplementation(JacobianContainer & J) override {
+      const Eigen::Vector3d p = _p_c.toEuclidean();
+      Eigen::MatrixXd Jp(2, 3);
+      Jp << 1.0 / p[2], 0.0, -p[0] / (p[2] * p[2]),
+            0.0, 1.0 / p[2], -p[1] / (p[2] * p[2]);
+      _p_c.evaluateJacobians(J, _f * Jp);
+    }
+   private:
+    EuclideanExpression _p_c;
+    Eigen::Vector2d _y;
+    double _f;
+  };
+
+  /// \brief A sample of a uniform cubic B-spline, optionally measured through a
+  ///        calibration (scale, bias) shared by all samples
+  class SplineSampleError : public ErrorTermFs<3> {
+   public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    SplineSampleError(const std::vector<DesignVariableVector<3>*> & controlPoints, DesignVariableVector<4> * calibration,
+                      double u, const Eigen::Vector3d & y, double sigma)
+        : _controlPoints(controlPoints), _calibration(calibration), _y(y) {
+      _b << (1 - u) * (1 - u) * (1 - u), 3 * u * u * u - 6 * u * u + 4, -3 * u * u * u + 3 * u * u + 3 * u + 1, u * u * u;
+      _b /= 6.0;
+      setInvR(Eigen::Matrix3d::Identity() / (sigma * sigma));
+      std::vector<DesignVariable*> dvs(controlPoints.begin(), controlPoints.end());
+      if (calibration != nullptr)
+        dvs.push_back(calibration);
+      setDesignVariables(dvs);
+    }
+    static Eigen::Vector3d evaluate(const std::vector<Eigen::Vector3d> & c, double u) {
+      const double b[4] = { (1 - u) * (1 - u) * (1 - u) / 6, (3 * u * u * u - 6 * u * u + 4) / 6, (-3 * u * u * u + 3 * u * u + 3 * u + 1) / 6, u * u * u / 6 };
+      return b[0] * c[0] + b[1] * c[1] + b[2] * c[2] + b[3] * c[3];
+    }
+   protected:
+    double evaluateErrorImplementation() override {
+      setError(Eigen::Vector3d(measure(position()) - _y));
+      return evaluateChiSquaredError();
+    }
+    void evaluateJacobiansImplementation(JacobianContainer & J) override {
+      const double scale = _calibration == nullptr ? 1.0 : _calibration->value()[0];
+      for (int k = 0; k < 4; ++k)
+        J.add(_controlPoints[k], Eigen::MatrixXd(scale * _b[k] * Eigen::Matrix3d::Identity()));
+      if (_calibration != nullptr) {
+        Eigen::MatrixXd Jc(3, 4);
+        Jc << position(), Eigen::Matrix3d::Identity();
+        J.add(_calibration, Jc);
+      }
+    }
+   private:
+    Eigen::Vector3d position() const {
+      Eigen::Vector3d p = Eigen::Vector3d::Zero();
+      for (int k = 0; k < 4; ++k)
+        p += _b[k] * _controlPoints[k]->value();
+      return p;
+    }
+    Eigen::Vector3d measure(const Eigen::Vector3d & p) const {
+      if (_calibration == nullptr)
+        return p;
+      return _calibration->value()[0] * p + _calibration->value().tail<3>();
+    }
+    std::vector<DesignVariableVector<3>*> _controlPoints;
+    DesignVariableVector<4> * _calibration;
+    Eigen::Vector4d _b;
+    Eigen::Vector3d _y;
+  };
+
+  /// \brief Cameras on a line looking along z at points in front of them. Each point is
+  ///        observed by the cameras within \p observationRange. The first two cameras fix the gauge.
+  boost::shared_ptr<OptimizationProblem> createBundleAdjustment(size_t numCameras, size_t numPoints, double observationRange, rng_t & rng) {
+    const double focalLength = 500.0, pixelSigma = 1.0;
+    boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem);
+    std::vector<Eigen::Matrix4d> T_w_c;
+    std::vector<Pose> cameras;
+    for (size_t i = 0; i < numCameras; ++i) {
+      T_w_c.push_back(transformation(randomRotation(rng, 0.05), Eigen::Vector3d(double(i), 0.0, 0.0)));
+      const bool active = i >= 2;
+      cameras.emplace_back(problem, active ? perturb(T_w_c.back(), rng, 0.01, 0.05) : T_w_c.back(), active);
+    }
+    std::uniform_real_distribution<double> x(0.0, double(numCameras)), y(-3.0, 3.0), z(5.0, 15.0);
+    std::normal_distribution<double> pixelNoise(0.0, pixelSigma);
+    for (size_t j = 0; j < numPoints; ++j) {
+      const Eigen::Vector3d p_w(x(rng), y(rng), z(rng));
+      boost::shared_ptr<EuclideanPoint> point(new EuclideanPoint(Eigen::Vector3d(p_w + randomVector(rng, 0.1))));
+      point->setActive(true);
+      problem->addDesignVariable(point);
+      for (size_t i = 0; i < numCameras; ++i) {
+        if (std::abs(T_w_c[i](0, 3) - p_w[0]) > observationRange)
+          continue;
+        const Eigen::Vector3d p_c = (T_w_c[i].inverse() * p_w.homogeneous()).head<3>();
+        const Eigen::Vector2d y = focalLength * p_c.head<2>() / p_c[2] + Eigen::Vector2d(pixelNoise(rng), pixelNoise(rng));
+        const EuclideanExpression p_c_expression = cameras[i].toExpression().inverse() * EuclideanExpression(point.get());
+        problem->addErrorTerm(boost::shared_ptr<ErrorTerm>(new ReprojectionError(p_c_expression, y, focalLength, pixelSigma)));
+      }
+    }
+    return problem;
+  }
+
+  /// \brief Poses on a helix connected by odometry and by loop closures to the pose one
+  ///        revolution earlier. The initial guess integrates the noisy odometry.
+  boost::shared_ptr<OptimizationProblem> createPoseGraph(size_t numPoses, size_t posesPerRevolution, rng_t & rng) {
+    const double sigmaRotation = 0.01, sigmaTranslation = 0.05;
+    boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem);
+    std::vector<Eigen::Matrix4d> T_w_p;
+    for (size_t i = 0; i < numPoses; ++i) {
+      const double angle = 2.0 * M_PI * double(i) / double(posesPerRevolution);
+      T_w_p.push_back(transformation(Eigen::AngleAxisd(angle, Eigen::Vector3d::UnitZ()).toRotationMatrix(),
+                                     Eigen::Vector3d(10.0 * std::cos(angle), 10.0 * std::sin(angle), 0.1 * double(i))));
+    }
+    auto measure = [&](size_t i, size_t j) {
+      return perturb(T_w_p[i].inverse() * T_w_p[j], rng, sigmaRotation, sigmaTranslation);
+    };
+
+    std::vector<Pose> poses;
+    std::vector<Eigen::Matrix4d> odometry;
+    Eigen::Matrix4d T = T_w_p.front();
+    for (size_t i = 0; i < numPoses; ++i) {
+      if (i > 0) {
+        odometry.push_back(measure(i - 1, i));
+        T = T * odometry.back();
+      }
+      poses.emplace_back(problem, T, i > 0);
+    }
+    auto addEdge = [&](size_t i, size_t j, const Eigen::Matrix4d & T_i_j) {
+      problem->addErrorTerm(boost::shared_ptr<ErrorTerm>(new ErrorTermTransformation(
+          poses[i].toExpression().inverse() * poses[j].toExpression(), sm::kinematics::Transformation(T_i_j),
+          1.0 / (sigmaRotation * sigmaRotation), 1.0 / (sigmaTranslation * sigmaTranslation))));
+    };
+    for (size_t i = 1; i < numPoses; ++i)
+      addEdge(i - 1, i, odometry[i - 1]);
+    for (size_t i = posesPerRevolution; i < numPoses; ++i)
+      addEdge(i - posesPerRevolution, i, measure(i - posesPerRevolution, i));
+    return problem;
+  }
+
+  /// \brief A 3d uniform cubic B-spline sampled by a calibrated sensor. Every
+  ///        \p referenceEach-th sample comes from an uncalibrated reference sensor,
+  ///        which makes the scale observable. The calibration couples all samples,
+  ///        i.e. it adds a dense row and column to the otherwise banded system.
+  boost::shared_ptr<OptimizationProblem> createSpline(size_t numControlPoints, size_t samplesPerSegment, size_t referenceEach, rng_t & rng) {
+    const double sigma = 0.01;
+    boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem);
+    std::vector<Eigen::Vector3d> c(1, Eigen::Vector3d::Zero());
+    for (size_t i = 1; i < numControlPoints; ++i)
+      c.push_back(c.back() + randomVector(rng, 1.0));
+    const Eigen::Vector4d trueCalibration(1.05, 0.1, -0.2, 0.3);
+
+    std::vector< boost::shared_ptr< DesignVariableVector<3> > > controlPoints;
+    for (size_t i = 0; i < numControlPoints; ++i) {
+      controlPoints.emplace_back(new DesignVariableVector<3>(c[i] + randomVector(rng, 0.1)));
+      controlPoints.back()->setActive(true);
+      problem->addDesignVariable(controlPoints.back());
+    }
+    boost::shared_ptr< DesignVariableVector<4> > calibration(new DesignVariableVector<4>(Eigen::Vector4d(1.0, 0.0, 0.0, 0.0)));
+    calibration->setActive(true);
+    problem->addDesignVariable(calibration);
+
+    size_t n = 0;
+    for (size_t s = 0; s + 3 < numControlPoints; ++s) {
+      const std::vector<Eigen::Vector3d> segment(c.begin() + s, c.begin() + s + 4);
+      std::vector<DesignVariableVector<3>*> segmentDvs;
+      for (size_t k = 0; k < 4; ++k)
+        segmentDvs.push_back(controlPoints[s + k].get());
+      for (size_t i = 0; i < samplesPerSegment; ++i, ++n) {
+        const double u = double(i) / double(samplesPerSegment);
+        const bool reference = n % referenceEach == 0;
+        Eigen::Vector3d y = SplineSampleError::evaluate(segment, u);
+        if (!reference)
+          y = trueCalibration[0] * y + trueCalibration.tail<3>();
+        y += randomVector(rng, sigma);
+        problem->addErrorTerm(boost::shared_ptr<ErrorTerm>(new SplineSampleError(segmentDvs, reference ? nullptr : calibration.get(), u, y, sigma)));
+      }
+    }
+    return problem;
+  }
+
+  boost::shared_ptr<LinearSystemSolver> createSolver(const string & name) {
+    if (name == "sparse_cholesky")
+      return boost::shared_ptr<LinearSystemSolver>(new SparseCholeskyLinearSystemSolver());
+    if (name == "block_cholesky")
+      return boost::shared_ptr<LinearSystemSolver>(new BlockCholeskyLinearSystemSolver());
+    if (name == "sparse_qr")
+      return boost::shared_ptr<LinearSystemSolver>(new SparseQrLinearSystemSolver());
+    if (name == "dense_qr")
+      return boost::shared_ptr<LinearSystemSolver>(new DenseQrLinearSystemSolver());
+    throw std::runtime_error("Unknown linear solver " + name);
+  }
+
+  double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// \brief The peak resident set size of the process so far. It never decreases, so it
+  ///        only describes a single run if the run has its own process (see runInChildProcess()).
+  long maxRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  /// \brief Run \p f in a child process and wait for it. The peak resident set size of the
+  ///        child covers this run and the small benchmark process it was forked from.
+  template <typename F>
+  void runInChildProcess(F f, std::ostream & out) {
+    out.flush();
+    const pid_t pid = fork();
+    SM_ASSERT_GE(std::runtime_error, pid, 0, "Failed to fork the benchmark process");
+    if (pid == 0) {
+      int status = EXIT_SUCCESS;
+      try {
+        f();
+      } catch (std::exception & e) {
+        SM_ERROR_STREAM(e.what());
+        status = EXIT_FAILURE;
+      }
+      out.flush();
+      // Don't run the destructors of the parent's objects
+      _exit(status);
+    }
+    int status = 0;
+    SM_ASSERT_EQ(std::runtime_error, waitpid(pid, &status, 0), pid, "Failed to wait for the benchmark run");
+    SM_ASSERT_TRUE(std::runtime_error, WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS, "A benchmark run failed");
+  }
+
+  double seconds(std::uint64_t ns) {
+    return double(ns) * 1e-9;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Warn";
+    vector<string> problems{"ba", "posegraph", "spline"};
+    // The dense QR solver stores the full Jacobian, which needs gigabytes and minutes per iteration
+    // on the larger problems. It only runs when asked for.
+    vector<string> solvers{"sparse_cholesky", "block_cholesky", "sparse_qr"};
+    vector<size_t> scales{1, 2, 4};
+    vector<size_t> threads{1, 4};
+    size_t repetitions = 1, maxIterations = 10;
+    unsigned seed = 1;
+    size_t baCameras = 20, baPoints = 500, posegraphPoses = 200, posegraphPosesPerRevolution = 50,
+           splineControlPoints = 100, splineSamplesPerSegment = 20, splineReferenceEach = 10;
+    double baObservationRange = 3.0;
+    bool forkRuns = true;
+    string output;
+
+    namespace po = boost::program_options;
+    po::options_description desc("aslam_backend_expressions benchmark options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("problems", po::value(&problems)->multitoken(), "Problems to benchmark: ba, posegraph, spline (default all)")
+      ("solvers", po::value(&solvers)->multitoken(), "Linear solvers: sparse_cholesky, block_cholesky, sparse_qr, dense_qr (default all but dense_qr)")
+      ("scales", po::value(&scales)->multitoken(), "Problem size multipliers (default 1 2 4)")
+      ("threads", po::value(&threads)->multitoken(), "Numbers of threads for the error and Jacobian evaluation (default 1 4)")
+      ("repetitions", po::value(&repetitions)->default_value(repetitions), "Number of runs per configuration")
+      ("max-iterations", po::value(&maxIterations)->default_value(maxIterations), "Maximum number of optimizer iterations")
+      ("seed", po::value(&seed)->default_value(seed), "Seed of the problem generator")
+      ("ba-cameras", po::value(&baCameras)->default_value(baCameras), "Bundle adjustment: cameras at scale 1")
+      ("ba-points", po::value(&baPoints)->default_value(baPoints), "Bundle adjustment: points at scale 1")
+      ("ba-observation-range", po::value(&baObservationRange)->default_value(baObservationRange), "Bundle adjustment: lateral distance up to which cameras observe a point")
+      ("posegraph-poses", po::value(&posegraphPoses)->default_value(posegraphPoses), "Pose graph: poses at scale 1")
+      ("posegraph-poses-per-revolution", po::value(&posegraphPosesPerRevolution)->default_value(posegraphPosesPerRevolution), "Pose graph: distance of the loop closures")
+      ("spline-control-points", po::value(&splineControlPoints)->default_value(splineControlPoints), "Spline: control points at scale 1")
+      ("spline-samples-per-segment", po::value(&splineSamplesPerSegment)->default_value(splineSamplesPerSegment), "Spline: samples per segment")
+      ("spline-reference-each", po::value(&splineReferenceEach)->default_value(splineReferenceEach), "Spline: every n-th sample is uncalibrated")
+      ("fork", po::value(&forkRuns)->default_value(forkRuns), "Run every configuration in its own process. Otherwise maxRssKb is the peak of all runs so far")
+      ("output,o", po::value(&output), "Write the CSV results to this file instead of stdout")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    std::ofstream file;
+    if (!output.empty()) {
+      file.open(output.c_str());
+      SM_ASSERT_TRUE(std::runtime_error, file.good(), "Failed to open " << output);
+    }
+    std::ostream & out = output.empty() ? cout : file;
+    // Durations of the phases are summed over all threads
+    out << "problem,scale,solver,threads,repetition,numDesignVariables,numErrorTerms,numParameters,numResiduals,"
+           "setupS,initializeS,optimizeS,iterations,failedIterations,JStart,JFinal,"
+           "errorEvaluationS,jacobianEvaluationS,assemblyS,factorizationS,solveS,stateUpdateS,maxRssKb" << endl;
+
+    instrumentation::setEnabled(true);
+    for (const string & problemName : problems) {
+      for (size_t scale : scales) {
+        for (const string & solverName : solvers) {
+          for (size_t nThreads : threads) {
+            for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+              // Every run optimizes the same problem
+              auto run = [&]() {
+                rng_t rng(seed);
+                const auto setupStart = now();
+                boost::shared_ptr<OptimizationProblem> problem;
+                if (problemName == "ba")
+                  problem = createBundleAdjustment(scale * baCameras, scale * baPoints, baObservationRange, rng);
+                else if (problemName == "posegraph")
+                  problem = createPoseGraph(scale * posegraphPoses, posegraphPosesPerRevolution, rng);
+                else if (problemName == "spline")
+                  problem = createSpline(scale * splineControlPoints, splineSamplesPerSegment, splineReferenceEach, rng);
+                else
+                  throw std::runtime_error("Unknown problem " + problemName);
+                const auto setupEnd = now();
+
+                Optimizer2Options options;
+                options.linearSystemSolver = createSolver(solverName);
+                options.maxIterations = maxIterations;
+                options.numThreadsError = nThreads;
+                options.numThreadsJacobian = nThreads;
+                Optimizer2 optimizer(options);
+                optimizer.setProblem(problem);
+                instrumentation::reset();
+                optimizer.initialize();
+                const auto optimizeStart = now();
+                const SolutionReturnValue srv = optimizer.optimize();
+                const auto optimizeEnd = now();
+                const instrumentation::Report report = instrumentation::collect();
+
+                size_t numParameters = 0, numResiduals = 0;
+                for (size_t i = 0; i < problem->numDesignVariables(); ++i)
+                  if (problem->designVariable(i)->isActive())
+                    numParameters += problem->designVariable(i)->minimalDimensions();
+                for (size_t i = 0; i < problem->numErrorTerms(); ++i)
+                  numResiduals += problem->errorTerm(i)->dimension();
+
+                out << problemName << ',' << scale << ',' << solverName << ',' << nThreads << ',' << repetition << ','
+                    << problem->numDesignVariables() << ',' << problem->numErrorTerms() << ',' << numParameters << ',' << numResiduals << ','
+                    << setupEnd - setupStart << ',' << optimizeStart - setupEnd << ',' << optimizeEnd - optimizeStart << ','
+                    << srv.iterations << ',' << srv.failedIterations << ',' << srv.JStart << ',' << srv.JFinal;
+                for (int p = 0; p < instrumentation::NumPhases; ++p)
+                  out << ',' << seconds(report.phases[p].totalNs);
+                out << ',' << maxRssKb() << endl;
+              };
+              if (forkRuns)
+                runInChildProcess(run, out);
+              else
+                run();
+            }
+          }
+        }
+      }
+    }
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
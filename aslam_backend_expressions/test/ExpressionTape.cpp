@@ -0,0 +1,227 @@
+#include <sm/eigen/gtest.hpp>
+#include <sm/kinematics/quaternion_algebra.hpp>
+#include <aslam/backend/test/ExpressionTests.hpp>
+#include <aslam/backend/RotationQuaternion.hpp>
+#include <aslam/backend/EuclideanPoint.hpp>
+#include <aslam/backend/RotationExpression.hpp>
+#include <aslam/backend/EuclideanExpression.hpp>
+#include <aslam/backend/HomogeneousPoint.hpp>
+#include <aslam/backend/TransformationExpression.hpp>
+#include <aslam/backend/ExpressionTape.hpp>
+#include <aslam/backend/ExpressionErrorTerm.hpp>
+
+using namespace aslam::backend;
+using namespace sm::kinematics;
+
+namespace {
+  // C_ab * (C_bc^-1 * p - q) x (p .* r) - C_ab * C_bc * (-r)
+  EuclideanExpression buildExpression(RotationQuaternion & qab, RotationQuaternion & qbc, EuclideanPoint & p, EuclideanPoint & q, const Eigen::Vector3d & r)
+  {
+    RotationExpression Cab(&qab), Cbc(&qbc);
+    EuclideanExpression ep(&p), eq(&q), er(r);
+    EuclideanExpression lhs = Cab * (Cbc.inverse() * ep - eq);
+    return lhs.cross(ep.elementwiseMultiply(er)) - (Cab * Cbc) * (-er) - Eigen::Vector3d(1.0, 2.0, 3.0);
+  }
+
+  // Forwards to its operand and counts how often it is asked for its Jacobians
+  class CountingNode : public EuclideanExpressionNode
+  {
+   public:
+    CountingNode(const EuclideanExpression & operand) : _operand(operand.root()) {}
+    mutable int numJacobianEvaluations = 0;
+   private:
+    Eigen::Vector3d evaluateImplementation() const override { return _operand->evaluate(); }
+    void evaluateJacobiansImplementation(JacobianContainer & outJacobians) const override {
+      ++numJacobianEvaluations;
+      _operand->evaluateJacobians(outJacobians);
+    }
+    void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override { _operand->getDesignVariables(designVariables); }
+    boost::shared_ptr<EuclideanExpressionNode> _operand;
+  };
+
+  Eigen::MatrixXd evaluateJacobianDense(const CompiledEuclideanExpression & expr) {
+    JacobianContainerSparse<3> jc(3);
+    expr.evaluateJacobians(jc);
+    return jc.asDenseMatrix();
+  }
+
+  Eigen::MatrixXd evaluateJacobianDense(const EuclideanExpression & expr) {
+    JacobianContainerSparse<3> jc(3);
+    expr.evaluateJacobians(jc);
+    return jc.asDenseMatrix();
+  }
+}
+
+// Test that the compiled expression matches the interpreted expression and the finite differences
+TEST(ExpressionTapeTestSuites, testCompiledMatchesInterpreted)
+{
+  try
+  {
+    RotationQuaternion qab(quatRandom()), qbc(quatRandom());
+    EuclideanPoint p(Eigen::Vector3d::Random()), q(Eigen::Vector3d::Random());
+    EuclideanExpression expr = buildExpression(qab, qbc, p, q, Eigen::Vector3d::Random());
+    CompiledEuclideanExpression cexpr = compileExpression(expr);
+
+    // The DVs are the only leaves, everything else is flattened
+    EXPECT_EQ(4u, cexpr.tape()->numLeaves());
+
+    SCOPED_TRACE("");
+    testExpression(cexpr, 4);
+
+    sm::eigen::assertNear(expr.evaluate(), cexpr.evaluate(), 1e-12, SM_SOURCE_FILE_POS, "Testing the value");
+    sm::eigen::assertNear(evaluateJacobianDense(expr), evaluateJacobianDense(cexpr), 1e-12, SM_SOURCE_FILE_POS, "Testing the Jacobian");
+
+    // The compiled expression has to follow updates of the design variables
+    const Eigen::Vector3d dx = Eigen::Vector3d::Random();
+    qab.update(dx.data(), 3);
+    p.update(dx.data(), 3);
+    sm::eigen::assertNear(expr.evaluate(), cexpr.evaluate(), 1e-12, SM_SOURCE_FILE_POS, "Testing the value after an update");
+    sm::eigen::assertNear(evaluateJacobianDense(expr), evaluateJacobianDense(cexpr), 1e-12, SM_SOURCE_FILE_POS, "Testing the Jacobian after an update");
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Test that a design variable used several times gets its Jacobians accumulated
+TEST(ExpressionTapeTestSuites, testSharedSubexpression)
+{
+  try
+  {
+    RotationQuaternion quat(quatRandom());
+    EuclideanPoint point(Eigen::Vector3d::Random());
+    RotationExpression C(&quat);
+    EuclideanExpression p(&point);
+    EuclideanExpression Cp = C * p;
+    EuclideanExpression expr = Cp.cross(p) + C.inverse() * Cp;
+
+    CompiledEuclideanExpression cexpr = compileExpression(expr);
+    EXPECT_EQ(2u, cexpr.tape()->numLeaves());
+
+    SCOPED_TRACE("");
+    testExpression(cexpr, 2);
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Test the transformation and homogeneous operations against the interpreted expression
+TEST(ExpressionTapeTestSuites, testTransformations)
+{
+  try
+  {
+    RotationQuaternion qab(quatRandom()), qbc(quatRandom());
+    EuclideanPoint tab(Eigen::Vector3d::Random()), tbc(Eigen::Vector3d::Random()), p(Eigen::Vector3d::Random());
+    HomogeneousPoint ph(Eigen::Vector4d::Random());
+    RotationExpression Cab(&qab), Cbc(&qbc);
+    EuclideanExpression eab(&tab), ebc(&tbc);
+    TransformationExpression Tab(Cab, eab), Tbc(Cbc, ebc);
+    Eigen::Matrix4d Tcd = Eigen::Matrix4d::Identity();
+    Tcd.topLeftCorner<3,3>() = quat2r(quatRandom());
+    Tcd.topRightCorner<3,1>() = Eigen::Vector3d::Random();
+
+    // The pose Tab is shared by all terms
+    TransformationExpression Tac = Tab * Tbc;
+    EuclideanExpression expr = (Tab * EuclideanExpression(&p)).cross((Tac.inverse() * TransformationExpression(Tcd) * HomogeneousExpression(&ph)).toEuclideanExpression())
+        + Tac.toRotationExpression() * Tac.toEuclideanExpression() + Tab.inverse().toEuclideanExpression();
+
+    CompiledEuclideanExpression cexpr = compileExpression(expr);
+    EXPECT_EQ(6u, cexpr.tape()->numLeaves());
+
+    SCOPED_TRACE("");
+    testExpression(cexpr, 6);
+
+    sm::eigen::assertNear(expr.evaluate(), cexpr.evaluate(), 1e-10, SM_SOURCE_FILE_POS, "Testing the value");
+    sm::eigen::assertNear(evaluateJacobianDense(expr), evaluateJacobianDense(cexpr), 1e-10, SM_SOURCE_FILE_POS, "Testing the Jacobian");
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Test that a subexpression reached along many paths is differentiated once
+TEST(ExpressionTapeTestSuites, testFanOut)
+{
+  try
+  {
+    EuclideanPoint point(Eigen::Vector3d::Random());
+    boost::shared_ptr<CountingNode> counter(new CountingNode(EuclideanExpression(&point)));
+
+    // 2^10 paths from the root to the counting node
+    const int depth = 10;
+    EuclideanExpression expr(counter);
+    for (int i = 0; i < depth; ++i)
+      expr = expr + expr;
+
+    const Eigen::MatrixXd J = evaluateJacobianDense(expr);
+    EXPECT_EQ(1 << depth, counter->numJacobianEvaluations);
+
+    counter->numJacobianEvaluations = 0;
+    CompiledEuclideanExpression cexpr = compileExpression(expr);
+    EXPECT_EQ(static_cast<std::size_t>(depth), cexpr.tape()->numInstructions() - 1);
+    sm::eigen::assertNear(J, evaluateJacobianDense(cexpr), 1e-10, SM_SOURCE_FILE_POS, "Testing the Jacobian");
+    EXPECT_EQ(1, counter->numJacobianEvaluations);
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Test that expressions with the same structure share one tape
+TEST(ExpressionTapeTestSuites, testTapeSharing)
+{
+  try
+  {
+    ExpressionTapeCompiler compiler;
+    RotationQuaternion qab0(quatRandom()), qbc0(quatRandom()), qab1(quatRandom()), qbc1(quatRandom());
+    EuclideanPoint p0(Eigen::Vector3d::Random()), q0(Eigen::Vector3d::Random()), p1(Eigen::Vector3d::Random()), q1(Eigen::Vector3d::Random());
+
+    EuclideanExpression expr0 = buildExpression(qab0, qbc0, p0, q0, Eigen::Vector3d::Random());
+    EuclideanExpression expr1 = buildExpression(qab1, qbc1, p1, q1, Eigen::Vector3d::Random());
+    CompiledEuclideanExpression cexpr0 = compiler.compile(expr0);
+    CompiledEuclideanExpression cexpr1 = compiler.compile(expr1);
+
+    EXPECT_EQ(1u, compiler.numTapes());
+    EXPECT_EQ(cexpr0.tape().get(), cexpr1.tape().get());
+
+    // Same tape, but the constants and leaves are bound per instance
+    sm::eigen::assertNear(expr0.evaluate(), cexpr0.evaluate(), 1e-12, SM_SOURCE_FILE_POS, "");
+    sm::eigen::assertNear(expr1.evaluate(), cexpr1.evaluate(), 1e-12, SM_SOURCE_FILE_POS, "");
+
+    // A different sharing pattern is a different structure
+    RotationExpression C(&qab0);
+    EuclideanExpression p(&p0), q(&q0);
+    compiler.compile(C * p + C * q);
+    compiler.compile(C * p + C * p);
+    EXPECT_EQ(3u, compiler.numTapes());
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Test that a compiled expression can be used as an error term
+TEST(ExpressionTapeTestSuites, testErrorTerm)
+{
+  try
+  {
+    RotationQuaternion qab(quatRandom()), qbc(quatRandom());
+    EuclideanPoint p(Eigen::Vector3d::Random()), q(Eigen::Vector3d::Random());
+    EuclideanExpression expr = buildExpression(qab, qbc, p, q, Eigen::Vector3d::Random());
+
+    auto et = toErrorTerm(expr);
+    auto cet = toErrorTerm(compileExpression(expr));
+    EXPECT_EQ(et->numDesignVariables(), cet->numDesignVariables());
+    EXPECT_NEAR(et->evaluateError(), cet->evaluateError(), 1e-12);
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
@@ -1,3 +1,6 @@
+#include <atomic>
+#include <thread>
+#include <vector>
 #include <sm/eigen/gtest.hpp>
 #include <sm/eigen/NumericalDiff.hpp>
 #include <sm/kinematics/rotations.hpp>
@@ -7,6 +10,8 @@
 #include <aslam/backend/GenericMatrixExpression.hpp>
 #include <aslam/backend/VectorExpression.hpp>
 #include <aslam/backend/DesignVariableVector.hpp>
+#include <aslam/backend/DesignVariableMappedVector.hpp>
+#include <aslam/backend/EuclideanPoint.hpp>
 #include <aslam/backend/VectorExpressionToGenericMatrixTraits.hpp>
 #include <aslam/backend/test/ExpressionTests.hpp>
 #include <aslam/backend/test/GenericScalarExpressionTests.hpp>
@@ -14,6 +19,28 @@
 using namespace aslam::backend;
 using namespace std;
 
+namespace {
+  // Forwards to its operand and counts how often it is evaluated
+  class CountingNode : public GenericMatrixExpressionNode<3, 1, double> {
+   public:
+    CountingNode(const GenericMatrixExpression<3, 1> & operand) : _operand(operand.root()) {}
+    mutable std::atomic<int> numEvaluations{0};
+   protected:
+    void evaluateImplementation() const override {
+      ++numEvaluations;
+      _currentValue = _operand->evaluate();
+    }
+    void getDesignVariablesImplementation(DesignVariable::set_t & designVariables) const override {
+      _operand->getDesignVariables(designVariables);
+    }
+    void evaluateJacobiansImplementation(JacobianContainer & outJacobians, const differential_t & chainRuleDifferential) const override {
+      _operand->evaluateJacobians(outJacobians, chainRuleDifferential);
+    }
+   private:
+    GenericMatrixExpression<3, 1>::node_ptr_t _operand;
+  };
+}
+
 TEST(GenericMatrixExpressionNodeTestSuites, testGenericMatrixBasicOperations) {
   try {
     const int VEC_ROWS = 5;
@@ -518,3 +545,95 @@ TEST(GenericMatrixExpressionNodeTestSuites, testSquaredNorm) {
     FAIL() << e.what();
   }
 }
+
+// Test that shared subexpressions are evaluated once per change of their design variables
+TEST(GenericMatrixExpressionNodeTestSuites, testValueCaching) {
+  try
+  {
+    typedef GenericMatrixExpression<3, 1> GV;
+    DesignVariableGenericVector<3> dv(Eigen::Vector3d::Random());
+    dv.setActive(true);
+    dv.setBlockIndex(0);
+    boost::shared_ptr<CountingNode> counter(new CountingNode(GV(&dv)));
+    GV shared(counter);
+    GV expr = shared + shared * 2.0 - shared.cross(shared);
+
+    const Eigen::Vector3d value = expr.evaluate();
+    EXPECT_EQ(1, counter->numEvaluations);
+    sm::eigen::assertNear(value, 3.0 * dv.value(), 1e-14, SM_SOURCE_FILE_POS, "Testing the value");
+    {
+      SCOPED_TRACE("");
+      testExpression(expr, 1);
+    }
+
+    // Any change of the design variable triggers one re-evaluation
+    counter->numEvaluations = 0;
+    const Eigen::Vector3d dx = Eigen::Vector3d::Random();
+    dv.update(dx.data(), 3);
+    sm::eigen::assertNear(expr.evaluate(), 3.0 * dv.value(), 1e-14, SM_SOURCE_FILE_POS, "Testing the value after an update");
+    EXPECT_EQ(1, counter->numEvaluations);
+    dv.revertUpdate();
+    sm::eigen::assertNear(expr.evaluate(), value, 1e-14, SM_SOURCE_FILE_POS, "Testing the value after reverting the update");
+    EXPECT_EQ(2, counter->numEvaluations);
+    dv.setParameters(Eigen::Vector3d(dv.value() + dx));
+    sm::eigen::assertNear(expr.evaluate(), 3.0 * dv.value(), 1e-14, SM_SOURCE_FILE_POS, "Testing the value after setting the parameters");
+    EXPECT_EQ(3, counter->numEvaluations);
+    counter->invalidate();
+    counter->evaluate();
+    EXPECT_EQ(4, counter->numEvaluations);
+
+    // Concurrent evaluations share one computation
+    dv.update(dx.data(), 3);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+      threads.emplace_back([&expr]() { for (int j = 0; j < 100; ++j) expr.evaluate(); });
+    for (auto & t : threads)
+      t.join();
+    EXPECT_EQ(5, counter->numEvaluations);
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Test that every way of changing a value reaches the caches
+TEST(GenericMatrixExpressionNodeTestSuites, testValueCachingSetters) {
+  try
+  {
+    EuclideanPoint point(Eigen::Vector3d(0.0, 1.0, 0.0));
+    point.setActive(true);
+    boost::shared_ptr<EuclideanExpressionNodeConstant> constant(new EuclideanExpressionNodeConstant(Eigen::Vector3d(1.0, 0.0, 0.0)));
+    auto norm = convertToGME(EuclideanExpression(boost::shared_ptr<EuclideanExpressionNode>(constant)) + point.toExpression()).squaredNorm();
+    EXPECT_DOUBLE_EQ(2.0, norm.evaluate());
+
+    std::uint64_t version = point.version();
+    point.set(Eigen::Vector3d(0.0, 2.0, 0.0));
+    EXPECT_GT(point.version(), version);
+    EXPECT_DOUBLE_EQ(5.0, norm.evaluate());
+
+    version = DesignVariable::constantsVersion();
+    constant->set(Eigen::Vector3d(2.0, 0.0, 0.0));
+    EXPECT_GT(DesignVariable::constantsVersion(), version);
+    EXPECT_DOUBLE_EQ(8.0, norm.evaluate());
+
+    // Writing the memory of a mapped design variable needs an explicit invalidation
+    double memory[3] = { 1.0, 2.0, 3.0 };
+    DesignVariableMappedVector<3> mapped(memory);
+    mapped.setActive(true);
+    auto mappedNorm = convertToGME(mapped.toExpression()).squaredNorm();
+    EXPECT_DOUBLE_EQ(14.0, mappedNorm.evaluate());
+    memory[0] = 2.0;
+    version = mapped.version();
+    mapped.invalidateCache();
+    EXPECT_GT(mapped.version(), version);
+    EXPECT_DOUBLE_EQ(17.0, mappedNorm.evaluate());
+    double otherMemory[3] = { 0.0, 0.0, 1.0 };
+    mapped.updateMap(otherMemory);
+    EXPECT_DOUBLE_EQ(1.0, mappedNorm.evaluate());
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
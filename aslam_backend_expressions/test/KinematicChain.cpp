@@ -3,11 +3,15 @@
  *      Author: hannes
  */
 
+#include <thread>
+#include <vector>
 #include <Eigen/Geometry>
 #include <sm/eigen/gtest.hpp>
 #include <sm/eigen/NumericalDiff.hpp>
 #include <aslam/backend/KinematicChain.hpp>
+#include <sm/kinematics/quaternion_algebra.hpp>
 #include <aslam/backend/EuclideanPoint.hpp>
+#include <aslam/backend/RotationQuaternion.hpp>
 #include <aslam/backend/EuclideanExpression.hpp>
 #include <aslam/backend/test/ExpressionTests.hpp>
 
@@ -126,3 +130,89 @@ TEST(KinematicChainTestSuites, testTheoreticallyTwoFrames) {
 //    C, B(C), A(B);
 
 }
+
+namespace {
+  struct Link {
+    Link(int blockIndex) : q(sm::kinematics::quatRandom()), t(Eigen::Vector3d::Random()) {
+      q.setActive(true);
+      q.setBlockIndex(blockIndex);
+      t.setActive(true);
+      t.setBlockIndex(blockIndex + 1);
+    }
+    RotationQuaternion q;
+    EuclideanPoint t;
+  };
+}
+
+TEST(KinematicChainTestSuites, testConcurrentGlobals) {
+  Link l0(0), l1(2), l2(4);
+  CoordinateFrame A(RotationExpression(&l0.q), EuclideanExpression(&l0.t), Ones, Ones, Ones, Ones);
+  CoordinateFrame B(A, RotationExpression(&l1.q), EuclideanExpression(&l1.t), X, Y, Z, Ones);
+  CoordinateFrame C(B, RotationExpression(&l2.q), EuclideanExpression(&l2.t), Y, Z, X, Ones);
+
+  std::vector<const EuclideanExpressionNode *> roots(8);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < roots.size(); ++i)
+    threads.emplace_back([&C, &roots, i]() { roots[i] = C.getAG().root().get(); });
+  for (auto & t : threads)
+    t.join();
+  for (auto root : roots)
+    EXPECT_EQ(roots.front(), root);
+
+  sm::eigen::assertNear(C.getPG().toValue(), (B.getPG() + B.getR_G_L() * EuclideanExpression(&l2.t)).toValue(), 1e-12, SM_SOURCE_FILE_POS, "");
+  sm::eigen::assertNear(C.getVG().toValue(),
+                        (B.getVG() + B.getR_G_L() * EuclideanExpression(Z) + B.getOmegaG().cross(B.getR_G_L() * EuclideanExpression(&l2.t))).toValue(),
+                        1e-12, SM_SOURCE_FILE_POS, "");
+}
+
+TEST(KinematicChainTestSuites, testChainEvaluator) {
+  try {
+    // A tree with two branches: A - B - C and A - D
+    Link l0(0), l1(2), l2(4), l3(6);
+    CoordinateFrame A(RotationExpression(&l0.q), EuclideanExpression(&l0.t));
+    CoordinateFrame B(A, RotationExpression(&l1.q), EuclideanExpression(&l1.t));
+    CoordinateFrame C(B, RotationExpression(&l2.q), EuclideanExpression(&l2.t));
+    CoordinateFrame D(A, RotationExpression(&l3.q), EuclideanExpression(&l3.t));
+
+    KinematicChainEvaluator evaluator;
+    evaluator.evaluate({&C, &D, &B});
+    EXPECT_EQ(4u, evaluator.numEvaluatedFrames());
+
+    for (const CoordinateFrame * frame : {&A, &B, &C, &D}) {
+      sm::eigen::assertNear(evaluator.getR_G_L(*frame), frame->getR_G_L().toRotationMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Testing the rotation");
+      sm::eigen::assertNear(evaluator.getPG(*frame), frame->getPG().toValue(), 1e-12, SM_SOURCE_FILE_POS, "Testing the position");
+
+      JacobianContainerSparse<3> JR(3), Jp(3);
+      frame->getR_G_L().evaluateJacobians(JR);
+      frame->getPG().evaluateJacobians(Jp);
+      sm::eigen::assertNear(evaluator.getR_G_LJacobians(*frame).asDenseMatrix(), JR.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Testing the rotation Jacobians");
+      sm::eigen::assertNear(evaluator.getPGJacobians(*frame).asDenseMatrix(), Jp.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Testing the position Jacobians");
+    }
+
+    // A batch of points attached to the last link
+    const int numPoints = 50;
+    const Eigen::Matrix3Xd pointsL = Eigen::Matrix3Xd::Random(3, numPoints);
+    Eigen::Matrix3Xd pointsG;
+    std::vector<DesignVariable*> dvs;
+    Eigen::MatrixXd J;
+    evaluator.transformPoints(C, pointsL, pointsG, dvs, J);
+    ASSERT_EQ(6u, dvs.size());
+    ASSERT_EQ(3 * numPoints, J.rows());
+    ASSERT_EQ(18, J.cols());
+    for (int i = 0; i < numPoints; ++i) {
+      EuclideanExpression pointG = C.getPG() + C.getR_G_L() * EuclideanExpression(Eigen::Vector3d(pointsL.col(i)));
+      sm::eigen::assertNear(pointsG.col(i), pointG.toValue(), 1e-12, SM_SOURCE_FILE_POS, "Testing the point");
+      JacobianContainerSparse<3> Jpoint(3);
+      pointG.evaluateJacobians(Jpoint);
+      sm::eigen::assertNear(J.middleRows<3>(3 * i), Jpoint.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Testing the point Jacobian");
+    }
+
+    Eigen::Matrix3Xd pointsGOnly;
+    evaluator.transformPoints(C, pointsL, pointsGOnly);
+    sm::eigen::assertNear(pointsGOnly, pointsG, 1e-14, SM_SOURCE_FILE_POS, "Testing the points without Jacobians");
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
@@ -14,6 +14,11 @@
 #include <aslam/backend/DesignVariableVector.hpp>
 #include <aslam/backend/MapTransformation.hpp>
 #include <aslam/backend/HomogeneousPoint.hpp>
+#include <aslam/backend/TransformationExpression.hpp>
+#include <aslam/backend/ExpressionArena.hpp>
+#include <aslam/backend/ExpressionContext.hpp>
+#include <aslam/backend/JacobianContainerSparse.hpp>
+#include <aslam/backend/ScalarExpression.hpp>
 
 using namespace aslam::backend;
 using namespace sm::kinematics;
@@ -652,3 +657,222 @@ TEST(EuclideanExpressionNodeTestSuites, testElementwiseMultiply)
     FAIL() << e.what();
   }
 }
+
+// Test that nodes allocated from an arena behave like heap nodes and outlive the release of the arena
+TEST(EuclideanExpressionNodeTestSuites, testArenaAllocation)
+{
+  try
+  {
+    RotationQuaternion quat(quatRandom());
+    quat.setActive(true);
+    quat.setBlockIndex(0);
+    EuclideanPoint point(Eigen::Vector3d::Random());
+    point.setActive(true);
+    point.setBlockIndex(1);
+    RotationExpression C(&quat);
+    EuclideanExpression p(&point);
+
+    const EuclideanExpression heap = (C * p).cross(p) - Eigen::Vector3d::Ones();
+    EXPECT_EQ(nullptr, ExpressionArena::current());
+
+    ExpressionArena arena(256);
+    EuclideanExpression e;
+    {
+      ExpressionArena::Scope scope(arena);
+      EXPECT_EQ(&arena, ExpressionArena::current());
+      e = (C * p).cross(p) - Eigen::Vector3d::Ones();
+    }
+    EXPECT_EQ(nullptr, ExpressionArena::current());
+    EXPECT_LT(0u, arena.numBytesAllocated());
+    EXPECT_LT(1u, arena.numSlabs());
+
+    sm::eigen::assertNear(e.toEuclidean(), heap.toEuclidean(), 1e-14, SM_SOURCE_FILE_POS, "Testing the result is unchanged");
+    SCOPED_TRACE("");
+    testJacobian(e);
+
+    // The slabs stay alive as long as nodes use them
+    arena.release();
+    EXPECT_EQ(0u, arena.numSlabs());
+    EXPECT_EQ(0u, arena.numBytesAllocated());
+    sm::eigen::assertNear(e.toEuclidean(), heap.toEuclidean(), 1e-14, SM_SOURCE_FILE_POS, "Testing the result after releasing the arena");
+
+    // So do weak pointers to them, e.g. those of an ExpressionContext
+    boost::weak_ptr<void> weak;
+    {
+      ExpressionArena scoped(256);
+      ExpressionArena::Scope scope(scoped);
+      boost::shared_ptr<int> node = allocateNode<int>(42);
+      weak = node;
+    }
+    EXPECT_TRUE(weak.expired());
+    EXPECT_FALSE(weak.lock());
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+TEST(EuclideanExpressionNodeTestSuites, testExpressionContext)
+{
+  try
+  {
+    RotationQuaternion quat(quatRandom());
+    quat.setActive(true);
+    quat.setBlockIndex(0);
+    EuclideanPoint point(Eigen::Vector3d::Random());
+    point.setActive(true);
+    point.setBlockIndex(1);
+    EuclideanPoint point2(Eigen::Vector3d::Random());
+    point2.setActive(true);
+    point2.setBlockIndex(2);
+    RotationQuaternion quat2(quatRandom());
+    quat2.setActive(true);
+    quat2.setBlockIndex(3);
+    RotationExpression C(&quat);
+    RotationExpression D(&quat2);
+    EuclideanExpression p(&point);
+    EuclideanExpression q(&point2);
+    TransformationExpression T_world_cam(C, p);
+    TransformationExpression T_world_body(D, q);
+
+    const EuclideanExpression unshared = p.cross(q) - Eigen::Vector3d::Ones();
+    EXPECT_EQ(nullptr, ExpressionContext::current());
+
+    ExpressionContext context;
+    EuclideanExpression e0, e1, r0, r1;
+    TransformationExpression T0, T1;
+    boost::shared_ptr<ScalarExpressionNode> s0, s1, s2;
+    {
+      ExpressionContext::Scope scope(context);
+      EXPECT_EQ(&context, ExpressionContext::current());
+      e0 = p.cross(q) - Eigen::Vector3d::Ones();
+      EXPECT_EQ(0u, context.numHits());
+      e1 = p.cross(q) - Eigen::Vector3d::Ones();
+      // The cross product and the difference are shared
+      EXPECT_EQ(e0.root(), e1.root());
+      EXPECT_EQ(2u, context.numHits());
+      EXPECT_EQ(4u, context.numLookups());
+      EXPECT_EQ(2u, context.numUniqueNodes());
+      EXPECT_DOUBLE_EQ(0.5, context.deduplicationRatio());
+
+      // So are the products and inverses of rotations and transformations
+      r0 = C.inverse() * p;
+      r1 = C.inverse() * p;
+      EXPECT_EQ(r0.root(), r1.root());
+      EXPECT_EQ(4u, context.numHits());
+      EXPECT_EQ(8u, context.numLookups());
+      T0 = T_world_cam.inverse() * T_world_body;
+      T1 = T_world_cam.inverse() * T_world_body;
+      EXPECT_EQ(T0.root(), T1.root());
+      EXPECT_EQ(6u, context.numHits());
+      EXPECT_EQ(12u, context.numLookups());
+      EXPECT_EQ(6u, context.numUniqueNodes());
+
+      s0 = sqrt(ScalarExpression(2.0) * ScalarExpression(3.0)).root();
+      s1 = sqrt(ScalarExpression(2.0) * ScalarExpression(3.0)).root();
+      s2 = sqrt(ScalarExpression(3.0) * ScalarExpression(2.0)).root();
+    }
+    EXPECT_EQ(nullptr, ExpressionContext::current());
+    EXPECT_EQ(s0, s1);
+    EXPECT_NE(s0, s2);
+    EXPECT_DOUBLE_EQ(s0->evaluate(), s2->evaluate());
+
+    sm::eigen::assertNear(e0.toEuclidean(), unshared.toEuclidean(), 1e-14, SM_SOURCE_FILE_POS, "Testing the result is unchanged");
+    sm::eigen::assertNear(e1.toEuclidean(), unshared.toEuclidean(), 1e-14, SM_SOURCE_FILE_POS, "Testing the result is unchanged");
+    SCOPED_TRACE("");
+    testJacobian(e1);
+
+    // Shared nodes cache their value per state, updates of their design variables are seen by all users
+    const Eigen::Vector3d r0Value = r0.toEuclidean();
+    sm::eigen::assertNear(r0Value, C.toRotationMatrix().transpose() * p.toEuclidean(), 1e-14, SM_SOURCE_FILE_POS, "Testing the shared product");
+    const double dq[3] = { 0.1, -0.2, 0.3 };
+    quat.update(dq, 3);
+    sm::eigen::assertNear(r1.toEuclidean(), C.toRotationMatrix().transpose() * p.toEuclidean(), 1e-14, SM_SOURCE_FILE_POS, "Testing the shared product after an update");
+    sm::eigen::assertNear(T1.toTransformationMatrix(), T_world_cam.toTransformationMatrix().inverse() * T_world_body.toTransformationMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Testing the shared transformation after an update");
+    quat.revertUpdate();
+    EXPECT_EQ(r0Value, r1.toEuclidean());
+    sm::eigen::assertNear(T0.toTransformationMatrix(), T_world_cam.toTransformationMatrix().inverse() * T_world_body.toTransformationMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Testing the shared transformation");
+    testJacobian(r1);
+    testJacobian(T1 * q);
+
+    // Shared nodes stay registered as long as one user is left
+    EXPECT_EQ(12u, context.numUniqueNodes());
+    s1.reset();
+    EXPECT_EQ(12u, context.numUniqueNodes());
+    s2.reset();
+    EXPECT_EQ(10u, context.numUniqueNodes());
+    context.purge();
+    context.clear();
+    EXPECT_EQ(0u, context.numLookups());
+    EXPECT_EQ(0u, context.numUniqueNodes());
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
+
+// Error terms built in one context share nodes and are evaluated by several threads at once
+TEST(EuclideanExpressionNodeTestSuites, testExpressionContextConcurrentEvaluation)
+{
+  try
+  {
+    RotationQuaternion quat(quatRandom());
+    quat.setActive(true);
+    quat.setBlockIndex(0);
+    EuclideanPoint point(Eigen::Vector3d::Random());
+    point.setActive(true);
+    point.setBlockIndex(1);
+    EuclideanPoint point2(Eigen::Vector3d::Random());
+    point2.setActive(true);
+    point2.setBlockIndex(2);
+    RotationExpression C(&quat);
+    EuclideanExpression p(&point);
+    EuclideanExpression q(&point2);
+
+    const size_t numTerms = 64, numThreads = 4, numRepetitions = 50;
+    ExpressionContext context;
+    std::vector<EuclideanExpression> terms;
+    {
+      ExpressionContext::Scope scope(context);
+      for (size_t i = 0; i < numTerms; ++i)
+        terms.push_back(C.inverse() * (C * p) + p.cross(q) - Eigen::Vector3d::Ones());
+    }
+    // All nodes but the first term's are shared: the inverse, both products, the cross product, the sum and the difference
+    EXPECT_EQ(6 * (numTerms - 1), context.numHits());
+    EXPECT_EQ(6u, context.numUniqueNodes());
+
+    const Eigen::Vector3d expected = terms[0].toEuclidean();
+    JacobianContainerSparse<3> jc(3);
+    terms[0].evaluateJacobians(jc);
+    const Eigen::MatrixXd expectedJ = jc.asDenseMatrix();
+
+    std::vector<Eigen::Vector3d> maxValueError(numThreads, Eigen::Vector3d::Zero());
+    std::vector<double> maxJacobianError(numThreads, 0.0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (size_t r = 0; r < numRepetitions; ++r) {
+          for (size_t i = t; i < numTerms; i += numThreads) {
+            maxValueError[t] = maxValueError[t].cwiseMax((terms[i].toEuclidean() - expected).cwiseAbs());
+            JacobianContainerSparse<3> J(3);
+            terms[i].evaluateJacobians(J);
+            maxJacobianError[t] = std::max(maxJacobianError[t], (J.asDenseMatrix() - expectedJ).cwiseAbs().maxCoeff());
+          }
+        }
+      });
+    }
+    for (auto & thread : threads)
+      thread.join();
+
+    for (size_t t = 0; t < numThreads; ++t) {
+      EXPECT_EQ(0.0, maxValueError[t].maxCoeff());
+      EXPECT_EQ(0.0, maxJacobianError[t]);
+    }
+  }
+  catch(std::exception const & e)
+  {
+    FAIL() << e.what();
+  }
+}
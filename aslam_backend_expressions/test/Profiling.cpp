@@ -26,6 +26,11 @@
 #include <aslam/backend/DesignVariableVector.hpp>
 #include <aslam/backend/VectorExpressionToGenericMatrixTraits.hpp>
 #include <aslam/backend/CacheExpression.hpp>
+#include <aslam/backend/RotationQuaternion.hpp>
+#include <aslam/backend/EuclideanPoint.hpp>
+#include <aslam/backend/RotationExpression.hpp>
+#include <aslam/backend/ExpressionTape.hpp>
+#include <aslam/backend/ExpressionArena.hpp>
 
 
 using namespace std;
@@ -45,11 +50,14 @@ int main(int argc, char** argv)
     bool disableDefaultStream = false;
     size_t nIterations = 100000;
     size_t updateDvEach = 1;
+    size_t nExpressions = 100000;
     bool useSparseJacobianContainer = false;
     bool useCaching = false, noUpdateDv = false;
     bool noDense = false, noSparse = false, noScalar = false,
          noMatrix = false, noError = false, noJacobian = false,
-         noCached = false, noNonCached = false;
+         noCached = false, noNonCached = false,
+         noEuclidean = false, noCompiled = false, noInterpreted = false,
+         noConstruction = false, noChainRuleKernels = false;
 
     namespace po = boost::program_options;
     po::options_description desc("local_planner options");
@@ -71,6 +79,12 @@ int main(int argc, char** argv)
       ("no-cached", po::bool_switch(&noCached), "Don't profile cached expressions")
       ("no-noncached", po::bool_switch(&noNonCached), "Don't profile non-cached expressions")
       ("no-update-dv", po::bool_switch(&noUpdateDv), "Don't update the design variables after each call")
+      ("no-euclidean", po::bool_switch(&noEuclidean), "Don't profile Euclidean expressions")
+      ("no-compiled", po::bool_switch(&noCompiled), "Don't profile compiled expressions")
+      ("no-interpreted", po::bool_switch(&noInterpreted), "Don't profile interpreted expressions")
+      ("no-construction", po::bool_switch(&noConstruction), "Don't profile construction and destruction of expressions")
+      ("no-chain-rule-kernels", po::bool_switch(&noChainRuleKernels), "Don't compare fixed-size and dynamic chain rule kernels")
+      ("num-expressions", po::value(&nExpressions)->default_value(nExpressions), "Number of expressions to construct")
     ;
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
@@ -236,6 +250,152 @@ int main(int argc, char** argv)
       }
     } // GenericMatrixExpression
 
+    // ************************************ //
+    //    EuclideanExpression (compiled)    //
+    // ************************************ //
+    {
+      RotationQuaternion qab(Eigen::Vector4d(0., 0., 0., 1.)), qbc(Eigen::Vector4d(0., 0., 0., 1.));
+      EuclideanPoint p(Eigen::Vector3d::Random()), q(Eigen::Vector3d::Random());
+      int blockIndex = 0;
+      for (DesignVariable* dv : std::vector<DesignVariable*>{&qab, &qbc, &p, &q}) {
+        dv->setActive(true);
+        dv->setBlockIndex(blockIndex);
+        dv->setColumnBase(3*blockIndex++);
+      }
+      RotationExpression Cab(&qab), Cbc(&qbc);
+      EuclideanExpression ep(&p), eq(&q);
+      const EuclideanExpression expr = (Cab * Cbc.inverse() * (ep - eq)).cross(Cab * ep) - Eigen::Vector3d::Ones();
+      const CompiledEuclideanExpression cexpr = compileExpression(expr);
+
+      Eigen::MatrixXd J = Eigen::MatrixXd::Zero(EuclideanExpression::Dimension, 3*blockIndex);
+      JacobianContainerDense<Eigen::MatrixXd&, EuclideanExpression::Dimension> jcDense(J);
+      JacobianContainerSparse<EuclideanExpression::Dimension> jcSparse(EuclideanExpression::Dimension);
+      const Eigen::Vector3d dx = 1e-3*Eigen::Vector3d::Ones();
+
+      // Test error evaluation interpreted
+      if (!noError && !noEuclidean && !noInterpreted) {
+        sm::timing::Timer timer("EuclideanExpression -- Interpreted: Error", false);
+        for (size_t i=0; i<nIterations; ++i) {
+          expr.evaluate();
+          if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+        }
+      }
+
+      // Test error evaluation compiled
+      if (!noError && !noEuclidean && !noCompiled) {
+        sm::timing::Timer timer("EuclideanExpression -- Compiled: Error", false);
+        for (size_t i=0; i<nIterations; ++i) {
+          cexpr.evaluate();
+          if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+        }
+      }
+
+      // Test Jacobian evaluation interpreted, sparse container
+      if (!noJacobian && !noSparse && !noEuclidean && !noInterpreted) {
+        sm::timing::Timer timer("EuclideanExpression -- Interpreted/Sparse: Jacobian", false);
+        for (size_t i=0; i<nIterations; ++i) {
+          expr.evaluate();
+          evaluateJacobian(expr, jcSparse);
+          if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+        }
+      }
+
+      // Test Jacobian evaluation compiled, sparse container
+      if (!noJacobian && !noSparse && !noEuclidean && !noCompiled) {
+        sm::timing::Timer timer("EuclideanExpression -- Compiled/Sparse: Jacobian", false);
+        for (size_t i=0; i<nIterations; ++i) {
+          evaluateJacobian(cexpr, jcSparse);
+          if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+        }
+      }
+
+      // Test Jacobian evaluation interpreted, dense container
+      if (!noJacobian && !noDense && !noEuclidean && !noInterpreted) {
+        sm::timing::Timer timer("EuclideanExpression -- Interpreted/Dense: Jacobian", false);
+        for (size_t i=0; i<nIterations; ++i) {
+          expr.evaluate();
+          evaluateJacobian(expr, jcDense);
+          if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+        }
+      }
+
+      // Test Jacobian evaluation compiled, dense container
+      if (!noJacobian && !noDense && !noEuclidean && !noCompiled) {
+        sm::timing::Timer timer("EuclideanExpression -- Compiled/Dense: Jacobian", false);
+        for (size_t i=0; i<nIterations; ++i) {
+          evaluateJacobian(cexpr, jcDense);
+          if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+        }
+      }
+
+      // Compare the fixed-size and the dynamic chain rule kernels, interpreted
+      if (!noJacobian && !noEuclidean && !noInterpreted && !noChainRuleKernels) {
+        for (bool useFixedSize : {true, false}) {
+          const string kernels = useFixedSize ? "FixedSizeChainRule" : "DynamicChainRule";
+          jcSparse.setUseFixedSizeChainRule(useFixedSize);
+          jcDense.setUseFixedSizeChainRule(useFixedSize);
+          if (!noSparse) {
+            sm::timing::Timer timer("EuclideanExpression -- Interpreted/Sparse/" + kernels + ": Jacobian", false);
+            for (size_t i=0; i<nIterations; ++i) {
+              evaluateJacobian(expr, jcSparse);
+              if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+            }
+          }
+          if (!noDense) {
+            sm::timing::Timer timer("EuclideanExpression -- Interpreted/Dense/" + kernels + ": Jacobian", false);
+            for (size_t i=0; i<nIterations; ++i) {
+              evaluateJacobian(expr, jcDense);
+              if (!noUpdateDv && i % updateDvEach == 0) qab.update(dx.data(), dx.size());
+            }
+          }
+        }
+      }
+    } // EuclideanExpression (compiled)
+
+    // ************************************** //
+    //    Expression construction/teardown    //
+    // ************************************** //
+    if (!noConstruction) {
+      RotationQuaternion q(Eigen::Vector4d(0., 0., 0., 1.));
+      EuclideanPoint t(Eigen::Vector3d::Random());
+      vector<EuclideanPoint> points;
+      points.reserve(nExpressions);
+      for (size_t i=0; i<nExpressions; ++i)
+        points.emplace_back(Eigen::Vector3d::Random());
+      RotationExpression C(&q);
+      EuclideanExpression et(&t);
+
+      // Builds a reprojection-like expression per point, nodes are allocated by makeNode()
+      auto build = [&](vector<EuclideanExpression>& exprs) {
+        exprs.reserve(nExpressions);
+        for (auto& p : points)
+          exprs.push_back((C * (EuclideanExpression(&p) - et)).elementwiseMultiply(EuclideanExpression(&p)) - Eigen::Vector3d::Ones());
+      };
+
+      {
+        vector<EuclideanExpression> exprs;
+        {
+          sm::timing::Timer timer("Expression construction -- Heap: Build", false);
+          build(exprs);
+        }
+        sm::timing::Timer timer("Expression construction -- Heap: Teardown", false);
+        exprs.clear();
+      }
+
+      {
+        ExpressionArena arena;
+        vector<EuclideanExpression> exprs;
+        {
+          sm::timing::Timer timer("Expression construction -- Arena: Build", false);
+          ExpressionArena::Scope scope(arena);
+          build(exprs);
+        }
+        sm::timing::Timer timer("Expression construction -- Arena: Teardown", false);
+        exprs.clear();
+        arena.release();
+      }
+    } // Expression construction
+
     sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
 
   }
@@ -0,0 +1,41 @@
+#include <numpy_eigen/boost_python_headers.hpp>
+
+#include <sstream>
+
+#include <aslam/backend/util/Instrumentation.hpp>
+
+using namespace boost::python;
+using namespace aslam::backend;
+
+namespace {
+
+  std::string instrumentationReport()
+  {
+    std::ostringstream out;
+    instrumentation::collect().print(out);
+    return out.str();
+  }
+
+  void writeChromeTrace(const std::string & filename)
+  {
+    instrumentation::writeChromeTrace(filename);
+  }
+
+  void startTracing(std::size_t eventsPerBuffer)
+  {
+    instrumentation::startTracing(eventsPerBuffer);
+  }
+
+}
+
+void exportInstrumentation()
+{
+  def("setInstrumentationEnabled", &instrumentation::setEnabled, "Switch recording the durations of the optimizer phases on or off");
+  def("isInstrumentationEnabled", &instrumentation::isEnabled);
+  def("resetInstrumentation", &instrumentation::reset, "Reset the recorded durations");
+  def("instrumentationReport", &instrumentationReport, "The recorded durations per phase and error term type as a table");
+  def("startTracing", &startTracing, (arg("eventsPerBuffer") = std::size_t(1 << 15)), "Discard the trace events and start recording a timeline of the optimizer phases per thread");
+  def("stopTracing", &instrumentation::stopTracing);
+  def("isTracing", &instrumentation::isTracing);
+  def("writeChromeTrace", &writeChromeTrace, "Write the recorded trace events to a file in the Chrome trace event format");
+}
@@ -5,6 +5,8 @@
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/SparseQrLinearSystemSolver.hpp>
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/DenseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/LinearSystemSolverSelector.hpp>
 #include <aslam/backend/OptimizerCallbackManager.hpp>
 
 
@@ -78,6 +80,18 @@ void exportLinearSystemSolver()
 
 
     class_<DenseQrLinearSystemSolver, boost::shared_ptr<DenseQrLinearSystemSolver>, bases<LinearSystemSolver> >("DenseQrLinearSystemSolver", init<>());
+    class_<DenseCholeskyLinearSolverOptions>("DenseCholeskyLinearSolverOptions", init<>())
+        .def_readwrite("useLdlt", &DenseCholeskyLinearSolverOptions::useLdlt)
+        .def_readwrite("minReciprocalCondition", &DenseCholeskyLinearSolverOptions::minReciprocalCondition)
+        .def_readwrite("rowBlockSize", &DenseCholeskyLinearSolverOptions::rowBlockSize)
+        .def_readwrite("threadMemoryBudget", &DenseCholeskyLinearSolverOptions::threadMemoryBudget)
+        ;
+    DenseCholeskyLinearSolverOptions& (DenseCholeskyLinearSystemSolver::*getDenseCholeskyOptions)() = &DenseCholeskyLinearSystemSolver::getOptions;
+    class_<DenseCholeskyLinearSystemSolver, boost::shared_ptr<DenseCholeskyLinearSystemSolver>, bases<LinearSystemSolver> >("DenseCholeskyLinearSystemSolver", init<>())
+        .def("numQrFallbacks", &DenseCholeskyLinearSystemSolver::numQrFallbacks)
+        .def("getOptions", getDenseCholeskyOptions, return_internal_reference<>())
+        .def("setOptions", &DenseCholeskyLinearSystemSolver::setOptions)
+        ;
     class_<BlockCholeskyLinearSystemSolver, boost::shared_ptr<BlockCholeskyLinearSystemSolver>, bases<LinearSystemSolver> >("BlockCholeskyLinearSystemSolver", init<>());
     class_<SparseCholeskyLinearSystemSolver, boost::shared_ptr<SparseCholeskyLinearSystemSolver>, bases<LinearSystemSolver> >("SparseCholeskyLinearSystemSolver", init<>());
     class_<SparseQrLinearSystemSolver, boost::shared_ptr<SparseQrLinearSystemSolver>, bases<LinearSystemSolver> >("SparseQrLinearSystemSolver", init<>())
@@ -92,4 +106,19 @@ void exportLinearSystemSolver()
         .def("setOptions", &SparseQrLinearSystemSolver::setOptions)
         ;
 
+    class_<LinearSystemSolverSelectorOptions>("LinearSystemSolverSelectorOptions", init<>())
+        .def_readwrite("backend", &LinearSystemSolverSelectorOptions::backend)
+        .def_readwrite("calibrate", &LinearSystemSolverSelectorOptions::calibrate)
+        .def_readwrite("calibrationRuns", &LinearSystemSolverSelectorOptions::calibrationRuns)
+        .def_readwrite("verbose", &LinearSystemSolverSelectorOptions::verbose)
+        ;
+
+    LinearSystemSolverSelectorOptions& (LinearSystemSolverSelector::*getSelectorOptions)() = &LinearSystemSolverSelector::options;
+    class_<LinearSystemSolverSelector, boost::shared_ptr<LinearSystemSolverSelector>, boost::noncopyable>("LinearSystemSolverSelector", init<>())
+        .def(init<LinearSystemSolverSelectorOptions>())
+        .def("getSolver", &LinearSystemSolverSelector::getSolver)
+        .def("options", getSelectorOptions, return_internal_reference<>())
+        .def("setOptions", &LinearSystemSolverSelector::setOptions)
+        ;
+
 }
@@ -200,6 +200,8 @@ void exportOptimizer()
         .value("GRADIENT_NORM", ConvergenceStatus::GRADIENT_NORM)
         .value("DX", ConvergenceStatus::DX)
         .value("DOBJECTIVE", ConvergenceStatus::DOBJECTIVE)
+        .value("TIME_LIMIT", ConvergenceStatus::TIME_LIMIT)
+        .value("STOPPED", ConvergenceStatus::STOPPED)
         ;
 
     class_<OptimizerStatus, boost::shared_ptr<OptimizerStatus> >("OptimizerStatus")
@@ -3,6 +3,7 @@
 #include <aslam/backend/Optimizer2Options.hpp>
 #include <boost/shared_ptr.hpp>
 #include <aslam/backend/LinearSystemSolver.hpp>
+#include <aslam/backend/LinearSystemSolverSelector.hpp>
 #include <aslam/backend/TrustRegionPolicy.hpp>
 void exportOptimizerOptions()
 {
@@ -32,10 +33,14 @@ void exportOptimizerOptions()
     .def_readwrite("doSchurComplement",&Optimizer2Options::doSchurComplement)
     .def_readwrite("maxIterations",&Optimizer2Options::maxIterations)
     .def_readwrite("verbose",&Optimizer2Options::verbose)
+    .def_readwrite("timeLimit",&Optimizer2Options::timeLimit)
     .def_readwrite("numThreadsError", &Optimizer2Options::numThreadsError)
     .def_readwrite("numThreadsJacobian", &Optimizer2Options::numThreadsJacobian)
     .def_readwrite("linearSolver",&Optimizer2Options::linearSystemSolver)
+    .def_readwrite("linearSolverSelector",&Optimizer2Options::linearSystemSolverSelector)
     .def_readwrite("trustRegionPolicy", &Optimizer2Options::trustRegionPolicy)
+    .def_readwrite("traceFile", &Optimizer2Options::traceFile)
+    .def_readwrite("traceBufferSize", &Optimizer2Options::traceBufferSize)
     ;
 
 }
@@ -24,6 +24,10 @@ void exportTrustRegionPolicies() {
   // LM
   class_<LevenbergMarquardtTrustRegionPolicy, boost::shared_ptr<LevenbergMarquardtTrustRegionPolicy>, bases< TrustRegionPolicy >, boost::noncopyable >("LevenbergMarquardtTrustRegionPolicy", init<>() )
       .def(init<double>("LevenbergMarquardtTrustRegionPolicy( double initalLambda )"))
+      .def("setNumSpeculativeLambdas", &LevenbergMarquardtTrustRegionPolicy::setNumSpeculativeLambdas)
+      .def("getNumSpeculativeLambdas", &LevenbergMarquardtTrustRegionPolicy::getNumSpeculativeLambdas)
+      .def("setSpeculativeLambdaFactor", &LevenbergMarquardtTrustRegionPolicy::setSpeculativeLambdaFactor)
+      .def("getSpeculativeLambdaFactor", &LevenbergMarquardtTrustRegionPolicy::getSpeculativeLambdaFactor)
       ;
 
   // DL
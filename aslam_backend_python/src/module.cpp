@@ -14,6 +14,7 @@ void exportDesignVariableTimePair();
 void exportSampleDvAndError();
 void exportScalarNonSquaredErrorTerm();
 void exportProblemManager();
+void exportInstrumentation();
 
 // The title of this library must match exactly
 BOOST_PYTHON_MODULE(libaslam_backend_python)
@@ -31,4 +32,5 @@ BOOST_PYTHON_MODULE(libaslam_backend_python)
   exportDesignVariableTimePair();
   exportSampleDvAndError();
   exportProblemManager();
+  exportInstrumentation();
 }
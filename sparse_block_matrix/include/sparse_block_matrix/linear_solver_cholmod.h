@@ -17,6 +17,9 @@
 #ifndef SBM_LINEAR_SOLVER_CHOLMOD
 #define SBM_LINEAR_SOLVER_CHOLMOD
 
+#include <cstring>
+#include <vector>
+
 #include <sparse_block_matrix/linear_solver.h>
 #include <sparse_block_matrix/marginal_covariance_cholesky.h>
 #include <sparse_block_matrix/sparse_helper.h>
@@ -64,6 +67,7 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
         cholmod_free_factor(&_cholmodFactor, &_cholmodCommon);
         _cholmodFactor = 0;
       }
+      _valueMap.clear();
       return true;
     }
 
@@ -206,6 +210,20 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
     void setBlockOrdering(bool blockOrdering) { _blockOrdering = blockOrdering;}
 
   protected:
+    /**
+     * \brief Where the values of a block go in the CCS matrix.
+     *
+     * Column c of the block starts at Cx[Cp[columnStart + c] + rowOffset], plus c + 1 if a diagonal
+     * block precedes it in the same block column. Of diagonal blocks only the upper triangle is stored.
+     */
+    struct BlockValueMap {
+      const MatrixType* block;
+      int columnStart;
+      int rowOffset;
+      bool isDiagonal;
+      bool afterDiagonal;
+    };
+
     // temp used for cholesky with cholmod
     cholmod_common _cholmodCommon;
     CholmodExt<int>* _cholmodSparse;
@@ -213,6 +231,8 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
     bool _blockOrdering;
     MatrixStructure _matrixStructure;
     VectorXi _scalarPermutation, _blockPermutation;
+    //! the blocks of the matrix the CCS structure was filled from, in CCS order
+    std::vector<BlockValueMap> _valueMap;
 
     void computeSymbolicDecomposition(const SparseBlockMatrix<MatrixType>& A)
     {
@@ -287,6 +307,16 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
       size_t m = A.rows();
       size_t n = A.cols();
 
+      // The values can only be copied through the value map if A still consists of the same blocks.
+      // Otherwise the structure is filled again and the symbolic factorization has to be redone.
+      if (onlyValues && ! isValueMapValid(A)) {
+        onlyValues = false;
+        if (_cholmodFactor) {
+          cholmod_free_factor(&_cholmodFactor, &_cholmodCommon);
+          _cholmodFactor = 0;
+        }
+      }
+
       if (_cholmodSparse->columnsAllocated < n) {
         //std::cerr << __PRETTY_FUNCTION__ << ": reallocating columns" << std::endl;
         _cholmodSparse->columnsAllocated = _cholmodSparse->columnsAllocated == 0 ? n : 2 * n; // pre-allocate more space if re-allocating
@@ -307,10 +337,69 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
       _cholmodSparse->ncol = n;
       _cholmodSparse->nrow = m;
 
-      if (onlyValues)
-        A.template fillCCS<int>((double*)_cholmodSparse->x, true);
-      else
+      if (onlyValues) {
+        fillValues();
+      } else {
         A.template fillCCS<int>((int*)_cholmodSparse->p, (int*)_cholmodSparse->i, (double*)_cholmodSparse->x, true);
+        buildValueMap(A);
+      }
+    }
+
+    //! compute where the blocks of A go in the values of the CCS matrix, in the order fillCCS() writes them
+    void buildValueMap(const SparseBlockMatrix<MatrixType>& A)
+    {
+      _valueMap.clear();
+      for (size_t i = 0; i < A.blockCols().size(); ++i) {
+        const int cstart = A.colBaseOfBlock(i);
+        int rowOffset = 0;
+        bool afterDiagonal = false;
+        for (typename SparseBlockMatrix<MatrixType>::IntBlockMap::const_iterator it = A.blockCols()[i].begin(); it != A.blockCols()[i].end(); ++it) {
+          BlockValueMap m;
+          m.block = it->second;
+          m.columnStart = cstart;
+          m.rowOffset = rowOffset;
+          m.isDiagonal = A.rowBaseOfBlock(it->first) == cstart;
+          m.afterDiagonal = afterDiagonal;
+          _valueMap.push_back(m);
+          if (m.isDiagonal)
+            afterDiagonal = true;
+          else
+            rowOffset += it->second->rows();
+        }
+      }
+    }
+
+    //! check that A still consists of the blocks the value map was built from
+    bool isValueMapValid(const SparseBlockMatrix<MatrixType>& A) const
+    {
+      size_t k = 0;
+      for (size_t i = 0; i < A.blockCols().size(); ++i) {
+        for (typename SparseBlockMatrix<MatrixType>::IntBlockMap::const_iterator it = A.blockCols()[i].begin(); it != A.blockCols()[i].end(); ++it, ++k) {
+          if (k >= _valueMap.size() || _valueMap[k].block != it->second || _valueMap[k].columnStart != A.colBaseOfBlock(i))
+            return false;
+        }
+      }
+      return k == _valueMap.size();
+    }
+
+    //! copy the values of all blocks into the CCS matrix using the value map
+    void fillValues()
+    {
+      const int* Cp = (const int*)_cholmodSparse->p;
+      double* Cx = (double*)_cholmodSparse->x;
+      const int numBlocks = static_cast<int>(_valueMap.size());
+# ifdef G2O_OPENMP
+# pragma omp parallel for default (shared) if (numBlocks > 100)
+# endif
+      for (int k = 0; k < numBlocks; ++k) {
+        const BlockValueMap& m = _valueMap[k];
+        const int rows = m.block->rows();
+        const double* src = m.block->data();
+        for (int c = 0; c < m.block->cols(); ++c) {
+          const int elemsToCopy = m.isDiagonal ? c + 1 : rows;
+          memcpy(Cx + Cp[m.columnStart + c] + m.rowOffset + (m.afterDiagonal ? c + 1 : 0), src + c * rows, elemsToCopy * sizeof(double));
+        }
+      }
     }
 
 };
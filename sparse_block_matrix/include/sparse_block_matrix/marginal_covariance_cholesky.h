@@ -21,22 +21,51 @@
 #include "sparse_block_matrix.h"
 
 #include <cassert>
+#include <cstddef>
 #include <vector>
 
-#include <unordered_map>
-
 namespace sparse_block_matrix {
 
   /**
    * \brief computing the marginal covariance given a cholesky factor (lower triangle of the factor)
+   *
+   * The entries of the covariance in the pattern of L (the selected inverse) are computed supernode by
+   * supernode with dense block operations, starting at the root of the elimination tree. Supernodes whose
+   * parents are done are independent and distributed over numThreads() threads, which all write into one shared
+   * selected inverse. Requested entries outside the pattern of L are read from columns of the covariance
+   * obtained by solving with the factor, one column per thread at a time.
+   *
+   * memoryBudget() bounds the additional memory: the selected inverse needs as much memory as the values of L,
+   * and every thread computing it needs two vectors of size n and the dense blocks of the largest supernode.
+   * The number of threads is reduced to fit into the budget. If not even one thread fits, all requested entries
+   * are computed from columns of the covariance, which only need a dense vector of size n per thread. These are
+   * solved for one at a time even if a single vector exceeds the budget.
    */
   class MarginalCovarianceCholesky {
     protected:
       /**
-       * hash struct for storing the matrix elements needed to compute the covariance
+       * one element of the covariance to compute, r and c are after applying the permutation and upper triangular.
+       * out is where the result is written to.
        */
-      typedef std::unordered_map<int, double>     LookupMap;
-    
+      struct RequestedEntry
+      {
+        int r, c;
+        double* out;
+        RequestedEntry(int r_, int c_, double* out_) : r(r_), c(c_), out(out_) {}
+        bool operator<(const RequestedEntry& other) const
+        {
+          return r < other.r || (r == other.r && c < other.c);
+        }
+      };
+
+      //! consecutive columns [first, last] of L sharing the pattern below them
+      struct Supernode
+      {
+        int first, last;
+        int parent;                 ///< index of the supernode containing the first row below the supernode, -1 for a root
+        std::vector<int> children;
+      };
+
     public:
       MarginalCovarianceCholesky();
       ~MarginalCovarianceCholesky();
@@ -58,6 +87,13 @@ namespace sparse_block_matrix {
        */
       void computeCovariance(SparseBlockMatrix<MatrixXd>& spinv, const std::vector<int>& rowBlockIndices, const std::vector< std::pair<int, int> >& blockIndices);
 
+      /**
+       * compute the marginal cov for the given block indices and write the result into the blocks of spinv,
+       * which have to be allocated already. The block structure of spinv is only read. Repeated block indices
+       * are computed once.
+       */
+      void computeCovarianceBlocks(SparseBlockMatrix<MatrixXd>& spinv, const std::vector< std::pair<int, int> >& blockIndices);
+
 
       /**
        * set the CCS representation of the cholesky factor along with the inverse permutation used to reduce the fill-in.
@@ -65,6 +101,19 @@ namespace sparse_block_matrix {
        */
       void setCholeskyFactor(int n, int* Lp, int* Li, double* Lx, int* permInv);
 
+      //! number of threads used to compute independent supernodes and columns
+      int numThreads() const { return _numThreads;}
+      void setNumThreads(int numThreads);
+
+      //! memory budget in bytes for the selected inverse and the per thread workspaces, 0 means unbounded
+      size_t memoryBudget() const { return _memoryBudget;}
+      void setMemoryBudget(size_t memoryBudget) { _memoryBudget = memoryBudget;}
+
+      //! number of requested entries of the last computation which were read from the selected inverse
+      size_t numSelectedInverseEntries() const { return _numSelectedInverseEntries;}
+      //! number of columns of the covariance solved for by the last computation
+      size_t numSolvedColumns() const { return _numSolvedColumns;}
+
     protected:
       // information about the cholesky factor (lower triangle)
       int _n;           ///< L is an n X n matrix
@@ -73,16 +122,26 @@ namespace sparse_block_matrix {
       double* _Ax;      ///< values of the cholesky factor
       int* _perm;       ///< permutation of the cholesky factor. Variable re-ordering for better fill-in
 
-      LookupMap _map;             ///< hash look up table for the already computed entries
       std::vector<double> _diag;  ///< cache 1 / H_ii to avoid recalculations
-
-      //! compute the index used for hashing
-      int computeIndex(int r, int c) const { /*assert(r <= c);*/ return r*_n + c;}
-      /**
-       * compute one entry in the covariance, r and c are values after applying the permutation, and upper triangular.
-       * May issue recursive calls to itself to compute the missing values.
-       */
-      double computeEntry(int r, int c);
+      int _numThreads;            ///< number of threads computing independent supernodes or columns
+      size_t _memoryBudget;       ///< memory budget in bytes
+      size_t _numSelectedInverseEntries;
+      size_t _numSolvedColumns;
+
+      //! compute all requested entries, writing the results to their output locations
+      void computeEntries(std::vector<RequestedEntry>& entries);
+      //! find the fundamental supernodes of L and their elimination tree
+      void computeSupernodes(std::vector<Supernode>& supernodes) const;
+      //! bytes of the workspaces of one thread computing the selected inverse
+      size_t supernodeWorkspaceBytes(const std::vector<Supernode>& supernodes) const;
+      //! compute the covariance in the pattern of L, stored like the values of L
+      void computeSelectedInverse(const std::vector<Supernode>& supernodes, size_t numThreads, std::vector<double>& Z) const;
+      //! compute the entries of the selected inverse in the columns of one supernode
+      void computeSupernode(const Supernode& supernode, std::vector<double>& Z, std::vector<int>& localIndex, std::vector<double>& work) const;
+      //! compute column c of the covariance down to row minRow (all rows >= minRow are valid in x afterwards)
+      void solveColumn(int c, int minRow, std::vector<double>& x) const;
+      //! add the entries of the block at (rowBase, colBase) to entries, writing the results to block
+      void addBlock(std::vector<RequestedEntry>& entries, int rowBase, int colBase, MatrixXd& block) const;
   };
 
 }
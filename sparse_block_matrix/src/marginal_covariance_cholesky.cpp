@@ -16,24 +16,54 @@
 
 #include <sparse_block_matrix/marginal_covariance_cholesky.h>
 
+#include <Eigen/Dense>
+
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 using namespace std;
 
 namespace sparse_block_matrix {
 
-struct MatrixElem
+namespace {
+
+//! run work(threadIndex) on numThreads threads, rethrowing the first exception
+template <typename Work>
+void runThreads(size_t numThreads, Work work)
 {
-  int r, c;
-  MatrixElem(int r_, int c_) : r(r_), c(c_) {}
-  bool operator<(const MatrixElem& other) const
-  {
-    return c > other.c || (c == other.c && r > other.r);
+  if (numThreads <= 1) {
+    work();
+    return;
   }
-};
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.push_back(std::thread([&]() {
+      try {
+        work();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (! error)
+          error = std::current_exception();
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+}
 
 MarginalCovarianceCholesky::MarginalCovarianceCholesky() :
-  _n(0), _Ap(0), _Ai(0), _Ax(0), _perm(0)
+  _n(0), _Ap(0), _Ai(0), _Ax(0), _perm(0), _numThreads(1), _memoryBudget(0),
+  _numSelectedInverseEntries(0), _numSolvedColumns(0)
 {
 }
 
@@ -58,6 +88,11 @@ void MarginalCovarianceCholesky::setCholeskyFactor(int n, int* Lp, int* Li, doub
   }
 }
 
+void MarginalCovarianceCholesky::setNumThreads(int numThreads)
+{
+  _numThreads = std::max(1, numThreads);
+}
+
 // void MarginalCovarianceCholesky::computeCovariance(const std::vector<OptimizableGraph::Vertex*>& vertices)
 // {
 //   int maxDimension = -1;
@@ -118,67 +153,268 @@ void MarginalCovarianceCholesky::setCholeskyFactor(int n, int* Lp, int* Li, doub
 // #endif
 // }
 
-double MarginalCovarianceCholesky::computeEntry(int r, int c)
+void MarginalCovarianceCholesky::computeSupernodes(std::vector<Supernode>& supernodes) const
+{
+  // Column j + 1 continues the supernode of column j if the pattern of j below the diagonal is j + 1 followed
+  // by the pattern of j + 1. As the pattern of L is closed under elimination, it is enough to find j + 1 in
+  // column j and compare the counts.
+  supernodes.clear();
+  std::vector<int> supernodeOfColumn(_n);
+  for (int j = 0; j < _n; ++j) {
+    bool continues = false;
+    if (j > 0 && _Ap[j] - _Ap[j-1] == _Ap[j+1] - _Ap[j] + 1) {
+      for (int k = _Ap[j-1] + 1; k < _Ap[j] && ! continues; ++k)
+        continues = _Ai[k] == j;
+    }
+    if (continues) {
+      supernodes.back().last = j;
+    } else {
+      Supernode supernode;
+      supernode.first = supernode.last = j;
+      supernode.parent = -1;
+      supernodes.push_back(supernode);
+    }
+    supernodeOfColumn[j] = supernodes.size() - 1;
+  }
+  for (size_t s = 0; s < supernodes.size(); ++s) {
+    const int l = supernodes[s].last;
+    int firstBelow = _n;
+    for (int k = _Ap[l] + 1; k < _Ap[l+1]; ++k)
+      firstBelow = std::min(firstBelow, _Ai[k]);
+    if (firstBelow < _n) {
+      supernodes[s].parent = supernodeOfColumn[firstBelow];
+      supernodes[supernodes[s].parent].children.push_back(s);
+    }
+  }
+}
+
+void MarginalCovarianceCholesky::computeSupernode(const Supernode& supernode, std::vector<double>& Z, std::vector<int>& localIndex, std::vector<double>& work) const
 {
-  assert(r <= c);
-  int idx = computeIndex(r, c);
+  // With L = [L_SS; L_PS] the columns S of the supernode and P the rows below it, Z L = L^-T gives
+  //   Z_PS = -Z_PP L_PS L_SS^-1
+  //   Z_SS = L_SS^-T L_SS^-1 - Z_PS^T L_PS L_SS^-1
+  // Z_PP lies in the pattern of the ancestors of the supernode, which are done.
+  const int f = supernode.first;
+  const int l = supernode.last;
+  const int ns = l - f + 1;
+  std::vector<int> P;
+  for (int k = _Ap[l] + 1; k < _Ap[l+1]; ++k)
+    P.push_back(_Ai[k]);
+  const int np = P.size();
+  for (int i = 0; i < ns; ++i)
+    localIndex[f + i] = i;
+  for (int i = 0; i < np; ++i)
+    localIndex[P[i]] = ns + i;
 
-  LookupMap::const_iterator foundIt = _map.find(idx);
-  if (foundIt != _map.end()) {
-    return foundIt->second;
+  MatrixXd Lss = MatrixXd::Zero(ns, ns);
+  MatrixXd Lps(np, ns);
+  for (int k = f; k <= l; ++k) {
+    for (int j = _Ap[k]; j < _Ap[k+1]; ++j) {
+      const int li = localIndex[_Ai[j]];
+      assert(li >= 0 && "The column does not belong to the supernode");
+      if (li < ns)
+        Lss(li, k - f) = _Ax[j];
+      else
+        Lps(li - ns, k - f) = _Ax[j];
+    }
   }
 
-  // compute the summation over column r
-  double s = 0.;
-  const int& sc = _Ap[r];
-  const int& ec = _Ap[r+1];
-  for (int j = sc+1; j < ec; ++j) { // sum over row r while skipping the element on the diagonal
-    const int& rr = _Ai[j];
-    double val = rr < c ? computeEntry(rr, c) : computeEntry(c, rr);
-    s += val * _Ax[j];
+  MatrixXd Zpp(np, np);
+  for (int b = 0; b < np; ++b) {
+    const int pb = P[b];
+    for (int j = _Ap[pb]; j < _Ap[pb+1]; ++j)
+      work[_Ai[j]] = Z[j];
+    for (int a = 0; a < np; ++a) {
+      if (P[a] >= pb) {
+        Zpp(a, b) = work[P[a]];
+        Zpp(b, a) = work[P[a]];
+      }
+    }
   }
 
-  double result;
-  if (r == c) {
-    const double& diagElem = _diag[r];
-    result = diagElem * (diagElem - s);
-  } else {
-    result = -s * _diag[r];
+  const MatrixXd Y = Lss.triangularView<Eigen::Lower>().solve(MatrixXd::Identity(ns, ns));
+  const MatrixXd X = Lps * Y;
+  const MatrixXd Zps = -Zpp * X;
+  const MatrixXd Zss = Y.transpose() * Y - X.transpose() * Zps;
+
+  for (int k = f; k <= l; ++k) {
+    for (int j = _Ap[k]; j < _Ap[k+1]; ++j) {
+      const int li = localIndex[_Ai[j]];
+      Z[j] = li < ns ? Zss(li, k - f) : Zps(li - ns, k - f);
+    }
   }
-  _map[idx] = result;
-  return result;
+  for (int i = f; i <= l; ++i)
+    localIndex[i] = -1;
+  for (int i = 0; i < np; ++i)
+    localIndex[P[i]] = -1;
 }
 
-void MarginalCovarianceCholesky::computeCovariance(double** covBlocks, const std::vector<int>& blockIndices)
+size_t MarginalCovarianceCholesky::supernodeWorkspaceBytes(const std::vector<Supernode>& supernodes) const
 {
-  _map.clear();
-  int base = 0;
-  vector<MatrixElem> elemsToCompute;
-  for (size_t i = 0; i < blockIndices.size(); ++i) {
-    int nbase = blockIndices[i];
-    int vdim = nbase - base;
-    for (int rr = 0; rr < vdim; ++rr)
-      for (int cc = rr; cc < vdim; ++cc) {
-        int r = _perm ? _perm[rr + base] : rr + base; // apply permutation
-        int c = _perm ? _perm[cc + base] : cc + base;
-        if (r > c) // make sure it's still upper triangular after applying the permutation
-          swap(r, c);
-        elemsToCompute.push_back(MatrixElem(r, c));
+  // localIndex and work, and the dense blocks of computeSupernode() for the largest supernode
+  size_t maxBlockBytes = 0;
+  for (const Supernode& supernode : supernodes) {
+    const size_t ns = supernode.last - supernode.first + 1;
+    const size_t np = _Ap[supernode.last + 1] - _Ap[supernode.last] - 1;
+    maxBlockBytes = std::max(maxBlockBytes, np * sizeof(int) + (np * np + 3 * np * ns + 3 * ns * ns) * sizeof(double));
+  }
+  return _n * (sizeof(int) + sizeof(double)) + maxBlockBytes;
+}
+
+void MarginalCovarianceCholesky::computeSelectedInverse(const std::vector<Supernode>& supernodes, size_t numThreads, std::vector<double>& Z) const
+{
+  Z.resize(_Ap[_n]);
+
+  // A supernode is ready as soon as its parent is done. Start at the roots of the elimination tree.
+  std::vector<int> ready;
+  for (size_t s = 0; s < supernodes.size(); ++s) {
+    if (supernodes[s].parent < 0)
+      ready.push_back(s);
+  }
+  size_t numDone = 0;
+  bool failed = false;
+  std::mutex mutex;
+  std::condition_variable readyChanged;
+  runThreads(numThreads, [&]() {
+    std::vector<int> localIndex(_n, -1);
+    std::vector<double> work(_n);
+    while (true) {
+      int s;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        readyChanged.wait(lock, [&]() { return ! ready.empty() || numDone == supernodes.size() || failed; });
+        if (ready.empty() || failed)
+          return;
+        s = ready.back();
+        ready.pop_back();
       }
-    base = nbase;
+      try {
+        computeSupernode(supernodes[s], Z, localIndex, work);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+        readyChanged.notify_all();
+        throw;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++numDone;
+        ready.insert(ready.end(), supernodes[s].children.begin(), supernodes[s].children.end());
+      }
+      readyChanged.notify_all();
+    }
+  });
+}
+
+void MarginalCovarianceCholesky::solveColumn(int c, int minRow, std::vector<double>& x) const
+{
+  // x = L^-T L^-1 e_c. L^-1 e_c is nonzero on the ancestors of c only.
+  std::fill(x.begin(), x.end(), 0.0);
+  x[c] = 1.0;
+  for (int j = c; j < _n; ++j) {
+    if (x[j] == 0.0)
+      continue;
+    x[j] *= _diag[j];
+    for (int k = _Ap[j] + 1; k < _Ap[j+1]; ++k)
+      x[_Ai[k]] -= _Ax[k] * x[j];
   }
+  for (int j = _n - 1; j >= minRow; --j) {
+    double s = x[j];
+    for (int k = _Ap[j] + 1; k < _Ap[j+1]; ++k)
+      s -= _Ax[k] * x[_Ai[k]];
+    x[j] = s * _diag[j];
+  }
+}
 
-  // sort the elems to reduce the recursive calls
-  sort(elemsToCompute.begin(), elemsToCompute.end());
+void MarginalCovarianceCholesky::computeEntries(std::vector<RequestedEntry>& entries)
+{
+  _numSelectedInverseEntries = 0;
+  _numSolvedColumns = 0;
+  if (entries.empty())
+    return;
+
+  // Read the entries in the pattern of L from the selected inverse, if it and the workspaces of at least
+  // one thread fit into the budget. The selected inverse comes with the positions of the entries of one row.
+  std::vector<RequestedEntry> remaining;
+  std::vector<Supernode> supernodes;
+  computeSupernodes(supernodes);
+  const size_t selectedInverseBytes = _Ap[_n] * sizeof(double) + _n * sizeof(int);
+  const size_t threadBytes = supernodeWorkspaceBytes(supernodes);
+  if (_memoryBudget == 0 || selectedInverseBytes + threadBytes <= _memoryBudget) {
+    size_t numThreads = std::min<size_t>(_numThreads, supernodes.size());
+    if (_memoryBudget != 0)
+      numThreads = std::max<size_t>(1, std::min<size_t>(numThreads, (_memoryBudget - selectedInverseBytes) / threadBytes));
+    std::vector<double> Z;
+    computeSelectedInverse(supernodes, numThreads, Z);
+    sort(entries.begin(), entries.end());
+    std::vector<int> position(_n, -1);
+    for (size_t i = 0; i < entries.size(); ) {
+      const int r = entries[i].r;
+      for (int k = _Ap[r]; k < _Ap[r+1]; ++k)
+        position[_Ai[k]] = k;
+      for (; i < entries.size() && entries[i].r == r; ++i) {
+        const int k = position[entries[i].c];
+        if (k >= 0) {
+          *entries[i].out = Z[k];
+          ++_numSelectedInverseEntries;
+        } else {
+          remaining.push_back(entries[i]);
+        }
+      }
+      for (int k = _Ap[r]; k < _Ap[r+1]; ++k)
+        position[_Ai[k]] = -1;
+    }
+  } else {
+    remaining.swap(entries);
+  }
+  if (remaining.empty())
+    return;
 
-  // compute the inverse elements we need
-  for (size_t i = 0; i < elemsToCompute.size(); ++i) {
-    const MatrixElem& me = elemsToCompute[i];
-    computeEntry(me.r, me.c);
+  // Solve for one column of the covariance per group of remaining entries
+  sort(remaining.begin(), remaining.end(), [](const RequestedEntry& a, const RequestedEntry& b) { return a.c < b.c || (a.c == b.c && a.r < b.r); });
+  std::vector<std::pair<size_t, size_t> > columns;
+  for (size_t i = 0; i < remaining.size(); ) {
+    size_t end = i;
+    while (end < remaining.size() && remaining[end].c == remaining[i].c)
+      ++end;
+    columns.push_back(std::make_pair(i, end));
+    i = end;
   }
+  _numSolvedColumns = columns.size();
+  size_t numThreads = std::min<size_t>(_numThreads, columns.size());
+  if (_memoryBudget != 0)
+    numThreads = std::max<size_t>(1, std::min<size_t>(numThreads, _memoryBudget / (_n * sizeof(double))));
+  std::atomic<size_t> nextColumn(0);
+  runThreads(numThreads, [&]() {
+    std::vector<double> x(_n);
+    for (size_t g = nextColumn++; g < columns.size(); g = nextColumn++) {
+      const RequestedEntry* first = &remaining[columns[g].first];
+      const RequestedEntry* last = &remaining[columns[g].second - 1];
+      solveColumn(first->c, first->r, x);
+      for (const RequestedEntry* e = first; e <= last; ++e)
+        *e->out = x[e->r];
+    }
+  });
+}
 
-  // set the marginal covariance for the vertices, by writing to the blocks memory
-  base = 0;
+void MarginalCovarianceCholesky::addBlock(std::vector<RequestedEntry>& entries, int rowBase, int colBase, MatrixXd& block) const
+{
+  for (int iRow=0; iRow<block.rows(); iRow++)
+    for (int iCol=0; iCol<block.cols(); iCol++){
+      int rr=rowBase+iRow;
+      int cc=colBase+iCol;
+      int r = _perm ? _perm[rr] : rr; // apply permutation
+      int c = _perm ? _perm[cc] : cc;
+      if (r > c)
+        swap(r, c);
+      entries.push_back(RequestedEntry(r, c, &block(iRow, iCol)));
+    }
+}
+
+void MarginalCovarianceCholesky::computeCovariance(double** covBlocks, const std::vector<int>& blockIndices)
+{
+  std::vector<RequestedEntry> entries;
+  int base = 0;
   for (size_t i = 0; i < blockIndices.size(); ++i) {
     int nbase = blockIndices[i];
     int vdim = nbase - base;
@@ -187,17 +423,15 @@ void MarginalCovarianceCholesky::computeCovariance(double** covBlocks, const std
       for (int cc = rr; cc < vdim; ++cc) {
         int r = _perm ? _perm[rr + base] : rr + base; // apply permutation
         int c = _perm ? _perm[cc + base] : cc + base;
-        if (r > c) // upper triangle
+        if (r > c) // make sure it's still upper triangular after applying the permutation
           swap(r, c);
-        int idx = computeIndex(r, c);
-        LookupMap::const_iterator foundIt = _map.find(idx);
-        assert(foundIt != _map.end());
-        cov[rr*vdim + cc] = foundIt->second;
+        entries.push_back(RequestedEntry(r, c, &cov[rr*vdim + cc]));
         if (rr != cc)
-          cov[cc*vdim + rr] = foundIt->second;
+          entries.push_back(RequestedEntry(r, c, &cov[cc*vdim + rr]));
       }
     base = nbase;
   }
+  computeEntries(entries);
 }
 
 
@@ -208,65 +442,31 @@ void MarginalCovarianceCholesky::computeCovariance(double** covBlocks, const std
 				      &rowBlockIndices[0], 
 				      rowBlockIndices.size(),
 				      rowBlockIndices.size(), true);
-  _map.clear();
-  vector<MatrixElem> elemsToCompute;
   for (size_t i = 0; i < blockIndices.size(); ++i) {
-    int blockRow=blockIndices[i].first;    
-    int blockCol=blockIndices[i].second;
-    assert (blockRow>=0);
-    assert (blockRow < (int)rowBlockIndices.size());
-    assert (blockCol>=0);
-    assert (blockCol < (int)rowBlockIndices.size());
-
-    int rowBase=spinv.rowBaseOfBlock(blockRow);
-    int colBase=spinv.colBaseOfBlock(blockCol);
-    
-    MatrixXd *block=spinv.block(blockRow, blockCol, true);
-    assert(block);
-    for (int iRow=0; iRow<block->rows(); iRow++)
-      for (int iCol=0; iCol<block->cols(); iCol++){
-	int rr=rowBase+iRow;
-	int cc=colBase+iCol;
-        int r = _perm ? _perm[rr] : rr; // apply permutation
-        int c = _perm ? _perm[cc] : cc;
-        if (r > c)
-          swap(r, c);
-        elemsToCompute.push_back(MatrixElem(r, c));
-      }
-  }
-
-  // sort the elems to reduce the number of recursive calls
-  sort(elemsToCompute.begin(), elemsToCompute.end());
-
-  // compute the inverse elements we need
-  for (size_t i = 0; i < elemsToCompute.size(); ++i) {
-    const MatrixElem& me = elemsToCompute[i];
-    computeEntry(me.r, me.c);
+    assert (blockIndices[i].first >= 0);
+    assert (blockIndices[i].first < (int)rowBlockIndices.size());
+    assert (blockIndices[i].second >= 0);
+    assert (blockIndices[i].second < (int)rowBlockIndices.size());
+    spinv.block(blockIndices[i].first, blockIndices[i].second, true);
   }
+  computeCovarianceBlocks(spinv, blockIndices);
+}
 
-  // set the marginal covariance 
-  for (size_t i = 0; i < blockIndices.size(); ++i) {
-    int blockRow=blockIndices[i].first;    
-    int blockCol=blockIndices[i].second;
-    int rowBase=spinv.rowBaseOfBlock(blockRow);
-    int colBase=spinv.colBaseOfBlock(blockCol);
-    
-    MatrixXd *block=spinv.block(blockRow, blockCol, true);
+void MarginalCovarianceCholesky::computeCovarianceBlocks(SparseBlockMatrix<MatrixXd>& spinv, const std::vector< std::pair<int, int> >& blockIndices)
+{
+  // Repeated blocks would be written twice
+  std::vector< std::pair<int, int> > uniqueBlockIndices(blockIndices);
+  sort(uniqueBlockIndices.begin(), uniqueBlockIndices.end());
+  uniqueBlockIndices.erase(unique(uniqueBlockIndices.begin(), uniqueBlockIndices.end()), uniqueBlockIndices.end());
+  std::vector<RequestedEntry> entries;
+  for (size_t i = 0; i < uniqueBlockIndices.size(); ++i) {
+    int blockRow=uniqueBlockIndices[i].first;    
+    int blockCol=uniqueBlockIndices[i].second;
+    MatrixXd *block=spinv.block(blockRow, blockCol);
     assert(block);
-    for (int iRow=0; iRow<block->rows(); iRow++)
-      for (int iCol=0; iCol<block->cols(); iCol++){
-	int rr=rowBase+iRow;
-	int cc=colBase+iCol;
-        int r = _perm ? _perm[rr] : rr; // apply permutation
-        int c = _perm ? _perm[cc] : cc;
-        if (r > c)
-          swap(r, c);
-        int idx = computeIndex(r, c);
-        LookupMap::const_iterator foundIt = _map.find(idx);
-        assert(foundIt != _map.end());
-	(*block)(iRow, iCol) = foundIt->second;
-      }
+    addBlock(entries, spinv.rowBaseOfBlock(blockRow), spinv.colBaseOfBlock(blockCol), *block);
   }
+  computeEntries(entries);
 }
 
 } // end namespace
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <sm/eigen/gtest.hpp>
+#include <sparse_block_matrix/marginal_covariance_cholesky.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+using namespace sparse_block_matrix;
+
+namespace {
+
+// Builds a block tridiagonal SPD matrix with numBlocks blocks of size blockSize plus a few random couplings.
+Eigen::MatrixXd buildBlockSpdMatrix(int numBlocks, int blockSize)
+{
+  srand(7);
+  const int n = numBlocks * blockSize;
+  Eigen::MatrixXd J = Eigen::MatrixXd::Zero(2 * n, n);
+  for (int b = 0; b < numBlocks; ++b) {
+    const int other = (b + 1 + rand() % (numBlocks - 1)) % numBlocks;
+    J.block(2 * b * blockSize, b * blockSize, 2 * blockSize, blockSize).setRandom();
+    J.block(2 * b * blockSize, other * blockSize, 2 * blockSize, blockSize).setRandom();
+  }
+  return J.transpose() * J + Eigen::MatrixXd::Identity(n, n);
+}
+
+}
+
+TEST(MarginalCovarianceCholeskyTestSuite, testBlocksMatchDenseInverse)
+{
+  const int numBlocks = 12;
+  const int blockSize = 3;
+  const int n = numBlocks * blockSize;
+  const Eigen::MatrixXd H = buildBlockSpdMatrix(numBlocks, blockSize);
+  const Eigen::MatrixXd P = H.inverse();
+
+  const Eigen::SparseMatrix<double> Hs = H.sparseView();
+  Eigen::SimplicialLLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::AMDOrdering<int> > llt(Hs);
+  ASSERT_EQ(Eigen::Success, llt.info());
+  Eigen::SparseMatrix<double> L = llt.matrixL();
+  L.makeCompressed();
+  Eigen::VectorXi permInv = llt.permutationP().indices();
+
+  std::vector<int> rowBlockIndices;
+  for (int i = 1; i <= numBlocks; ++i)
+    rowBlockIndices.push_back(i * blockSize);
+  std::vector<std::pair<int, int> > blockIndices;
+  for (int r = 0; r < numBlocks; ++r)
+    for (int c = r; c < numBlocks; ++c)
+      blockIndices.push_back(std::make_pair(r, c));
+
+  // no budget, a budget too small for the selected inverse, a budget for the selected inverse without
+  // the workspaces to compute it; single and multi threaded
+  const size_t budgets[] = { 0, 64, L.nonZeros() * sizeof(double) };
+  const int threads[] = { 1, 4 };
+  for (size_t b = 0; b < 3; ++b) {
+    for (size_t t = 0; t < 2; ++t) {
+      MarginalCovarianceCholesky mcc;
+      mcc.setNumThreads(threads[t]);
+      mcc.setMemoryBudget(budgets[b]);
+      mcc.setCholeskyFactor(n, L.outerIndexPtr(), L.innerIndexPtr(), L.valuePtr(), permInv.data());
+
+      SparseBlockMatrix<Eigen::MatrixXd> spinv;
+      mcc.computeCovariance(spinv, rowBlockIndices, blockIndices);
+      for (size_t i = 0; i < blockIndices.size(); ++i) {
+        const int r = blockIndices[i].first;
+        const int c = blockIndices[i].second;
+        ASSERT_TRUE(spinv.block(r, c) != NULL);
+        sm::eigen::assertNear(*spinv.block(r, c), P.block(r * blockSize, c * blockSize, blockSize, blockSize), 1e-10, SM_SOURCE_FILE_POS, "Covariance block mismatch");
+      }
+
+      std::vector<Eigen::MatrixXd> marginals(numBlocks, Eigen::MatrixXd(blockSize, blockSize));
+      std::vector<double*> marginalPtrs;
+      for (int i = 0; i < numBlocks; ++i)
+        marginalPtrs.push_back(marginals[i].data());
+      mcc.computeCovariance(&marginalPtrs[0], rowBlockIndices);
+      for (int i = 0; i < numBlocks; ++i)
+        sm::eigen::assertNear(marginals[i], P.block(i * blockSize, i * blockSize, blockSize, blockSize), 1e-10, SM_SOURCE_FILE_POS, "Marginal covariance mismatch");
+      // The diagonal blocks are in the pattern of L
+      if (budgets[b] == 0) {
+        EXPECT_EQ((size_t)(numBlocks * blockSize * blockSize), mcc.numSelectedInverseEntries());
+        EXPECT_EQ(0u, mcc.numSolvedColumns());
+      } else {
+        EXPECT_EQ(0u, mcc.numSelectedInverseEntries());
+        EXPECT_GT(mcc.numSolvedColumns(), 0u);
+      }
+    }
+  }
+}
+
+TEST(MarginalCovarianceCholeskyTestSuite, testRepeatedBlocksAndManyThreads)
+{
+  const int numBlocks = 150;
+  const int blockSize = 4;
+  const int n = numBlocks * blockSize;
+  const Eigen::MatrixXd H = buildBlockSpdMatrix(numBlocks, blockSize);
+  const Eigen::MatrixXd P = H.inverse();
+
+  const Eigen::SparseMatrix<double> Hs = H.sparseView();
+  Eigen::SimplicialLLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::AMDOrdering<int> > llt(Hs);
+  ASSERT_EQ(Eigen::Success, llt.info());
+  Eigen::SparseMatrix<double> L = llt.matrixL();
+  L.makeCompressed();
+  Eigen::VectorXi permInv = llt.permutationP().indices();
+
+  std::vector<int> rowBlockIndices;
+  for (int i = 1; i <= numBlocks; ++i)
+    rowBlockIndices.push_back(i * blockSize);
+  // Every block twice and some blocks far from the diagonal
+  std::vector<std::pair<int, int> > blockIndices;
+  for (int k = 0; k < 2; ++k) {
+    for (int r = 0; r < numBlocks; ++r) {
+      blockIndices.push_back(std::make_pair(r, r));
+      blockIndices.push_back(std::make_pair(r, (r * 7 + 3) % numBlocks));
+    }
+  }
+
+  MarginalCovarianceCholesky mcc;
+  mcc.setNumThreads(8);
+  mcc.setCholeskyFactor(n, L.outerIndexPtr(), L.innerIndexPtr(), L.valuePtr(), permInv.data());
+  SparseBlockMatrix<Eigen::MatrixXd> spinv;
+  mcc.computeCovariance(spinv, rowBlockIndices, blockIndices);
+  for (size_t i = 0; i < blockIndices.size(); ++i) {
+    const int r = blockIndices[i].first;
+    const int c = blockIndices[i].second;
+    ASSERT_TRUE(spinv.block(r, c) != NULL);
+    sm::eigen::assertNear(*spinv.block(r, c), P.block(r * blockSize, c * blockSize, blockSize, blockSize), 1e-10, SM_SOURCE_FILE_POS, "Covariance block mismatch");
+  }
+  EXPECT_GT(mcc.numSelectedInverseEntries(), 0u);
+}
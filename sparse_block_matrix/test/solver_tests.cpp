@@ -126,3 +126,36 @@ TEST(g2oTestSuite, testCholmod)
 
 
 }
+
+// Refreshing the values must notice when the matrix consists of other blocks or has a new structure
+TEST(g2oTestSuite, testCholmodValueRefresh)
+{
+  typedef sparse_block_matrix::LinearSolverCholmod<Eigen::MatrixXd> Solver;
+  int rows[] = {3,6,11};
+  int cols[] = {3,6,11};
+  Solver solver;
+  ASSERT_TRUE(solver.init());
+  Eigen::VectorXd bb(11), xx(11);
+  bb.setRandom();
+
+  sparse_block_matrix::SparseBlockMatrix<Eigen::MatrixXd> A(rows,cols,3,3);
+  Eigen::MatrixXd Adense = Eigen::MatrixXd::Zero(11,11);
+  randomSparseBlockMatrix<Solver>(&A, Adense);
+  ASSERT_TRUE(solver.solve(A,&xx[0],&bb[0]));
+  sm::eigen::assertNear(Adense.selfadjointView<Eigen::Upper>().ldlt().solve(bb),xx,1e-10,SM_SOURCE_FILE_POS, "first solution");
+
+  // Same structure, other blocks
+  sparse_block_matrix::SparseBlockMatrix<Eigen::MatrixXd> B(rows,cols,3,3);
+  Eigen::MatrixXd Bdense = Eigen::MatrixXd::Zero(11,11);
+  randomSparseBlockMatrix<Solver>(&B, Bdense);
+  ASSERT_TRUE(solver.solve(B,&xx[0],&bb[0]));
+  sm::eigen::assertNear(Bdense.selfadjointView<Eigen::Upper>().ldlt().solve(bb),xx,1e-10,SM_SOURCE_FILE_POS, "solution with other blocks");
+
+  // Additional off-diagonal block
+  Eigen::MatrixXd* e = B.block(0,1,true);
+  e->setRandom();
+  *e *= 0.1;
+  Bdense.block(0,3,3,3) = *e;
+  ASSERT_TRUE(solver.solve(B,&xx[0],&bb[0]));
+  sm::eigen::assertNear(Bdense.selfadjointView<Eigen::Upper>().ldlt().solve(bb),xx,1e-10,SM_SOURCE_FILE_POS, "solution with a new structure");
+}